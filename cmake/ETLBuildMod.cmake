@@ -45,6 +45,11 @@ if(NOT ANDROID)
 			target_include_directories(qagame PUBLIC ${SQLITE3_INCLUDE_DIR})
 		endif()
 
+		# database worker thread (g_db.c)
+		if(NOT WIN32)
+			target_link_libraries(qagame pthread)
+		endif()
+
 		FILE(GLOB LUASQL_SRC
 			"src/luasql/luasql.c"
 			"src/luasql/luasql.h"
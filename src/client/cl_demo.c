@@ -49,7 +49,9 @@
 #endif
 
 #define MEGABYTES(x) x / 1024.0 / 1024.0
-#define MAX_REWIND_BACKUPS 20
+#define MAX_REWIND_BACKUPS 200
+#define DEMO_KEYFRAME_INTERVAL 16   ///< every n-th seek point restarts the delta chain
+#define DEMO_INDEX_MIN_JUMP 10000   ///< shorter forward seeks read the messages instead of using the demo file index
 
 #define NEW_DEMOFUNC 1
 
@@ -80,20 +82,54 @@ typedef struct
 	int firstNonDeltaMessageNumWritten;
 } demoInfo_t;
 
+/**
+ * @struct demoSeekPoint_t
+ * @brief A place in the demo playback can be restored to
+ *
+ * The client state is kept as the runs of bytes which changed since the
+ * previous point, or since zero on keyframes. The parse entity ring changes
+ * almost completely between points, so it is delta coded against the
+ * entity baselines like the network does instead.
+ */
 typedef struct
 {
 	qboolean valid;
+	qboolean keyframe;
 	int seekPoint;
-	clientActive_t cl;
-	clientConnection_t clc;
-	clientStatic_t cls;
 	int numSnaps;
-} rewindBackups_t;
+	int serverTime;             ///< cl.snap.serverTime at the point
+	byte *state;                ///< changed runs of cl, clc and cls
+	int stateSize;
+	byte *entities;             ///< parse entity ring
+	int entitiesSize;
+} demoSeekPoint_t;
+
+/**
+ * @struct demoSeekIndex_t
+ */
+typedef struct
+{
+	demoSeekPoint_t *points;
+	int lastIndex;              ///< point whose state is in last, -1 if none
+	byte *last;                 ///< client state of the last captured point, without the parse entities
+	byte *work;
+	byte *buffer;               ///< encoding scratch
+	int numKeyframes;
+	size_t stateBytes;
+	size_t entityBytes;
+} demoSeekIndex_t;
+
+// cl, clc and cls back to back, rounded up to whole words for the diff
+#define DEMO_STATE_SIZE     (PAD(sizeof(clientActive_t) + sizeof(clientConnection_t) + sizeof(clientStatic_t), sizeof(int)))
+#define DEMO_ENTITIES_SIZE  (MAX_PARSE_ENTITIES * sizeof(entityState_t) * 2)
+#define DEMO_BUFFER_SIZE    (MAX(DEMO_STATE_SIZE + 2 * sizeof(int), DEMO_ENTITIES_SIZE))
 
 cvar_t *cl_maxRewindBackups;
+cvar_t *cl_demoIndex;
 
 demoInfo_t      di;
-rewindBackups_t *rewindBackups   = NULL;
+demoSeekIndex_t demoIndex        = { NULL, -1, NULL, NULL, NULL, 0, 0, 0 };
+demoIndex_t     *demoFileIndex   = NULL; ///< the .idx file of the demo, see demo_index.c
 int             maxRewindBackups = 0;
 #endif
 
@@ -461,6 +497,274 @@ static void CL_DemoFastForward(double wantedTime)
 	di.firstNonDeltaMessageNumWritten = -1;
 }
 
+/**
+ * @brief Encodes the words of cur which differ from base
+ * @param[in] base NULL to encode against zero
+ * @param[in] cur
+ * @param[in] size multiple of sizeof(int)
+ * @param[out] out runs of (offset, length, bytes), at most size + 2 ints long
+ * @return Size of the encoded runs
+ */
+static int CL_DemoIndexDiff(const byte *base, const byte *cur, int size, byte *out)
+{
+	const int *b    = (const int *)base;
+	const int *c    = (const int *)cur;
+	int       words = size / (int)sizeof(int);
+	int       i     = 0, start, end, run[2];
+	byte      *o    = out;
+
+	while (i < words)
+	{
+		if (b ? b[i] == c[i] : !c[i])
+		{
+			i++;
+			continue;
+		}
+
+		// extend the run over gaps shorter than a run header
+		start = i;
+		end   = i + 1;
+		for (i = end; i < words; i++)
+		{
+			if (b ? b[i] != c[i] : c[i] != 0)
+			{
+				end = i + 1;
+			}
+			else if (i - end >= 2)
+			{
+				break;
+			}
+		}
+
+		run[0] = start * (int)sizeof(int);
+		run[1] = (end - start) * (int)sizeof(int);
+		Com_Memcpy(o, run, sizeof(run));
+		Com_Memcpy(o + sizeof(run), cur + run[0], run[1]);
+		o += sizeof(run) + run[1];
+		i  = end;
+	}
+
+	return (int)(o - out);
+}
+
+/**
+ * @brief Applies runs encoded by CL_DemoIndexDiff
+ * @param[in,out] state
+ * @param[in] runs
+ * @param[in] size
+ */
+static void CL_DemoIndexPatch(byte *state, const byte *runs, int size)
+{
+	const byte *end = runs + size;
+	int        run[2];
+
+	while (runs < end)
+	{
+		Com_Memcpy(run, runs, sizeof(run));
+		Com_Memcpy(state + run[0], runs + sizeof(run), run[1]);
+		runs += sizeof(run) + run[1];
+	}
+}
+
+/**
+ * @brief Copies the client state into a seek index buffer, leaving out the parse entities
+ * @param[out] state
+ */
+static void CL_DemoIndexCopyState(byte *state)
+{
+	Com_Memcpy(state, &cl, sizeof(cl));
+	Com_Memcpy(state + sizeof(cl), &clc, sizeof(clc));
+	Com_Memcpy(state + sizeof(cl) + sizeof(clc), &cls, sizeof(cls));
+	Com_Memset(state + offsetof(clientActive_t, parseEntities), 0, sizeof(cl.parseEntities));
+}
+
+/**
+ * @brief Records the current playback state as a seek point
+ * @param[in] index
+ */
+static void CL_DemoIndexCapture(int index)
+{
+	demoSeekPoint_t *sp = &demoIndex.points[index];
+	msg_t           msg;
+	byte            *swap;
+	int             i, first, size;
+
+	// the delta chain needs the state of the point right before
+	sp->keyframe = (qboolean)(!(index % DEMO_KEYFRAME_INTERVAL) || demoIndex.lastIndex != index - 1);
+
+	CL_DemoIndexCopyState(demoIndex.work);
+	size = CL_DemoIndexDiff(sp->keyframe ? NULL : demoIndex.last, demoIndex.work, DEMO_STATE_SIZE, demoIndex.buffer);
+
+	swap                = demoIndex.last;
+	demoIndex.last      = demoIndex.work;
+	demoIndex.work      = swap;
+	demoIndex.lastIndex = -1;
+
+	sp->state = (byte *)Com_Allocate(size);
+	if (!sp->state)
+	{
+		return;
+	}
+	Com_Memcpy(sp->state, demoIndex.buffer, size);
+	sp->stateSize = size;
+
+	// the whole ring in parse order, deltas against the baselines
+	first = MAX(cl.parseEntitiesNum - MAX_PARSE_ENTITIES, 0);
+
+	MSG_Init(&msg, demoIndex.buffer, DEMO_ENTITIES_SIZE);
+	for (i = first; i < cl.parseEntitiesNum && !msg.overflowed; i++)
+	{
+		entityState_t *es = &cl.parseEntities[i & (MAX_PARSE_ENTITIES - 1)];
+
+		MSG_WriteDeltaEntity(&msg, &cl.entityBaselines[es->number], es, qtrue);
+	}
+
+	if (msg.overflowed || !(sp->entities = (byte *)Com_Allocate(MAX(msg.cursize, 1))))
+	{
+		Com_Dealloc(sp->state);
+		sp->state = NULL;
+		return;
+	}
+	Com_Memcpy(sp->entities, msg.data, msg.cursize);
+	sp->entitiesSize = msg.cursize;
+
+	sp->valid      = qtrue;
+	sp->numSnaps   = di.numSnaps;
+	sp->seekPoint  = FS_FTell(clc.demo.file);
+	sp->serverTime = cl.snap.serverTime;
+
+	demoIndex.lastIndex    = index;
+	demoIndex.numKeyframes += sp->keyframe;
+	demoIndex.stateBytes  += sp->stateSize;
+	demoIndex.entityBytes += sp->entitiesSize;
+}
+
+/**
+ * @brief Puts the playback state back to a seek point
+ * @param[in] index
+ */
+static void CL_DemoIndexRestore(int index)
+{
+	demoSeekPoint_t *sp = &demoIndex.points[index];
+	msg_t           msg;
+	int             i, k, number;
+
+	// replay the delta chain from its keyframe
+	for (k = index; !demoIndex.points[k].keyframe; k--)
+		;
+
+	Com_Memset(demoIndex.work, 0, DEMO_STATE_SIZE);
+	for ( ; k <= index; k++)
+	{
+		CL_DemoIndexPatch(demoIndex.work, demoIndex.points[k].state, demoIndex.points[k].stateSize);
+	}
+
+	Com_Memcpy(&cl, demoIndex.work, sizeof(cl));
+	Com_Memcpy(&clc, demoIndex.work + sizeof(cl), sizeof(clc));
+	Com_Memcpy(&cls, demoIndex.work + sizeof(cl) + sizeof(clc), sizeof(cls));
+
+	MSG_Init(&msg, sp->entities, sp->entitiesSize);
+	msg.cursize = sp->entitiesSize;
+	MSG_BeginReading(&msg);
+
+	for (i = MAX(cl.parseEntitiesNum - MAX_PARSE_ENTITIES, 0); i < cl.parseEntitiesNum; i++)
+	{
+		number = MSG_ReadBits(&msg, GENTITYNUM_BITS);
+		MSG_ReadDeltaEntity(&msg, &cl.entityBaselines[number], &cl.parseEntities[i & (MAX_PARSE_ENTITIES - 1)], number);
+	}
+}
+
+/**
+ * @brief Moves playback to the last point of the demo file index a second before wantedTime
+ * @param[in] wantedTime
+ * @param[in] minTime the point has to be past this to be worth it
+ * @return qtrue if playback was moved
+ *
+ * @note Only cl and clc are set up, the cgame catches up with the
+ * configstrings like it does after a rewind.
+ */
+static qboolean CL_DemoFileIndexSeek(double wantedTime, double minTime)
+{
+	static demoIndexSnapshot_t snapshots[PACKET_BACKUP];
+	static gameState_t         gameState;
+	demoIndexPoint_t           *point;
+	demoIndexSnapshot_t        *in;
+	clSnapshot_t               *snap;
+	entityState_t              *entities;
+	int                        index, numSnapshots, i, j;
+
+	if (!demoFileIndex || !IS_DEFAULT_MOD)
+	{
+		return qfalse;
+	}
+
+	index = Com_FindDemoIndexPoint(demoFileIndex, (int)(wantedTime - 1000.0), FS_FTell(clc.demo.file));
+	if (index < 0 || (double)demoFileIndex->points[index].serverTime <= minTime)
+	{
+		return qfalse;
+	}
+	point = &demoFileIndex->points[index];
+
+	entities = (entityState_t *)Com_Allocate(sizeof(entityState_t) * MAX_PARSE_ENTITIES);
+	if (!entities)
+	{
+		return qfalse;
+	}
+
+	if (!Com_ReadDemoIndexPoint(demoFileIndex, index, cl.entityBaselines, &gameState, snapshots, &numSnapshots, entities, MAX_PARSE_ENTITIES))
+	{
+		Com_FuncPrinf("demo index point %i is damaged\n", index);
+		Com_Dealloc(entities);
+		return qfalse;
+	}
+
+	DEMODEBUG("seeking to file index point %d %d   cl.serverTime:%d  cl.snap.serverTime:%d\n", index, point->offset, cl.serverTime, cl.snap.serverTime);
+
+	Com_Memset(cl.snapshots, 0, sizeof(cl.snapshots));
+	for (i = 0; i < numSnapshots; i++)
+	{
+		in   = &snapshots[i];
+		snap = &cl.snapshots[in->messageNum & PACKET_MASK];
+
+		snap->valid            = qtrue;
+		snap->snapFlags        = in->snapFlags;
+		snap->serverTime       = in->serverTime;
+		snap->messageNum       = in->messageNum;
+		snap->deltaNum         = -1;
+		snap->ping             = 999;
+		snap->serverCommandNum = in->serverCommandNum;
+		snap->ps               = in->ps;
+		snap->numEntities      = in->numEntities;
+		snap->parseEntitiesNum = cl.parseEntitiesNum;
+		Com_Memcpy(snap->areamask, in->areamask, sizeof(snap->areamask));
+
+		for (j = 0; j < in->numEntities; j++)
+		{
+			cl.parseEntities[cl.parseEntitiesNum++ & (MAX_PARSE_ENTITIES - 1)] = entities[in->firstEntity + j];
+		}
+	}
+	Com_Dealloc(entities);
+
+	cl.snap               = cl.snapshots[snapshots[numSnapshots - 1].messageNum & PACKET_MASK];
+	cl.newSnapshots       = qtrue;
+	cl.gameState          = gameState;
+	cl.oldFrameServerTime = cl.snap.serverTime;
+	cl.oldServerTime      = cl.snap.serverTime;
+
+	clc.serverMessageSequence     = cl.snap.messageNum;
+	clc.serverCommandSequence     = point->serverCommandSequence;
+	clc.lastExecutedServerCommand = point->serverCommandSequence;
+
+	(void) FS_Seek(clc.demo.file, point->offset, FS_SEEK_SET);
+
+	// keep the seek points captured from here on in their slots
+	di.numSnaps  = point->numMessages;
+	di.snapCount = MIN(point->numMessages / MAX(di.snapsInDemo / maxRewindBackups, 1) + 1, maxRewindBackups);
+	di.Overf     = 0;
+
+	return qtrue;
+}
+
 /**
  * @brief CL_RewindDemo
  * @param[in] wantedTime
@@ -468,7 +772,7 @@ static void CL_DemoFastForward(double wantedTime)
 static void CL_RewindDemo(double wantedTime)
 {
 	int             i;
-	rewindBackups_t *rb;
+	demoSeekPoint_t *sp;
 
 	if (!IS_DEFAULT_MOD)
 	{
@@ -481,42 +785,46 @@ static void CL_RewindDemo(double wantedTime)
 		wantedTime = di.firstServerTime;
 	}
 
-	if (!rewindBackups[0].valid || di.snapCount == 0)
+	sp = NULL;
+	if (demoIndex.points[0].valid && di.snapCount != 0)
 	{
-		CL_DemoFastForward(wantedTime);
-		return;
+		for (i = di.snapCount - 1; i >= 0; i--)
+		{
+			sp = &demoIndex.points[i];
+			// go back a second before wanted time in order to have snapshot backups available for screen matching
+			if (sp->valid && (double)sp->serverTime < wantedTime - 1000.0)
+			{
+				break;
+			}
+		}
+		if (sp == NULL || i < 0)
+		{
+			sp = &demoIndex.points[0];
+			i  = 0;
+		}
 	}
 
-	rb = NULL;
-	for (i = di.snapCount - 1; i >= 0; i--)
+	// the file index may have a point closer than the ones passed so far
+	if (CL_DemoFileIndexSeek(wantedTime, sp ? (double)sp->serverTime : -1.0))
 	{
-		rb = &rewindBackups[i];
-		// go back a second before wanted time in order to have snapshot backups available for screen matching
-		if ((double)rb->cl.snap.serverTime < wantedTime - 1000.0)
-		{
-			break;
-		}
+		CL_DemoFastForward(wantedTime);
+		return;
 	}
-	if (rb == NULL || i < 0)
+
+	if (!sp)
 	{
-		if (rb == NULL)
-		{
-			Com_FuncPrinf("FIXME rewind couldn't find valid snap  rb:%p  i:%d  rb serverTime %d   wanted %f\n", (void *)rb, i, rewindBackups[0].cl.snap.serverTime, wantedTime);
-		}
-		rb = &rewindBackups[0];
-		i  = 0;
+		CL_DemoFastForward(wantedTime);
+		return;
 	}
 
-	DEMODEBUG("seeking to index %d %d   cl.serverTime:%d  cl.snap.serverTime:%d, new clc.lastExecutedServercommand %d  clc.serverCommandSequence %d\n", i, rb->seekPoint, cl.serverTime, cl.snap.serverTime, rb->clc.lastExecutedServerCommand, rb->clc.serverCommandSequence);
-	(void) FS_Seek(clc.demo.file, rb->seekPoint, FS_SEEK_SET);
+	DEMODEBUG("seeking to index %d %d   cl.serverTime:%d  cl.snap.serverTime:%d\n", i, sp->seekPoint, cl.serverTime, cl.snap.serverTime);
+	(void) FS_Seek(clc.demo.file, sp->seekPoint, FS_SEEK_SET);
 
 	// TODO: take a look at these hacks
-	di.numSnaps  = rb->numSnaps;
+	di.numSnaps  = sp->numSnaps;
 	di.snapCount = i + 1;
 
-	Com_Memcpy(&cl, &rb->cl, sizeof(clientActive_t));
-	Com_Memcpy(&clc, &rb->clc, sizeof(clientConnection_t));
-	Com_Memcpy(&cls, &rb->cls, sizeof(clientStatic_t));
+	CL_DemoIndexRestore(i);
 	di.Overf = 0;
 
 	// TODO: this is a hack to set the state to something valid
@@ -552,6 +860,8 @@ static void CL_DemoSeekMs(double ms, int exactServerTime)  // server time in mil
 
 	if (wantedTime > (double)cl.serverTime + di.Overf)
 	{
+		// far ahead start from the file index instead of reading every message up to there
+		CL_DemoFileIndexSeek(wantedTime, (double)cl.snap.serverTime + DEMO_INDEX_MIN_JUMP);
 		CL_DemoFastForward(wantedTime);
 	}
 	else
@@ -681,8 +991,12 @@ static void CL_ParseDemoSnapShotSimple(msg_t *msg)
 
 /**
  * @brief Do very shallow parse of the demo (could be extended) just to get times and snapshot count
+ * @param[in] name path of the demo for its file index, NULL if it has none
+ *
+ * @note With cl_demoIndex 1 the times come from the file index, a .idx file
+ * written next to the demo on its first playback instead of this parse.
  */
-static void CL_ParseDemo(void)
+static void CL_ParseDemo(const char *name)
 {
 	int tstart   = 0;
 	int demofile = 0;
@@ -693,6 +1007,29 @@ static void CL_ParseDemo(void)
 	// Parse start
 	di.gameStartTime = -1;
 	di.gameEndTime   = -1;
+
+	if (name && cl_demoIndex->integer)
+	{
+		demoFileIndex = Com_LoadDemoIndex(name);
+		if (!demoFileIndex && Com_WriteDemoIndex(name))
+		{
+			demoFileIndex = Com_LoadDemoIndex(name);
+		}
+
+		if (demoFileIndex)
+		{
+			di.firstServerTime = demoFileIndex->firstServerTime;
+			di.lastServerTime  = demoFileIndex->lastServerTime;
+			di.snapsInDemo     = demoFileIndex->snapsInDemo;
+
+			Com_FuncPrinf("Snaps in demo: %i, %i seek points\n", di.snapsInDemo, demoFileIndex->numPoints);
+
+			dpi.firstTime = di.firstServerTime;
+			dpi.lastTime  = di.lastServerTime;
+			return;
+		}
+	}
+
 	(void) FS_Seek(clc.demo.file, 0, FS_SEEK_SET);
 	tstart = Sys_Milliseconds();
 
@@ -889,11 +1226,42 @@ static void CL_ParseDemo(void)
  */
 void CL_FreeDemoPoints(void)
 {
-	if (rewindBackups)
+	int i;
+
+	if (demoIndex.points)
+	{
+		for (i = 0; i < maxRewindBackups; i++)
+		{
+			if (demoIndex.points[i].state)
+			{
+				Com_Dealloc(demoIndex.points[i].state);
+			}
+			if (demoIndex.points[i].entities)
+			{
+				Com_Dealloc(demoIndex.points[i].entities);
+			}
+		}
+		Com_Dealloc(demoIndex.points);
+	}
+
+	if (demoIndex.last)
+	{
+		Com_Dealloc(demoIndex.last);
+	}
+	if (demoIndex.work)
+	{
+		Com_Dealloc(demoIndex.work);
+	}
+	if (demoIndex.buffer)
 	{
-		Com_Dealloc(rewindBackups);
-		rewindBackups = NULL;
+		Com_Dealloc(demoIndex.buffer);
 	}
+
+	Com_Memset(&demoIndex, 0, sizeof(demoIndex));
+	demoIndex.lastIndex = -1;
+
+	Com_FreeDemoIndex(demoFileIndex);
+	demoFileIndex = NULL;
 }
 
 /**
@@ -909,13 +1277,41 @@ void CL_AllocateDemoPoints(void)
 		maxRewindBackups = MAX_REWIND_BACKUPS;
 	}
 
-	rewindBackups = (rewindBackups_t *)Com_Allocate(sizeof(rewindBackups_t) * maxRewindBackups);
-	if (!rewindBackups)
+	demoIndex.points = (demoSeekPoint_t *)Com_Allocate(sizeof(demoSeekPoint_t) * maxRewindBackups);
+	demoIndex.last   = (byte *)Com_Allocate(DEMO_STATE_SIZE);
+	demoIndex.work   = (byte *)Com_Allocate(DEMO_STATE_SIZE);
+	demoIndex.buffer = (byte *)Com_Allocate(DEMO_BUFFER_SIZE);
+	if (!demoIndex.points || !demoIndex.last || !demoIndex.work || !demoIndex.buffer)
 	{
-		Com_FuncError("couldn't allocate %.2f MB for rewind backups\n", MEGABYTES(sizeof(rewindBackups_t) * maxRewindBackups));
+		Com_FuncError("couldn't allocate %.2f MB for the demo seek index\n", MEGABYTES(2 * DEMO_STATE_SIZE + DEMO_BUFFER_SIZE));
+	}
+	Com_Memset(demoIndex.points, 0, sizeof(demoSeekPoint_t) * maxRewindBackups);
+	// the padding past cls stays zero
+	Com_Memset(demoIndex.last, 0, DEMO_STATE_SIZE);
+	Com_Memset(demoIndex.work, 0, DEMO_STATE_SIZE);
+	demoIndex.lastIndex = -1;
+}
+
+/**
+ * @brief Prints the size of the demo seek index
+ */
+static void CL_DemoIndexInfo(void)
+{
+	int i, numPoints = 0;
+
+	for (i = 0; i < maxRewindBackups; i++)
+	{
+		numPoints += demoIndex.points[i].valid;
+	}
+
+	Com_Printf("seek index: %i/%i points, %i keyframes, %.2f MB state, %.2f MB entities, %.2f MB buffers\n",
+	           numPoints, maxRewindBackups, demoIndex.numKeyframes, MEGABYTES(demoIndex.stateBytes),
+	           MEGABYTES(demoIndex.entityBytes), MEGABYTES(2 * DEMO_STATE_SIZE + DEMO_BUFFER_SIZE));
+
+	if (demoFileIndex)
+	{
+		Com_Printf("file index: %i points\n", demoFileIndex->numPoints);
 	}
-	Com_FuncPrinf("allocated %.2f MB for rewind backups\n", MEGABYTES(sizeof(rewindBackups_t) * maxRewindBackups));
-	Com_Memset(rewindBackups, 0, sizeof(rewindBackups_t) * maxRewindBackups);
 }
 
 #endif
@@ -933,18 +1329,15 @@ CLIENT SIDE DEMO RECORDING
  */
 void CL_WriteDemoMessage(msg_t *msg, int headerBytes)
 {
-	int len, swlen;
+	int len, head[2];
 
 	// write the packet sequence
-	len   = clc.serverMessageSequence;
-	swlen = LittleLong(len);
-	(void) FS_Write(&swlen, 4, clc.demo.file);
+	head[0] = LittleLong(clc.serverMessageSequence);
 
 	// skip the packet sequencing information
-	len   = msg->cursize - headerBytes;
-	swlen = LittleLong(len);
-	(void) FS_Write(&swlen, 4, clc.demo.file);
-	(void) FS_Write(msg->data + headerBytes, len, clc.demo.file);
+	len     = msg->cursize - headerBytes;
+	head[1] = LittleLong(len);
+	Com_DemoWriterWrite(clc.demo.writer, head, sizeof(head), msg->data + headerBytes, len);
 }
 
 /**
@@ -952,7 +1345,7 @@ void CL_WriteDemoMessage(msg_t *msg, int headerBytes)
  */
 void CL_StopRecord_f(void)
 {
-	int len;
+	int head[2];
 
 	if (!clc.demo.recording)
 	{
@@ -961,9 +1354,10 @@ void CL_StopRecord_f(void)
 	}
 
 	// finish up
-	len = -1;
-	(void) FS_Write(&len, 4, clc.demo.file);
-	(void) FS_Write(&len, 4, clc.demo.file);
+	head[0] = head[1] = -1;
+	Com_DemoWriterWrite(clc.demo.writer, head, sizeof(head), NULL, 0);
+	Com_DestroyDemoWriter(clc.demo.writer);
+	clc.demo.writer = NULL;
 	FS_FCloseFile(clc.demo.file);
 	clc.demo.file = 0;
 
@@ -1057,7 +1451,7 @@ void CL_Record(const char *name)
 	entityState_t *ent;
 	entityState_t nullstate;
 	char          *s;
-	int           len;
+	int           head[2];
 
 	// open the demo file
 	Com_FuncPrinf("Recording to %s.\n", name);
@@ -1067,6 +1461,7 @@ void CL_Record(const char *name)
 		Com_FuncPrinf("ERROR: couldn't open.\n");
 		return;
 	}
+	clc.demo.writer = Com_CreateDemoWriter(clc.demo.file);
 
 	clc.demo.recording = qtrue;
 	Cvar_Set("cl_demorecording", "1");    // fretn
@@ -1126,12 +1521,9 @@ void CL_Record(const char *name)
 	MSG_WriteByte(&buf, svc_EOF);
 
 	// write it to the demo file
-	len = LittleLong(clc.serverMessageSequence - 1);
-	(void) FS_Write(&len, 4, clc.demo.file);
-
-	len = LittleLong(buf.cursize);
-	(void) FS_Write(&len, 4, clc.demo.file);
-	(void) FS_Write(buf.data, buf.cursize, clc.demo.file);
+	head[0] = LittleLong(clc.serverMessageSequence - 1);
+	head[1] = LittleLong(buf.cursize);
+	Com_DemoWriterWrite(clc.demo.writer, head, sizeof(head), buf.data, buf.cursize);
 
 	// the rest of the demo file will be copied from net messages
 }
@@ -1294,10 +1686,8 @@ void CL_ReadDemoMessage(void)
 
 	if (di.snapCount < maxRewindBackups &&
 	    ((!di.gotFirstSnap  &&  !(cls.state >= CA_CONNECTED && cls.state < CA_PRIMED))
-	     || (di.gotFirstSnap  &&  di.numSnaps % (di.snapsInDemo / maxRewindBackups) == 0)))
+	     || (di.gotFirstSnap  &&  di.numSnaps % MAX(di.snapsInDemo / maxRewindBackups, 1) == 0)))
 	{
-		rewindBackups_t *rb;
-
 		if (!di.skipSnap)
 		{
 			// first snap triggers loading screen when rewinding
@@ -1306,17 +1696,10 @@ void CL_ReadDemoMessage(void)
 		}
 
 		di.gotFirstSnap = qtrue;
-		rb              = &rewindBackups[di.snapCount];
 
-		if (!rb->valid)
+		if (!demoIndex.points[di.snapCount].valid)
 		{
-			rb->valid     = qtrue;
-			rb->numSnaps  = di.numSnaps;
-			rb->seekPoint = FS_FTell(clc.demo.file);
-
-			Com_Memcpy(&rb->cl, &cl, sizeof(clientActive_t));
-			Com_Memcpy(&rb->clc, &clc, sizeof(clientConnection_t));
-			Com_Memcpy(&rb->cls, &cls, sizeof(clientStatic_t));
+			CL_DemoIndexCapture(di.snapCount);
 		}
 		di.snapCount++;
 	}
@@ -1393,7 +1776,7 @@ static void CL_CompleteDemoName(char *args, int argNum)
 void CL_PlayDemo_f(void)
 {
 	char name[MAX_OSPATH], retry[MAX_OSPATH];
-	char *demoFile, *ext_test;
+	char *demoFile, *ext_test, *indexName = name;
 	int  protocol, i;
 
 	if (Cmd_Argc() < 2)
@@ -1432,6 +1815,7 @@ void CL_PlayDemo_f(void)
 			{
 				char *nameOnly = strrchr(demoFile, '/');
 				FS_FOpenFileReadFullDir(demoFile, &clc.demo.file);
+				indexName = NULL;
 
 				if (nameOnly)
 				{
@@ -1476,7 +1860,7 @@ void CL_PlayDemo_f(void)
 
 #if NEW_DEMOFUNC
 	CL_AllocateDemoPoints();
-	CL_ParseDemo();
+	CL_ParseDemo(indexName);
 #endif
 
 	if (Cmd_Argc() == 3)
@@ -1775,6 +2159,71 @@ void CL_SeekPrev_f(void)
 
 	CL_DemoSeekMs(0, clSnap->serverTime);
 }
+
+/**
+ * @brief Times seeks to random places of the playing demo
+ *
+ * @note Usage: demo_seekbench [seeks]. The first seek goes to the end to
+ * fill the seek index, the rest are spread over the whole demo.
+ */
+static void CL_DemoSeekBench_f(void)
+{
+	int    i, count, seed, t, dt, minTime = 0, maxTime = 0, totalTime = 0, done = 0, fillTime;
+	double startTime, target;
+
+	if (!clc.demo.playing || !demoIndex.points)
+	{
+		Com_FuncPrinf("not playing demo can't seek\n");
+		return;
+	}
+
+	count = (Cmd_Argc() > 1) ? Q_atoi(Cmd_Argv(1)) : 50;
+	if (count < 1)
+	{
+		Com_FuncPrinf("usage:  demo_seekbench [seeks]\n");
+		return;
+	}
+
+	startTime = (double)cl.serverTime + di.Overf;
+	seed      = 0x5eec;
+
+	t = Sys_Milliseconds();
+	CL_DemoSeekMs(0, di.lastServerTime - 1000);
+	fillTime = Sys_Milliseconds() - t;
+
+	for (i = 0; i < count && clc.demo.playing; i++)
+	{
+		target = di.firstServerTime + (double)Q_random(&seed) * (di.lastServerTime - 1000 - di.firstServerTime);
+
+		t = Sys_Milliseconds();
+		CL_DemoSeekMs(target, -1);
+		dt = Sys_Milliseconds() - t;
+
+		if (!done || dt < minTime)
+		{
+			minTime = dt;
+		}
+		if (dt > maxTime)
+		{
+			maxTime = dt;
+		}
+		totalTime += dt;
+		done++;
+	}
+
+	if (!clc.demo.playing)
+	{
+		Com_FuncPrinf("demo ended during the benchmark\n");
+		return;
+	}
+
+	CL_DemoSeekMs(startTime, -1);
+
+	Com_Printf("%i seeks over %.1f minutes of demo: min %i, avg %.1f, max %i msec, %i msec to index the demo\n",
+	           done, (di.lastServerTime - di.firstServerTime) / 1000.0 / 60.0, minTime,
+	           done ? (double)totalTime / done : 0.0, maxTime, fillTime);
+	CL_DemoIndexInfo();
+}
 #endif
 
 /**
@@ -1831,8 +2280,10 @@ void CL_DemoInit(void)
 	Cmd_AddCommand("seekend", CL_SeekEnd_f);
 	Cmd_AddCommand("seeknext", CL_SeekNext_f);
 	Cmd_AddCommand("seekprev", CL_SeekPrev_f);
+	Cmd_AddCommand("demo_seekbench", CL_DemoSeekBench_f);
 
 	cl_maxRewindBackups = Cvar_Get("cl_maxRewindBackups", va("%i", MAX_REWIND_BACKUPS), CVAR_ARCHIVE_ND | CVAR_LATCH);
+	cl_demoIndex        = Cvar_Get("cl_demoIndex", "0", CVAR_ARCHIVE_ND);
 #endif
 }
 
@@ -1854,5 +2305,6 @@ void CL_DemoShutdown(void)
 	Cmd_RemoveCommand("seekend");
 	Cmd_RemoveCommand("seeknext");
 	Cmd_RemoveCommand("seekprev");
+	Cmd_RemoveCommand("demo_seekbench");
 #endif
 }
@@ -314,7 +314,7 @@ void SCR_DrawDemoRecording(void)
 		return;
 	}
 
-	Cvar_Set("cl_demooffset", va("%d", FS_FTell(clc.demo.file)));
+	Cvar_Set("cl_demooffset", va("%d", Com_DemoWriterOffset(clc.demo.writer)));
 }
 
 static int   current;
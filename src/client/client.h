@@ -109,11 +109,6 @@ typedef struct
 	int p_realtime;             ///< cls.realtime when packet was sent
 } outPacket_t;
 
-/// the parseEntities array must be large enough to hold PACKET_BACKUP frames of
-/// entities, so that when a delta compressed message arives from the server
-/// it can be un-deltad from the original
-#define MAX_PARSE_ENTITIES  2048
-
 extern int g_console_field_width;
 
 /**
@@ -204,6 +199,7 @@ typedef struct
 	qboolean waiting;                       ///< don't record until a non-delta message is received
 	qboolean firstFrameSkipped;
 	fileHandle_t file;
+	demoWriter_t *writer;                   ///< queues the messages of the demo being recorded
 
 	int timeFrames;                         ///< counter of rendered frames
 	int timeStart;                          ///< cls.realtime before first frame
@@ -99,6 +99,7 @@ void SP_info_player_deathmatch(gentity_t *ent)
 void SP_info_player_checkpoint(gentity_t *ent)
 {
 	ent->classname = "info_player_checkpoint";
+	G_IndexEntity(ent);
 	SP_info_player_deathmatch(ent);
 }
 
@@ -110,6 +111,7 @@ void SP_info_player_checkpoint(gentity_t *ent)
 void SP_info_player_start(gentity_t *ent)
 {
 	ent->classname = "info_player_deathmatch";
+	G_IndexEntity(ent);
 	SP_info_player_deathmatch(ent);
 }
 
@@ -543,6 +545,7 @@ void CopyToBodyQue(gentity_t *ent)
 
 	body->s.eType   = ET_CORPSE;
 	body->classname = "corpse";
+	G_IndexEntity(body);
 
 	body->s.powerups    = 0; // clear powerups
 	body->s.loopSound   = 0; // clear lava burning
@@ -2982,6 +2985,8 @@ void ClientSpawn(gentity_t *ent, qboolean revived, qboolean teamChange, qboolean
 		ent->props_frame_state = -1;
 	}
 
+	G_IndexEntity(ent);
+
 	ent->die        = player_die;
 	ent->waterlevel = 0;
 	ent->watertype  = 0;
@@ -3406,6 +3411,8 @@ void ClientDisconnect(int clientNum)
 	ent->client->sess.sessionTeam          = TEAM_FREE;
 	ent->active                            = 0;
 
+	G_IndexEntity(ent);
+
 	// this needs to be cleared
 	ent->r.svFlags &= ~SVF_BOT;
 
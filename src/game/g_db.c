@@ -19,13 +19,788 @@
  */
 /**
  * @file g_db.c
- * @brief Database initialization functions
+ * @brief Database initialization functions and the database worker thread
+ *
+ * Once the database is open, level.database.db is only used by the worker
+ * thread. The game queues jobs with G_DB_Queue (asynchronous writes, with an
+ * optional completion callback delivered from G_DB_RunFrame) or G_DB_Run
+ * (reads the game has to wait for). Jobs run in queue order, so a read
+ * always sees the writes queued before it.
  */
 
 #ifdef FEATURE_DBMS
 #include "g_local.h"
 #include <sqlite3.h>
 
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <pthread.h>
+#endif
+
+#define DB_MAX_JOBS         256     ///< size of the job ring, must be a power of two
+#define DB_JOB_DATA_SIZE    256     ///< payload copied along with queued jobs
+#define DB_PRINT_BUFFER     8192    ///< console/log text buffered by the worker
+
+/**
+ * @enum dbJobState_t
+ * @brief
+ */
+typedef enum
+{
+	DB_JOB_FREE = 0,
+	DB_JOB_QUEUED,
+	DB_JOB_DONE
+} dbJobState_t;
+
+/**
+ * @struct dbJob_s
+ * @typedef dbJob_t
+ * @brief
+ */
+typedef struct dbJob_s
+{
+	dbJobFunc_t func;
+	dbDoneFunc_t done;                  ///< called on the game thread, may be NULL
+	void *data;                         ///< buffer for queued jobs, caller data for G_DB_Run
+	int result;
+	dbJobState_t state;
+	byte buffer[DB_JOB_DATA_SIZE];
+} dbJob_t;
+
+/**
+ * @struct dbWorker_s
+ * @typedef dbWorker_t
+ * @brief
+ */
+typedef struct dbWorker_s
+{
+#ifdef _WIN32
+	HANDLE thread;
+	CRITICAL_SECTION lock;
+	CONDITION_VARIABLE work;            ///< signalled when a job is queued
+	CONDITION_VARIABLE done;            ///< signalled when a job has run
+#else
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done;
+#endif
+	qboolean running;
+	qboolean quit;
+
+	dbJob_t jobs[DB_MAX_JOBS];
+	unsigned int head;                  ///< next slot to queue
+	unsigned int next;                  ///< next slot the worker runs
+	unsigned int tail;                  ///< next slot to deliver on the game thread
+
+	int batchDepth;
+
+	char print[DB_PRINT_BUFFER];
+	int printLen;
+	char log[DB_PRINT_BUFFER];
+	int logLen;
+} dbWorker_t;
+
+static dbWorker_t dbWorker;
+
+/**
+ * @struct dbStatementDef_s
+ * @typedef dbStatementDef_t
+ * @brief
+ */
+typedef struct dbStatementDef_s
+{
+	const char *name;
+	const char *sql;
+} dbStatementDef_t;
+
+/**
+ * @var dbStatements
+ * @brief SQL of the prepared statements, indexed by dbStatement_t
+ */
+static const dbStatementDef_t dbStatements[DB_STMT_MAX] =
+{
+	{ "begin",            "BEGIN;" },
+	{ "commit",           "COMMIT;" },
+	{ "xpsave_select",    "SELECT * FROM xpsave_users WHERE guid = ?;" },
+	{ "xpsave_insert",    "INSERT INTO xpsave_users (guid, skills, medals, created, updated) VALUES (?, ?, ?, CURRENT_TIMESTAMP, CURRENT_TIMESTAMP);" },
+	{ "xpsave_update",    "UPDATE xpsave_users SET skills = ?, medals = ?, updated = CURRENT_TIMESTAMP WHERE guid = ?;" },
+	{ "xpsave_delete",    "DELETE FROM xpsave_users;" },
+#ifdef FEATURE_PRESTIGE
+	{ "prestige_select",  "SELECT * FROM prestige_users WHERE guid = ?;" },
+	{ "prestige_insert",  "INSERT INTO prestige_users "
+	                      "(guid, prestige, streak, skill0, skill1, skill2, skill3, skill4, skill5, skill6, created, updated) "
+	                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, CURRENT_TIMESTAMP, CURRENT_TIMESTAMP);" },
+	{ "prestige_update",  "UPDATE prestige_users SET prestige = ?, streak = ?, skill0 = ?, skill1 = ?, skill2 = ?, skill3 = ?, "
+	                      "skill4 = ?, skill5 = ?, skill6 = ?, updated = CURRENT_TIMESTAMP WHERE guid = ?;" },
+#endif
+#ifdef FEATURE_RATING
+	{ "match_delete",     "DELETE FROM rating_match;" },
+	{ "match_select",     "SELECT * FROM rating_match WHERE guid = ?;" },
+	{ "match_insert",     "INSERT INTO rating_match (guid, mu, sigma, time_axis, time_allies) VALUES (?, ?, ?, ?, ?);" },
+	{ "match_update",     "UPDATE rating_match SET mu = ?, sigma = ?, time_axis = ?, time_allies = ? WHERE guid = ?;" },
+	{ "match_table",      "SELECT * FROM rating_match;" },
+	{ "users_select",     "SELECT * FROM rating_users WHERE guid = ?;" },
+	{ "users_insert",     "INSERT INTO rating_users (guid, mu, sigma, created, updated) VALUES (?, ?, ?, CURRENT_TIMESTAMP, CURRENT_TIMESTAMP);" },
+	{ "users_update",     "UPDATE rating_users SET mu = ?, sigma = ?, updated = CURRENT_TIMESTAMP WHERE guid = ?;" },
+	{ "maps_select",      "SELECT * FROM rating_maps WHERE mapname = ?;" },
+	{ "maps_insert",      "INSERT INTO rating_maps (win_axis, win_allies, mapname) VALUES (?, ?, ?);" },
+	{ "maps_update",      "UPDATE rating_maps SET win_axis = win_axis + ?, win_allies = win_allies + ? WHERE mapname = ?;" },
+#endif
+};
+
+/**
+ * @struct dbStatementStats_s
+ * @typedef dbStatementStats_t
+ * @brief
+ */
+typedef struct dbStatementStats_s
+{
+	int executed;
+	int64_t usec;           ///< total time from G_DB_Statement to G_DB_Reset
+	int64_t rows;           ///< rows returned or changed
+} dbStatementStats_t;
+
+static sqlite3_stmt       *dbStatementHandles[DB_STMT_MAX];
+static int64_t            dbStatementStart[DB_STMT_MAX];
+static dbStatementStats_t dbStatementStats[DB_STMT_MAX];    ///< only touched by the database thread
+
+#ifdef _WIN32
+#define DB_Lock()       EnterCriticalSection(&dbWorker.lock)
+#define DB_Unlock()     LeaveCriticalSection(&dbWorker.lock)
+#define DB_Wait(c)      SleepConditionVariableCS(&dbWorker.c, &dbWorker.lock, INFINITE)
+#define DB_Signal(c)    WakeAllConditionVariable(&dbWorker.c)
+#else
+#define DB_Lock()       pthread_mutex_lock(&dbWorker.lock)
+#define DB_Unlock()     pthread_mutex_unlock(&dbWorker.lock)
+#define DB_Wait(c)      pthread_cond_wait(&dbWorker.c, &dbWorker.lock)
+#define DB_Signal(c)    pthread_cond_broadcast(&dbWorker.c)
+#endif
+
+/**
+ * @brief Runs queued jobs until G_DB_StopWorker asks it to quit
+ */
+static void G_DB_WorkerLoop(void)
+{
+	dbJob_t *job;
+
+	DB_Lock();
+
+	while (1)
+	{
+		while (!dbWorker.quit && dbWorker.next == dbWorker.head)
+		{
+			DB_Wait(work);
+		}
+
+		// drain the queue before quitting
+		if (dbWorker.next == dbWorker.head)
+		{
+			break;
+		}
+
+		job = &dbWorker.jobs[dbWorker.next & (DB_MAX_JOBS - 1)];
+
+		DB_Unlock();
+		job->result = job->func(job->data);
+		DB_Lock();
+
+		job->state = DB_JOB_DONE;
+		dbWorker.next++;
+		DB_Signal(done);
+	}
+
+	DB_Unlock();
+}
+
+#ifdef _WIN32
+
+/**
+ * @brief G_DB_WorkerProc
+ * @param arg - unused
+ * @return
+ */
+static DWORD WINAPI G_DB_WorkerProc(LPVOID arg)
+{
+	G_DB_WorkerLoop();
+	return 0;
+}
+
+#else
+
+/**
+ * @brief G_DB_WorkerProc
+ * @param arg - unused
+ * @return
+ */
+static void *G_DB_WorkerProc(void *arg)
+{
+	G_DB_WorkerLoop();
+	return NULL;
+}
+
+#endif
+
+/**
+ * @brief Starts the database worker thread
+ * @return qtrue if the worker is running, jobs run inline on the game thread otherwise.
+ */
+static qboolean G_DB_StartWorker(void)
+{
+	Com_Memset(&dbWorker, 0, sizeof(dbWorker));
+
+#ifdef _WIN32
+	InitializeCriticalSection(&dbWorker.lock);
+	InitializeConditionVariable(&dbWorker.work);
+	InitializeConditionVariable(&dbWorker.done);
+
+	dbWorker.thread = CreateThread(NULL, 0, G_DB_WorkerProc, NULL, 0, NULL);
+
+	if (!dbWorker.thread)
+	{
+		DeleteCriticalSection(&dbWorker.lock);
+		return qfalse;
+	}
+#else
+	pthread_mutex_init(&dbWorker.lock, NULL);
+	pthread_cond_init(&dbWorker.work, NULL);
+	pthread_cond_init(&dbWorker.done, NULL);
+
+	if (pthread_create(&dbWorker.thread, NULL, G_DB_WorkerProc, NULL))
+	{
+		pthread_cond_destroy(&dbWorker.done);
+		pthread_cond_destroy(&dbWorker.work);
+		pthread_mutex_destroy(&dbWorker.lock);
+		return qfalse;
+	}
+#endif
+
+	dbWorker.running = qtrue;
+
+	return qtrue;
+}
+
+/**
+ * @brief Flushes the text buffered by the worker to the console and the log
+ */
+static void G_DB_FlushPrints(void)
+{
+	char print[DB_PRINT_BUFFER];
+	char log[DB_PRINT_BUFFER];
+	char *line, *end;
+
+	DB_Lock();
+	Com_Memcpy(print, dbWorker.print, dbWorker.printLen + 1);
+	Com_Memcpy(log, dbWorker.log, dbWorker.logLen + 1);
+	dbWorker.print[0] = '\0';
+	dbWorker.printLen = 0;
+	dbWorker.log[0]   = '\0';
+	dbWorker.logLen   = 0;
+	DB_Unlock();
+
+	if (print[0])
+	{
+		G_Printf("%s", print);
+	}
+
+	// log lines are written one by one so each gets its own timestamp
+	for (line = log; *line; line = end + 1)
+	{
+		end = strchr(line, '\n');
+
+		if (!end)
+		{
+			G_LogPrintf("%s\n", line);
+			break;
+		}
+
+		*end = '\0';
+		G_LogPrintf("%s\n", line);
+	}
+}
+
+/**
+ * @brief Delivers the completion callbacks of finished jobs in queue order
+ */
+static void G_DB_Deliver(void)
+{
+	dbJob_t *job;
+	dbJob_t done;
+
+	DB_Lock();
+
+	while (dbWorker.tail != dbWorker.next)
+	{
+		job = &dbWorker.jobs[dbWorker.tail & (DB_MAX_JOBS - 1)];
+
+		if (!job->done)
+		{
+			job->state = DB_JOB_FREE;
+			dbWorker.tail++;
+			continue;
+		}
+
+		// the slot is released before the callback so it may queue new jobs
+		Com_Memcpy(&done, job, sizeof(done));
+		job->state = DB_JOB_FREE;
+		dbWorker.tail++;
+
+		DB_Unlock();
+		done.done(done.buffer, done.result);
+		DB_Lock();
+	}
+
+	DB_Unlock();
+
+	G_DB_FlushPrints();
+}
+
+/**
+ * @brief Reserves the next ring slot, waiting for the worker if the queue is full
+ * @return The reserved slot, the lock is held on return
+ */
+static dbJob_t *G_DB_AllocJob(void)
+{
+	DB_Lock();
+
+	while (dbWorker.head - dbWorker.tail >= DB_MAX_JOBS)
+	{
+		if (dbWorker.tail != dbWorker.next)
+		{
+			DB_Unlock();
+			G_DB_Deliver();
+			DB_Lock();
+			continue;
+		}
+
+		DB_Wait(done);
+	}
+
+	return &dbWorker.jobs[dbWorker.head & (DB_MAX_JOBS - 1)];
+}
+
+/**
+ * @brief Waits until the worker has run every queued job
+ */
+static void G_DB_Flush(void)
+{
+	DB_Lock();
+
+	while (dbWorker.next != dbWorker.head)
+	{
+		DB_Wait(done);
+	}
+
+	DB_Unlock();
+}
+
+/**
+ * @brief Runs the remaining jobs and callbacks, then stops the worker thread
+ */
+static void G_DB_StopWorker(void)
+{
+	while (dbWorker.batchDepth > 0)
+	{
+		G_DB_EndBatch();
+	}
+
+	// callbacks may queue more work
+	do
+	{
+		G_DB_Flush();
+		G_DB_Deliver();
+	}
+	while (dbWorker.tail != dbWorker.head);
+
+	DB_Lock();
+	dbWorker.quit = qtrue;
+	DB_Signal(work);
+	DB_Unlock();
+
+#ifdef _WIN32
+	WaitForSingleObject(dbWorker.thread, INFINITE);
+	CloseHandle(dbWorker.thread);
+	DeleteCriticalSection(&dbWorker.lock);
+#else
+	pthread_join(dbWorker.thread, NULL);
+	pthread_cond_destroy(&dbWorker.done);
+	pthread_cond_destroy(&dbWorker.work);
+	pthread_mutex_destroy(&dbWorker.lock);
+#endif
+
+	dbWorker.running = qfalse;
+}
+
+/**
+ * @brief Queues a database job, the data is copied along with the job
+ * @param[in] func runs on the worker thread
+ * @param[in] done called with the job data and result on the game thread, may be NULL
+ * @param[in] data
+ * @param[in] size must not exceed DB_JOB_DATA_SIZE
+ */
+void G_DB_Queue(dbJobFunc_t func, dbDoneFunc_t done, const void *data, int size)
+{
+	dbJob_t *job;
+
+	if (size > DB_JOB_DATA_SIZE)
+	{
+		G_Error("G_DB_Queue: job data too large (%i > %i)\n", size, DB_JOB_DATA_SIZE);
+	}
+
+	if (!dbWorker.running)
+	{
+		byte buffer[DB_JOB_DATA_SIZE];
+		int  result;
+
+		if (size)
+		{
+			Com_Memcpy(buffer, data, size);
+		}
+		result = func(buffer);
+
+		if (done)
+		{
+			done(buffer, result);
+		}
+		return;
+	}
+
+	job = G_DB_AllocJob();
+
+	job->func   = func;
+	job->done   = done;
+	job->data   = job->buffer;
+	job->result = 0;
+	job->state  = DB_JOB_QUEUED;
+	if (size)
+	{
+		Com_Memcpy(job->buffer, data, size);
+	}
+
+	dbWorker.head++;
+	DB_Signal(work);
+	DB_Unlock();
+}
+
+/**
+ * @brief Runs a database job and waits for its result
+ * @details The job runs after every job queued before it, data is used in place.
+ * @param[in] func
+ * @param[in,out] data
+ * @return The result of func
+ */
+int G_DB_Run(dbJobFunc_t func, void *data)
+{
+	dbJob_t *job;
+	int     result;
+
+	if (!dbWorker.running)
+	{
+		return func(data);
+	}
+
+	job = G_DB_AllocJob();
+
+	job->func   = func;
+	job->done   = NULL;
+	job->data   = data;
+	job->result = 0;
+	job->state  = DB_JOB_QUEUED;
+
+	dbWorker.head++;
+	DB_Signal(work);
+
+	// the slot can't be released before we are back, only the game thread delivers
+	while (job->state != DB_JOB_DONE)
+	{
+		DB_Wait(done);
+	}
+
+	result = job->result;
+	DB_Unlock();
+
+	G_DB_FlushPrints();
+
+	return result;
+}
+
+/**
+ * @brief Runs a prepared statement without results
+ * @param[in] data dbStatement_t
+ * @return 0 if successful, 1 otherwise.
+ */
+static int G_DB_ExecJob(void *data)
+{
+	dbStatement_t id = *(dbStatement_t *)data;
+	int           result;
+
+	G_DB_Statement(id);
+	result = G_DB_Step(id);
+	G_DB_Reset(id);
+
+	if (result != SQLITE_DONE)
+	{
+		G_DB_Printf("G_DB_ExecJob: %s failed: %s\n", dbStatements[id].name, sqlite3_errmsg(level.database.db));
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Starts a batch, jobs queued until the matching G_DB_EndBatch share one transaction
+ */
+void G_DB_BeginBatch(void)
+{
+	if (!level.database.initialized)
+	{
+		return;
+	}
+
+	if (dbWorker.batchDepth++ == 0)
+	{
+		dbStatement_t id = DB_STMT_BEGIN;
+
+		G_DB_Queue(G_DB_ExecJob, NULL, &id, sizeof(id));
+	}
+}
+
+/**
+ * @brief Ends a batch started with G_DB_BeginBatch
+ */
+void G_DB_EndBatch(void)
+{
+	if (!level.database.initialized || dbWorker.batchDepth <= 0)
+	{
+		return;
+	}
+
+	if (--dbWorker.batchDepth == 0)
+	{
+		dbStatement_t id = DB_STMT_COMMIT;
+
+		G_DB_Queue(G_DB_ExecJob, NULL, &id, sizeof(id));
+	}
+}
+
+/**
+ * @brief Delivers completion callbacks and worker messages, called every server frame
+ */
+void G_DB_RunFrame(void)
+{
+	if (!dbWorker.running)
+	{
+		return;
+	}
+
+	G_DB_Deliver();
+}
+
+/**
+ * @brief Appends formatted text to a worker print buffer
+ * @param[in,out] buffer
+ * @param[in,out] length
+ * @param[in] text
+ */
+static void G_DB_Append(char *buffer, int *length, const char *text)
+{
+	DB_Lock();
+	Q_strncpyz(buffer + *length, text, DB_PRINT_BUFFER - *length);
+	*length += strlen(buffer + *length);
+	DB_Unlock();
+}
+
+/**
+ * @brief Console print usable from database jobs, printed by the game thread
+ * @param[in] fmt
+ */
+void QDECL G_DB_Printf(const char *fmt, ...)
+{
+	va_list argptr;
+	char    text[1024];
+
+	va_start(argptr, fmt);
+	Q_vsnprintf(text, sizeof(text), fmt, argptr);
+	va_end(argptr);
+
+	if (!dbWorker.running)
+	{
+		G_Printf("%s", text);
+		return;
+	}
+
+	G_DB_Append(dbWorker.print, &dbWorker.printLen, text);
+}
+
+/**
+ * @brief Log print usable from database jobs, logged by the game thread
+ * @param[in] fmt
+ */
+void QDECL G_DB_LogPrintf(const char *fmt, ...)
+{
+	va_list argptr;
+	char    text[1024];
+
+	va_start(argptr, fmt);
+	Q_vsnprintf(text, sizeof(text), fmt, argptr);
+	va_end(argptr);
+
+	if (!dbWorker.running)
+	{
+		G_LogPrintf("%s", text);
+		return;
+	}
+
+	G_DB_Append(dbWorker.log, &dbWorker.logLen, text);
+}
+
+/**
+ * @brief Prepares every statement of dbStatements
+ * @return 0 if successful, 1 otherwise.
+ */
+static int G_DB_PrepareStatements(void)
+{
+	int i, result;
+
+	Com_Memset(dbStatementHandles, 0, sizeof(dbStatementHandles));
+	Com_Memset(dbStatementStats, 0, sizeof(dbStatementStats));
+
+	for (i = 0; i < DB_STMT_MAX; i++)
+	{
+		result = sqlite3_prepare_v2(level.database.db, dbStatements[i].sql, -1, &dbStatementHandles[i], NULL);
+
+		if (result != SQLITE_OK)
+		{
+			G_Printf("G_DB_PrepareStatements: %s failed: %s\n", dbStatements[i].name, sqlite3_errmsg(level.database.db));
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Finalizes the statements prepared by G_DB_PrepareStatements
+ */
+static void G_DB_FinalizeStatements(void)
+{
+	int i;
+
+	for (i = 0; i < DB_STMT_MAX; i++)
+	{
+		if (dbStatementHandles[i])
+		{
+			sqlite3_finalize(dbStatementHandles[i]);
+			dbStatementHandles[i] = NULL;
+		}
+	}
+}
+
+/**
+ * @brief Returns a prepared statement ready for binding, release it with G_DB_Reset
+ * @param[in] id
+ * @return
+ */
+sqlite3_stmt *G_DB_Statement(dbStatement_t id)
+{
+	dbStatementStart[id] = G_Microseconds();
+
+	return dbStatementHandles[id];
+}
+
+/**
+ * @brief Steps a prepared statement and counts the rows it returns or changes
+ * @param[in] id
+ * @return The result of sqlite3_step
+ */
+int G_DB_Step(dbStatement_t id)
+{
+	sqlite3_stmt *stmt = dbStatementHandles[id];
+	int          result;
+
+	result = sqlite3_step(stmt);
+
+	if (result == SQLITE_ROW)
+	{
+		dbStatementStats[id].rows++;
+	}
+	else if (result == SQLITE_DONE && !sqlite3_stmt_readonly(stmt))
+	{
+		dbStatementStats[id].rows += sqlite3_changes(level.database.db);
+	}
+
+	return result;
+}
+
+/**
+ * @brief Resets a prepared statement for the next use and records its execution time
+ * @param[in] id
+ */
+void G_DB_Reset(dbStatement_t id)
+{
+	sqlite3_stmt *stmt = dbStatementHandles[id];
+
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+
+	dbStatementStats[id].executed++;
+	dbStatementStats[id].usec += G_Microseconds() - dbStatementStart[id];
+}
+
+/**
+ * @brief Database job copying the statement counters
+ * @param[out] data dbStatementStats_t[DB_STMT_MAX]
+ * @return 0
+ */
+static int G_DB_StatsJob(void *data)
+{
+	Com_Memcpy(data, dbStatementStats, sizeof(dbStatementStats));
+	return 0;
+}
+
+/**
+ * @brief Prints the prepared statement counters
+ */
+void Svcmd_DBStats_f(void)
+{
+	dbStatementStats_t stats[DB_STMT_MAX];
+	dbStatementStats_t total;
+	int                i;
+
+	if (!level.database.initialized)
+	{
+		G_Printf("Database is not initialized\n");
+		return;
+	}
+
+	G_DB_Run(G_DB_StatsJob, stats);
+
+	Com_Memset(&total, 0, sizeof(total));
+
+	G_Printf("%-16s %10s %10s %10s\n", "statement", "executed", "avg ms", "rows");
+	G_Printf("--------------------------------------------------\n");
+
+	for (i = 0; i < DB_STMT_MAX; i++)
+	{
+		total.executed += stats[i].executed;
+		total.usec     += stats[i].usec;
+		total.rows     += stats[i].rows;
+
+		if (!stats[i].executed)
+		{
+			continue;
+		}
+
+		G_Printf("%-16s %10i %10.3f %10lld\n", dbStatements[i].name, stats[i].executed,
+		         stats[i].usec / 1000.0 / stats[i].executed, (long long)stats[i].rows);
+	}
+
+	G_Printf("--------------------------------------------------\n");
+	G_Printf("%-16s %10i %10.3f %10lld\n", "total", total.executed,
+	         total.executed ? total.usec / 1000.0 / total.executed : 0.0, (long long)total.rows);
+}
+
 /**
  * @brief G_DB_Init
  * @return 0 if database is successfully initialized, 1 otherwise.
@@ -153,9 +928,22 @@ int G_DB_Init()
 		}
 	}
 
+	if (G_DB_PrepareStatements())
+	{
+		G_DB_FinalizeStatements();
+		(void) sqlite3_close(level.database.db);
+		return 1;
+	}
+
 	// initialize db - keep it open until deinit
 	level.database.initialized = 1;
 
+	// from here on the handle belongs to the worker
+	if (!G_DB_StartWorker())
+	{
+		G_Printf("G_DB_Init: failed to start database thread, running queries inline\n");
+	}
+
 	return 0;
 }
 
@@ -173,6 +961,13 @@ int G_DB_DeInit()
 		return 1;
 	}
 
+	if (dbWorker.running)
+	{
+		G_DB_StopWorker();
+	}
+
+	G_DB_FinalizeStatements();
+
 	// close db
 	result = sqlite3_close(level.database.db);
 	if (result != SQLITE_OK)
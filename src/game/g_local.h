@@ -1162,6 +1162,12 @@ typedef struct level_locals_s
 
 	int num_entities;                           ///< current number, <= MAX_GENTITIES - this is an index of highest used entity and grows very quickly to MAX_GENTITIES
 
+	int freeEntities[MAX_GENTITIES];            ///< ring of freed slots waiting out the reuse delay, oldest freetime first
+	int freeEntitiesStart;                      ///< oldest entry of freeEntities
+	int numFreeEntities;
+	int readyEntities[MAX_GENTITIES];           ///< freed slots that can be reused right away
+	int numReadyEntities;
+
 	int warmupTime;                             ///< restart match at this time
 
 	fileHandle_t logFile;
@@ -1505,12 +1511,19 @@ gentity_t *G_FindFloat(gentity_t *from, int fieldofs, float match);
 gentity_t *G_FindVector(gentity_t *from, int fieldofs, const vec3_t match);
 gentity_t *G_FindByTargetname(gentity_t *from, const char *match);
 gentity_t *G_FindByTargetnameFast(gentity_t *from, const char *match, int hash);
+gentity_t *G_FindByClassname(gentity_t *from, const char *match);
+gentity_t *G_FindByScriptName(gentity_t *from, const char *match);
+void G_IndexEntity(gentity_t *ent);
+void G_SyncEntityIndex(void);
+void G_ClearEntityIndex(void);
 gentity_t *G_PickTarget(const char *targetname);
 void G_UseTargets(gentity_t *ent, gentity_t *activator);
 void G_SetMovedir(vec3_t angles, vec3_t movedir);
 
 void G_InitGentity(gentity_t *e);
 gentity_t *G_Spawn(void);
+gentity_t *G_SpawnLinear(void);
+void G_RebuildFreeEntities(void);
 gentity_t *G_TempEntity(vec3_t origin, entity_event_t event);
 gentity_t *G_TempEntityNotLinked(entity_event_t event);
 gentity_t *G_PopupMessage(popupMessageType_t type);
@@ -1518,6 +1531,7 @@ void G_Sound(gentity_t *ent, int soundIndex);
 void G_AnimScriptSound(int soundIndex, vec3_t org, int client);
 void G_FreeEntity(gentity_t *ent);
 int G_EntitiesFree(void);
+int64_t G_Microseconds(void);
 void G_ClientSound(gentity_t *ent, int soundIndex);
 
 void G_TouchTriggers(gentity_t *ent);
@@ -2511,8 +2525,55 @@ void G_spawnPrintf(int print_type, int print_time, gentity_t *owner);
 void G_statsPrint(gentity_t *ent, int nType);
 
 #ifdef FEATURE_DBMS
+typedef int (*dbJobFunc_t)(void *data);                 ///< runs on the database thread
+typedef void (*dbDoneFunc_t)(void *data, int result);   ///< runs on the game thread
+
+/**
+ * @enum dbStatement_t
+ * @brief Statements prepared once by G_DB_Init, see dbStatements in g_db.c
+ */
+typedef enum
+{
+	DB_STMT_BEGIN = 0,
+	DB_STMT_COMMIT,
+	DB_STMT_XPUSERS_SELECT,
+	DB_STMT_XPUSERS_INSERT,
+	DB_STMT_XPUSERS_UPDATE,
+	DB_STMT_XPUSERS_DELETE,
+#ifdef FEATURE_PRESTIGE
+	DB_STMT_PRUSERS_SELECT,
+	DB_STMT_PRUSERS_INSERT,
+	DB_STMT_PRUSERS_UPDATE,
+#endif
+#ifdef FEATURE_RATING
+	DB_STMT_SRMATCH_DELETE,
+	DB_STMT_SRMATCH_SELECT,
+	DB_STMT_SRMATCH_INSERT,
+	DB_STMT_SRMATCH_UPDATE,
+	DB_STMT_SRMATCH_TABLE,
+	DB_STMT_SRUSERS_SELECT,
+	DB_STMT_SRUSERS_INSERT,
+	DB_STMT_SRUSERS_UPDATE,
+	DB_STMT_SRMAPS_SELECT,
+	DB_STMT_SRMAPS_INSERT,
+	DB_STMT_SRMAPS_UPDATE,
+#endif
+	DB_STMT_MAX
+} dbStatement_t;
+
 int G_DB_Init(void);
 int G_DB_DeInit(void);
+void G_DB_Queue(dbJobFunc_t func, dbDoneFunc_t done, const void *data, int size);
+int G_DB_Run(dbJobFunc_t func, void *data);
+void G_DB_BeginBatch(void);
+void G_DB_EndBatch(void);
+void G_DB_RunFrame(void);
+void QDECL G_DB_Printf(const char *fmt, ...) _attribute((format(printf, 1, 2)));
+void QDECL G_DB_LogPrintf(const char *fmt, ...) _attribute((format(printf, 1, 2)));
+sqlite3_stmt *G_DB_Statement(dbStatement_t id);
+int G_DB_Step(dbStatement_t id);
+void G_DB_Reset(dbStatement_t id);
+void Svcmd_DBStats_f(void);
 #endif
 
 #ifdef FEATURE_RATING
@@ -2530,7 +2591,7 @@ void G_UpdateSkillRating(int winner);
 
 typedef struct srData_s
 {
-	const unsigned char *guid;
+	char guid[MAX_GUID_LENGTH + 1];
 	float mu;
 	float sigma;
 	int time_axis;
@@ -2552,7 +2613,7 @@ void G_SkillRatingSetMapRating(char *mapname, int winner);
 // g_prestige.c
 typedef struct prData_s
 {
-	const unsigned char *guid;
+	char guid[MAX_GUID_LENGTH + 1];
 	int prestige;
 	int streak;
 	int skillpoints[SK_NUM_SKILLS];
@@ -25,6 +25,8 @@ extern field_t fields[];
 
 lua_vm_t *lVM[LUA_NUM_VM];
 
+static void G_LuaUpdateHooks(void);
+
 /**
  * @param addr pointer to a gentity (gentity*)
  * @returns the entity number.
@@ -131,7 +133,7 @@ static int _et_IPCSend(lua_State *L)
 	}
 
 	// Find callback
-	if (!G_LuaGetNamedFunction(vm, "et_IPCReceive"))
+	if (!G_LuaGetHook(vm, LUA_HOOK_IPCRECEIVE))
 	{
 		lua_pushinteger(L, 0);
 		return 1;
@@ -149,7 +151,7 @@ static int _et_IPCSend(lua_State *L)
 	lua_pushstring(vm->L, message);
 
 	// Call
-	if (!G_LuaCall(vm, "et.IPCSend", 2, 0))
+	if (!G_LuaCallHook(vm, LUA_HOOK_IPCRECEIVE, 2, 0))
 	{
 		//G_LuaStopVM(vm);
 		lua_pushinteger(L, 0);
@@ -1194,32 +1196,138 @@ static const gentity_field_t gentity_fields[] =
 	{ NULL },
 };
 
-// gentity fields helper functions
-static gentity_field_t *_et_gentity_getfield(gentity_t *ent, char *fieldname)
+// gentity field name index, built by G_LuaInit
+// a name can have an entry in both field tables, client entities prefer gclient_fields
+typedef struct
 {
-	int i;
+	const char *name;
+	const gentity_field_t *client;
+	const gentity_field_t *entity;
+} gentity_fieldname_t;
 
-	// search through client fields first
-	if (ent->client)
+#define LUA_FIELD_HASH_SIZE 1024 // power of two, keep it well above the number of field names
+
+static gentity_fieldname_t gentity_fieldnames[ARRAY_LEN(gclient_fields) + ARRAY_LEN(gentity_fields)];
+static int                 gentity_numfieldnames;
+static int                 gentity_fieldhash[LUA_FIELD_HASH_SIZE]; ///< field handle, 0 for an empty slot
+
+// returns the field handle of fieldname or 0
+static int _et_gentity_fieldhandle(const char *fieldname)
+{
+	int hash = (int)Q_GenerateHashValue(fieldname, LUA_FIELD_HASH_SIZE, qtrue, qtrue);
+
+	while (gentity_fieldhash[hash])
 	{
-		for (i = 0; gclient_fields[i].name; i++)
+		if (Q_stricmp(fieldname, gentity_fieldnames[gentity_fieldhash[hash] - 1].name) == 0)
 		{
-			if (Q_stricmp(fieldname, gclient_fields[i].name) == 0)
+			return gentity_fieldhash[hash];
+		}
+		hash = (hash + 1) & (LUA_FIELD_HASH_SIZE - 1);
+	}
+
+	return 0;
+}
+
+static void _et_gentity_indexfields(const gentity_field_t *fields, qboolean client)
+{
+	gentity_fieldname_t *fieldname;
+	int                 i, handle, hash;
+
+	for (i = 0; fields[i].name; i++)
+	{
+		handle = _et_gentity_fieldhandle(fields[i].name);
+
+		if (!handle)
+		{
+			hash = (int)Q_GenerateHashValue(fields[i].name, LUA_FIELD_HASH_SIZE, qtrue, qtrue);
+			while (gentity_fieldhash[hash])
 			{
-				return (gentity_field_t *)&gclient_fields[i];
+				hash = (hash + 1) & (LUA_FIELD_HASH_SIZE - 1);
 			}
+
+			handle                  = ++gentity_numfieldnames;
+			gentity_fieldhash[hash] = handle;
+
+			gentity_fieldnames[handle - 1].name = fields[i].name;
+		}
+
+		fieldname = &gentity_fieldnames[handle - 1];
+
+		// the first entry wins, as it did for the linear search
+		if (client && !fieldname->client)
+		{
+			fieldname->client = &fields[i];
+		}
+		else if (!client && !fieldname->entity)
+		{
+			fieldname->entity = &fields[i];
 		}
 	}
+}
+
+static void _et_gentity_initfields(void)
+{
+	Com_Memset(gentity_fieldnames, 0, sizeof(gentity_fieldnames));
+	Com_Memset(gentity_fieldhash, 0, sizeof(gentity_fieldhash));
+	gentity_numfieldnames = 0;
 
-	for (i = 0; gentity_fields[i].name; i++)
+	_et_gentity_indexfields(gclient_fields, qtrue);
+	_et_gentity_indexfields(gentity_fields, qfalse);
+}
+
+// gentity fields helper functions
+// the field argument at index is either a field name or a handle from et.gentity_field
+static gentity_field_t *_et_gentity_getfield(lua_State *L, gentity_t *ent, int index, const char **fieldname)
+{
+	const gentity_fieldname_t *field;
+	int                       handle;
+
+	if (lua_type(L, index) == LUA_TNUMBER)
 	{
-		if (Q_stricmp(fieldname, gentity_fields[i].name) == 0)
+		handle = (int)lua_tointeger(L, index);
+		if (handle < 1 || handle > gentity_numfieldnames)
 		{
-			return (gentity_field_t *)&gentity_fields[i];
+			luaL_error(L, "invalid gentity field handle %d", handle);
+			return NULL;
 		}
 	}
+	else
+	{
+		*fieldname = luaL_checkstring(L, index);
 
-	return 0;
+		handle = _et_gentity_fieldhandle(*fieldname);
+		if (!handle)
+		{
+			return NULL;
+		}
+	}
+
+	field      = &gentity_fieldnames[handle - 1];
+	*fieldname = field->name;
+
+	// search through client fields first
+	if (ent->client && field->client)
+	{
+		return (gentity_field_t *)field->client;
+	}
+
+	return (gentity_field_t *)field->entity;
+}
+
+// handle = et.gentity_field( fieldname )
+// resolves a field name once so et.gentity_get/et.gentity_set can take the handle instead
+static int _et_gentity_field(lua_State *L)
+{
+	int handle = _et_gentity_fieldhandle(luaL_checkstring(L, 1));
+
+	if (!handle)
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	lua_pushinteger(L, handle);
+	return 1;
 }
 
 static void _et_gentity_getvec3(lua_State *L, vec3_t vec3)
@@ -1645,12 +1753,12 @@ static int _et_G_SetSpawnVar(lua_State *L)
 	return 0;
 }
 
-// variable = et.gentity_get( entnum, fieldname, arrayindex )
+// variable = et.gentity_get( entnum, fieldname|handle, arrayindex )
 static int _et_gentity_get(lua_State *L)
 {
 	gentity_t       *ent       = g_entities + (int)luaL_checkinteger(L, 1);
-	const char      *fieldname = luaL_checkstring(L, 2);
-	gentity_field_t *field     = _et_gentity_getfield(ent, (char *)fieldname);
+	const char      *fieldname = NULL;
+	gentity_field_t *field     = _et_gentity_getfield(L, ent, 2, &fieldname);
 	unsigned long   addr;
 
 	// break on invalid gentity field
@@ -1731,12 +1839,12 @@ static int _et_gentity_get(lua_State *L)
 	return 0;
 }
 
-// et.gentity_set( entnum, fieldname, arrayindex, value )
+// et.gentity_set( entnum, fieldname|handle, arrayindex, value )
 static int _et_gentity_set(lua_State *L)
 {
 	gentity_t       *ent       = g_entities + (int)luaL_checkinteger(L, 1);
-	const char      *fieldname = luaL_checkstring(L, 2);
-	gentity_field_t *field     = _et_gentity_getfield(ent, (char *)fieldname);
+	const char      *fieldname = NULL;
+	gentity_field_t *field     = _et_gentity_getfield(L, ent, 2, &fieldname);
 	unsigned long   addr;
 	const char      *buffer;
 
@@ -1789,6 +1897,12 @@ static int _et_gentity_set(lua_State *L)
 			*(char **)addr = Com_Allocate(strlen(buffer) + 1);
 			Q_strncpyz(*(char **)addr, buffer, strlen(buffer));
 		}
+
+		// the new name may have been allocated at the old address
+		if (field->flags & FIELD_FLAG_GENTITY)
+		{
+			G_IndexEntity(ent);
+		}
 		break;
 	case FIELD_FLOAT:
 		*(float *)addr = (float)luaL_checknumber(L, 3);
@@ -2090,6 +2204,7 @@ static const luaL_Reg etlib[] =
 	{ "G_SetSpawnVar",           _et_G_SetSpawnVar           },
 	{ "gentity_get",             _et_gentity_get             },
 	{ "gentity_set",             _et_gentity_set             },
+	{ "gentity_field",           _et_gentity_field           },
 	{ "G_AddEvent",              _et_G_AddEvent              },
 	// Shaders
 	{ "G_ShaderRemap",           _et_G_ShaderRemap           },
@@ -2189,6 +2304,7 @@ qboolean G_LuaRunIsolated(const char *modName)
 			{
 				vm->id      = freeVM;
 				lVM[freeVM] = vm;
+				G_LuaUpdateHooks();
 				return qtrue;
 			}
 			else
@@ -2215,6 +2331,8 @@ qboolean G_LuaInit(void)
 		lVM[i] = NULL;
 	}
 
+	_et_gentity_initfields();
+
 	if (lua_modules.string[0])
 	{
 		Q_strncpyz(buff, lua_modules.string, sizeof(buff));
@@ -2309,6 +2427,112 @@ qboolean G_LuaGetNamedFunction(lua_vm_t *vm, const char *name)
 	return qfalse;
 }
 
+static const char *luaHookNames[LUA_HOOK_MAX] =
+{
+	"et_IPCReceive",
+	"et_Quit",
+	"et_InitGame",
+	"et_ShutdownGame",
+	"et_RunFrame",
+	"et_ClientConnect",
+	"et_ClientDisconnect",
+	"et_ClientBegin",
+	"et_ClientUserinfoChanged",
+	"et_ClientSpawn",
+	"et_ClientCommand",
+	"et_ConsoleCommand",
+	"et_UpgradeSkill",
+	"et_SetPlayerSkill",
+	"et_Print",
+	"et_DPrint",
+	"et_Error",
+	"et_Obituary",
+	"et_Damage",
+	"et_WeaponFire",
+	"et_FixedMGFire",
+	"et_MountedMGFire",
+	"et_AAGunFire",
+	"et_SpawnEntitiesFromString",
+};
+
+static int luaHooks; ///< bit per luaHook_t defined by any loaded VM
+
+/*
+ * G_LuaResolveHooks( vm )
+ * Looks up the et_* callbacks of a VM and keeps a registry reference to each.
+ */
+static void G_LuaResolveHooks(lua_vm_t *vm)
+{
+	int i;
+
+	for (i = 0; i < LUA_HOOK_MAX; i++)
+	{
+		if (vm->hooks & (1 << i))
+		{
+			luaL_unref(vm->L, LUA_REGISTRYINDEX, vm->hookRef[i]);
+			vm->hooks &= ~(1 << i);
+		}
+
+		if (G_LuaGetNamedFunction(vm, luaHookNames[i]))
+		{
+			vm->hookRef[i] = luaL_ref(vm->L, LUA_REGISTRYINDEX);
+			vm->hooks     |= 1 << i;
+		}
+	}
+}
+
+/*
+ * G_LuaUpdateHooks()
+ * Collects the callbacks of all loaded VMs so hooks nobody defines return at once.
+ */
+static void G_LuaUpdateHooks(void)
+{
+	int i;
+
+	luaHooks = 0;
+
+	for (i = 0; i < LUA_NUM_VM; i++)
+	{
+		if (lVM[i] && lVM[i]->id >= 0)
+		{
+			luaHooks |= lVM[i]->hooks;
+		}
+	}
+}
+
+/*
+ * G_LuaGetHook( vm, hook )
+ * Puts a callback resolved by G_LuaResolveHooks onto the stack.
+ * If the VM does not define it, returns qfalse.
+ */
+qboolean G_LuaGetHook(lua_vm_t *vm, luaHook_t hook)
+{
+	if (!vm->L || !(vm->hooks & (1 << hook)))
+	{
+		return qfalse;
+	}
+
+	lua_rawgeti(vm->L, LUA_REGISTRYINDEX, vm->hookRef[hook]);
+	return qtrue;
+}
+
+/*
+ * G_LuaCallHook( vm, hook, nargs, nresults )
+ * Calls a callback pushed by G_LuaGetHook and accounts the time spent in it.
+ */
+qboolean G_LuaCallHook(lua_vm_t *vm, luaHook_t hook, int nargs, int nresults)
+{
+	int64_t  start = G_Microseconds();
+	qboolean result;
+
+	result = G_LuaCall(vm, luaHookNames[hook], nargs, nresults);
+
+	vm->hookCalls[hook]++;
+	vm->hookTime[hook] += G_Microseconds() - start;
+
+	return result;
+}
+
 /**
  * @brief Dump the lua stack to console
  *        Executed by the ingame "lua_api" command
@@ -2814,6 +3038,10 @@ qboolean G_LuaStartVM(lua_vm_t *vm)
 	char       gamepath[MAX_OSPATH];
 	const char *luaPath, *luaCPath;
 
+	vm->hooks = 0;
+	Com_Memset(vm->hookCalls, 0, sizeof(vm->hookCalls));
+	Com_Memset(vm->hookTime, 0, sizeof(vm->hookTime));
+
 	// Open a new lua state
 	vm->L = luaL_newstate();
 	if (!vm->L)
@@ -2904,7 +3132,12 @@ qboolean G_LuaStartVM(lua_vm_t *vm)
 	}
 
 	// Execute the code
-	if (!G_LuaCall(vm, "G_LuaStartVM", 0, 0))
+	res = G_LuaCall(vm, "G_LuaStartVM", 0, 0);
+
+	// whatever the chunk defined before failing still gets its et_Quit call
+	G_LuaResolveHooks(vm);
+
+	if (!res)
 	{
 		G_Printf("%s API: %sLua VM start failed ( %s )\n", LUA_VERSION, S_COLOR_BLUE, vm->file_name);
 		return qfalse;
@@ -2933,9 +3166,9 @@ void G_LuaStopVM(lua_vm_t *vm)
 	}
 	if (vm->L)
 	{
-		if (G_LuaGetNamedFunction(vm, "et_Quit"))
+		if (G_LuaGetHook(vm, LUA_HOOK_QUIT))
 		{
-			G_LuaCall(vm, "et_Quit", 0, 0);
+			G_LuaCallHook(vm, LUA_HOOK_QUIT, 0, 0);
 		}
 		lua_close(vm->L);
 		vm->L = NULL;
@@ -2945,6 +3178,7 @@ void G_LuaStopVM(lua_vm_t *vm)
 		if (lVM[vm->id] == vm)
 		{
 			lVM[vm->id] = NULL;
+			G_LuaUpdateHooks();
 		}
 		if (!vm->err)
 		{
@@ -2989,7 +3223,7 @@ void G_LuaRestart(void)
  */
 void G_LuaStatus(gentity_t *ent)
 {
-	int i, cnt = 0;
+	int i, hook, cnt = 0;
 
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
@@ -3022,6 +3256,25 @@ void G_LuaStatus(gentity_t *ent)
 		}
 	}
 	G_refPrintf(ent, "-- ------------------------ ---------------------------------------- ------------------------");
+
+	// time spent in each callback since the VM was started
+	G_refPrintf(ent, "%-2s %-26s %10s %12s %10s", "VM", "Callback", "Calls", "Total ms", "Avg usec");
+	G_refPrintf(ent, "-- -------------------------- ---------- ------------ ----------");
+	for (i = 0; i < LUA_NUM_VM; i++)
+	{
+		if (lVM[i])
+		{
+			for (hook = 0; hook < LUA_HOOK_MAX; hook++)
+			{
+				if (lVM[i]->hookCalls[hook])
+				{
+					G_refPrintf(ent, "%2d %-26s %10d %12.3f %10.1f", lVM[i]->id, luaHookNames[hook], lVM[i]->hookCalls[hook],
+					            lVM[i]->hookTime[hook] / 1000.0, (double)lVM[i]->hookTime[hook] / lVM[i]->hookCalls[hook]);
+				}
+			}
+		}
+	}
+	G_refPrintf(ent, "-- -------------------------- ---------- ------------ ----------");
 }
 
 /*
@@ -3058,6 +3311,11 @@ void G_LuaHook_InitGame(int levelTime, int randomSeed, int restart)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_INITGAME)))
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3067,7 +3325,7 @@ void G_LuaHook_InitGame(int levelTime, int randomSeed, int restart)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_InitGame"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_INITGAME))
 			{
 				continue;
 			}
@@ -3076,13 +3334,17 @@ void G_LuaHook_InitGame(int levelTime, int randomSeed, int restart)
 			lua_pushinteger(vm->L, randomSeed);
 			lua_pushinteger(vm->L, restart);
 			// Call
-			if (!G_LuaCall(vm, "et_InitGame", 3, 0))
+			if (!G_LuaCallHook(vm, LUA_HOOK_INITGAME, 3, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
 			}
+			// pick up callbacks defined by et_InitGame
+			G_LuaResolveHooks(vm);
 		}
 	}
+
+	G_LuaUpdateHooks();
 }
 
 /*
@@ -3094,6 +3356,11 @@ void G_LuaHook_ShutdownGame(int restart)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_SHUTDOWNGAME)))
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3103,14 +3370,14 @@ void G_LuaHook_ShutdownGame(int restart)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ShutdownGame"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_SHUTDOWNGAME))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, restart);
 			// Call
-			if (!G_LuaCall(vm, "et_ShutdownGame", 1, 0))
+			if (!G_LuaCallHook(vm, LUA_HOOK_SHUTDOWNGAME, 1, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3128,6 +3395,11 @@ void G_LuaHook_RunFrame(int levelTime)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_RUNFRAME)))
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3137,14 +3409,14 @@ void G_LuaHook_RunFrame(int levelTime)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_RunFrame"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_RUNFRAME))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, levelTime);
 			// Call
-			if (!G_LuaCall(vm, "et_RunFrame", 1, 0))
+			if (!G_LuaCallHook(vm, LUA_HOOK_RUNFRAME, 1, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3162,6 +3434,11 @@ qboolean G_LuaHook_ClientConnect(int clientNum, qboolean firstTime, qboolean isB
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_CLIENTCONNECT)))
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3171,7 +3448,7 @@ qboolean G_LuaHook_ClientConnect(int clientNum, qboolean firstTime, qboolean isB
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ClientConnect"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_CLIENTCONNECT))
 			{
 				continue;
 			}
@@ -3180,7 +3457,7 @@ qboolean G_LuaHook_ClientConnect(int clientNum, qboolean firstTime, qboolean isB
 			lua_pushinteger(vm->L, (int)firstTime);
 			lua_pushinteger(vm->L, (int)isBot);
 			// Call
-			if (!G_LuaCall(vm, "et_ClientConnect", 3, 1))
+			if (!G_LuaCallHook(vm, LUA_HOOK_CLIENTCONNECT, 3, 1))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3207,6 +3484,11 @@ void G_LuaHook_ClientDisconnect(int clientNum)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_CLIENTDISCONNECT)))
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3216,14 +3498,14 @@ void G_LuaHook_ClientDisconnect(int clientNum)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ClientDisconnect"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_CLIENTDISCONNECT))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, clientNum);
 			// Call
-			if (!G_LuaCall(vm, "et_ClientDisconnect", 1, 0))
+			if (!G_LuaCallHook(vm, LUA_HOOK_CLIENTDISCONNECT, 1, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3241,6 +3523,11 @@ void G_LuaHook_ClientBegin(int clientNum)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_CLIENTBEGIN)))
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3250,14 +3537,14 @@ void G_LuaHook_ClientBegin(int clientNum)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ClientBegin"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_CLIENTBEGIN))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, clientNum);
 			// Call
-			if (!G_LuaCall(vm, "et_ClientBegin", 1, 0))
+			if (!G_LuaCallHook(vm, LUA_HOOK_CLIENTBEGIN, 1, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3275,6 +3562,11 @@ void G_LuaHook_ClientUserinfoChanged(int clientNum)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_CLIENTUSERINFOCHANGED)))
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3284,14 +3576,14 @@ void G_LuaHook_ClientUserinfoChanged(int clientNum)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ClientUserinfoChanged"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_CLIENTUSERINFOCHANGED))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, clientNum);
 			// Call
-			if (!G_LuaCall(vm, "et_ClientUserinfoChanged", 1, 0))
+			if (!G_LuaCallHook(vm, LUA_HOOK_CLIENTUSERINFOCHANGED, 1, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3309,6 +3601,11 @@ void G_LuaHook_ClientSpawn(int clientNum, qboolean revived, qboolean teamChange,
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_CLIENTSPAWN)))
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3318,7 +3615,7 @@ void G_LuaHook_ClientSpawn(int clientNum, qboolean revived, qboolean teamChange,
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ClientSpawn"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_CLIENTSPAWN))
 			{
 				continue;
 			}
@@ -3328,7 +3625,7 @@ void G_LuaHook_ClientSpawn(int clientNum, qboolean revived, qboolean teamChange,
 			lua_pushinteger(vm->L, (int)teamChange);
 			lua_pushinteger(vm->L, (int)restoreHealth);
 			// Call
-			if (!G_LuaCall(vm, "et_ClientSpawn", 4, 0))
+			if (!G_LuaCallHook(vm, LUA_HOOK_CLIENTSPAWN, 4, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3346,6 +3643,11 @@ qboolean G_LuaHook_ClientCommand(int clientNum, char *command)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_CLIENTCOMMAND)))
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3355,7 +3657,7 @@ qboolean G_LuaHook_ClientCommand(int clientNum, char *command)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ClientCommand"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_CLIENTCOMMAND))
 			{
 				continue;
 			}
@@ -3363,7 +3665,7 @@ qboolean G_LuaHook_ClientCommand(int clientNum, char *command)
 			lua_pushinteger(vm->L, clientNum);
 			lua_pushstring(vm->L, command);
 			// Call
-			if (!G_LuaCall(vm, "et_ClientCommand", 2, 1))
+			if (!G_LuaCallHook(vm, LUA_HOOK_CLIENTCOMMAND, 2, 1))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3392,6 +3694,11 @@ qboolean G_LuaHook_ConsoleCommand(char *command)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_CONSOLECOMMAND)))
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3401,14 +3708,14 @@ qboolean G_LuaHook_ConsoleCommand(char *command)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_ConsoleCommand"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_CONSOLECOMMAND))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushstring(vm->L, command);
 			// Call
-			if (!G_LuaCall(vm, "et_ConsoleCommand", 1, 1))
+			if (!G_LuaCallHook(vm, LUA_HOOK_CONSOLECOMMAND, 1, 1))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3437,6 +3744,11 @@ qboolean G_LuaHook_UpgradeSkill(int cno, skillType_t skill)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_UPGRADESKILL)))
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3446,7 +3758,7 @@ qboolean G_LuaHook_UpgradeSkill(int cno, skillType_t skill)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_UpgradeSkill"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_UPGRADESKILL))
 			{
 				continue;
 			}
@@ -3454,7 +3766,7 @@ qboolean G_LuaHook_UpgradeSkill(int cno, skillType_t skill)
 			lua_pushinteger(vm->L, cno);
 			lua_pushinteger(vm->L, (int)skill);
 			// Call
-			if (!G_LuaCall(vm, "et_UpgradeSkill", 2, 1))
+			if (!G_LuaCallHook(vm, LUA_HOOK_UPGRADESKILL, 2, 1))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3483,6 +3795,11 @@ qboolean G_LuaHook_SetPlayerSkill(int cno, skillType_t skill)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_SETPLAYERSKILL)))
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3492,7 +3809,7 @@ qboolean G_LuaHook_SetPlayerSkill(int cno, skillType_t skill)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_SetPlayerSkill"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_SETPLAYERSKILL))
 			{
 				continue;
 			}
@@ -3500,7 +3817,7 @@ qboolean G_LuaHook_SetPlayerSkill(int cno, skillType_t skill)
 			lua_pushinteger(vm->L, cno);
 			lua_pushinteger(vm->L, (int)skill);
 			// Call
-			if (!G_LuaCall(vm, "et_SetPlayerSkill", 2, 1))
+			if (!G_LuaCallHook(vm, LUA_HOOK_SETPLAYERSKILL, 2, 1))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3520,13 +3837,6 @@ qboolean G_LuaHook_SetPlayerSkill(int cno, skillType_t skill)
 	return qfalse;
 }
 
-static luaPrintFunctions_t g_luaPrintFunctions[] =
-{
-	{ GPRINT_TEXT,      "et_Print"  },
-	{ GPRINT_DEVELOPER, "et_DPrint" },
-	{ GPRINT_ERROR,     "et_Error"  }
-};
-
 /*
  * G_LuaHook_Print
  * et_Print( text ) callback
@@ -3536,6 +3846,11 @@ void G_LuaHook_Print(printMessageType_t category, char *text)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << (LUA_HOOK_PRINT + category))))
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3545,14 +3860,14 @@ void G_LuaHook_Print(printMessageType_t category, char *text)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, g_luaPrintFunctions[category].function))
+			if (!G_LuaGetHook(vm, LUA_HOOK_PRINT + category))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushstring(vm->L, text);
 			// Call
-			if (!G_LuaCall(vm, g_luaPrintFunctions[category].function, 1, 0))
+			if (!G_LuaCallHook(vm, LUA_HOOK_PRINT + category, 1, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3575,6 +3890,11 @@ qboolean G_LuaHook_Obituary(int victim, int killer, int meansOfDeath)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_OBITUARY)))
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3584,7 +3904,7 @@ qboolean G_LuaHook_Obituary(int victim, int killer, int meansOfDeath)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_Obituary"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_OBITUARY))
 			{
 				continue;
 			}
@@ -3594,7 +3914,7 @@ qboolean G_LuaHook_Obituary(int victim, int killer, int meansOfDeath)
 			lua_pushinteger(vm->L, meansOfDeath);
 
 			// Call
-			if (!G_LuaCall(vm, "et_Obituary", 3, 1))
+			if (!G_LuaCallHook(vm, LUA_HOOK_OBITUARY, 3, 1))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3618,6 +3938,11 @@ qboolean G_LuaHook_Damage(int target, int attacker, int damage, int dflags, mean
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_DAMAGE)))
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3627,7 +3952,7 @@ qboolean G_LuaHook_Damage(int target, int attacker, int damage, int dflags, mean
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_Damage"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_DAMAGE))
 			{
 				continue;
 			}
@@ -3638,7 +3963,7 @@ qboolean G_LuaHook_Damage(int target, int attacker, int damage, int dflags, mean
 			lua_pushinteger(vm->L, dflags);
 			lua_pushinteger(vm->L, mod);
 			// Call
-			if (!G_LuaCall(vm, "et_Damage", 5, 1))
+			if (!G_LuaCallHook(vm, LUA_HOOK_DAMAGE, 5, 1))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -3662,6 +3987,11 @@ qboolean G_LuaHook_WeaponFire(int clientNum, weapon_t weapon, gentity_t **pFired
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_WEAPONFIRE)))
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3671,7 +4001,7 @@ qboolean G_LuaHook_WeaponFire(int clientNum, weapon_t weapon, gentity_t **pFired
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_WeaponFire"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_WEAPONFIRE))
 			{
 				continue;
 			}
@@ -3679,7 +4009,7 @@ qboolean G_LuaHook_WeaponFire(int clientNum, weapon_t weapon, gentity_t **pFired
 			lua_pushinteger(vm->L, clientNum);
 			lua_pushinteger(vm->L, weapon);
 			// Call
-			if (!G_LuaCall(vm, "et_WeaponFire", 2, 2))
+			if (!G_LuaCallHook(vm, LUA_HOOK_WEAPONFIRE, 2, 2))
 			{
 				continue;
 			}
@@ -3710,6 +4040,11 @@ qboolean G_LuaHook_FixedMGFire(int clientNum)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_FIXEDMGFIRE)))
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3719,14 +4054,14 @@ qboolean G_LuaHook_FixedMGFire(int clientNum)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_FixedMGFire"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_FIXEDMGFIRE))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, clientNum);
 			// Call
-			if (!G_LuaCall(vm, "et_FixedMGFire", 1, 1))
+			if (!G_LuaCallHook(vm, LUA_HOOK_FIXEDMGFIRE, 1, 1))
 			{
 				continue;
 			}
@@ -3749,6 +4084,11 @@ qboolean G_LuaHook_MountedMGFire(int clientNum)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_MOUNTEDMGFIRE)))
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3758,14 +4098,14 @@ qboolean G_LuaHook_MountedMGFire(int clientNum)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_MountedMGFire"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_MOUNTEDMGFIRE))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, clientNum);
 			// Call
-			if (!G_LuaCall(vm, "et_MountedMGFire", 1, 1))
+			if (!G_LuaCallHook(vm, LUA_HOOK_MOUNTEDMGFIRE, 1, 1))
 			{
 				continue;
 			}
@@ -3788,6 +4128,11 @@ qboolean G_LuaHook_AAGunFire(int clientNum)
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_AAGUNFIRE)))
+	{
+		return qfalse;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3797,14 +4142,14 @@ qboolean G_LuaHook_AAGunFire(int clientNum)
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_AAGunFire"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_AAGUNFIRE))
 			{
 				continue;
 			}
 			// Arguments
 			lua_pushinteger(vm->L, clientNum);
 			// Call
-			if (!G_LuaCall(vm, "et_AAGunFire", 1, 1))
+			if (!G_LuaCallHook(vm, LUA_HOOK_AAGUNFIRE, 1, 1))
 			{
 				continue;
 			}
@@ -3829,6 +4174,11 @@ void G_LuaHook_SpawnEntitiesFromString()
 	int      i;
 	lua_vm_t *vm;
 
+	if (!(luaHooks & (1 << LUA_HOOK_SPAWNENTITIESFROMSTRING)))
+	{
+		return;
+	}
+
 	for (i = 0; i < LUA_NUM_VM; i++)
 	{
 		vm = lVM[i];
@@ -3838,13 +4188,13 @@ void G_LuaHook_SpawnEntitiesFromString()
 			{
 				continue;
 			}
-			if (!G_LuaGetNamedFunction(vm, "et_SpawnEntitiesFromString"))
+			if (!G_LuaGetHook(vm, LUA_HOOK_SPAWNENTITIESFROMSTRING))
 			{
 				continue;
 			}
 
 			// Call
-			if (!G_LuaCall(vm, "et_SpawnEntitiesFromString", 0, 0))
+			if (!G_LuaCallHook(vm, LUA_HOOK_SPAWNENTITIESFROMSTRING, 0, 0))
 			{
 				//G_LuaStopVM(vm);
 				continue;
@@ -76,6 +76,40 @@
 #define _et_gclient_addfield(n, t, f) { #n, t, offsetof(struct gclient_s, n), FIELD_FLAG_GCLIENT + f }
 #define _et_gclient_addfieldalias(n, a, t, f) { #n, t, offsetof(struct gclient_s, a), FIELD_FLAG_GCLIENT + f }
 
+/**
+ * @enum luaHook_e
+ * @typedef luaHook_t
+ * @brief et_* callbacks resolved once per VM
+ */
+typedef enum luaHook_e
+{
+	LUA_HOOK_IPCRECEIVE = 0,
+	LUA_HOOK_QUIT,
+	LUA_HOOK_INITGAME,
+	LUA_HOOK_SHUTDOWNGAME,
+	LUA_HOOK_RUNFRAME,
+	LUA_HOOK_CLIENTCONNECT,
+	LUA_HOOK_CLIENTDISCONNECT,
+	LUA_HOOK_CLIENTBEGIN,
+	LUA_HOOK_CLIENTUSERINFOCHANGED,
+	LUA_HOOK_CLIENTSPAWN,
+	LUA_HOOK_CLIENTCOMMAND,
+	LUA_HOOK_CONSOLECOMMAND,
+	LUA_HOOK_UPGRADESKILL,
+	LUA_HOOK_SETPLAYERSKILL,
+	LUA_HOOK_PRINT,                 ///< followed by LUA_HOOK_DPRINT and LUA_HOOK_ERROR in printMessageType_t order
+	LUA_HOOK_DPRINT,
+	LUA_HOOK_ERROR,
+	LUA_HOOK_OBITUARY,
+	LUA_HOOK_DAMAGE,
+	LUA_HOOK_WEAPONFIRE,
+	LUA_HOOK_FIXEDMGFIRE,
+	LUA_HOOK_MOUNTEDMGFIRE,
+	LUA_HOOK_AAGUNFIRE,
+	LUA_HOOK_SPAWNENTITIESFROMSTRING,
+	LUA_HOOK_MAX
+} luaHook_t;
+
 /**
  * @struct lua_vm_s
  * @brief
@@ -90,6 +124,10 @@ typedef struct
 	int code_size;
 	int err;
 	lua_State *L;
+	int hooks;                          ///< bit per luaHook_t the script defines
+	int hookRef[LUA_HOOK_MAX];          ///< registry reference of each defined callback
+	int hookCalls[LUA_HOOK_MAX];
+	int64_t hookTime[LUA_HOOK_MAX];     ///< microseconds spent in each callback
 } lua_vm_t;
 
 /**
@@ -118,21 +156,12 @@ typedef enum printMessageType_e
 	GPRINT_ERROR
 } printMessageType_t;
 
-/**
- * @struct luaPrintFunctions_s
- * @typedef luaPrintFunctions_t
- * @brief
- */
-typedef struct luaPrintFunctions_s
-{
-	printMessageType_t category;
-	const char *function;
-} luaPrintFunctions_t;
-
 // API
 qboolean G_LuaInit(void);
 qboolean G_LuaCall(lua_vm_t *vm, const char *func, int nargs, int nresults);
 qboolean G_LuaGetNamedFunction(lua_vm_t *vm, const char *name);
+qboolean G_LuaGetHook(lua_vm_t *vm, luaHook_t hook);
+qboolean G_LuaCallHook(lua_vm_t *vm, luaHook_t hook, int nargs, int nresults);
 qboolean G_LuaStartVM(lua_vm_t *vm);
 qboolean G_LuaRunIsolated(const char *modName);
 void G_LuaStopVM(lua_vm_t *vm);
@@ -1572,6 +1572,8 @@ void G_SetTargetName(gentity_t *ent, char *targetname)
 	{
 		ent->targetnamehash = -1;
 	}
+
+	G_IndexEntity(ent);
 }
 
 /**
@@ -1760,6 +1762,7 @@ void G_FindTeams(void)
 					if (Q_stricmp(e2->classname, "func_door_rotating"))
 					{
 						e2->targetname = NULL;
+						G_IndexEntity(e2);
 					}
 				}
 			}
@@ -2571,6 +2574,7 @@ void G_InitGame(int levelTime, int randomSeed, int restart, int etLegacyServer,
 	// initialize all entities for this game
 	Com_Memset(g_entities, 0, MAX_GENTITIES * sizeof(g_entities[0]));
 	level.gentities = g_entities;
+	G_ClearEntityIndex();
 
 	// initialize all clients for this game
 	level.maxclients = g_maxclients.integer;
@@ -3800,6 +3804,11 @@ void G_LogExit(const char *string)
 
 	G_LogPrintf("Exit: %s\n", string);
 
+#ifdef FEATURE_DBMS
+	// store everything recorded at the end of the match in one transaction
+	G_DB_BeginBatch();
+#endif
+
 #ifdef FEATURE_RATING
 	// record match ratings
 	if (g_skillRating.integer && g_gametype.integer != GT_WOLF_STOPWATCH && g_gametype.integer != GT_WOLF_LMS)
@@ -3893,6 +3902,10 @@ void G_LogExit(const char *string)
 	}
 #endif
 
+#ifdef FEATURE_DBMS
+	G_DB_EndBatch();
+#endif
+
 	if (g_gametype.integer == GT_WOLF_STOPWATCH)
 	{
 		int winner, defender;
@@ -5363,6 +5376,11 @@ void G_RunFrame(int levelTime)
 	level.time         = levelTime;
 	level.frameTime    = level.time - level.previousTime;
 
+#ifdef FEATURE_DBMS
+	// deliver finished database jobs
+	G_DB_RunFrame();
+#endif
+
 	level.axisAirstrikeCounter   -= level.frameTime;
 	level.alliedAirstrikeCounter -= level.frameTime;
 	level.axisArtilleryCounter   -= level.frameTime;
@@ -5396,6 +5414,8 @@ void G_RunFrame(int levelTime)
 		g_entities[i].runthisframe = qfalse;
 	}
 
+	G_SyncEntityIndex();
+
 	// go through all allocated objects
 	for (i = 0; i < level.num_entities; i++)
 	{
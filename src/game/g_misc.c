@@ -2989,6 +2989,9 @@ void G_PreFilledMissileEntity(gentity_t *ent, int weaponNum, int realWeapon, int
 	ent->splashMethodOfDeath = GetWeaponTableData(realWeapon)->splashMod;
 	ent->splashRadius        = GetWeaponTableData(realWeapon)->splashRadius;  // blast radius proportional to damage for ALL weapons
 
+	// misc_landmine turns itself into the missile
+	G_IndexEntity(ent);
+
 	// state
 	ent->s.weapon    = weaponNum;
 	ent->s.teamNum   = teamNum;
@@ -31,10 +31,58 @@
 
 #define PRCHECK_SQLWRAP_TABLES "SELECT * FROM prestige_users;"
 #define PRCHECK_SQLWRAP_SCHEMA "SELECT guid, prestige, streak, skill0, skill1, skill2, skill3, skill4, skill5, skill6, created, updated FROM prestige_users;"
-#define PRUSERS_SQLWRAP_SELECT "SELECT * FROM prestige_users WHERE guid = '%s';"
-#define PRUSERS_SQLWRAP_INSERT "INSERT INTO prestige_users " \
-	                           "(guid, prestige, streak, skill0, skill1, skill2, skill3, skill4, skill5, skill6, created, updated) VALUES ('%s', '%i', '%i', '%i', '%i', '%i', '%i', '%i', '%i', '%i', CURRENT_TIMESTAMP, CURRENT_TIMESTAMP);"
-#define PRUSERS_SQLWRAP_UPDATE "UPDATE prestige_users SET prestige = '%i', streak = '%i', skill0 = '%i', skill1 = '%i', skill2 = '%i', skill3 = '%i', skill4 = '%i', skill5 = '%i', skill6 = '%i', updated = CURRENT_TIMESTAMP WHERE guid = '%s';"
+
+/**
+ * @struct prJob_s
+ * @typedef prJob_t
+ * @brief Prestige update queued by G_SetClientPrestige
+ */
+typedef struct prJob_s
+{
+	prData_t pr_data;       ///< prestige and skill points to store
+	qboolean streakUp;      ///< all skills are maxed out, increase the stored streak
+	qboolean streakReset;   ///< prestige was collected, reset the stored streak
+} prJob_t;
+
+/**
+ * @brief Database job reading prestige for G_GetClientPrestige
+ * @param[in,out] data prData_t
+ * @return 0 if successful, 1 otherwise.
+ */
+static int G_ReadPrestigeJob(void *data)
+{
+	return G_ReadPrestige((prData_t *)data);
+}
+
+/**
+ * @brief Database job updating the streak and storing prestige for G_SetClientPrestige
+ * @param[in] data prJob_t
+ * @return 0 if successful, 1 otherwise.
+ */
+static int G_WritePrestigeJob(void *data)
+{
+	prJob_t  *job = (prJob_t *)data;
+	prData_t current;
+
+	Q_strncpyz(current.guid, job->pr_data.guid, sizeof(current.guid));
+
+	// retrieve current streak or assign default values
+	if (G_ReadPrestige(&current))
+	{
+		return 1;
+	}
+
+	if (job->streakReset)
+	{
+		job->pr_data.streak = 0;
+	}
+	else
+	{
+		job->pr_data.streak = current.streak + (job->streakUp ? 1 : 0);
+	}
+
+	return G_WritePrestige(&job->pr_data);
+}
 
 /**
  * @brief Checks if database exists, if tables exist and if schemas are correct
@@ -160,10 +208,10 @@ void G_GetClientPrestige(gclient_t *cl)
 	guid = Info_ValueForKey(userinfo, "cl_guid");
 
 	// assign guid
-	pr_data.guid = (const unsigned char *)guid;
+	Q_strncpyz(pr_data.guid, guid, sizeof(pr_data.guid));
 
 	// retrieve current prestige or assign default values
-	if (G_ReadPrestige(&pr_data))
+	if (G_DB_Run(G_ReadPrestigeJob, &pr_data))
 	{
 		return;
 	}
@@ -190,7 +238,7 @@ void G_SetClientPrestige(gclient_t *cl, qboolean streakUp)
 	char      userinfo[MAX_INFO_STRING];
 	char      *guid;
 	int       clientNum, i, j, skillMax, cnt = 0;
-	prData_t  pr_data;
+	prJob_t   job;
 	gentity_t *ent;
 	qboolean  hasMapXPs = qfalse;
 
@@ -231,7 +279,7 @@ void G_SetClientPrestige(gclient_t *cl, qboolean streakUp)
 	trap_GetUserinfo(clientNum, userinfo, sizeof(userinfo));
 	guid = Info_ValueForKey(userinfo, "cl_guid");
 
-	pr_data.guid = (const unsigned char *)guid;
+	Q_strncpyz(job.pr_data.guid, guid, sizeof(job.pr_data.guid));
 
 	// count the number of maxed out skills
 	for (i = 0; i < SK_NUM_SKILLS; i++)
@@ -254,17 +302,9 @@ void G_SetClientPrestige(gclient_t *cl, qboolean streakUp)
 		}
 	}
 
-	// retrieve current streak or assign default values
-	if (G_ReadPrestige(&pr_data))
-	{
-		return;
-	}
-
 	// increase streak if all skills are maxed out
-	if (cnt >= SK_NUM_SKILLS && streakUp)
-	{
-		pr_data.streak += 1;
-	}
+	job.streakUp    = (cnt >= SK_NUM_SKILLS && streakUp);
+	job.streakReset = qfalse;
 
 	// prestige button clicked in intermission
 	if (!level.intermissionQueued && level.intermissiontime)
@@ -290,15 +330,16 @@ void G_SetClientPrestige(gclient_t *cl, qboolean streakUp)
 		}
 
 		// reset streak
-		pr_data.streak = 0;
+		job.streakReset = qtrue;
 	}
 
-	// assign match data
-	pr_data.prestige = cl->sess.prestige;
+	// assign match data, the streak is read back and updated by the database job
+	job.pr_data.prestige = cl->sess.prestige;
+	job.pr_data.streak   = 0;
 
 	for (i = 0; i < SK_NUM_SKILLS; i++)
 	{
-		pr_data.skillpoints[i] = (int)cl->sess.skillpoints[i];
+		job.pr_data.skillpoints[i] = (int)cl->sess.skillpoints[i];
 
 		// check for new points this map
 		if (!hasMapXPs && (cl->sess.skillpoints[i] - cl->sess.startskillpoints[i]) != 0.f) // Skillpoints can be negative
@@ -313,11 +354,8 @@ void G_SetClientPrestige(gclient_t *cl, qboolean streakUp)
 		return;
 	}
 
-	// save or update prestige
-	if (G_WritePrestige(&pr_data))
-	{
-		return;
-	}
+	// save or update prestige on the database thread
+	G_DB_Queue(G_WritePrestigeJob, NULL, &job, sizeof(job));
 }
 
 /**
@@ -328,28 +366,26 @@ void G_SetClientPrestige(gclient_t *cl, qboolean streakUp)
 int G_ReadPrestige(prData_t *pr_data)
 {
 	int          result, i;
-	char         *err_msg = NULL;
-	char         *sql;
 	sqlite3_stmt *sqlstmt;
 
 	if (!level.database.initialized)
 	{
-		G_Printf("G_ReadPrestige: access to non-initialized database\n");
+		G_DB_Printf("G_ReadPrestige: access to non-initialized database\n");
 		return 1;
 	}
 
-	sql = va(PRUSERS_SQLWRAP_SELECT, pr_data->guid);
+	sqlstmt = G_DB_Statement(DB_STMT_PRUSERS_SELECT);
 
-	result = sqlite3_prepare(level.database.db, sql, strlen(sql), &sqlstmt, NULL);
+	result = sqlite3_bind_text(sqlstmt, 1, pr_data->guid, -1, SQLITE_STATIC);
 
 	if (result != SQLITE_OK)
 	{
-		G_Printf("G_ReadPrestige: sqlite3_prepare failed: %s\n", err_msg);
-		sqlite3_free(err_msg);
+		G_DB_Printf("G_ReadPrestige: sqlite3_bind_text failed: %s\n", sqlite3_errmsg(level.database.db));
+		G_DB_Reset(DB_STMT_PRUSERS_SELECT);
 		return 1;
 	}
 
-	result = sqlite3_step(sqlstmt);
+	result = G_DB_Step(DB_STMT_PRUSERS_SELECT);
 
 	if (result == SQLITE_ROW)
 	{
@@ -378,21 +414,13 @@ int G_ReadPrestige(prData_t *pr_data)
 		}
 		else
 		{
-			sqlite3_finalize(sqlstmt);
-
-			G_Printf("G_ReadPrestige: sqlite3_step failed: %s\n", err_msg);
-			sqlite3_free(err_msg);
+			G_DB_Printf("G_ReadPrestige: sqlite3_step failed: %s\n", sqlite3_errmsg(level.database.db));
+			G_DB_Reset(DB_STMT_PRUSERS_SELECT);
 			return 1;
 		}
 	}
 
-	result = sqlite3_finalize(sqlstmt);
-
-	if (result != SQLITE_OK)
-	{
-		G_Printf("G_ReadPrestige: sqlite3_finalize failed\n");
-		return 1;
-	}
+	G_DB_Reset(DB_STMT_PRUSERS_SELECT);
 
 	return 0;
 }
@@ -404,82 +432,80 @@ int G_ReadPrestige(prData_t *pr_data)
  */
 int G_WritePrestige(prData_t *pr_data)
 {
-	int          result;
-	char         *err_msg = NULL;
-	char         *sql;
-	sqlite3_stmt *sqlstmt;
+	int           result, i, param;
+	dbStatement_t id;
+	sqlite3_stmt  *sqlstmt;
 
 	if (!level.database.initialized)
 	{
-		G_Printf("G_WritePrestige: access to non-initialized database\n");
+		G_DB_Printf("G_WritePrestige: access to non-initialized database\n");
 		return 1;
 	}
 
-	sql = va(PRUSERS_SQLWRAP_SELECT, pr_data->guid);
+	sqlstmt = G_DB_Statement(DB_STMT_PRUSERS_SELECT);
 
-	result = sqlite3_prepare(level.database.db, sql, strlen(sql), &sqlstmt, NULL);
+	result = sqlite3_bind_text(sqlstmt, 1, pr_data->guid, -1, SQLITE_STATIC);
 
 	if (result != SQLITE_OK)
 	{
-		G_Printf("G_WritePrestige: sqlite3_prepare failed: %s\n", err_msg);
-		sqlite3_free(err_msg);
+		G_DB_Printf("G_WritePrestige: sqlite3_bind_text failed: %s\n", sqlite3_errmsg(level.database.db));
+		G_DB_Reset(DB_STMT_PRUSERS_SELECT);
 		return 1;
 	}
 
-	result = sqlite3_step(sqlstmt);
+	result = G_DB_Step(DB_STMT_PRUSERS_SELECT);
+	G_DB_Reset(DB_STMT_PRUSERS_SELECT);
 
-	if (result == SQLITE_DONE)
+	if (result != SQLITE_ROW && result != SQLITE_DONE)
 	{
-		sql = va(PRUSERS_SQLWRAP_INSERT,
-		         pr_data->guid,
-		         pr_data->prestige,
-		         pr_data->streak,
-		         pr_data->skillpoints[0],
-		         pr_data->skillpoints[1],
-		         pr_data->skillpoints[2],
-		         pr_data->skillpoints[3],
-		         pr_data->skillpoints[4],
-		         pr_data->skillpoints[5],
-		         pr_data->skillpoints[6]);
+		G_DB_Printf("G_WritePrestige: sqlite3_step failed: %s\n", sqlite3_errmsg(level.database.db));
+		return 1;
+	}
 
-		result = sqlite3_exec(level.database.db, sql, NULL, NULL, &err_msg);
+	// guid is the first parameter of the insert and the last of the update
+	id      = (result == SQLITE_DONE) ? DB_STMT_PRUSERS_INSERT : DB_STMT_PRUSERS_UPDATE;
+	sqlstmt = G_DB_Statement(id);
+	param   = 1;
+	result  = SQLITE_OK;
 
-		if (result != SQLITE_OK)
-		{
-			G_Printf("G_WritePrestige: sqlite3_exec:INSERT failed: %s\n", err_msg);
-			sqlite3_free(err_msg);
-			return 1;
-		}
+	if (id == DB_STMT_PRUSERS_INSERT)
+	{
+		result = sqlite3_bind_text(sqlstmt, param++, pr_data->guid, -1, SQLITE_STATIC);
 	}
-	else
+
+	if (result == SQLITE_OK)
 	{
-		sql = va(PRUSERS_SQLWRAP_UPDATE,
-		         pr_data->prestige,
-		         pr_data->streak,
-		         (int)pr_data->skillpoints[0],
-		         (int)pr_data->skillpoints[1],
-		         (int)pr_data->skillpoints[2],
-		         (int)pr_data->skillpoints[3],
-		         (int)pr_data->skillpoints[4],
-		         (int)pr_data->skillpoints[5],
-		         (int)pr_data->skillpoints[6],
-		         pr_data->guid);
+		result = sqlite3_bind_int(sqlstmt, param++, pr_data->prestige);
+	}
 
-		result = sqlite3_exec(level.database.db, sql, NULL, NULL, &err_msg);
+	if (result == SQLITE_OK)
+	{
+		result = sqlite3_bind_int(sqlstmt, param++, pr_data->streak);
+	}
 
-		if (result != SQLITE_OK)
-		{
-			G_Printf("G_WritePrestige: sqlite3_exec:UPDATE failed: %s\n", err_msg);
-			sqlite3_free(err_msg);
-			return 1;
-		}
+	for (i = 0; i < SK_NUM_SKILLS && result == SQLITE_OK; i++)
+	{
+		result = sqlite3_bind_int(sqlstmt, param++, pr_data->skillpoints[i]);
 	}
 
-	result = sqlite3_finalize(sqlstmt);
+	if (result == SQLITE_OK && id == DB_STMT_PRUSERS_UPDATE)
+	{
+		result = sqlite3_bind_text(sqlstmt, param, pr_data->guid, -1, SQLITE_STATIC);
+	}
 
 	if (result != SQLITE_OK)
 	{
-		G_Printf("G_WritePrestige: sqlite3_finalize failed\n");
+		G_DB_Printf("G_WritePrestige: sqlite3_bind failed: %s\n", sqlite3_errmsg(level.database.db));
+		G_DB_Reset(id);
+		return 1;
+	}
+
+	result = G_DB_Step(id);
+	G_DB_Reset(id);
+
+	if (result != SQLITE_DONE)
+	{
+		G_DB_Printf("G_WritePrestige: %s failed: %s\n", id == DB_STMT_PRUSERS_INSERT ? "INSERT" : "UPDATE", sqlite3_errmsg(level.database.db));
 		return 1;
 	}
 
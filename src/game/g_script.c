@@ -1404,6 +1404,7 @@ void SP_script_camera(gentity_t *ent)
 void SP_script_multiplayer(gentity_t *ent)
 {
 	ent->scriptName = "game_manager";
+	G_IndexEntity(ent);
 
 	// broadcasting this to clients now, should be cheaper in bandwidth for sending landmine info
 	ent->s.eType   = ET_GAMEMANAGER;
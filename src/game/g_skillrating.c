@@ -35,23 +35,6 @@
 #define SRCHECK_SQLWRAP_SCHEMA "SELECT guid, mu, sigma, created, updated FROM rating_users; " \
 	                           "SELECT guid, mu, sigma, time_axis, time_allies FROM rating_match; " \
 	                           "SELECT mapname, win_axis, win_allies FROM rating_maps;"
-#define SRMATCH_SQLWRAP_DELETE "DELETE FROM rating_match;"
-#define SRMATCH_SQLWRAP_SELECT "SELECT * FROM rating_match WHERE guid = '%s';"
-#define SRMATCH_SQLWRAP_INSERT "INSERT INTO rating_match " \
-	                           "(guid, mu, sigma, time_axis, time_allies) VALUES ('%s', '%f', '%f', '%i', '%i');"
-#define SRMATCH_SQLWRAP_UPDATE "UPDATE rating_match " \
-	                           "SET mu = '%f', sigma = '%f', time_axis = '%i', time_allies = '%i' WHERE guid = '%s';"
-#define SRUSERS_SQLWRAP_SELECT "SELECT * FROM rating_users WHERE guid = '%s';"
-#define SRUSERS_SQLWRAP_INSERT "INSERT INTO rating_users " \
-	                           "(guid, mu, sigma, created, updated) VALUES ('%s', '%f', '%f', CURRENT_TIMESTAMP, CURRENT_TIMESTAMP);"
-#define SRUSERS_SQLWRAP_UPDATE "UPDATE rating_users " \
-	                           "SET mu = '%f', sigma = '%f', updated = CURRENT_TIMESTAMP WHERE guid = '%s';"
-#define SRMATCH_SQLWRAP_TABLE  "SELECT * FROM rating_match;"
-#define SRMAPS_SQLWRAP_SELECT  "SELECT * FROM rating_maps WHERE mapname = '%s';"
-#define SRMAPS_SQLWRAP_INSERT  "INSERT INTO rating_maps " \
-	                           "(win_axis, win_allies, mapname) VALUES ('%i', '%i', '%s');"
-#define SRMAPS_SQLWRAP_UPDATE  "UPDATE rating_maps " \
-	                           "SET win_axis = win_axis + '%i', win_allies = win_allies + '%i' WHERE mapname = '%s';"
 
 // MU      25            - mean
 // SIGMA   MU / 3        - standard deviation
@@ -140,53 +123,61 @@ int G_SkillRatingDBCheck(char *db_path, int db_mode)
 }
 
 /**
- * @brief Ensure rating_match table is empty
+ * @brief Database job emptying the rating_match table
+ * @param data - unused
  * @return 0 if rating_table is successfully emptied, 1 otherwise.
  */
-int G_SkillRatingPrepareMatchRating(void)
+static int G_SkillRatingPrepareMatchRatingJob(void *data)
 {
-	int          result;
-	char         *err_msg = NULL;
-	sqlite3_stmt *sqlstmt;
+	int result;
 
-	if (!level.database.initialized)
+	G_DB_Statement(DB_STMT_SRMATCH_DELETE);
+	result = G_DB_Step(DB_STMT_SRMATCH_DELETE);
+	G_DB_Reset(DB_STMT_SRMATCH_DELETE);
+
+	if (result != SQLITE_DONE)
 	{
-		G_Printf("G_SkillRatingPrepareMatchRating: access to non-initialized database\n");
+		G_DB_Printf("G_SkillRatingPrepareMatchRating: DELETE failed: %s\n", sqlite3_errmsg(level.database.db));
 		return 1;
 	}
 
-	result = sqlite3_prepare(level.database.db, SRMATCH_SQLWRAP_DELETE, strlen(SRMATCH_SQLWRAP_DELETE), &sqlstmt, NULL);
+	return 0;
+}
 
-	if (result != SQLITE_OK)
+/**
+ * @brief Ensure rating_match table is empty
+ * @return 0 if rating_table is successfully emptied, 1 otherwise.
+ */
+int G_SkillRatingPrepareMatchRating(void)
+{
+	if (!level.database.initialized)
 	{
-		G_Printf("G_SkillRatingPrepareMatchRating: sqlite3_prepare failed: %s\n", err_msg);
-		sqlite3_free(err_msg);
+		G_Printf("G_SkillRatingPrepareMatchRating: access to non-initialized database\n");
 		return 1;
 	}
 
-	result = sqlite3_step(sqlstmt);
-
-	if (result == SQLITE_DONE)
-	{
-		result = sqlite3_exec(level.database.db, SRMATCH_SQLWRAP_DELETE, NULL, NULL, &err_msg);
+	return G_DB_Run(G_SkillRatingPrepareMatchRatingJob, NULL);
+}
 
-		if (result != SQLITE_OK)
-		{
-			G_Printf("G_SkillRatingPrepareMatchRating: sqlite3_exec:DELETE failed: %s\n", err_msg);
-			sqlite3_free(err_msg);
-			return 1;
-		}
-	}
+/**
+ * @brief Looks up a row by key with a prepared statement
+ * @param[in] id
+ * @param[in] key guid or mapname, bound to the first parameter
+ * @return The result of the step, release the statement with G_DB_Reset
+ */
+static int G_SkillRatingLookup(dbStatement_t id, const char *key)
+{
+	sqlite3_stmt *sqlstmt = G_DB_Statement(id);
+	int          result;
 
-	result = sqlite3_finalize(sqlstmt);
+	result = sqlite3_bind_text(sqlstmt, 1, key, -1, SQLITE_STATIC);
 
 	if (result != SQLITE_OK)
 	{
-		G_Printf("G_SkillRatingPrepareMatchRating: sqlite3_finalize failed\n");
-		return 1;
+		return result;
 	}
 
-	return 0;
+	return G_DB_Step(id);
 }
 
 /**
@@ -197,29 +188,17 @@ int G_SkillRatingPrepareMatchRating(void)
 int G_SkillRatingGetMatchRating(srData_t *sr_data)
 {
 	int          result;
-	char         *err_msg = NULL;
-	char         *sql;
 	sqlite3_stmt *sqlstmt;
 	qboolean     datafound = qtrue;
 
 	if (!level.database.initialized)
 	{
-		G_Printf("G_SkillRatingGetMatchRating: access to non-initialized database\n");
+		G_DB_Printf("G_SkillRatingGetMatchRating: access to non-initialized database\n");
 		return 1;
 	}
 
-	sql = va(SRMATCH_SQLWRAP_SELECT, sr_data->guid);
-
-	result = sqlite3_prepare(level.database.db, sql, strlen(sql), &sqlstmt, NULL);
-
-	if (result != SQLITE_OK)
-	{
-		G_Printf("G_SkillRatingGetMatchRating: sqlite3_prepare failed: %s\n", err_msg);
-		sqlite3_free(err_msg);
-		return 1;
-	}
-
-	result = sqlite3_step(sqlstmt);
+	sqlstmt = G_DB_Statement(DB_STMT_SRMATCH_SELECT);
+	result  = G_SkillRatingLookup(DB_STMT_SRMATCH_SELECT, sr_data->guid);
 
 	if (result == SQLITE_ROW)
 	{
@@ -244,21 +223,13 @@ int G_SkillRatingGetMatchRating(srData_t *sr_data)
 		}
 		else
 		{
-			sqlite3_finalize(sqlstmt);
-
-			G_Printf("G_SkillRatingGetMatchRating: sqlite3_step failed: %s\n", err_msg);
-			sqlite3_free(err_msg);
+			G_DB_Printf("G_SkillRatingGetMatchRating: sqlite3_step failed: %s\n", sqlite3_errmsg(level.database.db));
+			G_DB_Reset(DB_STMT_SRMATCH_SELECT);
 			return 1;
 		}
 	}
 
-	result = sqlite3_finalize(sqlstmt);
-
-	if (result != SQLITE_OK)
-	{
-		G_Printf("G_SkillRatingGetMatchRating: sqlite3_finalize failed\n");
-		return 1;
-	}
+	G_DB_Reset(DB_STMT_SRMATCH_SELECT);
 
 	if (!datafound)
 	{
@@ -275,64 +246,54 @@ int G_SkillRatingGetMatchRating(srData_t *sr_data)
 int G_SkillRatingSetMatchRating(srData_t *sr_data)
 {
 	int          result;
-	char         *err_msg = NULL;
-	char         *sql;
 	sqlite3_stmt *sqlstmt;
 
 	if (!level.database.initialized)
 	{
-		G_Printf("G_SkillRatingSetMatchRating: access to non-initialized database\n");
-		return 1;
-	}
-
-	sql = va(SRMATCH_SQLWRAP_SELECT, sr_data->guid);
-
-	result = sqlite3_prepare(level.database.db, sql, strlen(sql), &sqlstmt, NULL);
-
-	if (result != SQLITE_OK)
-	{
-		G_Printf("G_SkillRatingSetMatchRating: sqlite3_prepare failed: %s\n", err_msg);
-		sqlite3_free(err_msg);
+		G_DB_Printf("G_SkillRatingSetMatchRating: access to non-initialized database\n");
 		return 1;
 	}
 
-	result = sqlite3_step(sqlstmt);
+	result = G_SkillRatingLookup(DB_STMT_SRMATCH_SELECT, sr_data->guid);
+	G_DB_Reset(DB_STMT_SRMATCH_SELECT);
 
 	if (result == SQLITE_DONE)
 	{
-		sql = va(SRMATCH_SQLWRAP_INSERT, sr_data->guid, sr_data->mu, sr_data->sigma, sr_data->time_axis, sr_data->time_allies);
+		sqlstmt = G_DB_Statement(DB_STMT_SRMATCH_INSERT);
+		sqlite3_bind_text(sqlstmt, 1, sr_data->guid, -1, SQLITE_STATIC);
+		sqlite3_bind_double(sqlstmt, 2, sr_data->mu);
+		sqlite3_bind_double(sqlstmt, 3, sr_data->sigma);
+		sqlite3_bind_int(sqlstmt, 4, sr_data->time_axis);
+		sqlite3_bind_int(sqlstmt, 5, sr_data->time_allies);
 
-		result = sqlite3_exec(level.database.db, sql, NULL, NULL, &err_msg);
+		result = G_DB_Step(DB_STMT_SRMATCH_INSERT);
+		G_DB_Reset(DB_STMT_SRMATCH_INSERT);
 
-		if (result != SQLITE_OK)
+		if (result != SQLITE_DONE)
 		{
-			G_Printf("G_SkillRatingSetMatchRating: sqlite3_exec:INSERT failed: %s\n", err_msg);
-			sqlite3_free(err_msg);
+			G_DB_Printf("G_SkillRatingSetMatchRating: INSERT failed: %s\n", sqlite3_errmsg(level.database.db));
 			return 1;
 		}
 	}
 	else
 	{
-		sql = va(SRMATCH_SQLWRAP_UPDATE, sr_data->mu, sr_data->sigma, sr_data->time_axis, sr_data->time_allies, sr_data->guid);
+		sqlstmt = G_DB_Statement(DB_STMT_SRMATCH_UPDATE);
+		sqlite3_bind_double(sqlstmt, 1, sr_data->mu);
+		sqlite3_bind_double(sqlstmt, 2, sr_data->sigma);
+		sqlite3_bind_int(sqlstmt, 3, sr_data->time_axis);
+		sqlite3_bind_int(sqlstmt, 4, sr_data->time_allies);
+		sqlite3_bind_text(sqlstmt, 5, sr_data->guid, -1, SQLITE_STATIC);
 
-		result = sqlite3_exec(level.database.db, sql, NULL, NULL, &err_msg);
+		result = G_DB_Step(DB_STMT_SRMATCH_UPDATE);
+		G_DB_Reset(DB_STMT_SRMATCH_UPDATE);
 
-		if (result != SQLITE_OK)
+		if (result != SQLITE_DONE)
 		{
-			G_Printf("G_SkillRatingSetMatchRating: sqlite3_exec:UPDATE failed: %s\n", err_msg);
-			sqlite3_free(err_msg);
+			G_DB_Printf("G_SkillRatingSetMatchRating: UPDATE failed: %s\n", sqlite3_errmsg(level.database.db));
 			return 1;
 		}
 	}
 
-	result = sqlite3_finalize(sqlstmt);
-
-	if (result != SQLITE_OK)
-	{
-		G_Printf("G_SkillRatingSetMatchRating: sqlite3_finalize failed\n");
-		return 1;
-	}
-
 	return 0;
 }
 
@@ -344,28 +305,16 @@ int G_SkillRatingSetMatchRating(srData_t *sr_data)
 int G_SkillRatingGetUserRating(srData_t *sr_data)
 {
 	int          result;
-	char         *err_msg = NULL;
-	char         *sql;
 	sqlite3_stmt *sqlstmt;
 
 	if (!level.database.initialized)
 	{
-		G_Printf("G_SkillRatingGetUserRating: access to non-initialized database\n");
-		return 1;
-	}
-
-	sql = va(SRUSERS_SQLWRAP_SELECT, sr_data->guid);
-
-	result = sqlite3_prepare(level.database.db, sql, strlen(sql), &sqlstmt, NULL);
-
-	if (result != SQLITE_OK)
-	{
-		G_Printf("G_SkillRatingGetUserRating: sqlite3_prepare failed: %s\n", err_msg);
-		sqlite3_free(err_msg);
+		G_DB_Printf("G_SkillRatingGetUserRating: access to non-initialized database\n");
 		return 1;
 	}
 
-	result = sqlite3_step(sqlstmt);
+	sqlstmt = G_DB_Statement(DB_STMT_SRUSERS_SELECT);
+	result  = G_SkillRatingLookup(DB_STMT_SRUSERS_SELECT, sr_data->guid);
 
 	if (result == SQLITE_ROW)
 	{
@@ -388,21 +337,13 @@ int G_SkillRatingGetUserRating(srData_t *sr_data)
 		}
 		else
 		{
-			sqlite3_finalize(sqlstmt);
-
-			G_Printf("G_SkillRatingGetUserRating: sqlite3_step failed: %s\n", err_msg);
-			sqlite3_free(err_msg);
+			G_DB_Printf("G_SkillRatingGetUserRating: sqlite3_step failed: %s\n", sqlite3_errmsg(level.database.db));
+			G_DB_Reset(DB_STMT_SRUSERS_SELECT);
 			return 1;
 		}
 	}
 
-	result = sqlite3_finalize(sqlstmt);
-
-	if (result != SQLITE_OK)
-	{
-		G_Printf("G_SkillRatingGetUserRating: sqlite3_finalize failed\n");
-		return 1;
-	}
+	G_DB_Reset(DB_STMT_SRUSERS_SELECT);
 
 	return 0;
 }
@@ -415,67 +356,117 @@ int G_SkillRatingGetUserRating(srData_t *sr_data)
 int G_SkillRatingSetUserRating(srData_t *sr_data)
 {
 	int          result;
-	char         *err_msg = NULL;
-	char         *sql;
 	sqlite3_stmt *sqlstmt;
 
 	if (!level.database.initialized)
 	{
-		G_Printf("G_SkillRatingSetUserRating: access to non-initialized database\n");
+		G_DB_Printf("G_SkillRatingSetUserRating: access to non-initialized database\n");
 		return 1;
 	}
 
-	sql = va(SRUSERS_SQLWRAP_SELECT, sr_data->guid);
-
-	result = sqlite3_prepare(level.database.db, sql, strlen(sql), &sqlstmt, NULL);
-
-	if (result != SQLITE_OK)
-	{
-		G_Printf("G_SkillRatingSetUserRating: sqlite3_prepare failed: %s\n", err_msg);
-		sqlite3_free(err_msg);
-		return 1;
-	}
-
-	result = sqlite3_step(sqlstmt);
+	result = G_SkillRatingLookup(DB_STMT_SRUSERS_SELECT, sr_data->guid);
+	G_DB_Reset(DB_STMT_SRUSERS_SELECT);
 
 	if (result == SQLITE_DONE)
 	{
-		sql = va(SRUSERS_SQLWRAP_INSERT, sr_data->guid, sr_data->mu, sr_data->sigma);
+		sqlstmt = G_DB_Statement(DB_STMT_SRUSERS_INSERT);
+		sqlite3_bind_text(sqlstmt, 1, sr_data->guid, -1, SQLITE_STATIC);
+		sqlite3_bind_double(sqlstmt, 2, sr_data->mu);
+		sqlite3_bind_double(sqlstmt, 3, sr_data->sigma);
 
-		result = sqlite3_exec(level.database.db, sql, NULL, NULL, &err_msg);
+		result = G_DB_Step(DB_STMT_SRUSERS_INSERT);
+		G_DB_Reset(DB_STMT_SRUSERS_INSERT);
 
-		if (result != SQLITE_OK)
+		if (result != SQLITE_DONE)
 		{
-			G_Printf("G_SkillRatingSetUserRating: sqlite3_exec:INSERT failed: %s\n", err_msg);
-			sqlite3_free(err_msg);
+			G_DB_Printf("G_SkillRatingSetUserRating: INSERT failed: %s\n", sqlite3_errmsg(level.database.db));
 			return 1;
 		}
 	}
 	else
 	{
-		sql = va(SRUSERS_SQLWRAP_UPDATE, sr_data->mu, sr_data->sigma, sr_data->guid);
+		sqlstmt = G_DB_Statement(DB_STMT_SRUSERS_UPDATE);
+		sqlite3_bind_double(sqlstmt, 1, sr_data->mu);
+		sqlite3_bind_double(sqlstmt, 2, sr_data->sigma);
+		sqlite3_bind_text(sqlstmt, 3, sr_data->guid, -1, SQLITE_STATIC);
 
-		result = sqlite3_exec(level.database.db, sql, NULL, NULL, &err_msg);
+		result = G_DB_Step(DB_STMT_SRUSERS_UPDATE);
+		G_DB_Reset(DB_STMT_SRUSERS_UPDATE);
 
-		if (result != SQLITE_OK)
+		if (result != SQLITE_DONE)
 		{
-			G_Printf("G_SkillRatingSetUserRating: sqlite3_exec:UPDATE failed: %s\n", err_msg);
-			sqlite3_free(err_msg);
+			G_DB_Printf("G_SkillRatingSetUserRating: UPDATE failed: %s\n", sqlite3_errmsg(level.database.db));
 			return 1;
 		}
 	}
 
-	result = sqlite3_finalize(sqlstmt);
+	return 0;
+}
 
-	if (result != SQLITE_OK)
+/**
+ * @struct srJob_s
+ * @typedef srJob_t
+ * @brief Client rating read or write handed to the database thread
+ */
+typedef struct srJob_s
+{
+	srData_t sr_data;
+	qboolean match;     ///< use the rating_match table, rating_users otherwise
+} srJob_t;
+
+/**
+ * @brief Database job reading a client rating for G_SkillRatingGetClientRating
+ * @param[in,out] data srJob_t
+ * @return 0 if successful, 1 otherwise.
+ */
+static int G_SkillRatingReadClientJob(void *data)
+{
+	srJob_t *job = (srJob_t *)data;
+
+	if (!job->match)
+	{
+		// retrieve rating from rating_users table
+		return G_SkillRatingGetUserRating(&job->sr_data);
+	}
+
+	// retrieve rating from rating_match or rating_users table or set default values
+	switch (G_SkillRatingGetMatchRating(&job->sr_data))
 	{
-		G_Printf("G_SkillRatingSetUserRating: sqlite3_finalize failed\n");
+	case 1:
+		// error occurred
 		return 1;
+	case 2:
+		// data not found in rating_match
+		G_SkillRatingGetUserRating(&job->sr_data);
+		break;
+	case 0:
+	// data found
+	default:
+		break;
 	}
 
 	return 0;
 }
 
+/**
+ * @brief Database job storing a client rating for G_SkillRatingSetClientRating
+ * @param[in] data srJob_t
+ * @return 0 if successful, 1 otherwise.
+ */
+static int G_SkillRatingWriteClientJob(void *data)
+{
+	srJob_t *job = (srJob_t *)data;
+
+	if (job->match)
+	{
+		// save or update rating in rating_match table
+		return G_SkillRatingSetMatchRating(&job->sr_data);
+	}
+
+	// save or update rating in rating_users table
+	return G_SkillRatingSetUserRating(&job->sr_data);
+}
+
 /**
  * @brief Retrieve rating for client
  *         Called on ClientConnect and on G_UpdateSkillRating
@@ -486,7 +477,7 @@ void G_SkillRatingGetClientRating(gclient_t *cl)
 	char         userinfo[MAX_INFO_STRING];
 	char         *guid;
 	int          clientNum;
-	srData_t     sr_data;
+	srJob_t      job;
 
 	// disable for these game types
 	if (g_gametype.integer == GT_WOLF_STOPWATCH || g_gametype.integer == GT_WOLF_LMS)
@@ -512,20 +503,21 @@ void G_SkillRatingGetClientRating(gclient_t *cl)
 	guid = Info_ValueForKey(userinfo, "cl_guid");
 
 	// assign guid
-	sr_data.guid = (const unsigned char *)guid;
+	Q_strncpyz(job.sr_data.guid, guid, sizeof(job.sr_data.guid));
 
 	// retrieve current rating or assign default values
-	if (level.warmupTime || level.intermissionQueued || level.intermissiontime)
+	job.match = !(level.warmupTime || level.intermissionQueued || level.intermissiontime);
+
+	if (G_DB_Run(G_SkillRatingReadClientJob, &job))
 	{
-		// retrieve rating from rating_users table
-		if (G_SkillRatingGetUserRating(&sr_data))
-		{
-			return;
-		}
+		return;
+	}
 
+	if (!job.match)
+	{
 		// assign user data to session
-		cl->sess.mu          = sr_data.mu;
-		cl->sess.sigma       = sr_data.sigma;
+		cl->sess.mu          = job.sr_data.mu;
+		cl->sess.sigma       = job.sr_data.sigma;
 
 		// ensure auto statsdump is correct
 		if (!level.intermissionQueued && !level.intermissiontime)
@@ -537,37 +529,21 @@ void G_SkillRatingGetClientRating(gclient_t *cl)
 		// prepare delta rating
 		if (!level.intermissionQueued)
 		{
-			cl->sess.oldmu    = sr_data.mu;
-			cl->sess.oldsigma = sr_data.sigma;
+			cl->sess.oldmu    = job.sr_data.mu;
+			cl->sess.oldsigma = job.sr_data.sigma;
 		}
 	}
 	else // playing
 	{
-		// retrieve rating from rating_match or rating_users table or set default values
-		switch (G_SkillRatingGetMatchRating(&sr_data))
-		{
-			case 1:
-				// error occurred
-				return;
-			case 2:
-				// data not found in rating_match
-				G_SkillRatingGetUserRating(&sr_data);
-				break;
-			case 0:
-				// data found
-			default:
-				break;
-		}
-
 		// assign match data to session
-		cl->sess.mu          = sr_data.mu;
-		cl->sess.sigma       = sr_data.sigma;
-		cl->sess.time_axis   = sr_data.time_axis;
-		cl->sess.time_allies = sr_data.time_allies;
+		cl->sess.mu          = job.sr_data.mu;
+		cl->sess.sigma       = job.sr_data.sigma;
+		cl->sess.time_axis   = job.sr_data.time_axis;
+		cl->sess.time_allies = job.sr_data.time_allies;
 
 		// prepare delta rating
-		cl->sess.oldmu    = sr_data.mu;
-		cl->sess.oldsigma = sr_data.sigma;
+		cl->sess.oldmu    = job.sr_data.mu;
+		cl->sess.oldsigma = job.sr_data.sigma;
 	}
 }
 
@@ -581,7 +557,7 @@ void G_SkillRatingSetClientRating(gclient_t *cl)
 	char         userinfo[MAX_INFO_STRING];
 	char         *guid;
 	int          clientNum;
-	srData_t     sr_data;
+	srJob_t      job;
 
 	// disable for these game types
 	if (g_gametype.integer == GT_WOLF_STOPWATCH || g_gametype.integer == GT_WOLF_LMS)
@@ -613,75 +589,50 @@ void G_SkillRatingSetClientRating(gclient_t *cl)
 	guid = Info_ValueForKey(userinfo, "cl_guid");
 
 	// assign match data
-	sr_data.guid        = (const unsigned char *)guid;
-	sr_data.mu          = cl->sess.mu;
-	sr_data.sigma       = cl->sess.sigma;
-	sr_data.time_axis   = cl->sess.time_axis;
-	sr_data.time_allies = cl->sess.time_allies;
+	Q_strncpyz(job.sr_data.guid, guid, sizeof(job.sr_data.guid));
+	job.sr_data.mu          = cl->sess.mu;
+	job.sr_data.sigma       = cl->sess.sigma;
+	job.sr_data.time_axis   = cl->sess.time_axis;
+	job.sr_data.time_allies = cl->sess.time_allies;
 
 	// save match rating or update new user rating after calculation
-	if (!level.intermissionQueued)
-	{
-		// player has not played at all
-		if (sr_data.time_axis == 0 && sr_data.time_allies == 0)
-		{
-			return;
-		}
+	job.match = !level.intermissionQueued;
 
-		// save or update rating in rating_match table
-		if (G_SkillRatingSetMatchRating(&sr_data))
-		{
-			return;
-		}
-	}
-	else
+	// player has not played at all
+	if (job.match && job.sr_data.time_axis == 0 && job.sr_data.time_allies == 0)
 	{
-		// save or update rating in rating_users table
-		if (G_SkillRatingSetUserRating(&sr_data))
-		{
-			return;
-		}
+		return;
 	}
+
+	G_DB_Queue(G_SkillRatingWriteClientJob, NULL, &job, sizeof(job));
 }
 
 /**
- * @brief Retrieve map bias from the rating_maps table
+ * @struct srMapJob_s
+ * @typedef srMapJob_t
+ * @brief Map rating read or write handed to the database thread
+ */
+typedef struct srMapJob_s
+{
+	char mapname[MAX_QPATH];
+	int winner;
+	float mapProb;
+} srMapJob_t;
+
+/**
+ * @brief Database side of G_SkillRatingGetMapRating
  * @param[in] mapname
  * @return mapProb
  */
-float G_SkillRatingGetMapRating(char *mapname)
+static float G_SkillRatingReadMapRating(const char *mapname)
 {
 	float        mapProb;
 	int          win_axis, win_allies;
 	int          result;
-	char         *err_msg = NULL;
-	char         *sql;
 	sqlite3_stmt *sqlstmt;
 
-	// disable for these game types
-	if (g_gametype.integer == GT_WOLF_STOPWATCH || g_gametype.integer == GT_WOLF_LMS)
-	{
-		return 0.5f;
-	}
-
-	if (!level.database.initialized)
-	{
-		G_Printf("G_SkillRatingGetMapRating: access to non-initialized database\n");
-		return 0.5f;
-	}
-
-	sql = va(SRMAPS_SQLWRAP_SELECT, mapname);
-
-	result = sqlite3_prepare(level.database.db, sql, strlen(sql), &sqlstmt, NULL);
-
-	if (result != SQLITE_OK)
-	{
-		G_Printf("G_SkillRatingGetMapRating: sqlite3_prepare failed: %s\n", err_msg);
-		sqlite3_free(err_msg);
-		return 0.5f;
-	}
-
-	result = sqlite3_step(sqlstmt);
+	sqlstmt = G_DB_Statement(DB_STMT_SRMAPS_SELECT);
+	result  = G_SkillRatingLookup(DB_STMT_SRMAPS_SELECT, mapname);
 
 	if (result == SQLITE_ROW)
 	{
@@ -713,104 +664,115 @@ float G_SkillRatingGetMapRating(char *mapname)
 		}
 		else
 		{
-			sqlite3_finalize(sqlstmt);
-
-			G_Printf("G_SkillRatingGetMapRating: sqlite3_step failed: %s\n", err_msg);
-			sqlite3_free(err_msg);
+			G_DB_Printf("G_SkillRatingGetMapRating: sqlite3_step failed: %s\n", sqlite3_errmsg(level.database.db));
+			G_DB_Reset(DB_STMT_SRMAPS_SELECT);
 			return 1;
 		}
 	}
 
-	result = sqlite3_finalize(sqlstmt);
-
-	if (result != SQLITE_OK)
-	{
-		G_Printf("G_SkillRatingGetMapRating: sqlite3_finalize failed\n");
-		return 0.5f;
-	}
+	G_DB_Reset(DB_STMT_SRMAPS_SELECT);
 
 	return mapProb;
 }
 
 /**
- * @brief Sets or updates map bias in the rating_maps table
+ * @brief Database job reading the map bias for G_SkillRatingGetMapRating
+ * @param[in,out] data srMapJob_t
+ * @return 0
+ */
+static int G_SkillRatingReadMapJob(void *data)
+{
+	srMapJob_t *job = (srMapJob_t *)data;
+
+	job->mapProb = G_SkillRatingReadMapRating(job->mapname);
+
+	return 0;
+}
+
+/**
+ * @brief Retrieve map bias from the rating_maps table
  * @param[in] mapname
- * @param[in] winner
+ * @return mapProb
  */
-void G_SkillRatingSetMapRating(char *mapname, int winner)
+float G_SkillRatingGetMapRating(char *mapname)
 {
-	int          result;
-	char         *err_msg = NULL;
-	char         *sql;
-	sqlite3_stmt *sqlstmt;
+	srMapJob_t job;
+
+	// disable for these game types
+	if (g_gametype.integer == GT_WOLF_STOPWATCH || g_gametype.integer == GT_WOLF_LMS)
+	{
+		return 0.5f;
+	}
 
 	if (!level.database.initialized)
 	{
-		G_Printf("G_SkillRatingSetMapRating: access to non-initialized database\n");
-		return;
+		G_Printf("G_SkillRatingGetMapRating: access to non-initialized database\n");
+		return 0.5f;
 	}
 
-	sql = va(SRMAPS_SQLWRAP_SELECT, mapname);
+	Q_strncpyz(job.mapname, mapname, sizeof(job.mapname));
+	job.mapProb = 0.5f;
 
-	result = sqlite3_prepare(level.database.db, sql, strlen(sql), &sqlstmt, NULL);
+	G_DB_Run(G_SkillRatingReadMapJob, &job);
 
-	if (result != SQLITE_OK)
-	{
-		G_Printf("G_SkillRatingSetMapRating: sqlite3_prepare failed: %s\n", err_msg);
-		sqlite3_free(err_msg);
-		return;
-	}
+	return job.mapProb;
+}
 
-	result = sqlite3_step(sqlstmt);
+/**
+ * @brief Database job storing the map result for G_SkillRatingSetMapRating
+ * @param[in] data srMapJob_t
+ * @return 0 if successful, 1 otherwise.
+ */
+static int G_SkillRatingWriteMapJob(void *data)
+{
+	srMapJob_t    *job = (srMapJob_t *)data;
+	dbStatement_t id;
+	sqlite3_stmt  *sqlstmt;
+	int           result;
 
-	if (result == SQLITE_DONE)
-	{
-		if (winner == TEAM_AXIS)
-		{
-			sql = va(SRMAPS_SQLWRAP_INSERT, 1, 0, mapname);
-		}
-		else // winner == TEAM_ALLIES
-		{
-			sql = va(SRMAPS_SQLWRAP_INSERT, 0, 1, mapname);
-		}
+	result = G_SkillRatingLookup(DB_STMT_SRMAPS_SELECT, job->mapname);
+	G_DB_Reset(DB_STMT_SRMAPS_SELECT);
 
-		result = sqlite3_exec(level.database.db, sql, NULL, NULL, &err_msg);
+	id      = (result == SQLITE_DONE) ? DB_STMT_SRMAPS_INSERT : DB_STMT_SRMAPS_UPDATE;
+	sqlstmt = G_DB_Statement(id);
 
-		if (result != SQLITE_OK)
-		{
-			G_Printf("G_SkillRatingSetMapRating: sqlite3_exec:INSERT failed: %s\n", err_msg);
-			sqlite3_free(err_msg);
-			return;
-		}
-	}
-	else
-	{
-		if (winner == TEAM_AXIS)
-		{
-			sql = va(SRMAPS_SQLWRAP_UPDATE, 1, 0, mapname);
-		}
-		else // winner == TEAM_ALLIES
-		{
-			sql = va(SRMAPS_SQLWRAP_UPDATE, 0, 1, mapname);
-		}
+	// winner == TEAM_AXIS or TEAM_ALLIES
+	sqlite3_bind_int(sqlstmt, 1, job->winner == TEAM_AXIS ? 1 : 0);
+	sqlite3_bind_int(sqlstmt, 2, job->winner == TEAM_AXIS ? 0 : 1);
+	sqlite3_bind_text(sqlstmt, 3, job->mapname, -1, SQLITE_STATIC);
 
-		result = sqlite3_exec(level.database.db, sql, NULL, NULL, &err_msg);
+	result = G_DB_Step(id);
+	G_DB_Reset(id);
 
-		if (result != SQLITE_OK)
-		{
-			G_Printf("G_SkillRatingSetMapRating: sqlite3_exec:UPDATE failed: %s\n", err_msg);
-			sqlite3_free(err_msg);
-			return;
-		}
+	if (result != SQLITE_DONE)
+	{
+		G_DB_Printf("G_SkillRatingSetMapRating: %s failed: %s\n", id == DB_STMT_SRMAPS_INSERT ? "INSERT" : "UPDATE", sqlite3_errmsg(level.database.db));
+		return 1;
 	}
 
-	result = sqlite3_finalize(sqlstmt);
+	return 0;
+}
 
-	if (result != SQLITE_OK)
+/**
+ * @brief Sets or updates map bias in the rating_maps table
+ * @param[in] mapname
+ * @param[in] winner
+ */
+void G_SkillRatingSetMapRating(char *mapname, int winner)
+{
+	srMapJob_t job;
+
+	if (!level.database.initialized)
 	{
-		G_Printf("G_SkillRatingSetMapRating: sqlite3_finalize failed\n");
+		G_Printf("G_SkillRatingSetMapRating: access to non-initialized database\n");
 		return;
 	}
+
+	Q_strncpyz(job.mapname, mapname, sizeof(job.mapname));
+	job.winner  = winner;
+	job.mapProb = 0.5f;
+
+	G_DB_Queue(G_SkillRatingWriteMapJob, NULL, &job, sizeof(job));
 }
 
 /**
@@ -852,23 +814,12 @@ void G_CalculateSkillRatings(void)
 	G_LogPrintf("SkillRating: Map: %s, Winner: %d, Time: %d, Timelimit: %d\n",
 	            level.rawmapname, winner, level.intermissionQueued - level.startTime - level.timeDelta, g_timelimit.integer * 60000);
 
-	// update map rating
+	// update map rating, the new map bias is read back by G_UpdateSkillRating
 	if (g_skillRating.integer > 1)
 	{
 		G_SkillRatingSetMapRating(level.rawmapname, winner);
-		level.mapProb = G_SkillRatingGetMapRating(level.rawmapname);
-
-		G_LogPrintf("SkillRating: Map bias: %.6f\n", level.mapProb);
-
-		// update map bias on intermission scoreboard
-		trap_GetConfigstring(CS_MODINFO, cs, sizeof(cs));
-		Info_SetValueForKey(cs, "M", va("%f", level.mapProb));
-		trap_SetConfigstring(CS_MODINFO, cs);
 	}
 
-	// log last estimated win probability
-	G_LogPrintf("SkillRating: Win probability X/L: %.6f/%.6f\n", level.axisProb, level.alliesProb);
-
 	G_UpdateSkillRating(winner);
 }
 
@@ -943,21 +894,38 @@ float G_MapWinProb(int team)
 }
 
 /**
- * @brief Update skill rating
- * @details Update player's skill rating based on team performance
- * @param[in] team
+ * @struct srMatchJob_s
+ * @typedef srMatchJob_t
+ * @brief End of match rating update handed to the database thread
  */
-void G_UpdateSkillRating(int winner)
+typedef struct srMatchJob_s
 {
-	int          result;
-	char         *err_msg = NULL;
-	sqlite3_stmt *sqlstmt;
-	srData_t     sr_data;
+	char mapname[MAX_QPATH];
+	int winner;
+	int totalTime;
+	int skillRating;        ///< g_skillRating when the match ended
+	float mapProb;          ///< map bias, read back from rating_maps
+	float axisProb;         ///< last estimated win probabilities, for the log
+	float alliesProb;
+} srMatchJob_t;
 
-	int       i, playerTeam, rankFactor;
-	float     c, v, w, t, winningMu, losingMu, muFactor, sigmaFactor;
-	float     oldMu, oldSigma;
-	gclient_t *cl;
+/**
+ * @brief Database side of G_UpdateSkillRating
+ * @details Reads the map bias and the match ratings, then stores the updated user ratings
+ * @param[in,out] data srMatchJob_t
+ * @return 0 if successful, 1 otherwise.
+ */
+static int G_UpdateSkillRatingJob(void *data)
+{
+	srMatchJob_t        *job = (srMatchJob_t *)data;
+	sqlite3_stmt        *sqlstmt;
+	srData_t            sr_data;
+	const unsigned char *guid;
+
+	int   playerTeam, rankFactor;
+	float c, v, w, t, winningMu, losingMu, muFactor, sigmaFactor;
+	float oldMu, oldSigma;
+	int   winner = job->winner;
 
 	float teamMuX      = 0.f;
 	float teamMuL      = 0.f;
@@ -971,34 +939,30 @@ void G_UpdateSkillRating(int winner)
 	float mapBeta      = 0.f;
 
 	// total play time
-	int totalTime = level.intermissionQueued - level.startTime - level.timeDelta;
-
-	if (!level.database.initialized)
-	{
-		G_Printf("G_UpdateSkillRating: access to non-initialized database\n");
-		return;
-	}
+	int totalTime = job->totalTime;
 
 	// map side parameter
-	if (g_skillRating.integer > 1)
+	if (job->skillRating > 1)
 	{
-		mapProb  = G_MapWinProb(winner);
+		job->mapProb = G_SkillRatingReadMapRating(job->mapname);
+
+		G_DB_LogPrintf("SkillRating: Map bias: %.6f\n", job->mapProb);
+
+		// same as G_MapWinProb
+		mapProb  = job->mapProb ? job->mapProb : 0.5f;
+		mapProb  = (winner == TEAM_AXIS) ? mapProb : 1.0f - mapProb;
 		mapMu    = 2 * MU * mapProb;
 		mapSigma = 2 * MU * sqrtf(mapProb * (1.0f - mapProb));
 		mapBeta  = mapSigma / 2;
 	}
 
-	// player additive factors
-	result = sqlite3_prepare(level.database.db, SRMATCH_SQLWRAP_TABLE, strlen(SRMATCH_SQLWRAP_TABLE), &sqlstmt, NULL);
+	// log last estimated win probability
+	G_DB_LogPrintf("SkillRating: Win probability X/L: %.6f/%.6f\n", job->axisProb, job->alliesProb);
 
-	if (result != SQLITE_OK)
-	{
-		G_Printf("G_UpdateSkillRating: sqlite3_prepare failed: %s\n", err_msg);
-		sqlite3_free(err_msg);
-		return;
-	}
+	// player additive factors
+	sqlstmt = G_DB_Statement(DB_STMT_SRMATCH_TABLE);
 
-	while (sqlite3_step(sqlstmt) == SQLITE_ROW)
+	while (G_DB_Step(DB_STMT_SRMATCH_TABLE) == SQLITE_ROW)
 	{
 		// assign match data
 		sr_data.mu          = sqlite3_column_double(sqlstmt, 1);
@@ -1028,16 +992,10 @@ void G_UpdateSkillRating(int winner)
 		}
 	}
 
-	result = sqlite3_finalize(sqlstmt);
-
-	if (result != SQLITE_OK)
-	{
-		G_Printf("G_UpdateSkillRating: sqlite3_finalize failed\n");
-		return;
-	}
+	G_DB_Reset(DB_STMT_SRMATCH_TABLE);
 
 	// normalizing constant
-	if (g_skillRating.integer > 1)
+	if (job->skillRating > 1)
 	{
 		c = sqrt(teamSigmaSqX + teamSigmaSqL + (numPlayersX + numPlayersL) * pow(BETA, 2) + pow(mapSigma, 2) + pow(mapBeta, 2));
 	}
@@ -1051,7 +1009,7 @@ void G_UpdateSkillRating(int winner)
 	losingMu  = (winner == TEAM_AXIS) ? teamMuL : teamMuX;
 
 	// map bias
-	if (g_skillRating.integer > 1)
+	if (job->skillRating > 1)
 	{
 		if (mapProb > 0.5f)
 		{
@@ -1071,19 +1029,13 @@ void G_UpdateSkillRating(int winner)
 	w = W(t, EPSILON / c);
 
 	// update players rating
-	result = sqlite3_prepare(level.database.db, SRMATCH_SQLWRAP_TABLE, strlen(SRMATCH_SQLWRAP_TABLE), &sqlstmt, NULL);
+	sqlstmt = G_DB_Statement(DB_STMT_SRMATCH_TABLE);
 
-	if (result != SQLITE_OK)
-	{
-		G_Printf("G_UpdateSkillRating: sqlite3_prepare failed: %s\n", err_msg);
-		sqlite3_free(err_msg);
-		return;
-	}
-
-	while (sqlite3_step(sqlstmt) == SQLITE_ROW)
+	while (G_DB_Step(DB_STMT_SRMATCH_TABLE) == SQLITE_ROW)
 	{
 		// assign match data
-		sr_data.guid        = sqlite3_column_text(sqlstmt, 0);
+		guid = sqlite3_column_text(sqlstmt, 0);
+		Q_strncpyz(sr_data.guid, guid ? (const char *)guid : "", sizeof(sr_data.guid));
 		sr_data.mu          = sqlite3_column_double(sqlstmt, 1);
 		sr_data.sigma       = sqlite3_column_double(sqlstmt, 2);
 		sr_data.time_axis   = sqlite3_column_int(sqlstmt, 3);
@@ -1126,10 +1078,11 @@ void G_UpdateSkillRating(int winner)
 		// save or update rating in rating_users table
 		if (G_SkillRatingSetUserRating(&sr_data))
 		{
-			return;
+			G_DB_Reset(DB_STMT_SRMATCH_TABLE);
+			return 1;
 		}
 
-		G_LogPrintf("SkillRating: GUID: %s, Delta SR: %+.6f, SR: %.6f (%.6f, %.6f), Old SR: %.6f (%.6f, %.6f), Time X/L: %d/%d\n",
+		G_DB_LogPrintf("SkillRating: GUID: %s, Delta SR: %+.6f, SR: %.6f (%.6f, %.6f), Old SR: %.6f (%.6f, %.6f), Time X/L: %d/%d\n",
 		            sr_data.guid,
 		            (sr_data.mu - 3 * sr_data.sigma) - (oldMu - 3 * oldSigma),
 		            sr_data.mu - 3 * sr_data.sigma, sr_data.mu, sr_data.sigma,
@@ -1137,11 +1090,41 @@ void G_UpdateSkillRating(int winner)
 		            sr_data.time_axis, sr_data.time_allies);
 	}
 
-	result = sqlite3_finalize(sqlstmt);
+	G_DB_Reset(DB_STMT_SRMATCH_TABLE);
 
-	if (result != SQLITE_OK)
+	return 0;
+}
+
+/**
+ * @brief Applies the result of G_UpdateSkillRatingJob on the game thread
+ * @param[in] data srMatchJob_t
+ * @param[in] result
+ */
+static void G_UpdateSkillRatingDone(void *data, int result)
+{
+	srMatchJob_t *job = (srMatchJob_t *)data;
+	char         cs[MAX_STRING_CHARS];
+	int          i;
+	gclient_t    *cl;
+
+	if (job->skillRating > 1)
+	{
+		level.mapProb = job->mapProb;
+
+		// update map bias on intermission scoreboard
+		trap_GetConfigstring(CS_MODINFO, cs, sizeof(cs));
+		Info_SetValueForKey(cs, "M", va("%f", level.mapProb));
+		trap_SetConfigstring(CS_MODINFO, cs);
+
+		// same fallback as G_MapWinProb
+		if (!level.mapProb)
+		{
+			level.mapProb = 0.5f;
+		}
+	}
+
+	if (result)
 	{
-		G_Printf("G_UpdateSkillRating: sqlite3_finalize failed\n");
 		return;
 	}
 
@@ -1158,6 +1141,121 @@ void G_UpdateSkillRating(int winner)
 	}
 }
 
+/**
+ * @brief Update skill rating
+ * @details Update player's skill rating based on team performance. The database work
+ *          is queued and connected players get their new rating once it is done.
+ * @param[in] winner
+ */
+void G_UpdateSkillRating(int winner)
+{
+	srMatchJob_t job;
+
+	if (!level.database.initialized)
+	{
+		G_Printf("G_UpdateSkillRating: access to non-initialized database\n");
+		return;
+	}
+
+	Q_strncpyz(job.mapname, level.rawmapname, sizeof(job.mapname));
+	job.winner      = winner;
+	job.totalTime   = level.intermissionQueued - level.startTime - level.timeDelta;
+	job.skillRating = g_skillRating.integer;
+	job.mapProb     = level.mapProb;
+	job.axisProb    = level.axisProb;
+	job.alliesProb  = level.alliesProb;
+
+	G_DB_Queue(G_UpdateSkillRatingJob, G_UpdateSkillRatingDone, &job, sizeof(job));
+}
+
+/**
+ * @struct srProbJob_s
+ * @typedef srProbJob_t
+ * @brief Disconnected players' share of G_CalculateWinProbability
+ */
+typedef struct srProbJob_s
+{
+	char guids[MAX_CLIENTS][MAX_GUID_LENGTH + 1];   ///< connected players, skipped in rating_match
+	int numGuids;
+	int currentTime;
+	float teamMuX;
+	float teamMuL;
+	float teamSigmaSqX;
+	float teamSigmaSqL;
+	int numPlayersX;
+	int numPlayersL;
+} srProbJob_t;
+
+/**
+ * @brief Database job adding the players who left the match to the team factors
+ * @param[in,out] data srProbJob_t
+ * @return 0 if successful, 1 otherwise.
+ */
+static int G_CalculateWinProbabilityJob(void *data)
+{
+	srProbJob_t         *job = (srProbJob_t *)data;
+	int                 i;
+	sqlite3_stmt        *sqlstmt;
+	srData_t            sr_data;
+	const unsigned char *guid;
+	qboolean            isPlaying;
+
+	sqlstmt = G_DB_Statement(DB_STMT_SRMATCH_TABLE);
+
+	while (G_DB_Step(DB_STMT_SRMATCH_TABLE) == SQLITE_ROW)
+	{
+		// assign match data
+		guid = sqlite3_column_text(sqlstmt, 0);
+		Q_strncpyz(sr_data.guid, guid ? (const char *)guid : "", sizeof(sr_data.guid));
+		sr_data.mu          = sqlite3_column_double(sqlstmt, 1);
+		sr_data.sigma       = sqlite3_column_double(sqlstmt, 2);
+		sr_data.time_axis   = sqlite3_column_int(sqlstmt, 3);
+		sr_data.time_allies = sqlite3_column_int(sqlstmt, 4);
+
+		// player has not played at all
+		if (sr_data.time_axis == 0 && sr_data.time_allies == 0)
+		{
+			continue;
+		}
+
+		// player has reconnected
+		isPlaying = qfalse;
+
+		for (i = 0; i < job->numGuids; i++)
+		{
+			if (!Q_strncmp(sr_data.guid, job->guids[i], MAX_GUID_LENGTH + 1))
+			{
+				isPlaying = qtrue;
+				break;
+			}
+		}
+
+		if (isPlaying)
+		{
+			continue;
+		}
+
+		// player has played in at least one of the team
+		if (sr_data.time_axis > 0)
+		{
+			job->teamMuX      += sr_data.mu * (sr_data.time_axis / (float)job->currentTime);
+			job->teamSigmaSqX += pow(sr_data.sigma, 2);
+			job->numPlayersX++;
+		}
+
+		if (sr_data.time_allies > 0)
+		{
+			job->teamMuL      += sr_data.mu * (sr_data.time_allies / (float)job->currentTime);
+			job->teamSigmaSqL += pow(sr_data.sigma, 2);
+			job->numPlayersL++;
+		}
+	}
+
+	G_DB_Reset(DB_STMT_SRMATCH_TABLE);
+
+	return 0;
+}
+
 /**
  * @brief Calculate win probability
  * @details Calculate win probability // Axis = winprob, Allies = 1.0 - winprob
@@ -1254,81 +1352,36 @@ float G_CalculateWinProbability(int team)
 	// player additive factors - take time of disconnected players into account
 	if (g_gamestate.integer == GS_PLAYING)
 	{
-		int          result;
-		char         *err_msg = NULL;
-		sqlite3_stmt *sqlstmt;
-		srData_t     sr_data;
-
-		result = sqlite3_prepare(level.database.db, SRMATCH_SQLWRAP_TABLE, strlen(SRMATCH_SQLWRAP_TABLE), &sqlstmt, NULL);
-
-		if (result != SQLITE_OK)
-		{
-			G_Printf("G_CalculateWinProbability: sqlite3_prepare failed: %s\n", err_msg);
-			sqlite3_free(err_msg);
-			return 0.5f;
-		}
+		srProbJob_t job;
 
-		while (sqlite3_step(sqlstmt) == SQLITE_ROW)
+		for (i = 0; i < level.maxclients; i++)
 		{
-			// assign match data
-			sr_data.guid        = sqlite3_column_text(sqlstmt, 0);
-			sr_data.mu          = sqlite3_column_double(sqlstmt, 1);
-			sr_data.sigma       = sqlite3_column_double(sqlstmt, 2);
-			sr_data.time_axis   = sqlite3_column_int(sqlstmt, 3);
-			sr_data.time_allies = sqlite3_column_int(sqlstmt, 4);
+			char userinfo[MAX_INFO_STRING];
 
-			// player has not played at all
-			if (sr_data.time_axis == 0 && sr_data.time_allies == 0)
-			{
-				continue;
-			}
-
-			// player has reconnected
-			qboolean isPlaying = qfalse;
-
-			for (i = 0, cl = level.clients; i < level.maxclients; i++, cl++)
-			{
-				char userinfo[MAX_INFO_STRING];
-				char *guid;
-
-				trap_GetUserinfo(cl - level.clients, userinfo, sizeof(userinfo));
-				guid = Info_ValueForKey(userinfo, "cl_guid");
-
-				if (!Q_strncmp((const char *)sr_data.guid, guid, MAX_GUID_LENGTH + 1))
-				{
-					isPlaying = qtrue;
-					break;
-				}
-			}
-
-			if (isPlaying)
-			{
-				continue;
-			}
-
-			// player has played in at least one of the team
-			if (sr_data.time_axis > 0)
-			{
-				teamMuX      += sr_data.mu * (sr_data.time_axis / (float)currentTime);
-				teamSigmaSqX += pow(sr_data.sigma, 2);
-				numPlayersX++;
-			}
-
-			if (sr_data.time_allies > 0)
-			{
-				teamMuL      += sr_data.mu * (sr_data.time_allies / (float)currentTime);
-				teamSigmaSqL += pow(sr_data.sigma, 2);
-				numPlayersL++;
-			}
+			trap_GetUserinfo(i, userinfo, sizeof(userinfo));
+			Q_strncpyz(job.guids[i], Info_ValueForKey(userinfo, "cl_guid"), sizeof(job.guids[i]));
 		}
 
-		result = sqlite3_finalize(sqlstmt);
+		job.numGuids     = level.maxclients;
+		job.currentTime  = currentTime;
+		job.teamMuX      = teamMuX;
+		job.teamMuL      = teamMuL;
+		job.teamSigmaSqX = teamSigmaSqX;
+		job.teamSigmaSqL = teamSigmaSqL;
+		job.numPlayersX  = numPlayersX;
+		job.numPlayersL  = numPlayersL;
 
-		if (result != SQLITE_OK)
+		if (G_DB_Run(G_CalculateWinProbabilityJob, &job))
 		{
-			G_Printf("G_CalculateWinProbability: sqlite3_finalize failed\n");
 			return 0.5f;
 		}
+
+		teamMuX      = job.teamMuX;
+		teamMuL      = job.teamMuL;
+		teamSigmaSqX = job.teamSigmaSqX;
+		teamSigmaSqL = job.teamSigmaSqL;
+		numPlayersX  = job.numPlayersX;
+		numPlayersL  = job.numPlayersL;
 	}
 
 	// normalizing constant
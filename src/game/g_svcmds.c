@@ -630,6 +630,181 @@ void Svcmd_EntityList_f(void)
 	G_Printf("^2%4i: num_entities - %4i: entities not in use\n", level.num_entities, entsFree);
 }
 
+/**
+ * @struct stressEntity_s
+ * @brief An entity spawned by Svcmd_EntityStress_f
+ */
+typedef struct stressEntity_s
+{
+	gentity_t *ent;
+	int freeTime;               ///< level.time to free it at
+} stressEntity_t;
+
+/**
+ * @brief Spawns and frees entities like a full server on a panzer and artillery spam
+ * round does, once with G_Spawn and once with G_SpawnLinear, and times both
+ *
+ * @details 64 players fire a panzerfaust every 2.5 seconds and cause a bullet impact event
+ * every fourth frame, 8 field ops call in 8 artillery shells every 20 seconds.
+ * Missiles turn into their explosion event, events live EVENT_VALID_MSEC.
+ * The entities are never linked, level.time is restored and the slots opened up
+ * for them are given back afterwards.
+ *
+ * Only runs with cheats enabled on a server without clients or bots and with
+ * Omni-Bot disabled: it runs the real spawn and free paths on the live entity
+ * list, nothing else may see the entities or the time jump.
+ */
+void Svcmd_EntityStress_f(void)
+{
+	static stressEntity_t stress[MAX_GENTITIES];
+	char                  arg[MAX_TOKEN_CHARS];
+	gentity_t             *(*spawn)(void);
+	gentity_t             *e;
+	int                   i, j, k, numStress, room, frameTime, levelTime, endTime, start, msec, spawns, opened;
+
+	if (!g_cheats.integer)
+	{
+		G_Printf("Cheats are not enabled on this server.\n");
+		return;
+	}
+
+	if (level.numConnectedClients)
+	{
+		G_Printf("entitystress: only runs on an empty server\n");
+		return;
+	}
+
+#ifdef FEATURE_OMNIBOT
+	if (g_OmniBotEnable.integer)
+	{
+		G_Printf("entitystress: disable Omni-Bot first\n");
+		return;
+	}
+#endif
+
+	trap_Argv(1, arg, sizeof(arg));
+	endTime   = (trap_Argc() > 1 ? MAX(Q_atoi(arg), 1) : 60) * 1000;
+	frameTime = level.frameTime > 0 ? level.frameTime : 50;
+	levelTime = level.time;
+
+	// leave room for the entities already in use and some spare ones
+	room = MIN(G_EntitiesFree() - 2 - 64, MAX_GENTITIES);
+	if (room <= 0)
+	{
+		G_Printf("entitystress: no free entities\n");
+		return;
+	}
+
+	for (k = 0 ; k < 2 ; k++)
+	{
+		spawn     = k ? G_SpawnLinear : G_Spawn;
+		numStress = spawns = 0;
+		opened    = level.num_entities;
+		start     = trap_Milliseconds();
+
+		for (level.time = levelTime ; level.time < levelTime + endTime ; level.time += frameTime)
+		{
+			// free the expired ones, missiles explode first
+			for (i = 0 ; i < numStress ; )
+			{
+				if (stress[i].freeTime > level.time)
+				{
+					i++;
+					continue;
+				}
+
+				if (stress[i].ent->s.eType == ET_MISSILE)
+				{
+					stress[i].ent->s.eType = ET_GENERAL;
+					stress[i].freeTime     = level.time + EVENT_VALID_MSEC;
+					i++;
+					continue;
+				}
+
+				G_FreeEntity(stress[i].ent);
+				stress[i] = stress[--numStress];
+			}
+
+			for (i = 0 ; i < 64 && numStress < room ; i++)
+			{
+				// panzerfaust
+				if ((level.time - levelTime + i * 37) % 2500 < frameTime)
+				{
+					e            = spawn();
+					e->classname = "entitystress";
+					e->s.eType   = ET_MISSILE;
+
+					stress[numStress].ent        = e;
+					stress[numStress++].freeTime = level.time + 500 + (i * 13) % 1500;
+					spawns++;
+				}
+
+				// bullet impact
+				if (((level.time - levelTime) / frameTime + i) % 4 == 0 && numStress < room)
+				{
+					e            = spawn();
+					e->classname = "entitystress";
+					e->s.eType   = ET_EVENTS + EV_BULLET_HIT_WALL;
+
+					stress[numStress].ent        = e;
+					stress[numStress++].freeTime = level.time + EVENT_VALID_MSEC;
+					spawns++;
+				}
+			}
+
+			// artillery
+			for (i = 0 ; i < 8 ; i++)
+			{
+				if ((level.time - levelTime + i * 2500) % 20000 >= frameTime)
+				{
+					continue;
+				}
+
+				for (j = 0 ; j < 8 && numStress < room ; j++)
+				{
+					e            = spawn();
+					e->classname = "entitystress";
+					e->s.eType   = ET_MISSILE;
+
+					stress[numStress].ent        = e;
+					stress[numStress++].freeTime = level.time + 2000 + j * 300;
+					spawns++;
+				}
+			}
+		}
+
+		for (i = 0 ; i < numStress ; i++)
+		{
+			G_FreeEntity(stress[i].ent);
+		}
+
+		msec = trap_Milliseconds() - start;
+
+		G_Printf("%-8s %i seconds, %i spawns: %5i msec, %.2f usec per spawn, %i new slots, num_entities %i\n",
+		         k ? "linear:" : "G_Spawn:", endTime / 1000, spawns, msec, spawns ? msec * 1000.0 / spawns : 0.0,
+		         level.num_entities - opened, level.num_entities);
+
+		// give back the slots opened up for the run, they are all free again
+		while (level.num_entities > opened && !g_entities[level.num_entities - 1].inuse)
+		{
+			level.num_entities--;
+		}
+		trap_LocateGameData(level.gentities, level.num_entities, sizeof(gentity_t),
+		                    &level.clients[0].ps, sizeof(level.clients[0]));
+
+		// slots freed during the run must not wait for level.time to catch up
+		level.time = levelTime;
+		for (i = MAX_CLIENTS ; i < level.num_entities ; i++)
+		{
+			if (!g_entities[i].inuse && g_entities[i].freetime > level.time)
+			{
+				g_entities[i].freetime = level.time;
+			}
+		}
+		G_RebuildFreeEntities();
+	}
+}
+
 /**
  * @brief ClientForString
  * @param[in] s
@@ -2589,9 +2764,13 @@ qboolean Svcmd_Chat_f(void)
 static consoleCommandTable_t consoleCommandTable[] =
 {
 	{ "entitylist",                 Svcmd_EntityList_f            },
+	{ "entitystress",               Svcmd_EntityStress_f          },
 	{ "csinfo",                     Svcmd_CSInfo_f                },
 	{ "forceteam",                  Svcmd_ForceTeam_f             },
 	{ "game_memory",                Svcmd_GameMem_f               },
+#ifdef FEATURE_DBMS
+	{ "db_stats",                   Svcmd_DBStats_f               },
+#endif
 	{ "addip",                      Svcmd_AddIP_f                 },
 	{ "removeip",                   Svcmd_RemoveIP_f              },
 	{ "listip",                     Svcmd_ListIp_f                },
@@ -35,6 +35,13 @@
 
 #include "g_local.h"
 
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#else
+#   include <time.h>
+#endif
+
 #ifdef FEATURE_OMNIBOT
 #include "g_etbot_interface.h"
 #endif
@@ -306,11 +313,266 @@ void G_TeamCommand(team_t team, const char *cmd)
 	}
 }
 
+/**
+ * @name Entity name indexes
+ *
+ * Entities are hashed by classname, targetname and scriptName so G_Find and friends
+ * walk the entities with a matching name instead of all of them. Each chain is kept
+ * sorted by entity number, so the search order is the same as a scan of g_entities.
+ *
+ * Names are mostly set right after G_Spawn, so spawned entities are indexed on the
+ * next search. G_FreeEntity, G_SetTargetName and G_IndexEntity update an entity right
+ * away, everything else is picked up by G_SyncEntityIndex at the start of each frame.
+ *
+ * @note Unlike the old scan, G_Find only sees a rename written straight into the name
+ * of an indexed entity from the next frame on. Until then it may miss the entity under
+ * its new name, though never returns it under the old one. Code renaming a live
+ * entity and searching for it in the same frame has to call G_IndexEntity.
+ * @{
+ */
+
+#define ENTITY_INDEX_HASH   1024    ///< buckets per name index, power of two
+
+/**
+ * @struct entityIndex_s
+ * @brief Entities by one of their names, entity numbers are stored + 1 so 0 ends a chain
+ */
+typedef struct entityIndex_s
+{
+	int fieldofs;                           ///< FOFS() of the name
+	int buckets[ENTITY_INDEX_HASH];         ///< first entity of each chain
+	int next[MAX_GENTITIES];
+	int prev[MAX_GENTITIES];
+	const char *names[MAX_GENTITIES];       ///< name each entity is indexed under, NULL if none
+	int hashes[MAX_GENTITIES];              ///< BG_StringHashValue of names
+} entityIndex_t;
+
+static entityIndex_t entityIndexes[] =
+{
+	{ FOFS(classname),  { 0 }, { 0 }, { 0 }, { NULL }, { 0 } },
+	{ FOFS(targetname), { 0 }, { 0 }, { 0 }, { NULL }, { 0 } },
+	{ FOFS(scriptName), { 0 }, { 0 }, { 0 }, { NULL }, { 0 } },
+};
+
+#define CLASSNAME_INDEX     (&entityIndexes[0])
+#define TARGETNAME_INDEX    (&entityIndexes[1])
+#define SCRIPTNAME_INDEX    (&entityIndexes[2])
+#define NUM_ENTITY_INDEXES  (int)(sizeof(entityIndexes) / sizeof(entityIndexes[0]))
+
+static int  entityIndexPending[MAX_GENTITIES];  ///< spawned since they were last indexed
+static int  numEntityIndexPending;
+static byte entityIndexIsPending[MAX_GENTITIES];
+
+/**
+ * @brief G_IndexEntityName
+ * @param[in,out] index
+ * @param[in] num entity number
+ * @param[in] rehash also notice names rewritten in place
+ */
+static void G_IndexEntityName(entityIndex_t *index, int num, qboolean rehash)
+{
+	const char *name = NULL;
+	int        hash  = 0, i;
+
+	if (g_entities[num].inuse)
+	{
+		name = *(char **)((byte *)&g_entities[num] + index->fieldofs);
+	}
+
+	if (name == index->names[num])
+	{
+		if (!name || !rehash)
+		{
+			return;
+		}
+
+		hash = (int)BG_StringHashValue(name);
+		if (hash == index->hashes[num])
+		{
+			return;
+		}
+	}
+	else if (name)
+	{
+		hash = (int)BG_StringHashValue(name);
+	}
+
+	// take it out of its old chain
+	if (index->names[num])
+	{
+		if (index->prev[num])
+		{
+			index->next[index->prev[num] - 1] = index->next[num];
+		}
+		else
+		{
+			index->buckets[index->hashes[num] & (ENTITY_INDEX_HASH - 1)] = index->next[num];
+		}
+
+		if (index->next[num])
+		{
+			index->prev[index->next[num] - 1] = index->prev[num];
+		}
+	}
+
+	index->names[num]  = name;
+	index->hashes[num] = hash;
+
+	if (!name)
+	{
+		return;
+	}
+
+	// and sort it into the new one
+	index->prev[num] = 0;
+	for (i = index->buckets[hash & (ENTITY_INDEX_HASH - 1)] ; i && i - 1 < num ; i = index->next[i - 1])
+	{
+		index->prev[num] = i;
+	}
+
+	index->next[num] = index->prev[num] ? index->next[index->prev[num] - 1] : index->buckets[hash & (ENTITY_INDEX_HASH - 1)];
+	if (index->next[num])
+	{
+		index->prev[index->next[num] - 1] = num + 1;
+	}
+
+	if (index->prev[num])
+	{
+		index->next[index->prev[num] - 1] = num + 1;
+	}
+	else
+	{
+		index->buckets[hash & (ENTITY_INDEX_HASH - 1)] = num + 1;
+	}
+}
+
+/**
+ * @brief Updates the name indexes after an entity was renamed, spawned or freed
+ * @param[in] ent
+ */
+void G_IndexEntity(gentity_t *ent)
+{
+	int i, num = ent - g_entities;
+
+	for (i = 0 ; i < NUM_ENTITY_INDEXES ; i++)
+	{
+		G_IndexEntityName(&entityIndexes[i], num, qtrue);
+	}
+}
+
+/**
+ * @brief Indexes the entities spawned since the last search
+ */
+static void G_IndexPendingEntities(void)
+{
+	int i, num;
+
+	while (numEntityIndexPending)
+	{
+		num                       = entityIndexPending[--numEntityIndexPending];
+		entityIndexIsPending[num] = qfalse;
+
+		for (i = 0 ; i < NUM_ENTITY_INDEXES ; i++)
+		{
+			G_IndexEntityName(&entityIndexes[i], num, qfalse);
+		}
+	}
+}
+
+/**
+ * @brief Picks up names that were assigned directly since the last frame
+ */
+void G_SyncEntityIndex(void)
+{
+	int i, num;
+
+	G_IndexPendingEntities();
+
+	for (num = 0 ; num < level.num_entities ; num++)
+	{
+		for (i = 0 ; i < NUM_ENTITY_INDEXES ; i++)
+		{
+			G_IndexEntityName(&entityIndexes[i], num, qfalse);
+		}
+	}
+}
+
+/**
+ * @brief Empties the name indexes, for a new level
+ */
+void G_ClearEntityIndex(void)
+{
+	int i;
+
+	for (i = 0 ; i < NUM_ENTITY_INDEXES ; i++)
+	{
+		Com_Memset(entityIndexes[i].buckets, 0, sizeof(entityIndexes[i].buckets));
+		Com_Memset(entityIndexes[i].names, 0, sizeof(entityIndexes[i].names));
+	}
+
+	numEntityIndexPending = 0;
+	Com_Memset(entityIndexIsPending, 0, sizeof(entityIndexIsPending));
+}
+
+/**
+ * @brief G_FindIndexed
+ * @param[in] index
+ * @param[in] from entity to continue after, NULL to start at the first one
+ * @param[in] match
+ * @param[in] hash BG_StringHashValue of match
+ * @return the next entity in use with that name, NULL if there are no more
+ */
+static gentity_t *G_FindIndexed(entityIndex_t *index, gentity_t *from, const char *match, int hash)
+{
+	gentity_t  *ent;
+	const char *name;
+	int        num = -1, i;
+
+	G_IndexPendingEntities();
+
+	if (from)
+	{
+		num = from - g_entities;
+	}
+
+	// carry on in the chain of from, if it is in the one we need
+	if (num >= 0 && index->names[num] && ((index->hashes[num] ^ hash) & (ENTITY_INDEX_HASH - 1)) == 0)
+	{
+		i = index->next[num];
+	}
+	else
+	{
+		for (i = index->buckets[hash & (ENTITY_INDEX_HASH - 1)] ; i && i - 1 <= num ; i = index->next[i - 1])
+		{
+		}
+	}
+
+	for ( ; i ; i = index->next[i - 1])
+	{
+		if (index->hashes[i - 1] != hash || i - 1 >= level.num_entities)
+		{
+			continue;
+		}
+
+		ent  = &g_entities[i - 1];
+		name = *(char **)((byte *)ent + index->fieldofs);
+		if (ent->inuse && name && !Q_stricmp(name, match))
+		{
+			return ent;
+		}
+	}
+
+	return NULL;
+}
+
+/** @} */
+
 /**
  * @brief Searches all active entities for the next one that holds
  * the matching string at fieldofs (use the FOFS() macro) in the structure.
  * Searches beginning at the entity after from, or the beginning if NULL
  * NULL will be returned if the end of the list is reached.
+ * classname, targetname and scriptName are looked up in the name indexes.
  *
  * @param[in,out] from
  * @param[in] fieldofs
@@ -321,6 +583,18 @@ gentity_t *G_Find(gentity_t *from, int fieldofs, const char *match)
 {
 	char      *s;
 	gentity_t *max = &g_entities[level.num_entities];
+	int       i;
+
+	if (match)
+	{
+		for (i = 0 ; i < NUM_ENTITY_INDEXES ; i++)
+		{
+			if (entityIndexes[i].fieldofs == fieldofs)
+			{
+				return G_FindIndexed(&entityIndexes[i], from, match, (int)BG_StringHashValue(match));
+			}
+		}
+	}
 
 	if (!from)
 	{
@@ -474,8 +748,7 @@ gentity_t *G_FindVector(gentity_t *from, int fieldofs, const vec3_t match)
  */
 gentity_t *G_FindByTargetname(gentity_t *from, const char *match)
 {
-	gentity_t *max = &g_entities[level.num_entities];
-	int       hash;
+	int hash;
 
 	hash = BG_StringHashValue(match);
 
@@ -485,34 +758,7 @@ gentity_t *G_FindByTargetname(gentity_t *from, const char *match)
 		return NULL;
 	}
 
-	if (!from)
-	{
-		from = g_entities;
-	}
-	else
-	{
-		from++;
-	}
-
-	for ( ; from < max ; from++)
-	{
-		if (!from->inuse)
-		{
-			continue;
-		}
-
-		if (!from->targetname) // there are ents with no targetname set
-		{
-			continue;
-		}
-
-		if (from->targetnamehash == hash && !Q_stricmp(from->targetname, match))
-		{
-			return from;
-		}
-	}
-
-	return NULL;
+	return G_FindIndexed(TARGETNAME_INDEX, from, match, hash);
 }
 
 /**
@@ -524,36 +770,29 @@ gentity_t *G_FindByTargetname(gentity_t *from, const char *match)
  */
 gentity_t *G_FindByTargetnameFast(gentity_t *from, const char *match, int hash)
 {
-	gentity_t *max = &g_entities[level.num_entities];
-
-	if (!from)
-	{
-		from = g_entities;
-	}
-	else
-	{
-		from++;
-	}
-
-	for ( ; from < max ; from++)
-	{
-		if (!from->inuse)
-		{
-			continue;
-		}
-
-		if (!from->targetname) // there are ents with no targetname set
-		{
-			continue;
-		}
+	return G_FindIndexed(TARGETNAME_INDEX, from, match, hash);
+}
 
-		if (from->targetnamehash == hash && !Q_stricmp(from->targetname, match))
-		{
-			return from;
-		}
-	}
+/**
+ * @brief G_FindByClassname
+ * @param[in,out] from
+ * @param[in] match
+ * @return the next entity after from with that classname
+ */
+gentity_t *G_FindByClassname(gentity_t *from, const char *match)
+{
+	return G_FindIndexed(CLASSNAME_INDEX, from, match, (int)BG_StringHashValue(match));
+}
 
-	return NULL;
+/**
+ * @brief G_FindByScriptName
+ * @param[in,out] from
+ * @param[in] match
+ * @return the next entity after from with that scriptName
+ */
+gentity_t *G_FindByScriptName(gentity_t *from, const char *match)
+{
+	return G_FindIndexed(SCRIPTNAME_INDEX, from, match, (int)BG_StringHashValue(match));
 }
 
 #define MAXCHOICES  32
@@ -781,6 +1020,14 @@ void G_InitGentity(gentity_t *e)
 	e->inuse      = qtrue;
 	e->classname  = "noclass";
 	e->s.number   = e - g_entities;
+
+	// its names are set after this, index them on the next search
+	if (!entityIndexIsPending[e->s.number])
+	{
+		entityIndexIsPending[e->s.number]           = qtrue;
+		entityIndexPending[numEntityIndexPending++] = e->s.number;
+	}
+
 	e->r.ownerNum = ENTITYNUM_NONE;
 	e->nextthink  = 0;
 	e->free       = NULL;
@@ -797,6 +1044,88 @@ void G_InitGentity(gentity_t *e)
 #endif
 }
 
+/**
+ * @brief G_EntityRelaxing
+ * @param[in] e free entity
+ * @return qtrue if the slot was freed too recently to be reused
+ *
+ * @note The first couple seconds of server time can involve a lot of
+ * freeing and allocating, so relax the replacement policy
+ */
+static qboolean G_EntityRelaxing(gentity_t *e)
+{
+	// FIXME: inspect -> add '&& level.startTime != 0' for warmup?
+	return e->freetime > level.startTime + 2000 && level.time - e->freetime < 1000;
+}
+
+/**
+ * @brief Makes a freed entity slot available to G_Spawn
+ * @param[in] e
+ */
+static void G_QueueFreeEntity(gentity_t *e)
+{
+	int num = e - g_entities;
+
+	if (num < MAX_CLIENTS)
+	{
+		return;
+	}
+
+	// slots that are full get picked up again by the scan in G_Spawn
+	if (!G_EntityRelaxing(e))
+	{
+		if (level.numReadyEntities < MAX_GENTITIES)
+		{
+			level.readyEntities[level.numReadyEntities++] = num;
+		}
+	}
+	else if (level.numFreeEntities < MAX_GENTITIES)
+	{
+		// freetime is level.time, so the ring stays sorted by freetime
+		level.freeEntities[(level.freeEntitiesStart + level.numFreeEntities++) % MAX_GENTITIES] = num;
+	}
+}
+
+/**
+ * @brief Takes the next reusable slot off the free entity lists
+ * @param[in] force ignore the reuse delay
+ * @return NULL if no free slot can be reused yet
+ */
+static gentity_t *G_NextFreeEntity(qboolean force)
+{
+	gentity_t *e;
+
+	while (level.numReadyEntities)
+	{
+		e = &g_entities[level.readyEntities[--level.numReadyEntities]];
+		if (!e->inuse)
+		{
+			return e;
+		}
+	}
+
+	while (level.numFreeEntities)
+	{
+		e = &g_entities[level.freeEntities[level.freeEntitiesStart]];
+		if (!e->inuse && !force && G_EntityRelaxing(e))
+		{
+			// the oldest one is still relaxing, so are all others
+			return NULL;
+		}
+
+		level.freeEntitiesStart = (level.freeEntitiesStart + 1) % MAX_GENTITIES;
+		level.numFreeEntities--;
+
+		// slots can be queued again after the scan in G_Spawn reused them
+		if (!e->inuse)
+		{
+			return e;
+		}
+	}
+
+	return NULL;
+}
+
 /**
  * @brief Either finds a free entity, or allocates a new one.
  *
@@ -808,9 +1137,71 @@ void G_InitGentity(gentity_t *e)
  * instead of being removed and recreated, which can cause interpolated
  * angles and bad trails.
  *
+ * Freed slots are kept in level.readyEntities and level.freeEntities by
+ * G_FreeEntity, so finding one does not scan the entity list.
+ *
  * @return
  */
 gentity_t *G_Spawn(void)
+{
+	int       i;
+	gentity_t *e;
+
+	e = G_NextFreeEntity(qfalse);
+
+	if (!e && level.num_entities == ENTITYNUM_MAX_NORMAL)
+	{
+		// if we can't find one to free, override the
+		// normal minimum times before use
+		e = G_NextFreeEntity(qtrue);
+
+		// slots that did not fit the lists
+		for (i = MAX_CLIENTS ; !e && i < level.num_entities ; i++)
+		{
+			if (!g_entities[i].inuse)
+			{
+				e = &g_entities[i];
+			}
+		}
+
+		if (!e)
+		{
+			for (i = 0; i < MAX_GENTITIES; i++)
+			{
+				G_Printf("%4i: %s\n", i, g_entities[i].classname);
+			}
+			G_Error("G_Spawn: no free entities\n");
+		}
+	}
+
+	if (e)
+	{
+		// reuse this slot
+		G_InitGentity(e);
+		return e;
+	}
+
+	// open up a new slot
+	e = &g_entities[level.num_entities];
+	level.num_entities++;
+
+	// let the server system know that there are more entities
+	trap_LocateGameData(level.gentities, level.num_entities, sizeof(gentity_t),
+	                    &level.clients[0].ps, sizeof(level.clients[0]));
+
+	G_InitGentity(e);
+	return e;
+}
+
+/**
+ * @brief G_Spawn without the free entity lists
+ *
+ * @details Scans the entity list for the lowest free slot, the way G_Spawn used to.
+ * Only used by entitystress to compare against, call G_RebuildFreeEntities after it.
+ *
+ * @return
+ */
+gentity_t *G_SpawnLinear(void)
 {
 	int       i = 0, force;
 	gentity_t *e = NULL;
@@ -827,10 +1218,7 @@ gentity_t *G_Spawn(void)
 				continue;
 			}
 
-			// the first couple seconds of server time can involve a lot of
-			// freeing and allocating, so relax the replacement policy
-			// FIXME: inspect -> add '&& level.startTime != 0' for warmup?
-			if (!force && e->freetime > level.startTime + 2000 && level.time - e->freetime < 1000)
+			if (!force && G_EntityRelaxing(e))
 			{
 				continue;
 			}
@@ -847,10 +1235,6 @@ gentity_t *G_Spawn(void)
 
 	if (i == ENTITYNUM_MAX_NORMAL)
 	{
-		for (i = 0; i < MAX_GENTITIES; i++)
-		{
-			G_Printf("%4i: %s\n", i, g_entities[i].classname);
-		}
 		G_Error("G_Spawn: no free entities\n");
 	}
 
@@ -865,6 +1249,42 @@ gentity_t *G_Spawn(void)
 	return e;
 }
 
+/**
+ * @brief Refills the free entity lists from the entity slots
+ */
+void G_RebuildFreeEntities(void)
+{
+	int       i, j;
+	gentity_t *e;
+
+	level.numReadyEntities  = 0;
+	level.numFreeEntities   = 0;
+	level.freeEntitiesStart = 0;
+
+	// backwards, so the lowest slots are reused first
+	for (i = level.num_entities - 1 ; i >= MAX_CLIENTS ; i--)
+	{
+		e = &g_entities[i];
+		if (e->inuse)
+		{
+			continue;
+		}
+
+		if (!G_EntityRelaxing(e))
+		{
+			level.readyEntities[level.numReadyEntities++] = i;
+			continue;
+		}
+
+		// keep the ring sorted by freetime
+		for (j = level.numFreeEntities++ ; j > 0 && g_entities[level.freeEntities[j - 1]].freetime > e->freetime ; j--)
+		{
+			level.freeEntities[j] = level.freeEntities[j - 1];
+		}
+		level.freeEntities[j] = i;
+	}
+}
+
 /**
  * @brief G_EntitiesFree
  * @return
@@ -893,6 +1313,8 @@ int G_EntitiesFree(void)
  */
 void G_FreeEntity(gentity_t *ent)
 {
+	qboolean inuse = ent->inuse;
+
 #ifdef FEATURE_OMNIBOT
 	Bot_Event_EntityDeleted(ent);
 #endif
@@ -917,8 +1339,7 @@ void G_FreeEntity(gentity_t *ent)
 	// - when enabled g_debugHitboxes, g_debugPlayerHitboxes or g_debugbullets 3 we want visible trace effects - don't free immediately
 	// FIXME: remove tmp var l_free if we are sure there are no issues caused by this change (especially on network games)
 	if ((ent->s.eType == ET_TEMPHEAD || ent->s.eType == ET_TEMPLEGS || ent->s.eType == ET_CORPSE || ent->s.eType >= ET_EVENTS)
-	    && trap_Cvar_VariableIntegerValue("g_debugHitboxes") == 0 && trap_Cvar_VariableIntegerValue("g_debugPlayerHitboxes") == 0
-	    && trap_Cvar_VariableIntegerValue("g_debugbullets") < 3)
+	    && g_debugHitboxes.integer == 0 && g_debugPlayerHitboxes.integer == 0 && g_debugBullets.integer < 3)
 	{
 		// debug
 		if (g_developer.integer)
@@ -946,6 +1367,14 @@ void G_FreeEntity(gentity_t *ent)
 		ent->freetime  = level.time;
 		ent->inuse     = qfalse;
 	}
+
+	G_IndexEntity(ent);
+
+	// freeing a free entity must not queue its slot twice
+	if (inuse)
+	{
+		G_QueueFreeEntity(ent);
+	}
 }
 
 /**
@@ -2158,3 +2587,30 @@ qboolean CG_ParseMapVotePlayersCountConfig(void)
 
 	return qtrue;
 }
+
+/**
+ * @brief Monotonic microsecond clock for profiling counters
+ * @return
+ */
+int64_t G_Microseconds(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER        counter;
+
+	if (!frequency.QuadPart)
+	{
+		QueryPerformanceFrequency(&frequency);
+	}
+
+	QueryPerformanceCounter(&counter);
+
+	return (int64_t)(counter.QuadPart * 1000000 / frequency.QuadPart);
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
@@ -34,30 +34,21 @@
 
 #define bf_write(bf, T, input) *((T*)bf++) = (T)input;
 #define bf_read(bf, T, output) output = *((T*)bf++);
-#define assert_return(cond, status, msg) \
-	if (!(cond)) { \
-		if (msg) { \
-			G_Printf("^1%s (%i): failed: %s\n", __func__, __LINE__, msg); \
-		} \
-		return status; \
-	}
 
 typedef struct xpData_s
 {
-	const unsigned char *guid;
+	char guid[MAX_GUID_LENGTH + 1];
 	int skillpoints[SK_NUM_SKILLS];
 	int medals[SK_NUM_SKILLS];
 } xpData_t;
 
 static int G_XPSaver_Read(xpData_t *xp_data);
 static int G_XPSaver_Write(xpData_t *xp_data);
+static int G_XPSaver_ReadJob(void *data);
+static int G_XPSaver_WriteJob(void *data);
 
 #define XPCHECK_SQLWRAP_TABLES "SELECT * FROM xpsave_users;"
 #define XPCHECK_SQLWRAP_SCHEMA "SELECT guid, skills, medals, created, updated FROM xpsave_users;"
-#define XPUSERS_SQLWRAP_SELECT "SELECT * FROM xpsave_users WHERE guid = '%s';"
-#define XPUSERS_SQLWRAP_INSERT "INSERT INTO xpsave_users (guid, skills, medals, created, updated) VALUES ('%s', ?, ?, CURRENT_TIMESTAMP, CURRENT_TIMESTAMP);"
-#define XPUSERS_SQLWRAP_UPDATE "UPDATE xpsave_users SET skills = ?, medals = ?, updated = CURRENT_TIMESTAMP WHERE guid = '%s';"
-#define XPUSERS_SQLWRAP_DELETE "DELETE FROM xpsave_users"
 
 /**
  * @brief Checks if database exists, if tables exist and if schemas are correct
@@ -176,10 +167,10 @@ void G_XPSaver_Load(gclient_t *cl)
 	guid = Info_ValueForKey(userinfo, "cl_guid");
 
 	// assign guid
-	xp_data.guid = (const unsigned char *)guid;
+	Q_strncpyz(xp_data.guid, guid, sizeof(xp_data.guid));
 
 	// retrieve current xp or assign default values
-	if (G_XPSaver_Read(&xp_data))
+	if (G_DB_Run(G_XPSaver_ReadJob, &xp_data))
 	{
 		return;
 	}
@@ -238,7 +229,7 @@ void G_XPSaver_Store(gclient_t *cl)
 	trap_GetUserinfo(clientNum, userinfo, sizeof(userinfo));
 	guid = Info_ValueForKey(userinfo, "cl_guid");
 
-	xp_data.guid = (const unsigned char *)guid;
+	Q_strncpyz(xp_data.guid, guid, sizeof(xp_data.guid));
 
 	for (i = 0; i < SK_NUM_SKILLS; i++)
 	{
@@ -246,11 +237,8 @@ void G_XPSaver_Store(gclient_t *cl)
 		xp_data.medals[i] = (int)cl->sess.medals[i];
 	}
 
-	// save or update xp
-	if (G_XPSaver_Write(&xp_data))
-	{
-		return;
-	}
+	// save or update xp on the database thread
+	G_DB_Queue(G_XPSaver_WriteJob, NULL, &xp_data, sizeof(xp_data));
 }
 
 /**
@@ -271,23 +259,34 @@ static int G_XPSaver_Read(xpData_t *xp_data)
 
 	if (!level.database.initialized)
 	{
-		G_Printf("G_XPSaver_Read: access to non-initialized database\n");
+		G_DB_Printf("G_XPSaver_Read: access to non-initialized database\n");
 		return 1;
 	}
 
-	result = sqlite3_prepare(level.database.db, va(XPUSERS_SQLWRAP_SELECT, xp_data->guid), -1, &sqlstmt, NULL);
-	assert_return(result == SQLITE_OK, 1, sqlite3_errmsg(level.database.db));
+	sqlstmt = G_DB_Statement(DB_STMT_XPUSERS_SELECT);
+
+	result = sqlite3_bind_text(sqlstmt, 1, xp_data->guid, -1, SQLITE_STATIC);
+	if (result != SQLITE_OK)
+	{
+		G_DB_Printf("^1%s (%i): failed: %s\n", __func__, __LINE__, sqlite3_errmsg(level.database.db));
+		G_DB_Reset(DB_STMT_XPUSERS_SELECT);
+		return 1;
+	}
 
-	result = sqlite3_step(sqlstmt);
+	result = G_DB_Step(DB_STMT_XPUSERS_SELECT);
 
 	if (result == SQLITE_ROW)
-	{	
+	{
 		/* retrieve skills */
 		pSkills = (int*)sqlite3_column_blob(sqlstmt, 1);
-		assert_return(pSkills, 1, sqlite3_errmsg(level.database.db));
-
 		pMedals = (int*)sqlite3_column_blob(sqlstmt, 2);
-		assert_return(pMedals, 2, sqlite3_errmsg(level.database.db));
+
+		if (!pSkills || !pMedals)
+		{
+			G_DB_Printf("^1%s (%i): failed: %s\n", __func__, __LINE__, sqlite3_errmsg(level.database.db));
+			G_DB_Reset(DB_STMT_XPUSERS_SELECT);
+			return pSkills ? 2 : 1;
+		}
 
 		for (i = 0; i < SK_NUM_SKILLS; i++)
 		{
@@ -299,16 +298,15 @@ static int G_XPSaver_Read(xpData_t *xp_data)
 	else if (result != SQLITE_DONE)
 	{
 		err = sqlite3_errmsg(level.database.db);
-		if (err) 
+		if (err)
 		{
-			G_Printf("^3%s (%i): failed: %s\n", __func__, __LINE__, err);
+			G_DB_Printf("^3%s (%i): failed: %s\n", __func__, __LINE__, err);
 		}
-		sqlite3_finalize(sqlstmt);
+		G_DB_Reset(DB_STMT_XPUSERS_SELECT);
 		return 1;
 	}
 
-	result = sqlite3_finalize(sqlstmt);
-	assert_return(result == SQLITE_OK, 1, sqlite3_errmsg(level.database.db));	
+	G_DB_Reset(DB_STMT_XPUSERS_SELECT);
 
 	return 0;
 }
@@ -320,23 +318,32 @@ static int G_XPSaver_Read(xpData_t *xp_data)
  */
 static int G_XPSaver_Write(xpData_t *xp_data)
 {
-	int          i;
-	int          result;
-	sqlite3_stmt *sqlstmt;
-	int          buffer[SK_NUM_SKILLS * 2];
-	int          *pSkills;
-	int          *pMedals;
+	int           i;
+	int           result;
+	dbStatement_t id;
+	sqlite3_stmt  *sqlstmt;
+	int           buffer[SK_NUM_SKILLS * 2];
+	int           *pSkills;
+	int           *pMedals;
 
 	if (!level.database.initialized)
 	{
-		G_Printf("G_XPSaver_Write: access to non-initialized database\n");
+		G_DB_Printf("G_XPSaver_Write: access to non-initialized database\n");
 		return 1;
 	}
 
-	result = sqlite3_prepare(level.database.db, va(XPUSERS_SQLWRAP_SELECT, xp_data->guid), -1, &sqlstmt, NULL);
-	assert_return(result == SQLITE_OK, 1, sqlite3_errmsg(level.database.db));
+	sqlstmt = G_DB_Statement(DB_STMT_XPUSERS_SELECT);
 
-	result = sqlite3_step(sqlstmt);
+	result = sqlite3_bind_text(sqlstmt, 1, xp_data->guid, -1, SQLITE_STATIC);
+	if (result != SQLITE_OK)
+	{
+		G_DB_Printf("^1%s (%i): failed: %s\n", __func__, __LINE__, sqlite3_errmsg(level.database.db));
+		G_DB_Reset(DB_STMT_XPUSERS_SELECT);
+		return 1;
+	}
+
+	result = G_DB_Step(DB_STMT_XPUSERS_SELECT);
+	G_DB_Reset(DB_STMT_XPUSERS_SELECT);
 
 	pSkills = buffer;
 	pMedals = buffer + SK_NUM_SKILLS;
@@ -346,54 +353,91 @@ static int G_XPSaver_Write(xpData_t *xp_data)
 		bf_write(pMedals, int, xp_data->medals[i]);
 	}
 
-	if (result == SQLITE_DONE)
+	id      = (result == SQLITE_DONE) ? DB_STMT_XPUSERS_INSERT : DB_STMT_XPUSERS_UPDATE;
+	sqlstmt = G_DB_Statement(id);
+
+	// guid is the first parameter of the insert and the last of the update
+	result = sqlite3_bind_text(sqlstmt, id == DB_STMT_XPUSERS_INSERT ? 1 : 3, xp_data->guid, -1, SQLITE_STATIC);
+	if (result == SQLITE_OK)
 	{
-		result = sqlite3_prepare(level.database.db, va(XPUSERS_SQLWRAP_INSERT, xp_data->guid), -1, &sqlstmt, NULL);
+		result = sqlite3_bind_blob(sqlstmt, id == DB_STMT_XPUSERS_INSERT ? 2 : 1, buffer, sizeof(int) * SK_NUM_SKILLS, SQLITE_STATIC);
 	}
-	else
+	if (result == SQLITE_OK)
 	{
-		result = sqlite3_prepare(level.database.db, va(XPUSERS_SQLWRAP_UPDATE, xp_data->guid), -1, &sqlstmt, NULL);
+		result = sqlite3_bind_blob(sqlstmt, id == DB_STMT_XPUSERS_INSERT ? 3 : 2, buffer + SK_NUM_SKILLS, sizeof(int) * SK_NUM_SKILLS, SQLITE_STATIC);
+	}
+	if (result == SQLITE_OK)
+	{
+		result = G_DB_Step(id) == SQLITE_DONE ? SQLITE_OK : SQLITE_ERROR;
 	}
-	assert_return(result == SQLITE_OK, 1, sqlite3_errmsg(level.database.db));
 
-	result = sqlite3_bind_blob(sqlstmt, 1, buffer, sizeof(int) * SK_NUM_SKILLS, SQLITE_STATIC);
-	assert_return(result == SQLITE_OK, 1, sqlite3_errmsg(level.database.db));
+	if (result != SQLITE_OK)
+	{
+		G_DB_Printf("^1%s (%i): failed: %s\n", __func__, __LINE__, sqlite3_errmsg(level.database.db));
+		G_DB_Reset(id);
+		return 1;
+	}
 
-	result = sqlite3_bind_blob(sqlstmt, 2, buffer + SK_NUM_SKILLS, sizeof(int) * SK_NUM_SKILLS, SQLITE_STATIC);        
-	assert_return(result == SQLITE_OK, 1, sqlite3_errmsg(level.database.db));
+	G_DB_Reset(id);
 
-	result = sqlite3_step(sqlstmt);
-	assert_return(result == SQLITE_DONE, 1, sqlite3_errmsg(level.database.db));
+	return 0;
+}
 
-	result = sqlite3_finalize(sqlstmt);
-	assert_return(result == SQLITE_OK, 1, sqlite3_errmsg(level.database.db));
+/**
+ * @brief Database job reading xp for G_XPSaver_Load
+ * @param[in,out] data xpData_t
+ * @return 0 if successful, 1 otherwise.
+ */
+static int G_XPSaver_ReadJob(void *data)
+{
+	return G_XPSaver_Read((xpData_t *)data);
+}
 
-	return 0;
+/**
+ * @brief Database job storing xp for G_XPSaver_Store
+ * @param[in] data xpData_t
+ * @return 0 if successful, 1 otherwise.
+ */
+static int G_XPSaver_WriteJob(void *data)
+{
+	return G_XPSaver_Write((xpData_t *)data);
 }
 
 /**
- * @brief Clears any xp data from the table
+ * @brief Database job clearing the xpsave_users table
+ * @param data - unused
  * @return 0 if successful, 1 otherwise.
  */
-int G_XPSaver_Clear()
+static int G_XPSaver_ClearJob(void *data)
 {
-	int          result;
-	char         *err_msg = NULL;
+	int result;
 
-	if (!level.database.initialized)
+	G_DB_Statement(DB_STMT_XPUSERS_DELETE);
+	result = G_DB_Step(DB_STMT_XPUSERS_DELETE);
+	G_DB_Reset(DB_STMT_XPUSERS_DELETE);
+
+	if (result != SQLITE_DONE)
 	{
-		G_Printf("G_XPSaver_Clear: access to non-initialized database\n");
+		G_DB_Printf("G_XPSaver_Clear: delete failed: %s\n", sqlite3_errmsg(level.database.db));
 		return 1;
 	}
 
-	result = sqlite3_exec(level.database.db, XPUSERS_SQLWRAP_DELETE, 0, 0, &err_msg);
+	return 0;
+}
 
-	if (result != SQLITE_OK)
+/**
+ * @brief Clears any xp data from the table
+ * @return 0 if the clear was queued, 1 otherwise.
+ */
+int G_XPSaver_Clear()
+{
+	if (!level.database.initialized)
 	{
-		G_Printf("G_XPSaver_Clear: sqlite3_prepare failed: %s\n", err_msg);
-		sqlite3_free(err_msg);
+		G_Printf("G_XPSaver_Clear: access to non-initialized database\n");
 		return 1;
 	}
 
+	G_DB_Queue(G_XPSaver_ClearJob, NULL, NULL, 0);
+
 	return 0;
 }
@@ -44,8 +44,8 @@
 #define BOX_PLANES      12
 
 clipMap_t cm;
-int       c_pointcontents;
-int       c_traces, c_brush_traces, c_patch_traces;
+Q_THREAD_LOCAL int c_pointcontents;
+Q_THREAD_LOCAL int c_traces, c_brush_traces, c_patch_traces;
 
 byte *cmod_base;
 
@@ -101,7 +101,6 @@ typedef struct
 	vec3_t bounds[2];
 	int numsides;
 	cbrushside_t *sides;
-	int checkcount;            ///< to avoid repeated testings
 } cbrush_t;
 
 /**
@@ -109,7 +108,6 @@ typedef struct
  */
 typedef struct
 {
-	int checkcount;                    ///< to avoid repeated testings
 	int surfaceFlags;
 	int contents;
 	struct patchCollide_s *pc;
@@ -174,7 +172,6 @@ typedef struct
 	cPatch_t **surfaces;            ///< non-patches will be NULL
 
 	int floodvalid;
-	int checkcount;                         ///< incremented on each trace
 } clipMap_t;
 
 
@@ -183,8 +180,9 @@ typedef struct
 #define SURFACE_CLIP_EPSILON    (0.125f)
 
 extern clipMap_t cm;
-extern int       c_pointcontents;
-extern int       c_traces, c_brush_traces, c_patch_traces;
+// statistics are kept per thread, com_showtrace reports the main thread ones
+extern Q_THREAD_LOCAL int c_pointcontents;
+extern Q_THREAD_LOCAL int c_traces, c_brush_traces, c_patch_traces;
 extern cvar_t    *cm_noAreas;
 extern cvar_t    *cm_noCurves;
 extern cvar_t    *cm_playerCurveClip;
@@ -205,6 +203,28 @@ typedef struct
 	vec3_t offset;
 } sphere_t;
 
+#define TRACE_VISITED_BITS  9
+#define TRACE_VISITED_SIZE  (1 << TRACE_VISITED_BITS)
+#define TRACE_VISITED_MAX   (TRACE_VISITED_SIZE * 3 / 4)
+
+/**
+ * @struct traceVisited_s
+ * @brief Open addressed set of the brushes and patches a trace already tested
+ *
+ * @note Every thread has one, reused by all its traces. A slot only belongs to
+ * the set while its stamp is the current generation, so a new trace empties it
+ * by bumping the generation instead of clearing the slots.
+ */
+typedef struct traceVisited_s
+{
+	unsigned int generation;            ///< of the current trace
+	struct
+	{
+		unsigned int stamp;             ///< generation which filled the slot
+		int key;                        ///< CM_TraceVisited key
+	} slots[TRACE_VISITED_SIZE];
+} traceVisited_t;
+
 /**
  * @struct traceWork_s
  */
@@ -229,6 +249,9 @@ typedef struct
 	float traceDist2;
 	vec3_t dir;
 
+	int numVisited;                         ///< brushes and patches already tested by this trace
+	traceVisited_t *visited;                ///< the tracing thread's set, emptied for this trace
+
 } traceWork_t;
 
 /**
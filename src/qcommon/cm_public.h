@@ -56,6 +56,7 @@ char *CM_EntityString(void);
 int CM_PointContents(const vec3_t p, clipHandle_t model);
 int CM_TransformedPointContents(const vec3_t p, clipHandle_t model, const vec3_t origin, const vec3_t angles);
 
+// traces may run concurrently on the world and inline models, temp box models are not thread safe
 void CM_BoxTrace(trace_t *results, const vec3_t start, const vec3_t end,
                  const vec3_t mins, const vec3_t maxs,
                  clipHandle_t model, int brushmask, qboolean capsule);
@@ -63,6 +64,7 @@ void CM_TransformedBoxTrace(trace_t *results, const vec3_t start, const vec3_t e
                             const vec3_t mins, const vec3_t maxs,
                             clipHandle_t model, int brushmask,
                             const vec3_t origin, const vec3_t angles, qboolean capsule);
+void CM_TraceTest_f(void);
 
 byte *CM_ClusterPVS(int cluster);
 
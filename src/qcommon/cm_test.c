@@ -136,11 +136,17 @@ void CM_StoreBrushes(leafList_t *ll, int nodenum)
 	{
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
 		b        = &cm.brushes[brushnum];
-		if (b->checkcount == cm.checkcount)
+		for (i = 0 ; i < ll->count ; i++)
 		{
-			continue;   // already checked this brush in another leaf
+			if (((cbrush_t **)ll->list)[i] == b)
+			{
+				break;  // already stored from another leaf
+			}
+		}
+		if (i != ll->count)
+		{
+			continue;
 		}
-		b->checkcount = cm.checkcount;
 		for (i = 0 ; i < 3 ; i++)
 		{
 			if (b->bounds[0][i] >= ll->bounds[1][i] || b->bounds[1][i] <= ll->bounds[0][i])
@@ -226,8 +232,6 @@ int CM_BoxLeafnums(const vec3_t mins, const vec3_t maxs, int *list, int listsize
 {
 	leafList_t ll;
 
-	cm.checkcount++;
-
 	VectorCopy(mins, ll.bounds[0]);
 	VectorCopy(maxs, ll.bounds[1]);
 	ll.count      = 0;
@@ -257,8 +261,6 @@ int CM_BoxBrushes(const vec3_t mins, const vec3_t maxs, cbrush_t **list, int lis
 {
 	leafList_t ll;
 
-	cm.checkcount++;
-
 	VectorCopy(mins, ll.bounds[0]);
 	VectorCopy(maxs, ll.bounds[1]);
 	ll.count      = 0;
@@ -42,6 +42,9 @@
 
 //#define CAPSULE_DEBUG
 
+/// Brushes and patches tested by the current trace of each thread, see CM_TraceVisited
+static Q_THREAD_LOCAL traceVisited_t cm_traceVisited;
+
 /**
 ===============================================================================
 BASIC MATH
@@ -222,6 +225,40 @@ void CM_TestBoxInBrush(traceWork_t *tw, cbrush_t *brush)
 	tw->trace.contents   = brush->contents;
 }
 
+/**
+ * @brief Marks a brush or patch as tested by the current trace
+ * @param[in,out] tw
+ * @param[in] key brush number << 1, or surface number << 1 | 1 for patches
+ * @return qtrue if the trace already tested it in another leaf
+ *
+ * @note The set is per thread so concurrent traces don't share mailbox
+ * stamps. Once it is full the remaining brushes are simply tested again,
+ * which gives the same result.
+ */
+static ID_INLINE qboolean CM_TraceVisited(traceWork_t *tw, int key)
+{
+	traceVisited_t *visited = tw->visited;
+	unsigned int   slot     = ((unsigned int)key * 2654435761u) >> (32 - TRACE_VISITED_BITS);
+
+	while (visited->slots[slot].stamp == visited->generation)
+	{
+		if (visited->slots[slot].key == key)
+		{
+			return qtrue;
+		}
+		slot = (slot + 1) & (TRACE_VISITED_SIZE - 1);
+	}
+
+	if (tw->numVisited < TRACE_VISITED_MAX)
+	{
+		visited->slots[slot].stamp = visited->generation;
+		visited->slots[slot].key   = key;
+		tw->numVisited++;
+	}
+
+	return qfalse;
+}
+
 /**
  * @brief CM_TestInLeaf
  * @param[in,out] tw
@@ -230,19 +267,18 @@ void CM_TestBoxInBrush(traceWork_t *tw, cbrush_t *brush)
 void CM_TestInLeaf(traceWork_t *tw, cLeaf_t *leaf)
 {
 	int      k;
-	int      brushnum;
+	int      brushnum, surfacenum;
 	cbrush_t *b;
 
 	// test box position against all brushes in the leaf
 	for (k = 0 ; k < leaf->numLeafBrushes ; k++)
 	{
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
-		b        = &cm.brushes[brushnum];
-		if (b->checkcount == cm.checkcount)
+		if (CM_TraceVisited(tw, brushnum << 1))
 		{
 			continue;   // already checked this brush in another leaf
 		}
-		b->checkcount = cm.checkcount;
+		b = &cm.brushes[brushnum];
 
 		if (!(b->contents & tw->contents))
 		{
@@ -263,16 +299,16 @@ void CM_TestInLeaf(traceWork_t *tw, cLeaf_t *leaf)
 
 		for (k = 0 ; k < leaf->numLeafSurfaces ; k++)
 		{
-			patch = cm.surfaces[cm.leafsurfaces[leaf->firstLeafSurface + k]];
+			surfacenum = cm.leafsurfaces[leaf->firstLeafSurface + k];
+			patch      = cm.surfaces[surfacenum];
 			if (!patch)
 			{
 				continue;
 			}
-			if (patch->checkcount == cm.checkcount)
+			if (CM_TraceVisited(tw, (surfacenum << 1) | 1))
 			{
-				continue;   // already checked this brush in another leaf
+				continue;   // already checked this patch in another leaf
 			}
-			patch->checkcount = cm.checkcount;
 
 			if (!(patch->contents & tw->contents))
 			{
@@ -434,12 +470,8 @@ void CM_PositionTest(traceWork_t *tw)
 	ll.lastLeaf   = 0;
 	ll.overflowed = qfalse;
 
-	cm.checkcount++;
-
 	CM_BoxLeafnums_r(&ll, 0);
 
-	cm.checkcount++;
-
 	// test the contents of the leafs
 	for (i = 0 ; i < ll.count ; i++)
 	{
@@ -811,19 +843,19 @@ static void CM_TraceThroughBrush(traceWork_t *tw, cbrush_t *brush)
 static void CM_TraceThroughLeaf(traceWork_t *tw, cLeaf_t *leaf)
 {
 	int      k;
+	int      brushnum, surfacenum;
 	cbrush_t *brush;
 	float    fraction;
 
 	// trace line against all brushes in the leaf
 	for (k = 0 ; k < leaf->numLeafBrushes ; k++)
 	{
-		// brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
-		brush = &cm.brushes[cm.leafbrushes[leaf->firstLeafBrush + k]];
-		if (brush->checkcount == cm.checkcount)
+		brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
+		if (CM_TraceVisited(tw, brushnum << 1))
 		{
 			continue;   // already checked this brush in another leaf
 		}
-		brush->checkcount = cm.checkcount;
+		brush = &cm.brushes[brushnum];
 
 		if (!(brush->contents & tw->contents))
 		{
@@ -860,16 +892,16 @@ static void CM_TraceThroughLeaf(traceWork_t *tw, cLeaf_t *leaf)
 
 		for (k = 0 ; k < leaf->numLeafSurfaces ; k++)
 		{
-			patch = cm.surfaces[cm.leafsurfaces[leaf->firstLeafSurface + k]];
+			surfacenum = cm.leafsurfaces[leaf->firstLeafSurface + k];
+			patch      = cm.surfaces[surfacenum];
 			if (!patch)
 			{
 				continue;
 			}
-			if (patch->checkcount == cm.checkcount)
+			if (CM_TraceVisited(tw, (surfacenum << 1) | 1))
 			{
 				continue;   // already checked this patch in another leaf
 			}
-			patch->checkcount = cm.checkcount;
 
 			if (!(patch->contents & tw->contents))
 			{
@@ -1409,8 +1441,6 @@ static void CM_Trace(trace_t *results, const vec3_t start, const vec3_t end,
 
 	cmod = CM_ClipHandleToModel(model);
 
-	cm.checkcount++;        // for multi-check avoidance
-
 	c_traces++;             // for statistics, may be zeroed
 
 	// fill in a default trace
@@ -1418,6 +1448,14 @@ static void CM_Trace(trace_t *results, const vec3_t start, const vec3_t end,
 	tw.trace.fraction = 1.0f;   // assume it goes the entire distance until shown otherwise
 	VectorCopy(origin, tw.modelOrigin);
 
+	// empty this thread's visited set, the slots only need clearing when the generation wraps
+	tw.visited = &cm_traceVisited;
+	if (++tw.visited->generation == 0)
+	{
+		Com_Memset(tw.visited, 0, sizeof(*tw.visited));
+		tw.visited->generation = 1;
+	}
+
 	if (!cm.numNodes)
 	{
 		*results = tw.trace;
@@ -1789,3 +1827,198 @@ void CM_TransformedBoxTrace(trace_t *results, const vec3_t start, const vec3_t e
 
 	*results = trace;
 }
+
+/*
+===============================================================================
+CONCURRENCY TEST
+===============================================================================
+*/
+
+#define CM_TRACETEST_BATCH  64
+
+/**
+ * @struct cmTraceTest_s
+ * @brief One random trace of the cmtracetest command
+ */
+typedef struct
+{
+	vec3_t start;
+	vec3_t end;
+	vec3_t mins;
+	vec3_t maxs;
+	clipHandle_t model;
+	trace_t serial;
+	trace_t threaded;
+} cmTraceTest_t;
+
+/**
+ * @struct cmTraceTestJob_s
+ */
+typedef struct
+{
+	cmTraceTest_t *tests;
+	int numTests;
+} cmTraceTestJob_t;
+
+/**
+ * @brief Runs one batch of the test traces on a pool thread
+ * @param[in,out] data
+ * @param[in] index
+ */
+static void CM_TraceTestJob(void *data, int index)
+{
+	cmTraceTestJob_t *job = (cmTraceTestJob_t *)data;
+	cmTraceTest_t    *t;
+	int              i, last;
+
+	last = MIN((index + 1) * CM_TRACETEST_BATCH, job->numTests);
+
+	for (i = index * CM_TRACETEST_BATCH; i < last; i++)
+	{
+		t = &job->tests[i];
+		CM_BoxTrace(&t->threaded, t->start, t->end, t->mins, t->maxs, t->model, CONTENTS_SOLID | CONTENTS_PLAYERCLIP, qfalse);
+	}
+}
+
+/**
+ * @brief Compares two trace results
+ * @param[in] a
+ * @param[in] b
+ * @return qtrue if both traces hit the same thing at the same spot
+ */
+static qboolean CM_TraceTestEqual(const trace_t *a, const trace_t *b)
+{
+	return a->allsolid == b->allsolid && a->startsolid == b->startsolid && a->fraction == b->fraction
+	       && VectorCompare(a->endpos, b->endpos) && VectorCompare(a->plane.normal, b->plane.normal)
+	       && a->plane.dist == b->plane.dist && a->surfaceFlags == b->surfaceFlags && a->contents == b->contents;
+}
+
+/**
+ * @brief Runs random box traces on the loaded map, first serially and then
+ * concurrently on a thread pool, and reports any result that differs
+ *
+ * @note Usage: cmtracetest [traces] [threads]
+ */
+void CM_TraceTest_f(void)
+{
+	static const vec3_t sizes[3][2] =
+	{
+		{ { 0, 0, 0 },       { 0, 0, 0 }       },
+		{ { -4, -4, -4 },    { 4, 4, 4 }       },
+		{ { -18, -18, -24 }, { 18, 18, 48 }    },
+	};
+	cmTraceTestJob_t    job;
+	cmTraceTest_t       *t;
+	threadPool_t        *pool;
+	const cmodel_t      *world;
+	int                 numThreads, numBatches, mismatches;
+	int                 i, j, seed, start, serialTime, threadedTime;
+
+	if (!cm.numNodes)
+	{
+		Com_Printf("cmtracetest: no map loaded\n");
+		return;
+	}
+
+	job.numTests = (Cmd_Argc() > 1) ? Q_atoi(Cmd_Argv(1)) : 100000;
+	numThreads   = (Cmd_Argc() > 2) ? Q_atoi(Cmd_Argv(2)) : 4;
+	if (job.numTests < 1 || numThreads < 1)
+	{
+		Com_Printf("usage: cmtracetest [traces] [threads]\n");
+		return;
+	}
+
+	job.tests = (cmTraceTest_t *)Com_Allocate(job.numTests * sizeof(cmTraceTest_t));
+	if (!job.tests)
+	{
+		Com_Printf("cmtracetest: out of memory\n");
+		return;
+	}
+	Com_Memset(job.tests, 0, job.numTests * sizeof(cmTraceTest_t));
+
+	// fixed seed so a failing run can be repeated
+	seed  = 0x1f2e3d;
+	world = &cm.cmodels[0];
+
+	for (i = 0; i < job.numTests; i++)
+	{
+		t = &job.tests[i];
+
+		for (j = 0; j < 3; j++)
+		{
+			t->start[j] = world->mins[j] + Q_random(&seed) * (world->maxs[j] - world->mins[j]);
+		}
+
+		// mix long sweeps, short moves and position tests
+		switch (i & 3)
+		{
+		case 0:
+			for (j = 0; j < 3; j++)
+			{
+				t->end[j] = world->mins[j] + Q_random(&seed) * (world->maxs[j] - world->mins[j]);
+			}
+			break;
+		case 3:
+			VectorCopy(t->start, t->end);
+			break;
+		default:
+			for (j = 0; j < 3; j++)
+			{
+				t->end[j] = t->start[j] + Q_crandom(&seed) * 256;
+			}
+			break;
+		}
+
+		VectorCopy(sizes[i % 3][0], t->mins);
+		VectorCopy(sizes[i % 3][1], t->maxs);
+
+		if (cm.numSubModels > 1 && !(i & 7))
+		{
+			t->model = CM_InlineModel(1 + (int)(Q_random(&seed) * (cm.numSubModels - 1)) % (cm.numSubModels - 1));
+		}
+	}
+
+	start = Sys_Milliseconds();
+	for (i = 0; i < job.numTests; i++)
+	{
+		t = &job.tests[i];
+		CM_BoxTrace(&t->serial, t->start, t->end, t->mins, t->maxs, t->model, CONTENTS_SOLID | CONTENTS_PLAYERCLIP, qfalse);
+	}
+	serialTime = Sys_Milliseconds() - start;
+
+	// the calling thread drains jobs too
+	pool       = Com_CreateThreadPool(numThreads - 1);
+	numBatches = (job.numTests + CM_TRACETEST_BATCH - 1) / CM_TRACETEST_BATCH;
+
+	start = Sys_Milliseconds();
+	Com_ThreadPoolRun(pool, CM_TraceTestJob, &job, numBatches);
+	threadedTime = Sys_Milliseconds() - start;
+
+	if (pool)
+	{
+		Com_DestroyThreadPool(pool);
+	}
+
+	mismatches = 0;
+	for (i = 0; i < job.numTests; i++)
+	{
+		t = &job.tests[i];
+		if (CM_TraceTestEqual(&t->serial, &t->threaded))
+		{
+			continue;
+		}
+
+		if (++mismatches <= 5)
+		{
+			Com_Printf("cmtracetest: trace %i (%.1f %.1f %.1f) -> (%.1f %.1f %.1f) model %i: fraction %f vs %f\n", i,
+			           (double)t->start[0], (double)t->start[1], (double)t->start[2],
+			           (double)t->end[0], (double)t->end[1], (double)t->end[2],
+			           t->model, (double)t->serial.fraction, (double)t->threaded.fraction);
+		}
+	}
+
+	Com_Printf("%i traces on %s: serial %i msec, %i threads %i msec, %i mismatches\n",
+	           job.numTests, cm.name, serialTime, numThreads, threadedTime, mismatches);
+
+	Com_Dealloc(job.tests);
+}
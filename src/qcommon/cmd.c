@@ -394,7 +394,10 @@ void Cmd_Echo_f(void)
  */
 typedef struct cmd_function_s
 {
-	struct cmd_function_s *next;
+	struct cmd_function_s *next;                                        ///< registration order, used for listing and completion
+	struct cmd_function_s *hashNext;
+	struct cmd_function_s *hashPrev;
+	long hashIndex;
 	char *name;
 	char *description;
 	xcommand_t function;
@@ -408,6 +411,10 @@ static char cmd_cmd[BIG_INFO_STRING];                                   ///< the
 
 static cmd_function_t *cmd_functions;                                   ///< possible commands to execute
 
+#define CMD_HASH_SIZE 512
+static cmd_function_t *cmd_hashTable[CMD_HASH_SIZE];                    ///< case insensitive name lookup into cmd_functions
+#define Cmd_HashValue(name) Q_GenerateHashValue(name, CMD_HASH_SIZE, qtrue, qtrue)
+
 /**
  * @brief Cmd_Argc
  * @return
@@ -750,7 +757,7 @@ cmd_function_t *Cmd_FindCommand(const char *cmd_name)
 {
 	cmd_function_t *cmd;
 
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	for (cmd = cmd_hashTable[Cmd_HashValue(cmd_name)]; cmd; cmd = cmd->hashNext)
 	{
 		if (!Q_stricmp(cmd_name, cmd->name))
 		{
@@ -796,6 +803,15 @@ void Cmd_AddSystemCommand(const char *cmd_name, xcommand_t function, const char
 	cmd->next     = cmd_functions;
 	cmd_functions = cmd;
 
+	cmd->hashIndex = Cmd_HashValue(cmd_name);
+	cmd->hashPrev  = NULL;
+	cmd->hashNext  = cmd_hashTable[cmd->hashIndex];
+	if (cmd->hashNext)
+	{
+		cmd->hashNext->hashPrev = cmd;
+	}
+	cmd_hashTable[cmd->hashIndex] = cmd;
+
 	if (description && description[0])
 	{
 		cmd->description = CopyString(description);
@@ -813,15 +829,11 @@ void Cmd_AddSystemCommand(const char *cmd_name, xcommand_t function, const char
  */
 void Cmd_SetCommandCompletionFunc(const char *command, completionFunc_t complete)
 {
-	cmd_function_t *cmd;
+	cmd_function_t *cmd = Cmd_FindCommand(command);
 
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	if (cmd)
 	{
-		if (!Q_stricmp(command, cmd->name))
-		{
-			cmd->complete = complete;
-			return;
-		}
+		cmd->complete = complete;
 	}
 }
 
@@ -834,14 +846,11 @@ void Cmd_SetCommandCompletionFunc(const char *command, completionFunc_t complete
  */
 void Cmd_SetCommandDescription(const char *command, const char *description)
 {
-	cmd_function_t *cmd;
+	cmd_function_t *cmd = Cmd_FindCommand(command);
 
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	if (cmd)
 	{
-		if (!Q_stricmp(command, cmd->name))
-		{
-			cmd->description = CopyString(description);
-		}
+		cmd->description = CopyString(description);
 	}
 }
 
@@ -851,7 +860,7 @@ void Cmd_SetCommandDescription(const char *command, const char *description)
  */
 void Cmd_RemoveCommand(const char *cmd_name)
 {
-	cmd_function_t *cmd, **back = &cmd_functions;
+	cmd_function_t *cmd, **back;
 
 	if (!cmd_name || !cmd_name[0])
 	{
@@ -859,29 +868,50 @@ void Cmd_RemoveCommand(const char *cmd_name)
 		return;
 	}
 
-	while (1)
+	// the hash is case insensitive, removal matches the exact name
+	for (cmd = cmd_hashTable[Cmd_HashValue(cmd_name)]; cmd; cmd = cmd->hashNext)
 	{
-		cmd = *back;
-		if (!cmd)
+		if (!strcmp(cmd_name, cmd->name))
 		{
-			// command wasn't active
-			return;
+			break;
 		}
-		if (!strcmp(cmd_name, cmd->name))
+	}
+
+	if (!cmd)
+	{
+		// command wasn't active
+		return;
+	}
+
+	if (cmd->hashPrev)
+	{
+		cmd->hashPrev->hashNext = cmd->hashNext;
+	}
+	else
+	{
+		cmd_hashTable[cmd->hashIndex] = cmd->hashNext;
+	}
+	if (cmd->hashNext)
+	{
+		cmd->hashNext->hashPrev = cmd->hashPrev;
+	}
+
+	for (back = &cmd_functions; *back; back = &(*back)->next)
+	{
+		if (*back == cmd)
 		{
 			*back = cmd->next;
+			break;
+		}
+	}
 
-			Z_Free(cmd->name);
+	Z_Free(cmd->name);
 
-			if (cmd->description)
-			{
-				Z_Free(cmd->description);
-			}
-			Z_Free(cmd);
-			return;
-		}
-		back = &cmd->next;
+	if (cmd->description)
+	{
+		Z_Free(cmd->description);
 	}
+	Z_Free(cmd);
 }
 
 /**
@@ -959,22 +989,20 @@ void Cmd_CommandCompletion(void (*callback)(const char *s))
  */
 void Cmd_CompleteArgument(const char *command, char *args, int argNum)
 {
-	cmd_function_t *cmd;
+	cmd_function_t *cmd = Cmd_FindCommand(command);
 
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	if (!cmd)
 	{
-		if (!Q_stricmp(command, cmd->name))
-		{
-			if (cmd->complete)
-			{
-				cmd->complete(args, argNum);
-			}
-			else if (Field_CompleteMod())
-			{
-				Com_DPrintf(S_COLOR_CYAN "Argument completed via CGAme\n");
-			}
-			return;
-		}
+		return;
+	}
+
+	if (cmd->complete)
+	{
+		cmd->complete(args, argNum);
+	}
+	else if (Field_CompleteMod())
+	{
+		Com_DPrintf(S_COLOR_CYAN "Argument completed via CGAme\n");
 	}
 }
 
@@ -984,7 +1012,7 @@ void Cmd_CompleteArgument(const char *command, char *args, int argNum)
  */
 void Cmd_ExecuteString(const char *text)
 {
-	cmd_function_t *cmd, **prev;
+	cmd_function_t *cmd;
 
 	// execute the command line
 	Cmd_TokenizeString(text);
@@ -994,29 +1022,13 @@ void Cmd_ExecuteString(const char *text)
 	}
 
 	// check registered command functions
-	for (prev = &cmd_functions ; *prev ; prev = &cmd->next)
+	cmd = Cmd_FindCommand(cmd_argv[0]);
+
+	// commands without a function are left for the cgame or game to handle
+	if (cmd && cmd->function)
 	{
-		cmd = *prev;
-		if (!Q_stricmp(cmd_argv[0], cmd->name))
-		{
-			// rearrange the links so that the command will be
-			// near the head of the list next time it is used
-			*prev         = cmd->next;
-			cmd->next     = cmd_functions;
-			cmd_functions = cmd;
-
-			// perform the action
-			if (!cmd->function)
-			{
-				// let the cgame or game handle it
-				break;
-			}
-			else
-			{
-				cmd->function();
-			}
-			return;
-		}
+		cmd->function();
+		return;
 	}
 
 	// check cvars
@@ -1085,6 +1097,169 @@ void Cmd_List_f(void)
 	Com_Printf("%i commands\n", i);
 }
 
+/**
+ * @brief The unhashed lookup, kept for cmdbench to compare against
+ * @param[in] cmd_name
+ * @return
+ */
+static cmd_function_t *Cmd_FindCommandLinear(const char *cmd_name)
+{
+	cmd_function_t *cmd;
+
+	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	{
+		if (!Q_stricmp(cmd_name, cmd->name))
+		{
+			return cmd;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Times a set of command lookups through the list walk and the hash
+ * @param[in] names
+ * @param[in] numNames
+ * @param[in] iterations
+ * @param[in] label
+ */
+static void Cmd_BenchLookups(char **names, int numNames, int iterations, const char *label)
+{
+	int i, j, start, linearTime, hashTime, hits = 0, mismatches = 0;
+
+	start = Sys_Milliseconds();
+	for (i = 0; i < iterations; i++)
+	{
+		for (j = 0; j < numNames; j++)
+		{
+			if (Cmd_FindCommandLinear(names[j]))
+			{
+				hits++;
+			}
+		}
+	}
+	linearTime = Sys_Milliseconds() - start;
+
+	start = Sys_Milliseconds();
+	for (i = 0; i < iterations; i++)
+	{
+		for (j = 0; j < numNames; j++)
+		{
+			if (Cmd_FindCommand(names[j]))
+			{
+				hits--;
+			}
+		}
+	}
+	hashTime = Sys_Milliseconds() - start;
+
+	for (j = 0; j < numNames; j++)
+	{
+		if (Cmd_FindCommandLinear(names[j]) != Cmd_FindCommand(names[j]))
+		{
+			mismatches++;
+		}
+	}
+
+	Com_Printf("  %-12s: %6i lookups, list %5i msec, hash %5i msec%s\n", label, numNames * iterations, linearTime, hashTime,
+	           (hits || mismatches) ? S_COLOR_RED " (results differ)" : "");
+}
+
+/**
+ * @brief Replays the command names of a config file and every registered
+ * command, as a burst of rcon traffic would, through both command lookups
+ */
+void Cmd_Bench_f(void)
+{
+	cmd_function_t *cmd;
+	char           filename[MAX_QPATH];
+	char           *file, *text, *line, **names, *nameBuf;
+	int            fileLen, iterations, numNames = 0, numCommands = 0, quotes, nameLen = 0;
+
+	if (Cmd_Argc() < 2)
+	{
+		Com_Printf("usage: cmdbench <file.cfg> [iterations]\n");
+		return;
+	}
+
+	Q_strncpyz(filename, Cmd_Argv(1), sizeof(filename));
+	COM_DefaultExtension(filename, sizeof(filename), ".cfg");
+
+	iterations = Cmd_Argc() > 2 ? Q_atoi(Cmd_Argv(2)) : 100;
+	if (iterations < 1)
+	{
+		iterations = 1;
+	}
+
+	fileLen = FS_ReadFile(filename, (void **)&file);
+	if (fileLen <= 0)
+	{
+		Com_Printf("cmdbench: can't read %s\n", filename);
+		return;
+	}
+
+	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	{
+		numCommands++;
+	}
+
+	// every line holds at least two characters, so this bounds the names of the file
+	names   = (char **)Com_Allocate((fileLen / 2 + 1 + numCommands) * sizeof(char *));
+	nameBuf = (char *)Com_Allocate(fileLen + 1);
+	if (!names || !nameBuf)
+	{
+		Com_Dealloc(names);
+		Com_Dealloc(nameBuf);
+		FS_FreeFile(file);
+		Com_Printf("cmdbench: out of memory\n");
+		return;
+	}
+
+	// split the file the way Cbuf_Execute does and keep the command of each line
+	for (text = line = file, quotes = 0; text <= file + fileLen; text++)
+	{
+		if (text < file + fileLen && *text == '"')
+		{
+			quotes++;
+		}
+		if (text < file + fileLen && ((quotes & 1) || (*text != ';' && *text != '\n' && *text != '\r')))
+		{
+			continue;
+		}
+
+		if (text > line)
+		{
+			char saved = *text;
+
+			*text = '\0';
+			Cmd_TokenizeString(line);
+			*text = saved;
+
+			if (Cmd_Argc() && nameLen + strlen(Cmd_Argv(0)) < (size_t)fileLen)
+			{
+				names[numNames++] = strcpy(nameBuf + nameLen, Cmd_Argv(0));
+				nameLen          += strlen(Cmd_Argv(0)) + 1;
+			}
+		}
+		line = text + 1;
+	}
+
+	FS_FreeFile(file);
+
+	Com_Printf("cmdbench: %s, %i commands registered, %i iterations\n", filename, numCommands, iterations);
+	Cmd_BenchLookups(names, numNames, iterations, "config");
+
+	numNames = 0;
+	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	{
+		names[numNames++] = cmd->name;
+	}
+	Cmd_BenchLookups(names, numNames, iterations, "rcon burst");
+
+	Com_Dealloc(names);
+	Com_Dealloc(nameBuf);
+}
+
 /**
  * @brief Cmd_CompleteCfgName
  * @param args - unused
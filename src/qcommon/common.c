@@ -950,7 +950,14 @@ int Com_RealTime(qtime_t *qtime)
 There is never any space between memblocks, and there will never be two
 contiguous free memblocks.
 
-The rover can be left pointing at a non-empty block
+Free blocks are also kept in segregated free lists, one per size class, so
+an allocation takes the head of the first non-empty class that is large
+enough instead of walking the block list. Below ZONE_EXACT_SIZE there is a
+class per ZONE_ALIGN bytes and every block in it fits, above it the classes
+are powers of two. The list links live in the payload of the free block.
+
+The rover can be left pointing at a non-empty block, Z_FreeTags uses it
+to walk the zone.
 
 The zone calls are pretty much only used for small strings and structures,
 all big things are allocated on the hunk.
@@ -960,6 +967,11 @@ all big things are allocated on the hunk.
 #define ZONEID  0x1d4a11
 #define MINFRAGMENT 64
 
+#define ZONE_ALIGN      sizeof(intptr_t)
+#define ZONE_EXACT_BINS 64                              ///< one size class per ZONE_ALIGN bytes below ZONE_EXACT_SIZE
+#define ZONE_EXACT_SIZE (ZONE_EXACT_BINS * ZONE_ALIGN)
+#define ZONE_BINS       (ZONE_EXACT_BINS + 32)          ///< plus one size class per power of two above it
+
 /**
  * @struct zonedebug_s
  */
@@ -985,6 +997,18 @@ typedef struct memblock_s
 #endif
 } memblock_t;
 
+/**
+ * @struct memfree_s
+ * @brief Size class links, stored in the payload of a free block
+ */
+typedef struct memfree_s
+{
+	memblock_t *nextFree, *prevFree;
+} memfree_t;
+
+#define ZONE_FREELINKS(block) ((memfree_t *)((block) + 1))
+#define ZONE_MINBLOCK PAD(sizeof(memblock_t) + sizeof(memfree_t), ZONE_ALIGN)   ///< smallest block that can hold the links once freed
+
 /**
  * @struct memzone_s
  */
@@ -994,6 +1018,9 @@ typedef struct
 	int used;               ///< total bytes used
 	memblock_t blocklist;   ///< start / end cap for linked list
 	memblock_t *rover;
+	memblock_t *freeBins[ZONE_BINS];        ///< free blocks by size class
+	unsigned int binMask[ZONE_BINS / 32];   ///< bit set for each non-empty size class
+	qboolean firstFit;                      ///< walk the block list from the rover instead (zonebench only)
 } memzone_t;
 
 /// main zone for all "dynamic" memory allocation
@@ -1002,82 +1029,226 @@ static memzone_t *mainzone;
 /// fragment the main zone (think of cvar and cmd strings)
 static memzone_t *smallzone;
 
+/**
+ * @struct zoneTrace_s
+ * @brief A recorded zone call, replayed by zonebench
+ */
+typedef struct zoneTrace_s
+{
+	void *ptr;              ///< payload returned by Z_TagMalloc or passed to Z_Free
+	int size;               ///< requested size, 0 for Z_Free
+	int tag;
+} zoneTrace_t;
+
+static struct
+{
+	zoneTrace_t *calls;
+	int numCalls;
+	int maxCalls;
+	qboolean recording;
+} zoneBench;
+
 static void Z_CheckHeap(void);
 
 /**
- * @brief Z_ClearZone
- * @param[out] zone
- * @param[in] size
+ * @brief Z_BinForSize
+ * @param[in] size block size including the header
+ * @return size class of a free block of this size
  */
-static void Z_ClearZone(memzone_t *zone, int size)
+static int Z_BinForSize(size_t size)
 {
-	memblock_t *block;
+	int bin;
 
-	// set the entire zone to one free block
+	if (size < ZONE_EXACT_SIZE)
+	{
+		return (int)(size / ZONE_ALIGN);
+	}
 
-	zone->blocklist.next = zone->blocklist.prev = block =
-		( memblock_t * )((byte *)zone + sizeof(memzone_t));
-	zone->blocklist.tag  = 1;   // in use block
-	zone->blocklist.id   = 0;
-	zone->blocklist.size = 0;
-	zone->rover          = block;
-	zone->size           = size;
-	zone->used           = 0;
+	for (bin = ZONE_EXACT_BINS, size /= ZONE_EXACT_SIZE; size > 1 && bin < ZONE_BINS - 1; size >>= 1)
+	{
+		bin++;
+	}
 
-	block->prev = block->next = &zone->blocklist;
-	block->tag  = 0;        // free block
-	block->id   = ZONEID;
-	block->size = size - sizeof(memzone_t);
+	return bin;
 }
 
 /**
- * @brief Z_Free
- * @param[out] ptr
+ * @brief Z_LinkFree
+ * @param[in,out] zone
+ * @param[in,out] block free block to add to its size class
  */
-void Z_Free(void *ptr)
+static void Z_LinkFree(memzone_t *zone, memblock_t *block)
 {
-	memblock_t *block, *other;
-	memzone_t  *zone;
+	memfree_t *links = ZONE_FREELINKS(block);
+	int       bin    = Z_BinForSize(block->size);
 
-	if (!ptr)
+	links->prevFree = NULL;
+	links->nextFree = zone->freeBins[bin];
+	if (links->nextFree)
 	{
-		Com_Error(ERR_DROP, "Z_Free: NULL pointer");
+		ZONE_FREELINKS(links->nextFree)->prevFree = block;
 	}
+	zone->freeBins[bin]      = block;
+	zone->binMask[bin >> 5] |= 1u << (bin & 31);
+}
 
-	block = ( memblock_t * )((byte *)ptr - sizeof(memblock_t));
-	if (block->id != ZONEID)
+/**
+ * @brief Z_UnlinkFree
+ * @param[in,out] zone
+ * @param[in,out] block free block to remove from its size class, before its size changes
+ */
+static void Z_UnlinkFree(memzone_t *zone, memblock_t *block)
+{
+	memfree_t *links = ZONE_FREELINKS(block);
+	int       bin;
+
+	if (links->nextFree)
 	{
-		Com_Error(ERR_FATAL, "Z_Free: freed a pointer without ZONEID");
+		ZONE_FREELINKS(links->nextFree)->prevFree = links->prevFree;
 	}
-	if (block->tag == 0)
+
+	if (links->prevFree)
 	{
-		Com_Error(ERR_FATAL, "Z_Free: freed a freed pointer");
+		ZONE_FREELINKS(links->prevFree)->nextFree = links->nextFree;
+		return;
 	}
-	// if static memory
-	if (block->tag == TAG_STATIC)
+
+	bin                 = Z_BinForSize(block->size);
+	zone->freeBins[bin] = links->nextFree;
+	if (!links->nextFree)
 	{
-		return;
+		zone->binMask[bin >> 5] &= ~(1u << (bin & 31));
 	}
+}
 
-	// check the memory trash tester
-	if (*( int * )((byte *)block + block->size - 4) != ZONEID)
+/**
+ * @brief Z_FindFree
+ * @param[in] zone
+ * @param[in] size block size including the header
+ * @return a free block of at least size bytes, NULL if there is none
+ */
+static memblock_t *Z_FindFree(memzone_t *zone, size_t size)
+{
+	memblock_t   *block;
+	unsigned int mask;
+	int          bin, word;
+
+	bin = Z_BinForSize(size);
+
+	// a power of two class also holds blocks smaller than the request
+	if (bin >= ZONE_EXACT_BINS)
 	{
-		Com_Error(ERR_FATAL, "Z_Free: memory block wrote past end");
+		for (block = zone->freeBins[bin]; block; block = ZONE_FREELINKS(block)->nextFree)
+		{
+			if (block->size >= size)
+			{
+				return block;
+			}
+		}
+		bin++;
 	}
 
-	if (block->tag == TAG_SMALL)
+	// any block of a larger class fits
+	for (word = bin >> 5; word < ZONE_BINS / 32; word++)
 	{
-		zone = smallzone;
+		mask = zone->binMask[word];
+		if (word == bin >> 5)
+		{
+			mask &= ~0u << (bin & 31);
+		}
+
+		if (mask)
+		{
+			for (bin = word << 5; !(mask & 1); mask >>= 1)
+			{
+				bin++;
+			}
+			return zone->freeBins[bin];
+		}
 	}
-	else
+
+	return NULL;
+}
+
+/**
+ * @brief Z_FindFirstFit
+ * @param[in] zone
+ * @param[in] size block size including the header
+ * @return the first free block of at least size bytes after the rover, NULL if there is none
+ *
+ * @note The allocation strategy the size classes replaced, kept to compare against in zonebench
+ */
+static memblock_t *Z_FindFirstFit(memzone_t *zone, size_t size)
+{
+	memblock_t *start, *rover, *base;
+
+	base  = rover = zone->rover;
+	start = base->prev;
+
+	do
 	{
-		zone = mainzone;
+		if (rover == start)
+		{
+			return NULL;
+		}
+		if (rover->tag)
+		{
+			base = rover = rover->next;
+		}
+		else
+		{
+			rover = rover->next;
+		}
 	}
+	while (base->tag || base->size < size);
+
+	return base;
+}
+
+/**
+ * @brief Z_ClearZone
+ * @param[out] zone
+ * @param[in] size
+ */
+static void Z_ClearZone(memzone_t *zone, int size)
+{
+	memblock_t *block;
+
+	// set the entire zone to one free block
+
+	zone->blocklist.next = zone->blocklist.prev = block =
+		( memblock_t * )((byte *)zone + sizeof(memzone_t));
+	zone->blocklist.tag  = 1;   // in use block
+	zone->blocklist.id   = 0;
+	zone->blocklist.size = 0;
+	zone->rover          = block;
+	zone->size           = size;
+	zone->used           = 0;
+
+	Com_Memset(zone->freeBins, 0, sizeof(zone->freeBins));
+	Com_Memset(zone->binMask, 0, sizeof(zone->binMask));
+
+	block->prev = block->next = &zone->blocklist;
+	block->tag  = 0;        // free block
+	block->id   = ZONEID;
+	block->size = size - sizeof(memzone_t);
+
+	Z_LinkFree(zone, block);
+}
+
+/**
+ * @brief Z_ZoneFree
+ * @param[in,out] zone
+ * @param[in,out] block checked block to return to the zone
+ */
+static void Z_ZoneFree(memzone_t *zone, memblock_t *block)
+{
+	memblock_t *other;
 
 	zone->used -= block->size;
 	// set the block to something that should cause problems
 	// if it is referenced...
-	Com_Memset(ptr, 0xaa, block->size - sizeof(*block));
+	Com_Memset(block + 1, 0xaa, block->size - sizeof(*block));
 
 	block->tag = 0;     // mark as free
 
@@ -1085,6 +1256,7 @@ void Z_Free(void *ptr)
 	if (!other->tag)
 	{
 		// merge with previous free block
+		Z_UnlinkFree(zone, other);
 		other->size      += block->size;
 		other->next       = block->next;
 		other->next->prev = other;
@@ -1101,6 +1273,7 @@ void Z_Free(void *ptr)
 	if (!other->tag)
 	{
 		// merge the next free block onto the end
+		Z_UnlinkFree(zone, other);
 		block->size      += other->size;
 		block->next       = other->next;
 		block->next->prev = block;
@@ -1109,6 +1282,53 @@ void Z_Free(void *ptr)
 			zone->rover = block;
 		}
 	}
+
+	Z_LinkFree(zone, block);
+}
+
+/**
+ * @brief Z_Free
+ * @param[out] ptr
+ */
+void Z_Free(void *ptr)
+{
+	memblock_t *block;
+
+	if (!ptr)
+	{
+		Com_Error(ERR_DROP, "Z_Free: NULL pointer");
+	}
+
+	block = ( memblock_t * )((byte *)ptr - sizeof(memblock_t));
+	if (block->id != ZONEID)
+	{
+		Com_Error(ERR_FATAL, "Z_Free: freed a pointer without ZONEID");
+	}
+	if (block->tag == 0)
+	{
+		Com_Error(ERR_FATAL, "Z_Free: freed a freed pointer");
+	}
+	// if static memory
+	if (block->tag == TAG_STATIC)
+	{
+		return;
+	}
+
+	// check the memory trash tester
+	if (*( int * )((byte *)block + block->size - 4) != ZONEID)
+	{
+		Com_Error(ERR_FATAL, "Z_Free: memory block wrote past end");
+	}
+
+	if (zoneBench.recording && zoneBench.numCalls < zoneBench.maxCalls)
+	{
+		zoneBench.calls[zoneBench.numCalls].ptr  = ptr;
+		zoneBench.calls[zoneBench.numCalls].size = 0;
+		zoneBench.calls[zoneBench.numCalls].tag  = block->tag;
+		zoneBench.numCalls++;
+	}
+
+	Z_ZoneFree(block->tag == TAG_SMALL ? smallzone : mainzone, block);
 }
 
 /**
@@ -1143,6 +1363,70 @@ void Z_FreeTags(int tag)
 	while (zone->rover != &zone->blocklist);
 }
 
+/**
+ * @brief Z_BlockSize
+ * @param[in] size requested size
+ * @return size of the block holding it
+ */
+static size_t Z_BlockSize(size_t size)
+{
+	size += sizeof(memblock_t);         // account for size of block header
+	size += 4;                          // space for memory trash tester
+	size  = PAD(size, ZONE_ALIGN);      // align to 32/64 bit boundary
+
+	return MAX(size, ZONE_MINBLOCK);
+}
+
+/**
+ * @brief Z_ZoneAlloc
+ * @param[in,out] zone
+ * @param[in] size block size including the header
+ * @param[in] tag
+ * @return the allocated block, NULL if the zone has no free block that big
+ */
+static memblock_t *Z_ZoneAlloc(memzone_t *zone, size_t size, int tag)
+{
+	size_t     extra;
+	memblock_t *new, *base;
+
+	base = zone->firstFit ? Z_FindFirstFit(zone, size) : Z_FindFree(zone, size);
+	if (!base)
+	{
+		return NULL;
+	}
+
+	Z_UnlinkFree(zone, base);
+
+	// found a block big enough
+	extra = base->size - size;
+	if (extra > MINFRAGMENT && extra >= ZONE_MINBLOCK)
+	{
+		// there will be a free fragment after the allocated block
+		new             = ( memblock_t * )((byte *)base + size);
+		new->size       = extra;
+		new->tag        = 0;    // free block
+		new->prev       = base;
+		new->id         = ZONEID;
+		new->next       = base->next;
+		new->next->prev = new;
+		base->next      = new;
+		base->size      = size;
+		Z_LinkFree(zone, new);
+	}
+
+	base->tag = tag;            // no longer a free block
+
+	zone->rover = base->next;   // a first fit search will start looking here
+	zone->used += base->size;   //
+
+	base->id = ZONEID;
+
+	// marker for memory trash testing
+	*( int * )((byte *)base + base->size - 4) = ZONEID;
+
+	return base;
+}
+
 // so we can track a block to find out when it's getting trashed
 memblock_t *debugblock;
 
@@ -1158,13 +1442,12 @@ memblock_t *debugblock;
  */
 void *Z_TagMallocDebug(size_t size, int tag, char *label, char *file, int line)
 {
-	size_t allocSize;
 #else
 void *Z_TagMalloc(size_t size, int tag)
 {
 #endif
-	size_t     extra;
-	memblock_t *start, *rover, *new, *base;
+	size_t     allocSize = size;
+	memblock_t *base;
 	memzone_t  *zone;
 
 	if (!tag)
@@ -1181,69 +1464,22 @@ void *Z_TagMalloc(size_t size, int tag)
 		zone = mainzone;
 	}
 
-#ifdef ZONE_DEBUG
-	allocSize = size;
-#endif
-
-	// scan through the block list looking for the first free block
-	// of sufficient size
-
-	size += sizeof(memblock_t);         // account for size of block header
-	size += 4;                          // space for memory trash tester
-	size  = PAD(size, sizeof(intptr_t)); // align to 32/64 bit boundary
-
-	base  = rover = zone->rover;
-	start = base->prev;
-
-	do
+	size = Z_BlockSize(size);
+	base = Z_ZoneAlloc(zone, size, tag);
+	if (!base)
 	{
-		if (rover == start)
-		{
 #ifdef ZONE_DEBUG
-			Z_LogHeap();
+		Z_LogHeap();
 
-			Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %zu bytes from the %s zone: %s, line: %d (%s)",
-			          size, zone == smallzone ? "small" : "main", file, line, label);
+		Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %zu bytes from the %s zone: %s, line: %d (%s)",
+		          size, zone == smallzone ? "small" : "main", file, line, label);
 #else
-			Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %zu bytes from the %s zone",
-			          size, zone == smallzone ? "small" : "main");
+		Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %zu bytes from the %s zone",
+		          size, zone == smallzone ? "small" : "main");
 #endif
-			return NULL;
-		}
-		if (rover->tag)
-		{
-			base = rover = rover->next;
-		}
-		else
-		{
-			rover = rover->next;
-		}
-	}
-	while (base->tag || base->size < size);
-
-	// found a block big enough
-	extra = base->size - size;
-	if (extra > MINFRAGMENT)
-	{
-		// there will be a free fragment after the allocated block
-		new             = ( memblock_t * )((byte *)base + size);
-		new->size       = extra;
-		new->tag        = 0;    // free block
-		new->prev       = base;
-		new->id         = ZONEID;
-		new->next       = base->next;
-		new->next->prev = new;
-		base->next      = new;
-		base->size      = size;
+		return NULL;
 	}
 
-	base->tag = tag;            // no longer a free block
-
-	zone->rover = base->next;   // next allocation will start looking here
-	zone->used += base->size;   //
-
-	base->id = ZONEID;
-
 #ifdef ZONE_DEBUG
 	base->d.label     = label;
 	base->d.file      = file;
@@ -1251,8 +1487,13 @@ void *Z_TagMalloc(size_t size, int tag)
 	base->d.allocSize = allocSize;
 #endif
 
-	// marker for memory trash testing
-	*( int * )((byte *)base + base->size - 4) = ZONEID;
+	if (zoneBench.recording && zoneBench.numCalls < zoneBench.maxCalls)
+	{
+		zoneBench.calls[zoneBench.numCalls].ptr  = base + 1;
+		zoneBench.calls[zoneBench.numCalls].size = (int)allocSize;
+		zoneBench.calls[zoneBench.numCalls].tag  = tag;
+		zoneBench.numCalls++;
+	}
 
 	return ( void * )((byte *)base + sizeof(memblock_t));
 }
@@ -1546,6 +1787,8 @@ void Com_Meminfo_f(void)
 	int        zoneBytes = 0, zoneBlocks = 0;
 	int        smallZoneBytes, smallZoneBlocks;
 	int        botlibBytes = 0, rendererBytes = 0;
+	int        freeBlocks = 0;
+	size_t     largestFree = 0;
 	int        unused;
 
 	for (block = mainzone->blocklist.next ; ; block = block->next)
@@ -1568,6 +1811,11 @@ void Com_Meminfo_f(void)
 				rendererBytes += block->size;
 			}
 		}
+		else
+		{
+			freeBlocks++;
+			largestFree = MAX(largestFree, block->size);
+		}
 
 		if (block->next == &mainzone->blocklist)
 		{
@@ -1639,6 +1887,161 @@ void Com_Meminfo_f(void)
 	Com_Printf("        %9i bytes (%6.2f MB) in dynamic renderer\n", rendererBytes, rendererBytes / Square(1024.f));
 	Com_Printf("        %9i bytes (%6.2f MB) in dynamic other\n", zoneBytes - (botlibBytes + rendererBytes), (zoneBytes - (botlibBytes + rendererBytes)) / Square(1024.f));
 	Com_Printf("        %9i bytes (%6.2f MB) in small Zone memory\n", smallZoneBytes, smallZoneBytes / Square(1024.f));
+	Com_Printf("%9i free zone blocks, largest %zu bytes (%6.2f MB)\n", freeBlocks, largestFree, largestFree / Square(1024.f));
+}
+
+/**
+ * @brief Z_ReplayTrace
+ * @param[in,out] mainZone scratch zone for everything but TAG_SMALL
+ * @param[in,out] smallZone scratch zone for TAG_SMALL
+ * @param[in] allocs index of the call that allocated the block each Z_Free releases, -1 if it was not recorded
+ * @param[out] blocks block allocated by each call
+ * @return number of allocations that did not fit
+ */
+static int Z_ReplayTrace(memzone_t *mainZone, memzone_t *smallZone, const int *allocs, memblock_t **blocks)
+{
+	const zoneTrace_t *call;
+	memzone_t         *zone;
+	int               i, failed = 0;
+
+	Z_ClearZone(mainZone, s_zoneTotal);
+	Z_ClearZone(smallZone, s_smallZoneTotal);
+
+	for (i = 0, call = zoneBench.calls; i < zoneBench.numCalls; i++, call++)
+	{
+		zone = call->tag == TAG_SMALL ? smallZone : mainZone;
+
+		if (call->size)
+		{
+			blocks[i] = Z_ZoneAlloc(zone, Z_BlockSize(call->size), call->tag);
+			if (!blocks[i])
+			{
+				failed++;
+			}
+		}
+		else if (allocs[i] >= 0 && blocks[allocs[i]])
+		{
+			Z_ZoneFree(zone, blocks[allocs[i]]);
+		}
+	}
+
+	return failed;
+}
+
+/**
+ * @brief Records zone calls and replays them on scratch zones, with the size
+ * classes and with the first fit search they replaced
+ */
+void Com_ZoneBench_f(void)
+{
+	memzone_t  *mainZone, *smallZone;
+	memblock_t **blocks, *block;
+	void       **keys;
+	int        *values, *allocs;
+	int        i, j, k, passes, start, msec, failed, freeBlocks, hashSize;
+	size_t     largest;
+
+	if (Cmd_Argc() > 1 && !Q_stricmp(Cmd_Argv(1), "record"))
+	{
+		if (zoneBench.calls)
+		{
+			Com_Dealloc(zoneBench.calls);
+		}
+
+		zoneBench.maxCalls  = Cmd_Argc() > 2 ? MAX(atoi(Cmd_Argv(2)), 1) : 100000;
+		zoneBench.calls     = (zoneTrace_t *)Com_Allocate(zoneBench.maxCalls * sizeof(zoneTrace_t));
+		zoneBench.numCalls  = 0;
+		zoneBench.recording = zoneBench.calls != NULL;
+		Com_Printf("zonebench: recording the next %i zone calls\n", zoneBench.maxCalls);
+		return;
+	}
+
+	if (!zoneBench.numCalls)
+	{
+		Com_Printf("usage: zonebench record [count], then zonebench [passes]\n");
+		return;
+	}
+
+	zoneBench.recording = qfalse;
+	passes              = Cmd_Argc() > 1 ? MAX(atoi(Cmd_Argv(1)), 1) : 10;
+
+	// pair each Z_Free with the recorded call that allocated its block,
+	// addresses are reused so later allocations overwrite the entry
+	for (hashSize = 1; hashSize < zoneBench.numCalls * 2; hashSize <<= 1)
+	{
+	}
+
+	keys      = (void **)Com_Allocate(hashSize * sizeof(*keys));
+	values    = (int *)Com_Allocate(hashSize * sizeof(*values));
+	allocs    = (int *)Com_Allocate(zoneBench.numCalls * sizeof(*allocs));
+	blocks    = (memblock_t **)Com_Allocate(zoneBench.numCalls * sizeof(*blocks));
+	mainZone  = (memzone_t *)calloc(s_zoneTotal, 1);
+	smallZone = (memzone_t *)calloc(s_smallZoneTotal, 1);
+
+	if (!keys || !values || !allocs || !blocks || !mainZone || !smallZone)
+	{
+		Com_Printf("zonebench: not enough memory to replay %i calls\n", zoneBench.numCalls);
+	}
+	else
+	{
+		Com_Memset(keys, 0, hashSize * sizeof(*keys));
+
+		for (i = 0; i < zoneBench.numCalls; i++)
+		{
+			j = (int)(((uintptr_t)zoneBench.calls[i].ptr / ZONE_ALIGN) * 2654435761u) & (hashSize - 1);
+			while (keys[j] && keys[j] != zoneBench.calls[i].ptr)
+			{
+				j = (j + 1) & (hashSize - 1);
+			}
+
+			if (zoneBench.calls[i].size)
+			{
+				keys[j]   = zoneBench.calls[i].ptr;
+				values[j] = i;
+				allocs[i] = -1;
+			}
+			else
+			{
+				allocs[i] = keys[j] ? values[j] : -1;
+				values[j] = -1;
+			}
+		}
+
+		for (k = 0; k < 2; k++)
+		{
+			mainZone->firstFit = smallZone->firstFit = (k == 1);
+
+			failed = 0;
+			start  = Sys_Milliseconds();
+			for (j = 0; j < passes; j++)
+			{
+				failed = Z_ReplayTrace(mainZone, smallZone, allocs, blocks);
+			}
+			msec = Sys_Milliseconds() - start;
+
+			freeBlocks = 0;
+			largest    = 0;
+			for (block = mainZone->blocklist.next; block != &mainZone->blocklist; block = block->next)
+			{
+				if (!block->tag)
+				{
+					freeBlocks++;
+					largest = MAX(largest, block->size);
+				}
+			}
+
+			Com_Printf("%-11s %i passes of %i calls: %5i msec, %.1f ns per call, %i failed, %i free blocks, largest %zu bytes\n",
+			           k ? "first fit:" : "size class:", passes, zoneBench.numCalls, msec,
+			           msec * 1000000.0 / ((double)passes * zoneBench.numCalls), failed, freeBlocks, largest);
+		}
+	}
+
+	Com_Dealloc(keys);
+	Com_Dealloc(values);
+	Com_Dealloc(allocs);
+	Com_Dealloc(blocks);
+	free(mainZone);
+	free(smallZone);
 }
 
 /**
@@ -1887,6 +2290,7 @@ void Com_InitHunkMemory(void)
 	Hunk_Clear();
 
 	Cmd_AddCommand("meminfo", Com_Meminfo_f, "Displays info about used memory.");
+	Cmd_AddCommand("zonebench", Com_ZoneBench_f, "Records zone allocations and replays them to time the allocator.");
 #ifdef ZONE_DEBUG
 	Cmd_AddCommand("zonelog", Z_LogHeap, "Writes zone memory info into logfile.");
 #endif
@@ -3013,6 +3417,9 @@ void Com_Init(char *commandLine)
 		Cmd_AddCommand("error", Com_Error_f, "Just throw a fatal error to test error shutdown procedures.");
 		Cmd_AddCommand("crash", Com_Crash_f, "A way to force a bus error for development reasons.");
 		Cmd_AddCommand("freeze", Com_Freeze_f, "Just freeze in place for a given number of seconds to test error recovery.");
+		Cmd_AddCommand("huffbench", MSG_HuffmanBench_f, "Times the network huffman tables against the tree walk on a recorded demo.");
+		Cmd_AddCommand("cmdbench", Cmd_Bench_f, "Times the hashed command lookup against the list walk on a config file and the registered commands.");
+		Cmd_AddCommand("cmtracetest", CM_TraceTest_f, "Runs random box traces on the loaded map serially and on worker threads and compares the results.");
 		Win_ShowConsole(com_viewlog->integer, qtrue);
 	}
 	else
@@ -3025,6 +3432,7 @@ void Com_Init(char *commandLine)
 	Cmd_AddCommand("writeconfig", Com_WriteConfig_f, "Write the config file to a specific name.");
 	Cmd_AddCommand("update", Com_Update_f, "Updates the game to latest version.");
 	Cmd_AddCommand("download", Com_Download_f, "Downloads a pk3 from the URL set in cvar com_downloadURL.");
+	Cmd_AddCommand("demo_index", Com_DemoIndex_f, "Writes the seek index of a demo next to it.");
 
 #ifdef FEATURE_DBMS
 	Cmd_AddCommand("saveDB", DB_SaveMemDB_f, "Saves the internal memory database to disk.");
@@ -3549,8 +3957,8 @@ void Com_Frame(void)
 	// trace optimization tracking
 	if (com_showtrace->integer)
 	{
-		extern int c_traces, c_brush_traces, c_patch_traces;
-		extern int c_pointcontents;
+		extern Q_THREAD_LOCAL int c_traces, c_brush_traces, c_patch_traces;
+		extern Q_THREAD_LOCAL int c_pointcontents;
 
 		Com_Printf("%4i traces  (%ib %ip) %4i points\n", c_traces,
 		           c_brush_traces, c_patch_traces, c_pointcontents);
@@ -3589,6 +3997,7 @@ void Com_CheckDefaultProfileDatExists(void)
 void Com_Shutdown(qboolean badProfile)
 {
 	Cmd_RemoveCommand("meminfo");
+	Cmd_RemoveCommand("zonebench");
 #ifdef ZONE_DEBUG
 	Cmd_RemoveCommand("zonelog");
 #endif
@@ -0,0 +1,1248 @@
+/*
+ * Wolfenstein: Enemy Territory GPL Source Code
+ * Copyright (C) 1999-2010 id Software LLC, a ZeniMax Media company.
+ *
+ * ET: Legacy
+ * Copyright (C) 2012-2023 ET:Legacy team <mail@etlegacy.com>
+ *
+ * This file is part of ET: Legacy - http://www.etlegacy.com
+ *
+ * ET: Legacy is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ET: Legacy is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ET: Legacy. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, Wolfenstein: Enemy Territory GPL Source Code is also
+ * subject to certain additional terms. You should have received a copy
+ * of these additional terms immediately following the terms and conditions
+ * of the GNU General Public License which accompanied the source code.
+ * If not, please request a copy in writing from id Software at the address below.
+ *
+ * id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+ */
+/**
+ * @file demo_index.c
+ * @brief Seek index of recorded demos
+ *
+ * Every snapshot of a demo is delta compressed against an earlier one, so
+ * getting to a given time means parsing all the messages before it. The
+ * index is a file next to the demo (demos/name.dm_84.idx) listing resume
+ * points: the offset of a message together with the configstrings and the
+ * snapshots the messages after it delta from. Playback loads a point and
+ * reads on from its offset as if it had read everything before.
+ *
+ * The file is a list of records, a gamestate record for each gamestate and
+ * a point record every DEMO_INDEX_INTERVAL of server time, followed by the
+ * header. Writing the header last means an interrupted build is never used.
+ */
+
+#include "q_shared.h"
+#include "qcommon.h"
+
+#define DEMO_INDEX_IDENT        (('X' << 24) + ('D' << 16) + ('I' << 8) + 'D')
+#define DEMO_INDEX_VERSION      1
+#define DEMO_INDEX_INTERVAL     10000       ///< server time between points
+#define DEMO_INDEX_CHECKSUM     65536       ///< leading demo bytes summed to notice a changed demo
+#define DEMO_INDEX_POINT_SIZE   0x100000    ///< largest encoded point
+
+#define DEMO_RECORD_GAMESTATE   1
+#define DEMO_RECORD_POINT       2
+
+/**
+ * @struct demoIndexHeader_t
+ */
+typedef struct
+{
+	int ident;
+	int version;
+	int demoLength;
+	int demoChecksum;
+	int snapsInDemo;
+	int firstServerTime;
+	int lastServerTime;
+	int numGamestates;
+	int numPoints;
+	int dataSize;               ///< size of the records in front of the header
+} demoIndexHeader_t;
+
+/**
+ * @struct demoIndexFrame_t
+ * @brief A parsed snapshot, like clSnapshot_t
+ */
+typedef struct
+{
+	qboolean valid;
+	int messageNum;
+	int serverTime;
+	int snapFlags;
+	int serverCommandNum;
+	byte areamask[MAX_MAP_AREA_BYTES];
+	playerState_t ps;
+	int numEntities;
+	int parseEntitiesNum;
+} demoIndexFrame_t;
+
+/**
+ * @struct demoIndexBuild_t
+ * @brief What the client would have when playing the demo, only without a cgame
+ */
+typedef struct
+{
+	fileHandle_t demo;
+	fileHandle_t file;
+	demoIndexHeader_t header;
+	int dataSize;
+
+	byte message[MAX_MSGLEN];
+	int numMessages;
+	int messageSequence;
+	int serverCommandSequence;
+
+	gameState_t gameState;                      ///< configstrings with the commands read so far
+	gameState_t baseState;                      ///< configstrings of the last gamestate
+	entityState_t baselines[MAX_GENTITIES];
+	int bigConfigString;                        ///< index of the bcs0 - bcs2 configstring being built, -1 if none
+	char bigConfigData[BIG_INFO_STRING];
+
+	demoIndexFrame_t frames[PACKET_BACKUP];
+	demoIndexFrame_t snap;                      ///< newest valid snapshot
+	entityState_t parseEntities[MAX_PARSE_ENTITIES];
+	int parseEntitiesNum;
+
+	// the demo pre-scan counts snapshots across gamestates
+	qboolean haveSnap;
+	int snapTime;
+	int snapFlags;
+	int oldFrameServerTime;
+
+	// a point waits until the messages after it show which snapshots they delta from
+	qboolean pending;
+	int pendingSequence;                        ///< last message read before the point
+	demoIndexPoint_t pendingPoint;
+	int needed[PACKET_BACKUP];                  ///< message numbers of the snapshots to store
+	demoIndexFrame_t pendingFrames[PACKET_BACKUP];
+	entityState_t pendingEntities[MAX_PARSE_ENTITIES];
+	msg_t pointMsg;
+	byte pointData[DEMO_INDEX_POINT_SIZE];
+} demoIndexBuild_t;
+
+/**
+ * @brief Sums the start of a demo so an index can tell it was built for it
+ * @param[in] demoName
+ * @param[out] length
+ * @param[out] checksum
+ * @return qfalse if the demo can't be read
+ */
+static qboolean Com_DemoIndexChecksum(const char *demoName, int *length, int *checksum)
+{
+	fileHandle_t f;
+	byte         *buf;
+	int          len;
+
+	*length = FS_FOpenFileRead(demoName, &f, qtrue);
+	if (!f)
+	{
+		return qfalse;
+	}
+
+	len = MIN(*length, DEMO_INDEX_CHECKSUM);
+	buf = (byte *)Com_Allocate(MAX(len, 1));
+	if (!buf || FS_Read(buf, len, f) != len)
+	{
+		Com_Dealloc(buf);
+		FS_FCloseFile(f);
+		return qfalse;
+	}
+
+	*checksum = (int)Com_BlockChecksum(buf, len);
+
+	Com_Dealloc(buf);
+	FS_FCloseFile(f);
+	return qtrue;
+}
+
+/**
+ * @brief Changes a configstring the way the client does for the cs command
+ * @param[in,out] gs
+ * @param[in] index
+ * @param[in] s
+ * @return qfalse if the strings don't fit
+ */
+static qboolean Com_DemoIndexSetConfigstring(gameState_t *gs, int index, const char *s)
+{
+	static gameState_t oldGs;
+	const char         *dup;
+	int                i, len;
+
+	if (!strcmp(gs->stringData + gs->stringOffsets[index], s))
+	{
+		return qtrue;
+	}
+
+	// unused so far, append it
+	if (!gs->stringOffsets[index])
+	{
+		len = strlen(s);
+		if (len + 1 + gs->dataCount > MAX_GAMESTATE_CHARS)
+		{
+			return qfalse;
+		}
+
+		gs->stringOffsets[index] = gs->dataCount;
+		Com_Memcpy(gs->stringData + gs->dataCount, s, len + 1);
+		gs->dataCount += len + 1;
+		return qtrue;
+	}
+
+	oldGs = *gs;
+	Com_Memset(gs, 0, sizeof(*gs));
+	gs->dataCount = 1;
+
+	for (i = 0; i < MAX_CONFIGSTRINGS; i++)
+	{
+		dup = (i == index) ? s : oldGs.stringData + oldGs.stringOffsets[i];
+		if (!dup[0])
+		{
+			continue;
+		}
+
+		len = strlen(dup);
+		if (len + 1 + gs->dataCount > MAX_GAMESTATE_CHARS)
+		{
+			*gs = oldGs;
+			return qfalse;
+		}
+
+		gs->stringOffsets[i] = gs->dataCount;
+		Com_Memcpy(gs->stringData + gs->dataCount, dup, len + 1);
+		gs->dataCount += len + 1;
+	}
+
+	return qtrue;
+}
+
+/**
+ * @brief Writes the configstrings of to which differ from those of from
+ * @param[in,out] msg
+ * @param[in] from NULL to write all set configstrings
+ * @param[in] to
+ */
+static void Com_DemoIndexWriteConfigstrings(msg_t *msg, const gameState_t *from, const gameState_t *to)
+{
+	const char *s;
+	int        i;
+
+	for (i = 0; i < MAX_CONFIGSTRINGS; i++)
+	{
+		s = to->stringData + to->stringOffsets[i];
+		if (from ? !strcmp(from->stringData + from->stringOffsets[i], s) : !s[0])
+		{
+			continue;
+		}
+
+		MSG_WriteShort(msg, i);
+		MSG_WriteBigString(msg, s);
+	}
+	MSG_WriteShort(msg, MAX_CONFIGSTRINGS);
+}
+
+/**
+ * @brief Reads configstrings written by Com_DemoIndexWriteConfigstrings into gs
+ * @param[in,out] msg
+ * @param[in,out] gs
+ * @return qfalse on bad data
+ */
+static qboolean Com_DemoIndexReadConfigstrings(msg_t *msg, gameState_t *gs)
+{
+	int index;
+
+	while ((index = MSG_ReadShort(msg)) != MAX_CONFIGSTRINGS)
+	{
+		if (index < 0 || index >= MAX_CONFIGSTRINGS || msg->readcount > msg->cursize)
+		{
+			return qfalse;
+		}
+
+		if (!Com_DemoIndexSetConfigstring(gs, index, MSG_ReadBigString(msg)))
+		{
+			return qfalse;
+		}
+	}
+
+	return qtrue;
+}
+
+/**
+ * @brief Writes an int of a record
+ * @param[in] b
+ * @param[in] value
+ */
+static void Com_DemoIndexWriteInt(demoIndexBuild_t *b, int value)
+{
+	value = LittleLong(value);
+	b->dataSize += FS_Write(&value, 4, b->file);
+}
+
+/**
+ * @brief Reads an int of a record
+ * @param[in] data
+ * @param[in,out] pos
+ * @return
+ */
+static int Com_DemoIndexReadInt(const byte *data, int *pos)
+{
+	int value;
+
+	Com_Memcpy(&value, data + *pos, 4);
+	*pos += 4;
+	return LittleLong(value);
+}
+
+/**
+ * @brief Starts a point before the next message
+ * @param[in,out] b
+ * @param[in] offset
+ */
+static void Com_DemoIndexBeginPoint(demoIndexBuild_t *b, int offset)
+{
+	int i;
+
+	b->pending         = qtrue;
+	b->pendingSequence = b->messageSequence;
+
+	b->pendingPoint.offset                = offset;
+	b->pendingPoint.numMessages           = b->numMessages;
+	b->pendingPoint.serverTime            = b->snap.serverTime;
+	b->pendingPoint.serverCommandSequence = b->serverCommandSequence;
+	b->pendingPoint.gamestate             = b->header.numGamestates - 1;
+
+	Com_Memcpy(b->pendingFrames, b->frames, sizeof(b->frames));
+	Com_Memcpy(b->pendingEntities, b->parseEntities, sizeof(b->parseEntities));
+
+	for (i = 0; i < PACKET_BACKUP; i++)
+	{
+		b->needed[i] = -1;
+	}
+	// the newest snapshot becomes the current one
+	b->needed[b->snap.messageNum & PACKET_MASK] = b->snap.messageNum;
+
+	MSG_Init(&b->pointMsg, b->pointData, sizeof(b->pointData));
+	Com_DemoIndexWriteConfigstrings(&b->pointMsg, &b->baseState, &b->gameState);
+}
+
+/**
+ * @brief Writes the pending point with the snapshots the messages after it need
+ * @param[in,out] b
+ */
+static void Com_DemoIndexEndPoint(demoIndexBuild_t *b)
+{
+	msg_t            *msg = &b->pointMsg;
+	demoIndexFrame_t *frame;
+	entityState_t    *es;
+	int              num, i;
+
+	b->pending = qfalse;
+
+	// oldest first, so the newest ends up as the current snapshot
+	for (num = b->pendingSequence - PACKET_MASK; num <= b->pendingSequence; num++)
+	{
+		frame = &b->pendingFrames[num & PACKET_MASK];
+		if (b->needed[num & PACKET_MASK] != num || !frame->valid || frame->messageNum != num)
+		{
+			continue;
+		}
+
+		MSG_WriteByte(msg, 1);
+		MSG_WriteLong(msg, frame->messageNum);
+		MSG_WriteLong(msg, frame->serverTime);
+		MSG_WriteLong(msg, frame->serverCommandNum);
+		MSG_WriteByte(msg, frame->snapFlags);
+		MSG_WriteData(msg, frame->areamask, sizeof(frame->areamask));
+		MSG_WriteDeltaPlayerstate(msg, NULL, &frame->ps);
+
+		for (i = 0; i < frame->numEntities; i++)
+		{
+			es = &b->pendingEntities[(frame->parseEntitiesNum + i) & (MAX_PARSE_ENTITIES - 1)];
+			MSG_WriteDeltaEntity(msg, &b->baselines[es->number], es, qtrue);
+		}
+		MSG_WriteBits(msg, MAX_GENTITIES - 1, GENTITYNUM_BITS);
+	}
+	MSG_WriteByte(msg, 0);
+
+	if (msg->overflowed)
+	{
+		Com_DPrintf("demo_index: point at %i too large, skipped\n", b->pendingPoint.serverTime);
+		return;
+	}
+
+	Com_DemoIndexWriteInt(b, DEMO_RECORD_POINT);
+	Com_DemoIndexWriteInt(b, b->pendingPoint.offset);
+	Com_DemoIndexWriteInt(b, b->pendingPoint.numMessages);
+	Com_DemoIndexWriteInt(b, b->pendingPoint.serverTime);
+	Com_DemoIndexWriteInt(b, b->pendingPoint.serverCommandSequence);
+	Com_DemoIndexWriteInt(b, b->pendingPoint.gamestate);
+	Com_DemoIndexWriteInt(b, msg->cursize);
+	b->dataSize += FS_Write(msg->data, msg->cursize, b->file);
+
+	b->header.numPoints++;
+}
+
+/**
+ * @brief Keeps the configstrings of the cs and bcs commands, like CL_GetServerCommand
+ * @param[in,out] b
+ * @param[in] s
+ */
+static void Com_DemoIndexServerCommand(demoIndexBuild_t *b, const char *s)
+{
+	char       value[BIG_INFO_STRING];
+	const char *arg;
+	int        len, index;
+	qboolean   big;
+
+	big = !Q_strncmp(s, "bcs", 3);
+	if (Q_strncmp(s, "cs ", 3) && !(big && s[3] >= '0' && s[3] <= '2' && s[4] == ' '))
+	{
+		return;
+	}
+
+	// cs <index> "<value>", the value is a single quoted argument
+	arg   = strchr(s, ' ');
+	index = Q_atoi(arg);
+	arg   = strchr(arg, '"');
+	if (index < 0 || index >= MAX_CONFIGSTRINGS || !arg)
+	{
+		return;
+	}
+	arg++;
+	len = strchr(arg, '"') ? strchr(arg, '"') - arg : strlen(arg);
+	len = MIN(len, (int)sizeof(value) - 1);
+	Com_Memcpy(value, arg, len);
+	value[len] = '\0';
+
+	if (big)
+	{
+		switch (s[3])
+		{
+		case '0':
+			b->bigConfigString = index;
+			Q_strncpyz(b->bigConfigData, value, sizeof(b->bigConfigData));
+			return;
+		case '1':
+			Q_strcat(b->bigConfigData, sizeof(b->bigConfigData), value);
+			return;
+		default:
+			Q_strcat(b->bigConfigData, sizeof(b->bigConfigData), value);
+			if (b->bigConfigString >= 0)
+			{
+				Com_DemoIndexSetConfigstring(&b->gameState, b->bigConfigString, b->bigConfigData);
+			}
+			b->bigConfigString = -1;
+			return;
+		}
+	}
+
+	if (!Com_DemoIndexSetConfigstring(&b->gameState, index, value))
+	{
+		Com_DPrintf("demo_index: MAX_GAMESTATE_CHARS exceeded\n");
+	}
+}
+
+/**
+ * @brief Reads a gamestate like CL_ParseGamestate and records it
+ * @param[in,out] b
+ * @param[in] msg
+ * @param[in] offset of the message
+ * @return qfalse on bad data
+ */
+static qboolean Com_DemoIndexParseGamestate(demoIndexBuild_t *b, msg_t *msg, int offset)
+{
+	entityState_t nullstate;
+	msg_t         out;
+	const char    *s;
+	int           cmd, i, len;
+
+	// nothing after the gamestate deltas from before it
+	if (b->pending)
+	{
+		Com_DemoIndexEndPoint(b);
+	}
+
+	Com_Memset(&b->gameState, 0, sizeof(b->gameState));
+	Com_Memset(b->baselines, 0, sizeof(b->baselines));
+	Com_Memset(b->frames, 0, sizeof(b->frames));
+	Com_Memset(&b->snap, 0, sizeof(b->snap));
+	b->parseEntitiesNum = 0;
+	b->bigConfigString  = -1;
+
+	b->serverCommandSequence = MSG_ReadLong(msg);
+
+	b->gameState.dataCount = 1;
+	while ((cmd = MSG_ReadByte(msg)) != svc_EOF)
+	{
+		if (cmd == svc_configstring)
+		{
+			i = MSG_ReadShort(msg);
+			if (i < 0 || i >= MAX_CONFIGSTRINGS)
+			{
+				return qfalse;
+			}
+			s   = MSG_ReadBigString(msg);
+			len = strlen(s);
+			if (len + 1 + b->gameState.dataCount > MAX_GAMESTATE_CHARS)
+			{
+				return qfalse;
+			}
+
+			b->gameState.stringOffsets[i] = b->gameState.dataCount;
+			Com_Memcpy(b->gameState.stringData + b->gameState.dataCount, s, len + 1);
+			b->gameState.dataCount += len + 1;
+		}
+		else if (cmd == svc_baseline)
+		{
+			i = MSG_ReadBits(msg, GENTITYNUM_BITS);
+			if (i < 0 || i >= MAX_GENTITIES)
+			{
+				return qfalse;
+			}
+			Com_Memset(&nullstate, 0, sizeof(nullstate));
+			MSG_ReadDeltaEntity(msg, &nullstate, &b->baselines[i], i);
+		}
+		else
+		{
+			return qfalse;
+		}
+
+		if (msg->readcount > msg->cursize)
+		{
+			return qfalse;
+		}
+	}
+
+	(void) MSG_ReadLong(msg);   // clientNum
+	(void) MSG_ReadLong(msg);   // checksumFeed
+
+	b->baseState = b->gameState;
+
+	MSG_Init(&out, b->pointData, sizeof(b->pointData));
+	Com_DemoIndexWriteConfigstrings(&out, NULL, &b->gameState);
+
+	Com_DemoIndexWriteInt(b, DEMO_RECORD_GAMESTATE);
+	Com_DemoIndexWriteInt(b, offset);
+	Com_DemoIndexWriteInt(b, out.cursize);
+	b->dataSize += FS_Write(out.data, out.cursize, b->file);
+
+	b->header.numGamestates++;
+	return qtrue;
+}
+
+/**
+ * @brief Stores an entity of a snapshot like CL_DeltaEntity
+ * @param[in,out] b
+ * @param[in] msg
+ * @param[in,out] frame
+ * @param[in] newnum
+ * @param[in] old
+ * @param[in] unchanged
+ */
+static void Com_DemoIndexDeltaEntity(demoIndexBuild_t *b, msg_t *msg, demoIndexFrame_t *frame, int newnum, entityState_t *old, qboolean unchanged)
+{
+	entityState_t *state = &b->parseEntities[b->parseEntitiesNum & (MAX_PARSE_ENTITIES - 1)];
+
+	if (unchanged)
+	{
+		*state = *old;
+	}
+	else
+	{
+		MSG_ReadDeltaEntity(msg, old, state, newnum);
+	}
+
+	if (state->number == (MAX_GENTITIES - 1))
+	{
+		return;     // entity was delta removed
+	}
+
+	b->parseEntitiesNum++;
+	frame->numEntities++;
+}
+
+/**
+ * @brief Returns the entity number at oldindex of oldframe, MAX_GENTITIES past the end
+ * @param[in] b
+ * @param[in] oldframe
+ * @param[in] oldindex
+ * @param[out] oldstate
+ * @return
+ */
+static int Com_DemoIndexOldEntity(demoIndexBuild_t *b, demoIndexFrame_t *oldframe, int oldindex, entityState_t **oldstate)
+{
+	if (!oldframe || oldindex >= oldframe->numEntities)
+	{
+		return MAX_GENTITIES;
+	}
+
+	*oldstate = &b->parseEntities[(oldframe->parseEntitiesNum + oldindex) & (MAX_PARSE_ENTITIES - 1)];
+	return (*oldstate)->number;
+}
+
+/**
+ * @brief Reads the entities of a snapshot like CL_ParsePacketEntities
+ * @param[in,out] b
+ * @param[in] msg
+ * @param[in] oldframe
+ * @param[in,out] newframe
+ * @return qfalse on bad data
+ */
+static qboolean Com_DemoIndexParseEntities(demoIndexBuild_t *b, msg_t *msg, demoIndexFrame_t *oldframe, demoIndexFrame_t *newframe)
+{
+	entityState_t *oldstate = NULL;
+	int           oldindex  = 0, newnum, oldnum;
+
+	newframe->parseEntitiesNum = b->parseEntitiesNum;
+	newframe->numEntities      = 0;
+
+	oldnum = Com_DemoIndexOldEntity(b, oldframe, oldindex, &oldstate);
+
+	while (1)
+	{
+		newnum = MSG_ReadBits(msg, GENTITYNUM_BITS);
+		if (newnum >= (MAX_GENTITIES - 1))
+		{
+			break;
+		}
+
+		if (msg->readcount > msg->cursize)
+		{
+			return qfalse;
+		}
+
+		while (oldnum < newnum)
+		{
+			// one or more entities from the old packet are unchanged
+			Com_DemoIndexDeltaEntity(b, msg, newframe, oldnum, oldstate, qtrue);
+			oldnum = Com_DemoIndexOldEntity(b, oldframe, ++oldindex, &oldstate);
+		}
+
+		if (oldnum == newnum)
+		{
+			// delta from previous state
+			Com_DemoIndexDeltaEntity(b, msg, newframe, newnum, oldstate, qfalse);
+			oldnum = Com_DemoIndexOldEntity(b, oldframe, ++oldindex, &oldstate);
+		}
+		else
+		{
+			// delta from baseline
+			Com_DemoIndexDeltaEntity(b, msg, newframe, newnum, &b->baselines[newnum], qfalse);
+		}
+	}
+
+	// any remaining entities in the old frame are copied over
+	while (oldnum != MAX_GENTITIES)
+	{
+		Com_DemoIndexDeltaEntity(b, msg, newframe, oldnum, oldstate, qtrue);
+		oldnum = Com_DemoIndexOldEntity(b, oldframe, ++oldindex, &oldstate);
+	}
+
+	return qtrue;
+}
+
+/**
+ * @brief Reads a snapshot like CL_ParseSnapshot
+ * @param[in,out] b
+ * @param[in] msg
+ * @return qfalse on bad data
+ */
+static qboolean Com_DemoIndexParseSnapshot(demoIndexBuild_t *b, msg_t *msg)
+{
+	static demoIndexFrame_t newSnap;
+	demoIndexFrame_t        *old = NULL;
+	int                     deltaNum, len, oldMessageNum;
+
+	Com_Memset(&newSnap, 0, sizeof(newSnap));
+
+	newSnap.serverCommandNum = b->serverCommandSequence;
+	newSnap.serverTime       = MSG_ReadLong(msg);
+	newSnap.messageNum       = b->messageSequence;
+
+	deltaNum           = MSG_ReadByte(msg);
+	deltaNum           = deltaNum ? newSnap.messageNum - deltaNum : -1;
+	newSnap.snapFlags  = MSG_ReadByte(msg);
+
+	if (deltaNum <= 0)
+	{
+		newSnap.valid = qtrue;      // uncompressed frame
+	}
+	else
+	{
+		old           = &b->frames[deltaNum & PACKET_MASK];
+		newSnap.valid = (qboolean)(old->valid && old->messageNum == deltaNum
+		                           && b->parseEntitiesNum - old->parseEntitiesNum <= MAX_PARSE_ENTITIES - 128);
+
+		// the pending point has to carry the snapshots from before it that are still referenced
+		if (b->pending && deltaNum <= b->pendingSequence)
+		{
+			b->needed[deltaNum & PACKET_MASK] = deltaNum;
+		}
+	}
+
+	len = MSG_ReadByte(msg);
+	if (len < 0 || len > sizeof(newSnap.areamask))
+	{
+		return qfalse;
+	}
+	MSG_ReadData(msg, &newSnap.areamask, len);
+
+	MSG_ReadDeltaPlayerstate(msg, old ? &old->ps : NULL, &newSnap.ps);
+
+	if (!Com_DemoIndexParseEntities(b, msg, old, &newSnap))
+	{
+		return qfalse;
+	}
+
+	if (!newSnap.valid)
+	{
+		return qtrue;
+	}
+
+	// invalidate the dropped frames like the client does
+	oldMessageNum = b->snap.messageNum + 1;
+	if (newSnap.messageNum - oldMessageNum >= PACKET_BACKUP)
+	{
+		oldMessageNum = newSnap.messageNum - (PACKET_BACKUP - 1);
+	}
+	for ( ; oldMessageNum < newSnap.messageNum; oldMessageNum++)
+	{
+		b->frames[oldMessageNum & PACKET_MASK].valid = qfalse;
+	}
+
+	b->snap                                     = newSnap;
+	b->frames[newSnap.messageNum & PACKET_MASK] = newSnap;
+
+	b->haveSnap  = qtrue;
+	b->snapTime  = newSnap.serverTime;
+	b->snapFlags = newSnap.snapFlags;
+	return qtrue;
+}
+
+/**
+ * @brief Reads a demo message like CL_ParseServerMessage
+ * @param[in,out] b
+ * @param[in] msg
+ * @param[in] offset of the message
+ * @return qfalse on bad data
+ */
+static qboolean Com_DemoIndexParseMessage(demoIndexBuild_t *b, msg_t *msg, int offset)
+{
+	int seq;
+	int cmd;
+
+	MSG_Bitstream(msg);
+	(void) MSG_ReadLong(msg);   // reliable acknowledge
+
+	while (1)
+	{
+		if (msg->readcount > msg->cursize)
+		{
+			return qfalse;
+		}
+
+		cmd = MSG_ReadByte(msg);
+		if (cmd == svc_EOF)
+		{
+			return qtrue;
+		}
+
+		switch (cmd)
+		{
+		case svc_nop:
+			break;
+		case svc_serverCommand:
+			seq = MSG_ReadLong(msg);
+			if (seq > b->serverCommandSequence)
+			{
+				b->serverCommandSequence = seq;
+				Com_DemoIndexServerCommand(b, MSG_ReadString(msg));
+			}
+			else
+			{
+				(void) MSG_ReadString(msg);
+			}
+			break;
+		case svc_gamestate:
+			if (!Com_DemoIndexParseGamestate(b, msg, offset))
+			{
+				return qfalse;
+			}
+			break;
+		case svc_snapshot:
+			if (!b->header.numGamestates || !Com_DemoIndexParseSnapshot(b, msg))
+			{
+				return qfalse;
+			}
+			break;
+		case svc_download:
+			(void) MSG_ReadShort(msg);
+			break;
+		default:
+			return qfalse;
+		}
+	}
+}
+
+/**
+ * @brief Counts the snapshots like the client demo pre-scan does
+ * @param[in,out] b
+ */
+static void Com_DemoIndexCount(demoIndexBuild_t *b)
+{
+	if (!b->haveSnap)
+	{
+		return;
+	}
+
+	// ignore snapshots that don't have entities
+	if (b->snapTime < b->oldFrameServerTime && (b->snapFlags & SNAPFLAG_NOT_ACTIVE))
+	{
+		return;
+	}
+	b->oldFrameServerTime = b->snapTime;
+
+	b->header.lastServerTime = b->snapTime;
+	if (!b->header.firstServerTime)
+	{
+		b->header.firstServerTime = b->snapTime;
+	}
+	b->header.snapsInDemo++;
+}
+
+/**
+ * @brief Reads the whole demo, writing the gamestate and point records
+ * @param[in,out] b
+ * @return qfalse if the demo can't be parsed
+ */
+static qboolean Com_DemoIndexBuild(demoIndexBuild_t *b)
+{
+	msg_t msg;
+	int   offset, sequence, length;
+
+	b->bigConfigString = -1;
+
+	while (1)
+	{
+		offset = FS_FTell(b->demo);
+
+		// points go after a current snapshot, and not into a configstring split over commands
+		if (!b->pending && b->snap.valid && b->bigConfigString < 0
+		    && b->messageSequence - b->snap.messageNum < PACKET_BACKUP
+		    && (!b->header.numPoints || b->snap.serverTime >= b->pendingPoint.serverTime + DEMO_INDEX_INTERVAL))
+		{
+			Com_DemoIndexBeginPoint(b, offset);
+		}
+
+		if (FS_Read(&sequence, 4, b->demo) != 4 || FS_Read(&length, 4, b->demo) != 4)
+		{
+			break;
+		}
+
+		length = LittleLong(length);
+		if (length == -1)
+		{
+			break;
+		}
+		if (length < 0 || length > MAX_MSGLEN)
+		{
+			Com_Printf("demo_index: bad message length %i\n", length);
+			return qfalse;
+		}
+		if (FS_Read(b->message, length, b->demo) != length)
+		{
+			// truncated, index what is there like playback does
+			break;
+		}
+
+		b->messageSequence = LittleLong(sequence);
+		b->numMessages++;
+
+		MSG_Init(&msg, b->message, sizeof(b->message));
+		msg.cursize = length;
+		if (!Com_DemoIndexParseMessage(b, &msg, offset))
+		{
+			Com_Printf("demo_index: bad message %i at offset %i\n", b->messageSequence, offset);
+			return qfalse;
+		}
+
+		Com_DemoIndexCount(b);
+
+		if (b->pending && b->messageSequence - b->pendingSequence >= PACKET_BACKUP)
+		{
+			Com_DemoIndexEndPoint(b);
+		}
+	}
+
+	if (b->pending)
+	{
+		Com_DemoIndexEndPoint(b);
+	}
+
+	return qtrue;
+}
+
+/**
+ * @brief Builds the seek index of a demo and writes it next to it
+ * @param[in] demoName path of the demo, e.g. demos/name.dm_84
+ * @return qtrue if the index was written
+ */
+qboolean Com_WriteDemoIndex(const char *demoName)
+{
+	demoIndexBuild_t *b;
+	char             name[MAX_OSPATH];
+	int              startTime, i;
+	qboolean         ok;
+
+	startTime = Sys_Milliseconds();
+
+	b = (demoIndexBuild_t *)Com_Allocate(sizeof(demoIndexBuild_t));
+	if (!b)
+	{
+		Com_Printf("demo_index: out of memory\n");
+		return qfalse;
+	}
+	Com_Memset(b, 0, sizeof(demoIndexBuild_t));
+
+	if (!Com_DemoIndexChecksum(demoName, &b->header.demoLength, &b->header.demoChecksum)
+	    || FS_FOpenFileRead(demoName, &b->demo, qtrue) < 0 || !b->demo)
+	{
+		Com_Printf("demo_index: can't read %s\n", demoName);
+		Com_Dealloc(b);
+		return qfalse;
+	}
+
+	Com_sprintf(name, sizeof(name), "%s.%s", demoName, DEMO_INDEX_EXT);
+	b->file = FS_FOpenFileWrite(name);
+	if (!b->file)
+	{
+		Com_Printf("demo_index: can't write %s\n", name);
+		FS_FCloseFile(b->demo);
+		Com_Dealloc(b);
+		return qfalse;
+	}
+
+	ok = Com_DemoIndexBuild(b);
+
+	if (ok && b->header.numGamestates)
+	{
+		b->header.ident    = DEMO_INDEX_IDENT;
+		b->header.version  = DEMO_INDEX_VERSION;
+		b->header.dataSize = b->dataSize;
+		for (i = 0; i < (int)(sizeof(b->header) / sizeof(int)); i++)
+		{
+			((int *)&b->header)[i] = LittleLong(((int *)&b->header)[i]);
+		}
+		(void) FS_Write(&b->header, sizeof(b->header), b->file);
+
+		Com_Printf("demo_index: %s, %i points, %i KB in %i msec\n", name, LittleLong(b->header.numPoints),
+		           (int)((b->dataSize + sizeof(b->header)) / 1024), Sys_Milliseconds() - startTime);
+	}
+	else if (ok)
+	{
+		Com_Printf("demo_index: %s has no gamestate\n", demoName);
+		ok = qfalse;
+	}
+
+	FS_FCloseFile(b->file);
+	FS_FCloseFile(b->demo);
+	Com_Dealloc(b);
+
+	return ok;
+}
+
+/**
+ * @brief Loads the seek index written for a demo
+ * @param[in] demoName path of the demo, e.g. demos/name.dm_84
+ * @return NULL if there is none or it was written for a different demo
+ */
+demoIndex_t *Com_LoadDemoIndex(const char *demoName)
+{
+	demoIndexHeader_t header;
+	demoIndex_t       *index;
+	fileHandle_t      f;
+	char              name[MAX_OSPATH];
+	byte              *data;
+	int               length, checksum, fileLength, pos, type, i, numGamestates = 0, numPoints = 0;
+	qboolean          damaged = qfalse;
+
+	if (!Com_DemoIndexChecksum(demoName, &length, &checksum))
+	{
+		return NULL;
+	}
+
+	Com_sprintf(name, sizeof(name), "%s.%s", demoName, DEMO_INDEX_EXT);
+	fileLength = FS_FOpenFileRead(name, &f, qtrue);
+	if (!f)
+	{
+		return NULL;
+	}
+
+	if (fileLength < (int)sizeof(header) || !(data = (byte *)Com_Allocate(fileLength)))
+	{
+		FS_FCloseFile(f);
+		return NULL;
+	}
+
+	if (FS_Read(data, fileLength, f) != fileLength)
+	{
+		FS_FCloseFile(f);
+		Com_Dealloc(data);
+		return NULL;
+	}
+	FS_FCloseFile(f);
+
+	Com_Memcpy(&header, data + fileLength - sizeof(header), sizeof(header));
+	for (i = 0; i < (int)(sizeof(header) / sizeof(int)); i++)
+	{
+		((int *)&header)[i] = LittleLong(((int *)&header)[i]);
+	}
+
+	if (header.ident != DEMO_INDEX_IDENT || header.version != DEMO_INDEX_VERSION
+	    || header.demoLength != length || header.demoChecksum != checksum
+	    || header.dataSize != fileLength - (int)sizeof(header)
+	    || header.numGamestates <= 0 || header.numPoints < 0 || header.numPoints > header.dataSize / 28)
+	{
+		Com_DPrintf("%s is not an index of %s\n", name, demoName);
+		Com_Dealloc(data);
+		return NULL;
+	}
+
+	index = (demoIndex_t *)Com_Allocate(sizeof(demoIndex_t) + header.numGamestates * sizeof(demoIndexGamestate_t)
+	                                    + header.numPoints * sizeof(demoIndexPoint_t));
+	if (!index)
+	{
+		Com_Dealloc(data);
+		return NULL;
+	}
+
+	index->snapsInDemo     = header.snapsInDemo;
+	index->firstServerTime = header.firstServerTime;
+	index->lastServerTime  = header.lastServerTime;
+	index->numGamestates   = header.numGamestates;
+	index->numPoints       = header.numPoints;
+	index->gamestates      = (demoIndexGamestate_t *)(index + 1);
+	index->points          = (demoIndexPoint_t *)(index->gamestates + header.numGamestates);
+	index->data            = data;
+
+	for (pos = 0; pos + 12 <= header.dataSize; )
+	{
+		type = Com_DemoIndexReadInt(data, &pos);
+
+		if (type == DEMO_RECORD_GAMESTATE && numGamestates < header.numGamestates)
+		{
+			demoIndexGamestate_t *gs = &index->gamestates[numGamestates++];
+
+			gs->offset     = Com_DemoIndexReadInt(data, &pos);
+			gs->dataSize   = Com_DemoIndexReadInt(data, &pos);
+			gs->dataOffset = pos;
+
+			// a size running backwards or past the end could still land on the end
+			if (gs->dataSize < 0 || gs->dataSize > header.dataSize - pos)
+			{
+				damaged = qtrue;
+				break;
+			}
+			pos += gs->dataSize;
+		}
+		else if (type == DEMO_RECORD_POINT && numPoints < header.numPoints && pos + 24 <= header.dataSize)
+		{
+			demoIndexPoint_t *point = &index->points[numPoints++];
+
+			point->offset                = Com_DemoIndexReadInt(data, &pos);
+			point->numMessages           = Com_DemoIndexReadInt(data, &pos);
+			point->serverTime            = Com_DemoIndexReadInt(data, &pos);
+			point->serverCommandSequence = Com_DemoIndexReadInt(data, &pos);
+			point->gamestate             = Com_DemoIndexReadInt(data, &pos);
+			point->dataSize              = Com_DemoIndexReadInt(data, &pos);
+			point->dataOffset            = pos;
+
+			if (point->dataSize < 0 || point->dataSize > header.dataSize - pos
+			    || point->gamestate < 0 || point->gamestate >= numGamestates)
+			{
+				damaged = qtrue;
+				break;
+			}
+			pos += point->dataSize;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	if (damaged || pos != header.dataSize || numGamestates != header.numGamestates || numPoints != header.numPoints)
+	{
+		Com_Printf("%s is damaged\n", name);
+		Com_FreeDemoIndex(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+/**
+ * @brief Com_FreeDemoIndex
+ * @param[in] index may be NULL
+ */
+void Com_FreeDemoIndex(demoIndex_t *index)
+{
+	if (!index)
+	{
+		return;
+	}
+
+	Com_Dealloc(index->data);
+	Com_Dealloc(index);
+}
+
+/**
+ * @brief Finds the last point before a server time
+ * @param[in] index
+ * @param[in] serverTime
+ * @param[in] demoOffset where playback is in the demo, as the point has to be
+ * of the gamestate it has the baselines of
+ * @return The point, -1 if there is none
+ */
+int Com_FindDemoIndexPoint(const demoIndex_t *index, int serverTime, int demoOffset)
+{
+	int gamestate, i;
+
+	for (gamestate = index->numGamestates - 1; gamestate > 0 && index->gamestates[gamestate].offset >= demoOffset; gamestate--)
+		;
+
+	for (i = index->numPoints - 1; i >= 0; i--)
+	{
+		if (index->points[i].gamestate == gamestate && index->points[i].serverTime < serverTime)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * @brief Decodes the state playback needs to continue from a point
+ * @param[in] index
+ * @param[in] num
+ * @param[in] baselines of the gamestate of the point
+ * @param[out] gameState
+ * @param[out] snapshots at least PACKET_BACKUP, oldest first
+ * @param[out] numSnapshots
+ * @param[out] entities of the snapshots
+ * @param[in] maxEntities
+ * @return qfalse on bad data
+ */
+qboolean Com_ReadDemoIndexPoint(const demoIndex_t *index, int num, entityState_t *baselines, gameState_t *gameState,
+                                demoIndexSnapshot_t *snapshots, int *numSnapshots, entityState_t *entities, int maxEntities)
+{
+	const demoIndexGamestate_t *gs;
+	const demoIndexPoint_t     *point;
+	demoIndexSnapshot_t        *snap;
+	msg_t                      msg;
+	int                        numEntities = 0, number;
+
+	if (num < 0 || num >= index->numPoints)
+	{
+		return qfalse;
+	}
+	point = &index->points[num];
+	gs    = &index->gamestates[point->gamestate];
+
+	// the configstrings of the gamestate, then the changes up to the point
+	Com_Memset(gameState, 0, sizeof(*gameState));
+	gameState->dataCount = 1;
+
+	MSG_Init(&msg, index->data + gs->dataOffset, gs->dataSize);
+	msg.cursize = gs->dataSize;
+	MSG_BeginReading(&msg);
+	if (!Com_DemoIndexReadConfigstrings(&msg, gameState))
+	{
+		return qfalse;
+	}
+
+	MSG_Init(&msg, index->data + point->dataOffset, point->dataSize);
+	msg.cursize = point->dataSize;
+	MSG_BeginReading(&msg);
+	if (!Com_DemoIndexReadConfigstrings(&msg, gameState))
+	{
+		return qfalse;
+	}
+
+	*numSnapshots = 0;
+	while (MSG_ReadByte(&msg) == 1)
+	{
+		if (*numSnapshots >= PACKET_BACKUP)
+		{
+			return qfalse;
+		}
+
+		snap                   = &snapshots[(*numSnapshots)++];
+		snap->messageNum       = MSG_ReadLong(&msg);
+		snap->serverTime       = MSG_ReadLong(&msg);
+		snap->serverCommandNum = MSG_ReadLong(&msg);
+		snap->snapFlags        = MSG_ReadByte(&msg);
+		MSG_ReadData(&msg, snap->areamask, sizeof(snap->areamask));
+		MSG_ReadDeltaPlayerstate(&msg, NULL, &snap->ps);
+
+		snap->firstEntity = numEntities;
+		snap->numEntities = 0;
+		while ((number = MSG_ReadBits(&msg, GENTITYNUM_BITS)) != MAX_GENTITIES - 1)
+		{
+			if (numEntities >= maxEntities || msg.readcount > msg.cursize)
+			{
+				return qfalse;
+			}
+
+			MSG_ReadDeltaEntity(&msg, &baselines[number], &entities[numEntities++], number);
+			snap->numEntities++;
+		}
+	}
+
+	return (qboolean)(*numSnapshots > 0 && msg.readcount <= msg.cursize);
+}
+
+/**
+ * @brief Writes the seek index of a demo
+ *
+ * @note Usage: demo_index <demoname>. A dedicated server indexes demos
+ * without a client with +demo_index name +quit on its command line.
+ */
+void Com_DemoIndex_f(void)
+{
+	char       name[MAX_OSPATH];
+	const char *arg, *ext;
+
+	if (Cmd_Argc() < 2)
+	{
+		Com_Printf("usage: demo_index <demoname>\n");
+		return;
+	}
+
+	arg = Cmd_Argv(1);
+	ext = strrchr(arg, '.');
+	if (ext && !Q_stricmpn(ext + 1, DEMOEXT, strlen(DEMOEXT)))
+	{
+		Com_sprintf(name, sizeof(name), "demos/%s", arg);
+	}
+	else
+	{
+		Com_sprintf(name, sizeof(name), "demos/%s.%s%d", arg, DEMOEXT, PROTOCOL_VERSION);
+	}
+
+	(void) Com_WriteDemoIndex(name);
+}
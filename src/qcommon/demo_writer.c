@@ -0,0 +1,369 @@
+/*
+ * Wolfenstein: Enemy Territory GPL Source Code
+ * Copyright (C) 1999-2010 id Software LLC, a ZeniMax Media company.
+ *
+ * ET: Legacy
+ * Copyright (C) 2012-2023 ET:Legacy team <mail@etlegacy.com>
+ *
+ * This file is part of ET: Legacy - http://www.etlegacy.com
+ *
+ * ET: Legacy is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ET: Legacy is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ET: Legacy. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, Wolfenstein: Enemy Territory GPL Source Code is also
+ * subject to certain additional terms. You should have received a copy
+ * of these additional terms immediately following the terms and conditions
+ * of the GNU General Public License which accompanied the source code.
+ * If not, please request a copy in writing from id Software at the address below.
+ *
+ * id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+ */
+/**
+ * @file demo_writer.c
+ * @brief Background writer of recorded demos
+ *
+ * Demo messages are queued into a ring buffer on the game thread and
+ * written to disk by a thread of their own, so a slow disk can't hitch a
+ * frame. The ring has a single producer and a single consumer: the game
+ * thread only moves the head, the writer thread only moves the tail, and
+ * the bytes between them are handed over without a lock. The mutex only
+ * parks the writer when the ring is empty and the game thread when it is
+ * full.
+ *
+ * com_demoWriteBuffer caps the ring (in kilobytes, 0 writes on the game
+ * thread as before). When a message doesn't fit, com_demoWritePolicy
+ * decides: 0 waits for the disk, 1 drops the rest of the demo so the file
+ * ends on the last complete message.
+ */
+
+#include "q_shared.h"
+#include "qcommon.h"
+
+#define DEMO_WRITER_MIN_BUFFER  64          ///< smallest ring, in kilobytes
+#define DEMO_WRITER_MAX_BUFFER  262144      ///< largest ring, in kilobytes
+
+/**
+ * @struct demoWriter_s
+ * @brief
+ */
+struct demoWriter_s
+{
+	fileHandle_t file;
+	FILE *stream;
+
+	byte *ring;
+	int size;                   ///< ring capacity, 0 when writing on the game thread
+	volatile int head;          ///< bytes queued since the start, moved by the game thread only
+	volatile int tail;          ///< bytes written since the start, moved by the writer thread only
+	volatile int quit;
+	volatile int failed;        ///< the writer thread could not write everything
+
+	qthread_t *thread;
+	qmutex_t *lock;
+	qcond_t *cond;              ///< signalled when the head or the tail moved
+
+	qboolean dropped;           ///< a message was dropped, nothing more is queued
+
+	int queued;                 ///< bytes handed to the writer
+	int peak;                   ///< largest backlog seen
+	int stalls;                 ///< messages which waited for room
+	int maxStall;               ///< longest wait, in msec
+};
+
+static cvar_t *com_demoWriteBuffer;
+static cvar_t *com_demoWritePolicy;
+
+/**
+ * @brief Room left in the ring
+ * @param[in] writer
+ * @return
+ */
+static int Com_DemoWriterSpace(demoWriter_t *writer)
+{
+	return writer->size - (int)((unsigned int)writer->head - (unsigned int)Com_AtomicGet(&writer->tail));
+}
+
+/**
+ * @brief Writer thread, writes out the ring until it is empty and told to quit
+ * @param[in] arg
+ *
+ * @note Must not call into the engine.
+ */
+static void Com_DemoWriterThread(void *arg)
+{
+	demoWriter_t *writer = (demoWriter_t *)arg;
+	unsigned int tail    = (unsigned int)writer->tail;
+	unsigned int offset;
+	int          used, len;
+
+	while (1)
+	{
+		used = (int)((unsigned int)Com_AtomicGet(&writer->head) - tail);
+
+		if (!used)
+		{
+			Com_LockMutex(writer->lock);
+			while ((unsigned int)Com_AtomicGet(&writer->head) == tail && !writer->quit)
+			{
+				Com_WaitCond(writer->cond, writer->lock);
+			}
+			Com_UnlockMutex(writer->lock);
+
+			if ((unsigned int)Com_AtomicGet(&writer->head) == tail)
+			{
+				break;
+			}
+			continue;
+		}
+
+		// write up to the end of the ring, the wrapped part goes on the next pass
+		offset = tail % (unsigned int)writer->size;
+		len    = MIN(used, writer->size - (int)offset);
+
+		if (!writer->failed && fwrite(writer->ring + offset, 1, len, writer->stream) != (size_t)len)
+		{
+			writer->failed = 1;
+		}
+
+		tail += len;
+		Com_AtomicSet(&writer->tail, (int)tail);
+
+		Com_LockMutex(writer->lock);
+		Com_BroadcastCond(writer->cond);
+		Com_UnlockMutex(writer->lock);
+	}
+}
+
+/**
+ * @brief Copies bytes into the ring, waiting for the writer thread while it is full
+ * @param[in,out] writer
+ * @param[in] data
+ * @param[in] len
+ */
+static void Com_DemoWriterQueue(demoWriter_t *writer, const byte *data, int len)
+{
+	unsigned int offset;
+	int          space, n, first;
+
+	while (len > 0)
+	{
+		space = Com_DemoWriterSpace(writer);
+
+		if (!space)
+		{
+			Com_LockMutex(writer->lock);
+			while (!Com_DemoWriterSpace(writer))
+			{
+				Com_WaitCond(writer->cond, writer->lock);
+			}
+			Com_UnlockMutex(writer->lock);
+			continue;
+		}
+
+		n      = MIN(space, len);
+		offset = (unsigned int)writer->head % (unsigned int)writer->size;
+		first  = MIN(n, writer->size - (int)offset);
+
+		Com_Memcpy(writer->ring + offset, data, first);
+		Com_Memcpy(writer->ring, data + first, n - first);
+		Com_AtomicSet(&writer->head, (int)((unsigned int)writer->head + n));
+
+		data += n;
+		len  -= n;
+
+		Com_LockMutex(writer->lock);
+		Com_BroadcastCond(writer->cond);
+		Com_UnlockMutex(writer->lock);
+	}
+}
+
+/**
+ * @brief Starts writing a demo file in the background
+ * @param[in] file Opened for writing, must stay open until Com_DestroyDemoWriter
+ * @return
+ *
+ * @note Falls back to writing on the game thread when the buffer is off
+ * or the thread can't be started.
+ */
+demoWriter_t *Com_CreateDemoWriter(fileHandle_t file)
+{
+	demoWriter_t *writer;
+	int          size;
+
+	com_demoWriteBuffer = Cvar_Get("com_demoWriteBuffer", "4096", CVAR_ARCHIVE_ND);
+	com_demoWritePolicy = Cvar_Get("com_demoWritePolicy", "0", CVAR_ARCHIVE_ND);
+
+	writer = (demoWriter_t *)Com_Allocate(sizeof(demoWriter_t));
+	if (!writer)
+	{
+		Com_Error(ERR_DROP, "Com_CreateDemoWriter: out of memory");
+	}
+	Com_Memset(writer, 0, sizeof(demoWriter_t));
+	writer->file = file;
+
+	if (com_demoWriteBuffer->integer <= 0)
+	{
+		return writer;
+	}
+
+	size         = Com_Clamp(DEMO_WRITER_MIN_BUFFER, DEMO_WRITER_MAX_BUFFER, com_demoWriteBuffer->integer) * 1024;
+	writer->ring = (byte *)Com_Allocate(size);
+	writer->lock = Com_CreateMutex();
+	writer->cond = Com_CreateCond();
+
+	if (writer->ring && writer->lock && writer->cond)
+	{
+		writer->stream = FS_StreamForHandle(file);
+		writer->size   = size;
+		writer->thread = Com_CreateThread(Com_DemoWriterThread, writer);
+	}
+
+	if (!writer->thread)
+	{
+		Com_Printf(S_COLOR_YELLOW "WARNING: demo writer thread not started, writing demos on the game thread\n");
+
+		if (writer->ring)
+		{
+			Com_Dealloc(writer->ring);
+			writer->ring = NULL;
+		}
+		if (writer->lock)
+		{
+			Com_DestroyMutex(writer->lock);
+			writer->lock = NULL;
+		}
+		if (writer->cond)
+		{
+			Com_DestroyCond(writer->cond);
+			writer->cond = NULL;
+		}
+		writer->size = 0;
+	}
+
+	return writer;
+}
+
+/**
+ * @brief Queues one demo message
+ * @param[in,out] writer
+ * @param[in] head Message header (length, sequence)
+ * @param[in] headLen
+ * @param[in] data Message body, may be NULL
+ * @param[in] dataLen
+ *
+ * @note The header and the body are queued or dropped together so the file always ends on a complete message.
+ */
+void Com_DemoWriterWrite(demoWriter_t *writer, const void *head, int headLen, const void *data, int dataLen)
+{
+	int total = headLen + dataLen;
+	int start, stall;
+
+	if (!writer->size)
+	{
+		(void) FS_Write(head, headLen, writer->file);
+		if (dataLen)
+		{
+			(void) FS_Write(data, dataLen, writer->file);
+		}
+		writer->queued += total;
+		return;
+	}
+
+	if (writer->dropped)
+	{
+		return;
+	}
+
+	if (Com_DemoWriterSpace(writer) < total)
+	{
+		if (com_demoWritePolicy->integer)
+		{
+			Com_Printf(S_COLOR_YELLOW "WARNING: demo writer is %i bytes behind, dropping the rest of the demo\n", writer->size - Com_DemoWriterSpace(writer));
+			writer->dropped = qtrue;
+			return;
+		}
+
+		start = Sys_Milliseconds();
+		Com_DemoWriterQueue(writer, (const byte *)head, headLen);
+		Com_DemoWriterQueue(writer, (const byte *)data, dataLen);
+		stall = Sys_Milliseconds() - start;
+
+		writer->stalls++;
+		if (stall > writer->maxStall)
+		{
+			writer->maxStall = stall;
+		}
+	}
+	else
+	{
+		Com_DemoWriterQueue(writer, (const byte *)head, headLen);
+		Com_DemoWriterQueue(writer, (const byte *)data, dataLen);
+	}
+
+	writer->queued += total;
+	writer->peak    = MAX(writer->peak, writer->size - Com_DemoWriterSpace(writer));
+}
+
+/**
+ * @brief Bytes handed to the writer so far, the size the file will have once written
+ * @param[in] writer
+ * @return
+ */
+int Com_DemoWriterOffset(const demoWriter_t *writer)
+{
+	return writer->queued;
+}
+
+/**
+ * @brief Writes out what is left in the ring and stops the writer thread
+ * @param[in] writer
+ *
+ * @note The file itself is left open for the caller to close.
+ */
+void Com_DestroyDemoWriter(demoWriter_t *writer)
+{
+	if (!writer)
+	{
+		return;
+	}
+
+	if (writer->size)
+	{
+		Com_LockMutex(writer->lock);
+		writer->quit = 1;
+		Com_BroadcastCond(writer->cond);
+		Com_UnlockMutex(writer->lock);
+
+		Com_JoinThread(writer->thread);
+		Com_DestroyCond(writer->cond);
+		Com_DestroyMutex(writer->lock);
+		Com_Dealloc(writer->ring);
+
+		if (writer->failed)
+		{
+			Com_Printf(S_COLOR_YELLOW "WARNING: demo writer could not write everything, the demo is truncated\n");
+		}
+
+		if (writer->stalls || writer->dropped)
+		{
+			Com_Printf("Demo writer: %i bytes queued, %i bytes peak backlog, %i stalls (longest %i msec)%s\n",
+			           writer->queued, writer->peak, writer->stalls, writer->maxStall, writer->dropped ? ", demo cut short" : "");
+		}
+		else
+		{
+			Com_DPrintf("Demo writer: %i bytes queued, %i bytes peak backlog\n", writer->queued, writer->peak);
+		}
+	}
+
+	Com_Dealloc(writer);
+}
@@ -295,6 +295,52 @@ static int fs_packFiles = 0;
 
 static int fs_checksumFeed;
 
+/**
+ * @struct fileIndexEntry_t
+ * @brief A file in one of the paks of the search path, or a directory of it
+ */
+typedef struct
+{
+	fileInPack_t *file;                 ///< NULL for directories
+	searchpath_t *search;
+	int order;                          ///< position of search in fs_searchpaths
+	int next;                           ///< next entry of the hash bucket, -1 ends the chain
+} fileIndexEntry_t;
+
+/**
+ * @var fs_fileIndex
+ * @brief All files of all paks in a single hash, so finding a file takes one lookup
+ * however many paks there are. Built once the search paths are set up, the files of
+ * each bucket are chained in search order. The directories are still checked on disk
+ * at their place in the search order.
+ */
+static struct
+{
+	fileIndexEntry_t *entries;
+	int numEntries;
+	int *buckets;
+	int hashSize;                       ///< power of 2
+
+	fileIndexEntry_t *dirs;
+	int numDirs;
+	int numPaks;
+} fs_fileIndex;
+
+static cvar_t *fs_fileIndexVar;
+
+/**
+ * @var fs_openStats
+ * @brief Counters of FS_FOpenFileRead, see fs_openStats command
+ */
+static struct
+{
+	int opens;
+	int found;
+	int pakProbes;                      ///< hash lookups into pak or global file tables
+	int dirProbes;                      ///< files looked for on the disk
+	int msec;                           ///< spent in lookups, sums whole milliseconds so only meaningful over many calls
+} fs_openStats;
+
 /**
  * @union qfile_gus
  * @typedef qfile_gut
@@ -505,6 +551,19 @@ static FILE *FS_FileForHandle(fileHandle_t f)
 	return fsh[f].handleFiles.file.o;
 }
 
+/**
+ * @brief Gives the stdio stream behind a file opened for writing
+ * @param[in] f
+ * @return
+ *
+ * @note For writers that can't go through FS_Write, such as a thread of their own.
+ * The handle must stay open for as long as the stream is used.
+ */
+FILE *FS_StreamForHandle(fileHandle_t f)
+{
+	return FS_FileForHandle(f);
+}
+
 /**
  * @brief FS_ForceFlush
  * @param[in] f
@@ -1032,6 +1091,53 @@ long FS_SV_FOpenFileRead(const char *fileName, fileHandle_t *fp)
 	return -1;
 }
 
+/**
+ * @brief Opens a file below the home path or base path for reads at any
+ * offset, searched in the FS_SV_FOpenFileRead order
+ *
+ * @param[in] fileName
+ * @param[out] length
+ * @return The file or NULL, read it with Sys_ReadSharedFile and close it with Sys_CloseSharedFile
+ */
+sysSharedFile_t *FS_SV_OpenSharedFile(const char *fileName, int *length)
+{
+	char            *ospath;
+	sysSharedFile_t *file;
+
+	if (!fs_searchpaths)
+	{
+		Com_Error(ERR_FATAL, "FS_SV_OpenSharedFile: Filesystem call made without initialization");
+	}
+
+	// search homepath
+	ospath = FS_BuildOSPath(fs_homepath->string, fileName, "");
+	// remove trailing slash
+	ospath[strlen(ospath) - 1] = '\0';
+
+	if (fs_debug->integer)
+	{
+		Com_Printf("FS_SV_OpenSharedFile (fs_homepath): %s\n", ospath);
+	}
+
+	file = Sys_OpenSharedFile(ospath, length);
+
+	if (!file && Q_stricmp(fs_homepath->string, fs_basepath->string))
+	{
+		// search basepath
+		ospath                     = FS_BuildOSPath(fs_basepath->string, fileName, "");
+		ospath[strlen(ospath) - 1] = '\0';
+
+		if (fs_debug->integer)
+		{
+			Com_Printf("FS_SV_OpenSharedFile (fs_basepath): %s\n", ospath);
+		}
+
+		file = Sys_OpenSharedFile(ospath, length);
+	}
+
+	return file;
+}
+
 /**
  * @brief FS_SV_Rename - used to rename downloaded files from .tmp to .pk3
  * @param[in] from
@@ -1447,6 +1553,111 @@ long FS_FOpenFileReadFullDir(const char *fullFileName, fileHandle_t *file)
 	return FS_fplength(filep);
 }
 
+/**
+ * @brief Opens a file found in a pak and marks the pak as referenced
+ * @param[in] fileName
+ * @param[in,out] pak
+ * @param[in] pakFile
+ * @param[in] file Handle to open it on
+ * @param[in] uniqueFILE
+ * @return file size
+ */
+static long FS_OpenFileInPack(const char *fileName, pack_t *pak, fileInPack_t *pakFile, fileHandle_t file, qboolean uniqueFILE)
+{
+	//qboolean includeCampaignFiles = (Cvar_VariableIntegerValue("g_gametype") == 4 || com_dedicated == NULL|| com_dedicated->integer == 0);
+	qboolean includeCampaignFiles = (Cvar_VariableIntegerValue("g_gametype") == 4);
+	int      len;
+
+	// mark the pak as having been referenced and mark specifics on cgame and ui
+	// shaders, txt, arena files  by themselves do not count as a reference as
+	// these are loaded from all pk3s
+	// from every pk3 file..
+	len = strlen(fileName);
+
+	if (!(pak->referenced & FS_GENERAL_REF))
+	{
+		// blacklist
+		if (!FS_IsExt(fileName, ".shader", len) &&
+		    !FS_IsExt(fileName, ".txt", len) &&
+		    !FS_IsExt(fileName, ".cfg", len) &&
+		    !FS_IsExt(fileName, ".config", len) &&
+		    !FS_IsExt(fileName, ".bot", len) && // not used in ET for real
+		    !FS_IsExt(fileName, ".arena", len) &&
+		    !FS_IsExt(fileName, ".menu", len) &&
+		    Q_stricmp(fileName, Sys_GetDLLName("qagame")) != 0 &&
+		    !strstr(fileName, "levelshots") &&
+		    !FS_IsExt(fileName, ".campaign", len) // don't referernce for gametype != 4 - see below
+		    )
+		{
+			pak->referenced |= FS_GENERAL_REF;
+		}
+
+		// special whitelist - objective gametype still has to reference 'campaign' pk3s
+		// FIXME: dedicated campaign servers require an additional map restart when switching gametype to 4 while server is running with other gametypes
+		// this won't trigger for the first map because g_gametype is latched cvar and cvar modfifications are processed later on
+		// ... but this is better than populating the CS with not needed references and forcing players to download
+		// maps/pk3s containing campaign files in other gametypes - delete the print after fix
+		if (FS_IsExt(fileName, ".campaign", len) && includeCampaignFiles)
+		{
+			pak->referenced |= FS_GENERAL_REF;
+			Com_Printf("^3Campaign PK3 file %s is referenced in search path!\n", fileName);
+		}
+	}
+
+	// for OS client/server interoperability, we expect binaries for .so and .dll to be in the same pk3
+	// so that when we reference the DLL files on any platform, this covers everyone else
+
+	// qagame dll
+	if (!(pak->referenced & FS_QAGAME_REF) && !Q_stricmp(fileName, Sys_GetDLLName("qagame")))
+	{
+		pak->referenced |= FS_QAGAME_REF;
+	}
+	// cgame dll
+	if (!(pak->referenced & FS_CGAME_REF) && !Q_stricmp(fileName, Sys_GetDLLName("cgame")))
+	{
+		pak->referenced |= FS_CGAME_REF;
+	}
+	// ui dll
+	if (!(pak->referenced & FS_UI_REF) && !Q_stricmp(fileName, Sys_GetDLLName("ui")))
+	{
+		pak->referenced |= FS_UI_REF;
+	}
+
+	if (uniqueFILE)
+	{
+		// open a new file on the pakfile
+		fsh[file].handleFiles.file.z = FS_UnzOpen(pak->pakFilename);
+
+		if (fsh[file].handleFiles.file.z == NULL)
+		{
+			Com_Error(ERR_FATAL, "FS_FOpenFileReadDir: Couldn't open %s", pak->pakFilename);
+		}
+	}
+	else
+	{
+		fsh[file].handleFiles.file.z = pak->handle;
+	}
+
+	Q_strncpyz(fsh[file].name, fileName, sizeof(fsh[file].name));
+	fsh[file].zipFile = qtrue;
+
+	// set the file position in the zip file (also sets the current file info)
+	unzSetOffset(fsh[file].handleFiles.file.z, pakFile->pos);
+
+	// open the file in the zip
+	unzOpenCurrentFile(fsh[file].handleFiles.file.z);
+	fsh[file].zipFilePos = pakFile->pos;
+	fsh[file].zipFileLen = pakFile->len;
+
+	if (fs_debug->integer)
+	{
+		Com_Printf("FS_FOpenFileRead: %s (found in '%s')\n",
+		           fileName, pak->pakFilename);
+	}
+
+	return pakFile->len;
+}
+
 /**
  * @brief Finds the file in the search path.
  * Used for streaming data out of either a separate file or a ZIP file.
@@ -1581,9 +1792,6 @@ long FS_FOpenFileReadDir(const char *fileName, searchpath_t *search, fileHandle_
 
 		if (search->pack->hashTable[hash])
 		{
-			//qboolean includeCampaignFiles = (Cvar_VariableIntegerValue("g_gametype") == 4 || com_dedicated == NULL|| com_dedicated->integer == 0);
-			qboolean includeCampaignFiles = (Cvar_VariableIntegerValue("g_gametype") == 4);
-
 			// disregard if it doesn't match one of the allowed pure pak files
 			if (!unpure && !FS_PakIsPure(search->pack))
 			{
@@ -1601,95 +1809,7 @@ long FS_FOpenFileReadDir(const char *fileName, searchpath_t *search, fileHandle_
 				if (!FS_FilenameCompare(pakFile->name, fileName))
 				{
 					// found it!
-
-					// mark the pak as having been referenced and mark specifics on cgame and ui
-					// shaders, txt, arena files  by themselves do not count as a reference as
-					// these are loaded from all pk3s
-					// from every pk3 file..
-					len = strlen(fileName);
-
-					if (!(pak->referenced & FS_GENERAL_REF))
-					{
-						// blacklist
-						if (!FS_IsExt(fileName, ".shader", len) &&
-						    !FS_IsExt(fileName, ".txt", len) &&
-						    !FS_IsExt(fileName, ".cfg", len) &&
-						    !FS_IsExt(fileName, ".config", len) &&
-						    !FS_IsExt(fileName, ".bot", len) && // not used in ET for real
-						    !FS_IsExt(fileName, ".arena", len) &&
-						    !FS_IsExt(fileName, ".menu", len) &&
-						    Q_stricmp(fileName, Sys_GetDLLName("qagame")) != 0 &&
-						    !strstr(fileName, "levelshots") &&
-						    !FS_IsExt(fileName, ".campaign", len) // don't referernce for gametype != 4 - see below
-						    )
-						{
-							pak->referenced |= FS_GENERAL_REF;
-						}
-
-						// special whitelist - objective gametype still has to reference 'campaign' pk3s
-						// FIXME: dedicated campaign servers require an additional map restart when switching gametype to 4 while server is running with other gametypes
-						// this won't trigger for the first map because g_gametype is latched cvar and cvar modfifications are processed later on
-						// ... but this is better than populating the CS with not needed references and forcing players to download
-						// maps/pk3s containing campaign files in other gametypes - delete the print after fix
-						if (FS_IsExt(fileName, ".campaign", len) && includeCampaignFiles)
-						{
-							pak->referenced |= FS_GENERAL_REF;
-							Com_Printf("^3Campaign PK3 file %s is referenced in search path!\n", fileName);
-						}
-					}
-
-					// for OS client/server interoperability, we expect binaries for .so and .dll to be in the same pk3
-					// so that when we reference the DLL files on any platform, this covers everyone else
-
-					// qagame dll
-					if (!(pak->referenced & FS_QAGAME_REF) && !Q_stricmp(fileName, Sys_GetDLLName("qagame")))
-					{
-						pak->referenced |= FS_QAGAME_REF;
-					}
-					// cgame dll
-					if (!(pak->referenced & FS_CGAME_REF) && !Q_stricmp(fileName, Sys_GetDLLName("cgame")))
-					{
-						pak->referenced |= FS_CGAME_REF;
-					}
-					// ui dll
-					if (!(pak->referenced & FS_UI_REF) && !Q_stricmp(fileName, Sys_GetDLLName("ui")))
-					{
-						pak->referenced |= FS_UI_REF;
-					}
-
-					if (uniqueFILE)
-					{
-						// open a new file on the pakfile
-						fsh[*file].handleFiles.file.z = FS_UnzOpen(pak->pakFilename);
-
-						if (fsh[*file].handleFiles.file.z == NULL)
-						{
-							Com_Error(ERR_FATAL, "FS_FOpenFileReadDir: Couldn't open %s", pak->pakFilename);
-						}
-					}
-					else
-					{
-						fsh[*file].handleFiles.file.z = pak->handle;
-					}
-
-					Q_strncpyz(fsh[*file].name, fileName, sizeof(fsh[*file].name));
-					fsh[*file].zipFile = qtrue;
-
-					// set the file position in the zip file (also sets the current file info)
-					unzSetOffset(fsh[*file].handleFiles.file.z, pakFile->pos);
-
-					// open the file in the zip
-					unzOpenCurrentFile(fsh[*file].handleFiles.file.z);
-					fsh[*file].zipFilePos = pakFile->pos;
-					fsh[*file].zipFileLen = pakFile->len;
-
-					if (fs_debug->integer)
-					{
-						Com_Printf("FS_FOpenFileRead: %s (found in '%s')\n",
-						           fileName, pak->pakFilename);
-					}
-
-					return pakFile->len;
+					return FS_OpenFileInPack(fileName, pak, pakFile, *file, uniqueFILE);
 				}
 
 				pakFile = pakFile->next;
@@ -1763,37 +1883,195 @@ long FS_FOpenFileReadDir(const char *fileName, searchpath_t *search, fileHandle_
 #endif
 
 /**
- * @brief Finds the file in the search path.
- * Used for streaming data out of either a separate file or a ZIP file.
+ * @brief Indexes the files of all paks in the search path, see fs_fileIndex
+ */
+static void FS_BuildFileIndex(void)
+{
+	searchpath_t     *search;
+	fileInPack_t     *pakFile;
+	fileIndexEntry_t *entry;
+	int              i, hash, order, numFiles = 0, numDirs = 0;
+
+	for (search = fs_searchpaths; search; search = search->next)
+	{
+		if (search->pack)
+		{
+			numFiles += search->pack->numfiles;
+			fs_fileIndex.numPaks++;
+		}
+		else
+		{
+			numDirs++;
+		}
+	}
+
+	for (fs_fileIndex.hashSize = 1; fs_fileIndex.hashSize < numFiles; fs_fileIndex.hashSize <<= 1)
+	{
+	}
+
+	fs_fileIndex.entries    = Z_Malloc(numFiles * sizeof(fileIndexEntry_t) + 1);
+	fs_fileIndex.buckets    = Z_Malloc(fs_fileIndex.hashSize * sizeof(int));
+	fs_fileIndex.dirs       = Z_Malloc(numDirs * sizeof(fileIndexEntry_t) + 1);
+	fs_fileIndex.numEntries = 0;
+	fs_fileIndex.numDirs    = 0;
+
+	for (search = fs_searchpaths, order = 0; search; search = search->next, order++)
+	{
+		if (!search->pack)
+		{
+			entry         = &fs_fileIndex.dirs[fs_fileIndex.numDirs++];
+			entry->file   = NULL;
+			entry->search = search;
+			entry->order  = order;
+			continue;
+		}
+
+		for (i = 0; i < search->pack->hashSize; i++)
+		{
+			for (pakFile = search->pack->hashTable[i]; pakFile; pakFile = pakFile->next)
+			{
+				entry         = &fs_fileIndex.entries[fs_fileIndex.numEntries++];
+				entry->file   = pakFile;
+				entry->search = search;
+				entry->order  = order;
+			}
+		}
+	}
+
+	// chain backwards, so each bucket lists its files in search order
+	for (i = 0; i < fs_fileIndex.hashSize; i++)
+	{
+		fs_fileIndex.buckets[i] = -1;
+	}
+
+	for (i = fs_fileIndex.numEntries - 1; i >= 0; i--)
+	{
+		hash                         = FS_HashFileName(fs_fileIndex.entries[i].file->name, fs_fileIndex.hashSize);
+		fs_fileIndex.entries[i].next = fs_fileIndex.buckets[hash];
+		fs_fileIndex.buckets[hash]   = i;
+	}
+}
+
+/**
+ * @brief Frees the file index
+ */
+static void FS_FreeFileIndex(void)
+{
+	if (fs_fileIndex.entries)
+	{
+		Z_Free(fs_fileIndex.entries);
+		Z_Free(fs_fileIndex.buckets);
+		Z_Free(fs_fileIndex.dirs);
+	}
+
+	Com_Memset(&fs_fileIndex, 0, sizeof(fs_fileIndex));
+}
+
+/**
+ * @brief Returns the next pak holding a file, in search order
+ * @param[in] index Entry to continue after, -1 to start with the bucket of the file
+ * @param[in] fileName
+ * @return Index of the entry or -1
+ */
+static int FS_NextFileIndexEntry(int index, const char *fileName)
+{
+	index = index < 0 ? fs_fileIndex.buckets[FS_HashFileName(fileName, fs_fileIndex.hashSize)] : fs_fileIndex.entries[index].next;
+
+	for ( ; index >= 0; index = fs_fileIndex.entries[index].next)
+	{
+		// case and separator insensitive comparisons
+		if (!FS_FilenameCompare(fs_fileIndex.entries[index].file->name, fileName))
+		{
+			break;
+		}
+	}
+
+	return index;
+}
+
+/**
+ * @brief FS_FOpenFileRead through the file index, the paks holding the file and the
+ * directories are visited in search order and nothing else is looked at
  *
  * @param[in] fileName
  * @param[in,out] file
  * @param[in] uniqueFILE
+ * @param[in] unpure
  *
  * @returns filesize and an open FILE pointer -  0 or -1 for invalid files
  */
-long FS_FOpenFileRead(const char *fileName, fileHandle_t *file, qboolean uniqueFILE)
+static long FS_FOpenFileReadIndexed(const char *fileName, fileHandle_t *file, qboolean uniqueFILE, qboolean unpure)
 {
-	searchpath_t *search;
-	long         len;
+	const char       *name;
+	fileIndexEntry_t *entry;
+	int              index, dir = 0;
+	long             len;
 
-	if (!fs_searchpaths)
+	if (fileName == NULL)
 	{
-		Com_Error(ERR_FATAL, "FS_FOpenFileRead: Filesystem call made without initialization");
+		Com_Error(ERR_FATAL, "FS_FOpenFileReadIndexed: NULL 'fileName' parameter passed");
 	}
 
-	for (search = fs_searchpaths; search; search = search->next)
+	name = fileName;
+
+	// same checks as FS_FOpenFileReadDir, the paks are looked at directly
+	if (name[0] == '/' || name[0] == '\\')
 	{
-		if (search->pack && (fs_filter_flag & FS_EXCLUDE_PK3))
+		name++;
+	}
+
+	if (strstr(name, "..") || strstr(name, "::") || (com_fullyInitialized && strstr(name, "etkey")))
+	{
+		if (file == NULL)
 		{
-			continue;
+			return 0;
+		}
+
+		*file = 0;
+		return -1;
+	}
+
+	fs_openStats.pakProbes++;
+	index = FS_NextFileIndexEntry(-1, name);
+
+	while (index >= 0 || dir < fs_fileIndex.numDirs)
+	{
+		if (index >= 0 && (dir == fs_fileIndex.numDirs || fs_fileIndex.entries[index].order < fs_fileIndex.dirs[dir].order))
+		{
+			entry = &fs_fileIndex.entries[index];
+			index = FS_NextFileIndexEntry(index, name);
+
+			if (fs_filter_flag & FS_EXCLUDE_PK3)
+			{
+				continue;
+			}
+
+			if (file == NULL)
+			{
+				// legacy code depends on positive value if file exists no matter what size
+				return entry->file->len ? (long)entry->file->len : 1;
+			}
+
+			// disregard if it doesn't match one of the allowed pure pak files
+			if (!unpure && !FS_PakIsPure(entry->search->pack))
+			{
+				continue;
+			}
+
+			*file                         = FS_HandleForFile();
+			fsh[*file].handleFiles.unique = uniqueFILE;
+			return FS_OpenFileInPack(name, entry->search->pack, entry->file, *file, uniqueFILE);
 		}
-		if (search->dir && (fs_filter_flag & FS_EXCLUDE_DIR))
+
+		entry = &fs_fileIndex.dirs[dir++];
+
+		if (fs_filter_flag & FS_EXCLUDE_DIR)
 		{
 			continue;
 		}
 
-		len = FS_FOpenFileReadDir(fileName, search, file, uniqueFILE, ALLOW_RAW_FILE_ACCESS);
+		fs_openStats.dirProbes++;
+		len = FS_FOpenFileReadDir(fileName, entry->search, file, uniqueFILE, unpure);
 
 		if (file == NULL)
 		{
@@ -1802,11 +2080,96 @@ long FS_FOpenFileRead(const char *fileName, fileHandle_t *file, qboolean uniqueF
 				return len;
 			}
 		}
-		else
+		else if (len >= 0 && *file)
+		{
+			return len;
+		}
+	}
+
+	if (file)
+	{
+		*file = 0;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Prints and resets the FS_FOpenFileRead counters
+ */
+static void FS_OpenStats_f(void)
+{
+	Com_Printf("%i files opened or checked, %i found, %i pak lookups, %i directory lookups, %i msec\n",
+	           fs_openStats.opens, fs_openStats.found, fs_openStats.pakProbes, fs_openStats.dirProbes, fs_openStats.msec);
+	Com_Printf("file index %s: %i files in %i paks and %i directories\n",
+	           fs_fileIndexVar && fs_fileIndexVar->integer ? "on" : "off",
+	           fs_fileIndex.numEntries, fs_fileIndex.numPaks, fs_fileIndex.numDirs);
+
+	Com_Memset(&fs_openStats, 0, sizeof(fs_openStats));
+}
+
+/**
+ * @brief Lookup part of FS_FOpenFileRead
+ * @param[in] fileName
+ * @param[in,out] file
+ * @param[in] uniqueFILE
+ * @return
+ */
+static long FS_FOpenFileReadSearch(const char *fileName, fileHandle_t *file, qboolean uniqueFILE)
+{
+	searchpath_t *search;
+	long         len;
+
+	if (fs_fileIndex.entries && fs_fileIndexVar->integer)
+	{
+		len = FS_FOpenFileReadIndexed(fileName, file, uniqueFILE, ALLOW_RAW_FILE_ACCESS);
+
+		if (file == NULL ? len > 0 : (len >= 0 && *file))
 		{
-			if (len >= 0 && *file)
+			fs_openStats.found++;
+			return len;
+		}
+	}
+	else
+	{
+		for (search = fs_searchpaths; search; search = search->next)
+		{
+			if (search->pack && (fs_filter_flag & FS_EXCLUDE_PK3))
 			{
-				return len;
+				continue;
+			}
+			if (search->dir && (fs_filter_flag & FS_EXCLUDE_DIR))
+			{
+				continue;
+			}
+
+			if (search->pack)
+			{
+				fs_openStats.pakProbes++;
+			}
+			else
+			{
+				fs_openStats.dirProbes++;
+			}
+
+			len = FS_FOpenFileReadDir(fileName, search, file, uniqueFILE, ALLOW_RAW_FILE_ACCESS);
+
+			if (file == NULL)
+			{
+				if (len > 0)
+				{
+					fs_openStats.found++;
+					return len;
+				}
+			}
+			else
+			{
+				if (len >= 0 && *file)
+				{
+					fs_openStats.found++;
+					return len;
+				}
 			}
 		}
 	}
@@ -1827,10 +2190,39 @@ long FS_FOpenFileRead(const char *fileName, fileHandle_t *file, qboolean uniqueF
 	}
 	else
 	{
-		// When file is NULL, we're querying the existence of the file
-		// If we've got here, it doesn't exist
-		return 0;
+		// When file is NULL, we're querying the existence of the file
+		// If we've got here, it doesn't exist
+		return 0;
+	}
+}
+
+/**
+ * @brief Finds the file in the search path.
+ * Used for streaming data out of either a separate file or a ZIP file.
+ *
+ * @param[in] fileName
+ * @param[in,out] file
+ * @param[in] uniqueFILE
+ *
+ * @returns filesize and an open FILE pointer -  0 or -1 for invalid files
+ */
+long FS_FOpenFileRead(const char *fileName, fileHandle_t *file, qboolean uniqueFILE)
+{
+	int  start;
+	long len;
+
+	if (!fs_searchpaths)
+	{
+		Com_Error(ERR_FATAL, "FS_FOpenFileRead: Filesystem call made without initialization");
 	}
+
+	fs_openStats.opens++;
+
+	start              = Sys_Milliseconds();
+	len                = FS_FOpenFileReadSearch(fileName, file, uniqueFILE);
+	fs_openStats.msec += Sys_Milliseconds() - start;
+
+	return len;
 }
 
 long FS_FOpenFileRead_Filtered(const char *qpath, fileHandle_t *file, qboolean uniqueFILE, int filter_flag)
@@ -2690,58 +3082,324 @@ ZIP FILE LOADING
 ==========================================================================
 */
 
+/*
+Parsing the central directory of every pk3 at each start and filesystem restart
+takes a while with a lot of paks. The result is kept in PAKCACHE_FILE in the home
+path: for each pak its file list with offsets and the checksums the pure checks
+are built from, keyed by path, size and modification time. The cache of the last
+start is mapped, unchanged paks are set up from it without reading their zip
+directory, and a new cache is written when any pak was added, changed or removed.
+*/
+
+#define PAKCACHE_FILE       "pakcache.dat"
+#define PAKCACHE_IDENT      (('C' << 24) + ('K' << 16) + ('A' << 8) + 'P')
+#define PAKCACHE_VERSION    1
+#define PAKCACHE_HEADER     (4 * (int)sizeof(int))  ///< ident, version, number of records, checksum of the rest
+
 /**
- * @brief Creates a new pak_t in the search chain for the contents of a zip file.
+ * @struct pakCacheRecord_t
+ * @brief A pak in the cache, followed by int checksums[numChecksums],
+ * unsigned int files[numFiles][2] holding offset and size, the path and the file names
+ */
+typedef struct
+{
+	int size;                           ///< of the whole record, a multiple of 4
+	int fileSize;
+	int modified;                       ///< modification time of the pak
+	int numFiles;
+	int numChecksums;
+	int pathLength;                     ///< including the terminating 0
+	int namesLength;                    ///< all names, each with its terminating 0
+} pakCacheRecord_t;
+
+static struct
+{
+	byte *data;                         ///< cache of the last start, mapped
+	int length;
+	int numRecords;
+	int cursor;                         ///< offset of the record after the last one found
+
+	byte *out;                          ///< cache being built
+	int outLength, outSize;
+	int numOutRecords;
+
+	int hits, misses;
+	qboolean building;
+} fs_pakCache;
+
+static cvar_t *fs_pakCacheVar;
+
+/**
+ * @brief Maps the cache written by the last start and gets ready to build the new one
+ */
+static void FS_OpenPakCache(void)
+{
+	int *header;
+
+	// left over from a startup that was aborted
+	if (fs_pakCache.data)
+	{
+		Sys_UnmapFile(fs_pakCache.data, fs_pakCache.length);
+	}
+	if (fs_pakCache.out)
+	{
+		Com_Dealloc(fs_pakCache.out);
+	}
+
+	Com_Memset(&fs_pakCache, 0, sizeof(fs_pakCache));
+
+	if (!fs_pakCacheVar->integer)
+	{
+		return;
+	}
+
+	fs_pakCache.building = qtrue;
+
+	fs_pakCache.data = Sys_MapFile(FS_BuildOSPath(fs_homepath->string, PAKCACHE_FILE, NULL), &fs_pakCache.length);
+	if (!fs_pakCache.data)
+	{
+		return;
+	}
+
+	header = (int *)fs_pakCache.data;
+	if (fs_pakCache.length < PAKCACHE_HEADER || header[0] != PAKCACHE_IDENT || header[1] != PAKCACHE_VERSION
+	    || header[3] != (int)Com_BlockChecksum(fs_pakCache.data + PAKCACHE_HEADER, fs_pakCache.length - PAKCACHE_HEADER))
+	{
+		Com_Printf("Ignoring outdated or damaged " PAKCACHE_FILE "\n");
+		Sys_UnmapFile(fs_pakCache.data, fs_pakCache.length);
+		fs_pakCache.data = NULL;
+		return;
+	}
+
+	fs_pakCache.numRecords = header[2];
+	fs_pakCache.cursor     = PAKCACHE_HEADER;
+}
+
+/**
+ * @brief Checks that a record lies within the cache and its parts within the record
+ * @param[in] offset
+ * @return The record or NULL if the cache is damaged
+ */
+static pakCacheRecord_t *FS_PakCacheRecord(int offset)
+{
+	pakCacheRecord_t *record;
+	int              needed;
+
+	if (offset < 0 || offset > fs_pakCache.length - (int)sizeof(pakCacheRecord_t))
+	{
+		return NULL;
+	}
+
+	record = (pakCacheRecord_t *)(fs_pakCache.data + offset);
+
+	if (record->size <= 0 || (record->size & 3) || record->size > fs_pakCache.length - offset
+	    || record->numFiles < 0 || record->numFiles > record->size / 8
+	    || record->numChecksums < 0 || record->numChecksums > record->size / 4
+	    || record->pathLength <= 0 || record->namesLength < 0)
+	{
+		return NULL;
+	}
+
+	needed = sizeof(pakCacheRecord_t) + record->numChecksums * sizeof(int) + record->numFiles * 2 * sizeof(int);
+	if (needed > record->size || record->pathLength > record->size - needed || record->namesLength > record->size - needed - record->pathLength)
+	{
+		return NULL;
+	}
+
+	return record;
+}
+
+/**
+ * @brief Finds a pak in the cache of the last start
  * @param[in] zipfile
- * @param[in] basename
- * @return
+ * @param[in] fileSize
+ * @param[in] modified
+ * @return The record or NULL if the pak isn't cached or has changed
  */
-static pack_t *FS_LoadZipFile(const char *zipfile, const char *basename)
+static pakCacheRecord_t *FS_FindPakCache(const char *zipfile, int fileSize, int modified)
 {
-	fileInPack_t    *buildBuffer;
-	pack_t          *pack;
-	unzFile         uf;
-	int             err;
-	unz_global_info gi;
-	char            fileName_inzip[MAX_ZPATH];
-	unz_file_info   file_info;
-	unsigned int    i, len;
-	long            hash;
-	int             fs_numHeaderLongs = 0;
-	int             *fs_headerLongs;
-	char            *namePtr;
-
-	uf  = FS_UnzOpen(zipfile);
-	err = unzGetGlobalInfo(uf, &gi);
+	pakCacheRecord_t *record;
+	const char       *path;
+	int              offset, start, i;
 
-	if (err != UNZ_OK)
+	if (!fs_pakCache.data)
 	{
 		return NULL;
 	}
 
-	len = 0;
-	unzGoToFirstFile(uf);
-	for (i = 0; i < gi.number_entry; i++)
+	// paks are loaded in the same order each time, so the next record is usually the one
+	offset = start = fs_pakCache.cursor;
+	for (i = 0; i < fs_pakCache.numRecords; i++)
 	{
-		err = unzGetCurrentFileInfo(uf, &file_info, fileName_inzip, sizeof(fileName_inzip), NULL, 0, NULL, 0);
-		if (err != UNZ_OK)
+		record = FS_PakCacheRecord(offset);
+		if (!record)
+		{
+			// end of the cache or damaged, start over from the first record
+			if (offset == PAKCACHE_HEADER)
+			{
+				return NULL;
+			}
+			offset = PAKCACHE_HEADER;
+			record = FS_PakCacheRecord(offset);
+			if (!record)
+			{
+				return NULL;
+			}
+		}
+
+		path = (const char *)record + sizeof(pakCacheRecord_t) + (record->numChecksums + record->numFiles * 2) * sizeof(int);
+
+		if (path[record->pathLength - 1] == '\0' && !strcmp(path, zipfile))
+		{
+			fs_pakCache.cursor = offset + record->size;
+
+			if (record->fileSize != fileSize || record->modified != modified)
+			{
+				return NULL;
+			}
+			return record;
+		}
+
+		offset += record->size;
+		if (offset == start)
 		{
 			break;
 		}
-		len += strlen(fileName_inzip) + 1;
-		unzGoToNextFile(uf);
 	}
 
-	buildBuffer                         = Z_Malloc((gi.number_entry * sizeof(fileInPack_t)) + len);
-	namePtr                             = ((char *) buildBuffer) + gi.number_entry * sizeof(fileInPack_t);
-	fs_headerLongs                      = Z_Malloc((gi.number_entry + 1) * sizeof(int));
-	fs_headerLongs[fs_numHeaderLongs++] = LittleLong(fs_checksumFeed);
+	return NULL;
+}
+
+/**
+ * @brief Adds a pak to the cache being built
+ * @param[in] record The record, without its size filled in
+ * @param[in] checksums
+ * @param[in] files Offsets and sizes
+ * @param[in] path
+ * @param[in] names
+ */
+static void FS_AddPakCache(pakCacheRecord_t *record, const int *checksums, const unsigned int *files, const char *path, const char *names)
+{
+	byte *out;
+	int  size;
+
+	size         = sizeof(pakCacheRecord_t) + (record->numChecksums + record->numFiles * 2) * sizeof(int) + record->pathLength + record->namesLength;
+	record->size = (size + 3) & ~3;
+
+	if (fs_pakCache.outLength + record->size > fs_pakCache.outSize)
+	{
+		fs_pakCache.outSize = MAX(fs_pakCache.outSize * 2, fs_pakCache.outLength + record->size + 0x10000);
+		out                 = Com_Allocate(fs_pakCache.outSize);
+		if (!out)
+		{
+			Com_Error(ERR_FATAL, "FS_AddPakCache: out of memory");
+		}
+
+		if (fs_pakCache.out)
+		{
+			Com_Memcpy(out, fs_pakCache.out, fs_pakCache.outLength);
+			Com_Dealloc(fs_pakCache.out);
+		}
+		else
+		{
+			fs_pakCache.outLength = PAKCACHE_HEADER;
+		}
+		fs_pakCache.out = out;
+	}
+
+	out = fs_pakCache.out + fs_pakCache.outLength;
+	Com_Memset(out, 0, record->size);
+	Com_Memcpy(out, record, sizeof(pakCacheRecord_t));
+	out += sizeof(pakCacheRecord_t);
+	Com_Memcpy(out, checksums, record->numChecksums * sizeof(int));
+	out += record->numChecksums * sizeof(int);
+	Com_Memcpy(out, files, record->numFiles * 2 * sizeof(int));
+	out += record->numFiles * 2 * sizeof(int);
+	Com_Memcpy(out, path, record->pathLength);
+	out += record->pathLength;
+	Com_Memcpy(out, names, record->namesLength);
+
+	fs_pakCache.outLength += record->size;
+	fs_pakCache.numOutRecords++;
+}
+
+/**
+ * @brief Writes the new cache if the paks have changed since the last start, and releases both
+ */
+static void FS_ClosePakCache(void)
+{
+	char ospath[MAX_OSPATH], tmppath[MAX_OSPATH];
+	FILE *f;
+	int  *header;
+
+	if (fs_pakCache.building && fs_pakCache.out && (fs_pakCache.misses || fs_pakCache.numOutRecords != fs_pakCache.numRecords))
+	{
+		header    = (int *)fs_pakCache.out;
+		header[0] = PAKCACHE_IDENT;
+		header[1] = PAKCACHE_VERSION;
+		header[2] = fs_pakCache.numOutRecords;
+		header[3] = (int)Com_BlockChecksum(fs_pakCache.out + PAKCACHE_HEADER, fs_pakCache.outLength - PAKCACHE_HEADER);
+
+		// the old cache may still be mapped, write the new one next to it
+		Q_strncpyz(tmppath, FS_BuildOSPath(fs_homepath->string, PAKCACHE_FILE ".tmp", NULL), sizeof(tmppath));
+		Q_strncpyz(ospath, FS_BuildOSPath(fs_homepath->string, PAKCACHE_FILE, NULL), sizeof(ospath));
+
+		f = Sys_FOpen(tmppath, "wb");
+		if (f)
+		{
+			qboolean written = fwrite(fs_pakCache.out, 1, fs_pakCache.outLength, f) == (size_t)fs_pakCache.outLength;
+
+			fclose(f);
+
+			if (fs_pakCache.data)
+			{
+				Sys_UnmapFile(fs_pakCache.data, fs_pakCache.length);
+				fs_pakCache.data = NULL;
+			}
+
+			Sys_Remove(ospath);
+			if (!written || Sys_Rename(tmppath, ospath))
+			{
+				Com_Printf(S_COLOR_YELLOW "WARNING: can't write %s\n", ospath);
+				Sys_Remove(tmppath);
+			}
+		}
+	}
+
+	if (fs_pakCache.building)
+	{
+		Com_Printf("%i of %i pk3 files loaded from " PAKCACHE_FILE "\n", fs_pakCache.hits, fs_pakCache.hits + fs_pakCache.misses);
+	}
+
+	if (fs_pakCache.data)
+	{
+		Sys_UnmapFile(fs_pakCache.data, fs_pakCache.length);
+	}
+	if (fs_pakCache.out)
+	{
+		Com_Dealloc(fs_pakCache.out);
+	}
+
+	Com_Memset(&fs_pakCache, 0, sizeof(fs_pakCache));
+}
+
+/**
+ * @brief Allocates a pak_t with a hash table sized for its files
+ * @param[in] zipfile
+ * @param[in] basename
+ * @param[in] numFiles
+ * @return
+ */
+static pack_t *FS_AllocPack(const char *zipfile, const char *basename, int numFiles)
+{
+	pack_t *pack;
+	int    i;
 
 	// get the hash table size from the number of files in the zip
 	// because lots of custom pk3 files have less than 32 or 64 files
 	for (i = 1; i <= MAX_FILEHASH_SIZE; i <<= 1)
 	{
-		if (i > gi.number_entry)
+		if (i > numFiles)
 		{
 			break;
 		}
@@ -2764,8 +3422,162 @@ static pack_t *FS_LoadZipFile(const char *zipfile, const char *basename)
 		pack->pakBasename[strlen(pack->pakBasename) - 4] = 0;
 	}
 
-	pack->handle   = uf;
-	pack->numfiles = gi.number_entry;
+	pack->numfiles = numFiles;
+
+	return pack;
+}
+
+/**
+ * @brief Sets the checksums of a pak from the CRCs of its files
+ * @param[in,out] pack
+ * @param[in,out] headerLongs The CRCs from index 1 on, index 0 is set to the checksum feed
+ * @param[in] numHeaderLongs Including index 0
+ */
+static void FS_SetPakChecksums(pack_t *pack, int *headerLongs, int numHeaderLongs)
+{
+	headerLongs[0] = LittleLong(fs_checksumFeed);
+
+	pack->checksum      = Com_BlockChecksum(&headerLongs[1], sizeof(*headerLongs) * (numHeaderLongs - 1));
+	pack->pure_checksum = Com_BlockChecksum(headerLongs, sizeof(*headerLongs) * numHeaderLongs);
+	pack->checksum      = LittleLong(pack->checksum);
+	pack->pure_checksum = LittleLong(pack->pure_checksum);
+}
+
+/**
+ * @brief Creates a pak_t from its record in the pak cache
+ * @param[in] zipfile
+ * @param[in] basename
+ * @param[in] uf
+ * @param[in] record
+ * @return NULL if the record is damaged
+ */
+static pack_t *FS_LoadCachedZipFile(const char *zipfile, const char *basename, unzFile uf, const pakCacheRecord_t *record)
+{
+	fileInPack_t       *buildBuffer;
+	pack_t             *pack;
+	const int          *checksums = (const int *)(record + 1);
+	const unsigned int *files     = (const unsigned int *)(checksums + record->numChecksums);
+	const char         *names     = (const char *)(files + record->numFiles * 2) + record->pathLength;
+	char               *namePtr;
+	int                *headerLongs;
+	int                i, len, hash;
+
+	// the names must be exactly numFiles terminated strings
+	if (record->namesLength && names[record->namesLength - 1] != '\0')
+	{
+		return NULL;
+	}
+	for (i = 0, len = 0; len < record->namesLength; i++)
+	{
+		len += strlen(names + len) + 1;
+	}
+	if (i != record->numFiles)
+	{
+		return NULL;
+	}
+
+	buildBuffer = Z_Malloc((record->numFiles * sizeof(fileInPack_t)) + record->namesLength);
+	namePtr     = ((char *) buildBuffer) + record->numFiles * sizeof(fileInPack_t);
+	Com_Memcpy(namePtr, names, record->namesLength);
+
+	pack         = FS_AllocPack(zipfile, basename, record->numFiles);
+	pack->handle = uf;
+
+	for (i = 0; i < record->numFiles; i++)
+	{
+		hash                  = FS_HashFileName(namePtr, pack->hashSize);
+		buildBuffer[i].name   = namePtr;
+		buildBuffer[i].pos    = files[i * 2];
+		buildBuffer[i].len    = files[i * 2 + 1];
+		buildBuffer[i].next   = pack->hashTable[hash];
+		pack->hashTable[hash] = &buildBuffer[i];
+		namePtr              += strlen(namePtr) + 1;
+	}
+
+	headerLongs = Z_Malloc((record->numChecksums + 1) * sizeof(int));
+	Com_Memcpy(headerLongs + 1, checksums, record->numChecksums * sizeof(int));
+	FS_SetPakChecksums(pack, headerLongs, record->numChecksums + 1);
+	Z_Free(headerLongs);
+
+	pack->buildBuffer = buildBuffer;
+	return pack;
+}
+
+/**
+ * @brief Creates a new pak_t in the search chain for the contents of a zip file.
+ * @param[in] zipfile
+ * @param[in] basename
+ * @return
+ */
+static pack_t *FS_LoadZipFile(const char *zipfile, const char *basename)
+{
+	fileInPack_t     *buildBuffer;
+	pack_t           *pack;
+	unzFile          uf;
+	int              err;
+	unz_global_info  gi;
+	char             fileName_inzip[MAX_ZPATH];
+	unz_file_info    file_info;
+	unsigned int     i, len;
+	long             hash;
+	int              fs_numHeaderLongs = 0;
+	int              *fs_headerLongs;
+	char             *namePtr;
+	sys_stat_t       stat_buf;
+	pakCacheRecord_t record, *cached = NULL;
+	unsigned int     *files;
+
+	uf = FS_UnzOpen(zipfile);
+
+	Com_Memset(&record, 0, sizeof(record));
+	if (fs_pakCache.building && uf && Sys_Stat(zipfile, &stat_buf) != -1)
+	{
+		record.fileSize   = (int)stat_buf.st_size;
+		record.modified   = (int)stat_buf.st_mtime;
+		record.pathLength = strlen(zipfile) + 1;
+
+		cached = FS_FindPakCache(zipfile, record.fileSize, record.modified);
+		if (cached && (pack = FS_LoadCachedZipFile(zipfile, basename, uf, cached)) != NULL)
+		{
+			const int *checksums = (const int *)(cached + 1);
+
+			fs_pakCache.hits++;
+			record = *cached;
+			FS_AddPakCache(&record, checksums, (const unsigned int *)(checksums + cached->numChecksums),
+			               zipfile, (const char *)(checksums + cached->numChecksums + cached->numFiles * 2) + cached->pathLength);
+			return pack;
+		}
+		fs_pakCache.misses++;
+	}
+
+	err = unzGetGlobalInfo(uf, &gi);
+
+	if (err != UNZ_OK)
+	{
+		return NULL;
+	}
+
+	len = 0;
+	unzGoToFirstFile(uf);
+	for (i = 0; i < gi.number_entry; i++)
+	{
+		err = unzGetCurrentFileInfo(uf, &file_info, fileName_inzip, sizeof(fileName_inzip), NULL, 0, NULL, 0);
+		if (err != UNZ_OK)
+		{
+			break;
+		}
+		len += strlen(fileName_inzip) + 1;
+		unzGoToNextFile(uf);
+	}
+
+	buildBuffer       = Z_Malloc((gi.number_entry * sizeof(fileInPack_t)) + len);
+	namePtr           = ((char *) buildBuffer) + gi.number_entry * sizeof(fileInPack_t);
+	fs_headerLongs    = Z_Malloc((gi.number_entry + 1) * sizeof(int));
+	fs_numHeaderLongs = 1;      // the checksum feed goes first
+	files             = Z_Malloc(gi.number_entry * 2 * sizeof(int) + 1);
+
+	pack         = FS_AllocPack(zipfile, basename, gi.number_entry);
+	pack->handle = uf;
 	unzGoToFirstFile(uf);
 
 	for (i = 0; i < gi.number_entry; i++)
@@ -2789,13 +3601,22 @@ static pack_t *FS_LoadZipFile(const char *zipfile, const char *basename)
 		buildBuffer[i].len    = file_info.uncompressed_size;
 		buildBuffer[i].next   = pack->hashTable[hash];
 		pack->hashTable[hash] = &buildBuffer[i];
+		files[i * 2]          = (unsigned int)buildBuffer[i].pos;
+		files[i * 2 + 1]      = (unsigned int)buildBuffer[i].len;
 		unzGoToNextFile(uf);
 	}
 
-	pack->checksum      = Com_BlockChecksum(&fs_headerLongs[1], sizeof(*fs_headerLongs) * (fs_numHeaderLongs - 1));
-	pack->pure_checksum = Com_BlockChecksum(fs_headerLongs, sizeof(*fs_headerLongs) * fs_numHeaderLongs);
-	pack->checksum      = LittleLong(pack->checksum);
-	pack->pure_checksum = LittleLong(pack->pure_checksum);
+	// only complete directories are cached, a damaged pak is read again next time
+	if (record.pathLength && i == gi.number_entry)
+	{
+		record.numFiles     = i;
+		record.numChecksums = fs_numHeaderLongs - 1;
+		record.namesLength  = len;
+		FS_AddPakCache(&record, &fs_headerLongs[1], files, zipfile, ((char *) buildBuffer) + gi.number_entry * sizeof(fileInPack_t));
+	}
+	Z_Free(files);
+
+	FS_SetPakChecksums(pack, fs_headerLongs, fs_numHeaderLongs);
 
 	Z_Free(fs_headerLongs);
 
@@ -4238,6 +5059,8 @@ void FS_Shutdown(qboolean closemfp)
 		}
 	}
 
+	FS_FreeFileIndex();
+
 	// free everything
 	for (p = fs_searchpaths ; p ; p = next)
 	{
@@ -4264,6 +5087,7 @@ void FS_Shutdown(qboolean closemfp)
 	Cmd_RemoveCommand("touchFile");
 	Cmd_RemoveCommand("which");
 	Cmd_RemoveCommand("fs_printOpen");
+	Cmd_RemoveCommand("fs_openStats");
 
 #ifdef FS_MISSING
 	if (closemfp)
@@ -4432,9 +5256,11 @@ static void FS_Startup(const char *gameName)
 
 	fs_packFiles = 0;
 
-	fs_debug    = Cvar_Get("fs_debug", "0", 0);
-	fs_basepath = Cvar_Get("fs_basepath", Sys_DefaultInstallPath(), CVAR_INIT | CVAR_PROTECTED);
-	fs_basegame = Cvar_Get("fs_basegame", "", CVAR_INIT | CVAR_PROTECTED);
+	fs_debug        = Cvar_Get("fs_debug", "0", 0);
+	fs_fileIndexVar = Cvar_GetAndDescribe("fs_fileIndex", "1", 0, "Look files up in a single index of all paks instead of pak by pak.");
+	fs_pakCacheVar  = Cvar_GetAndDescribe("fs_pakCache", "1", 0, "Keep the file lists of the pk3 files in " PAKCACHE_FILE " to start faster.");
+	fs_basepath     = Cvar_Get("fs_basepath", Sys_DefaultInstallPath(), CVAR_INIT | CVAR_PROTECTED);
+	fs_basegame     = Cvar_Get("fs_basegame", "", CVAR_INIT | CVAR_PROTECTED);
 
 	homePath = Sys_DefaultHomePath();
 
@@ -4468,6 +5294,9 @@ static void FS_Startup(const char *gameName)
 		Com_Error(ERR_DROP, "Invalid fs_game '%s'", fs_gamedirvar->string);
 	}
 
+	// set up unchanged paks from the cache of the last start
+	FS_OpenPakCache();
+
 	// add search path elements in reverse priority order
 	FS_AddBothGameDirectories(gameName);
 
@@ -4483,6 +5312,8 @@ static void FS_Startup(const char *gameName)
 		FS_AddBothGameDirectories(fs_gamedirvar->string);
 	}
 
+	FS_ClosePakCache();
+
 	// add our commands
 	Cmd_AddCommand("path", FS_Path_f, "Prints current search path including files.");
 	Cmd_AddCommand("dir", FS_Dir_f, "Prints a given directory.");
@@ -4490,6 +5321,7 @@ static void FS_Startup(const char *gameName)
 	Cmd_AddCommand("touchFile", FS_TouchFile_f, "Simulates the 'touch' unix command.");
 	Cmd_AddCommand("which", FS_Which_f, "Searches for a given file.");
 	Cmd_AddCommand("fs_printOpen", FS_PrintOpenHandles_f, "Dump a list of all open files.");
+	Cmd_AddCommand("fs_openStats", FS_OpenStats_f, "Prints and resets the file lookup counters.");
 
 	// reorder the pure pk3 files according to server order
 	FS_ReorderPurePaks();
@@ -4497,6 +5329,9 @@ static void FS_Startup(const char *gameName)
 	// force local paths to the top of the list
 	FS_ReorderLocalFoldersToTop();
 
+	// index the files of all paks now that the search order is final
+	FS_BuildFileIndex();
+
 	// print the current search paths
 	FS_Path_f();
 
@@ -5304,6 +6139,26 @@ qboolean FS_VerifyPak(const char *pak)
 	return qfalse;
 }
 
+/**
+ * @brief Calls back for every pak in the search paths, with the name FS_VerifyPak accepts
+ * @param[in] callback Gets "gamename/basename.pk3" and the OS path of the pak
+ * @param[in] arg
+ */
+void FS_ForEachPak(void (*callback)(const char *pakName, const char *ospath, void *arg), void *arg)
+{
+	char         pakName[MAX_QPATH];
+	searchpath_t *search;
+
+	for (search = fs_searchpaths ; search ; search = search->next)
+	{
+		if (search->pack)
+		{
+			Com_sprintf(pakName, sizeof(pakName), "%s/%s.pk3", search->pack->pakGamename, search->pack->pakBasename);
+			callback(pakName, search->pack->pakFilename, arg);
+		}
+	}
+}
+
 /**
  * @brief Extracts zipped file into the selected path
  * @param[in] fileName to extract
@@ -38,8 +38,6 @@
 #include "q_shared.h"
 #include "qcommon.h"
 
-static int bloc = 0;
-
 /**
  * @brief Clears data along the way so we dont have to memset() it ahead of time
  * @param[in] bit
@@ -50,16 +48,14 @@ void Huff_putBit(int bit, byte *fout, int *offset)
 {
 	int x, y;
 
-	bloc = *offset;
-	x    = bloc >> 3;
-	y    = bloc & 7;
+	x = *offset >> 3;
+	y = *offset & 7;
 	if (!y)
 	{
 		fout[x] = 0;
 	}
 	fout[x] |= bit << y;
-	bloc++;
-	*offset = bloc;
+	(*offset)++;
 }
 
 /**
@@ -72,10 +68,8 @@ int Huff_getBit(byte *fin, int *offset)
 {
 	int t;
 
-	bloc = *offset;
-	t    = fin[bloc >> 3] >> (bloc & 7) & 0x1;
-	bloc++;
-	*offset = bloc;
+	t = fin[*offset >> 3] >> (*offset & 7) & 0x1;
+	(*offset)++;
 	return t;
 }
 
@@ -84,13 +78,14 @@ int Huff_getBit(byte *fin, int *offset)
  *
  * @param[in] bit
  * @param[out] fout
+ * @param[in,out] offset
  */
-static void add_bit(const char bit, byte *fout)
+static void add_bit(const char bit, byte *fout, int *offset)
 {
 	int x, y;
 
-	y = bloc >> 3;
-	x = bloc++ & 7;
+	y = *offset >> 3;
+	x = (*offset)++ & 7;
 	if (!x)
 	{
 		fout[y] = 0;
@@ -101,14 +96,15 @@ static void add_bit(const char bit, byte *fout)
 /**
  * @brief get_bit
  * @param[in] fin
+ * @param[in,out] offset
  * @return
  */
-static int get_bit(byte *fin)
+static int get_bit(byte *fin, int *offset)
 {
 	int t;
 
-	t = fin[bloc >> 3] >> (bloc & 7) & 0x1;
-	bloc++;
+	t = fin[*offset >> 3] >> (*offset & 7) & 0x1;
+	(*offset)++;
 	return t;
 }
 
@@ -387,13 +383,14 @@ void Huff_addRef(huff_t *huff, byte ch)
  * @param[in] node
  * @param[out] ch
  * @param[in] fin
+ * @param[in,out] offset
  * @return
  */
-int Huff_Receive(node_t *node, int *ch, byte *fin)
+int Huff_Receive(node_t *node, int *ch, byte *fin, int *offset)
 {
 	while (node && node->symbol == INTERNAL_NODE)
 	{
-		if (get_bit(fin))
+		if (get_bit(fin, offset))
 		{
 			node = node->right;
 		}
@@ -420,7 +417,8 @@ int Huff_Receive(node_t *node, int *ch, byte *fin)
  */
 void Huff_offsetReceive(node_t *node, int *ch, byte *fin, int *offset, int maxoffset)
 {
-	bloc = *offset;
+	int bloc = *offset;
+
 	while (node && node->symbol == INTERNAL_NODE)
 	{
 		if (bloc >= maxoffset)
@@ -429,7 +427,7 @@ void Huff_offsetReceive(node_t *node, int *ch, byte *fin, int *offset, int maxof
 			*offset = maxoffset + 1;
 			return;
 		}
-		if (get_bit(fin))
+		if (get_bit(fin, &bloc))
 		{
 			node = node->right;
 		}
@@ -453,28 +451,29 @@ void Huff_offsetReceive(node_t *node, int *ch, byte *fin, int *offset, int maxof
  * @param[in] node
  * @param[in] child
  * @param[in] fout
+ * @param[in,out] offset
  * @param[in] maxoffset
  */
-static void send(node_t *node, node_t *child, byte *fout, int maxoffset)
+static void send(node_t *node, node_t *child, byte *fout, int *offset, int maxoffset)
 {
 	if (node->parent)
 	{
-		send(node->parent, node, fout, maxoffset);
+		send(node->parent, node, fout, offset, maxoffset);
 	}
 	if (child)
 	{
-		if (bloc >= maxoffset)
+		if (*offset >= maxoffset)
 		{
-			bloc = maxoffset + 1;
+			*offset = maxoffset + 1;
 			return;
 		}
 		if (node->right == child)
 		{
-			add_bit(1, fout);
+			add_bit(1, fout, offset);
 		}
 		else
 		{
-			add_bit(0, fout);
+			add_bit(0, fout, offset);
 		}
 	}
 }
@@ -484,24 +483,25 @@ static void send(node_t *node, node_t *child, byte *fout, int maxoffset)
  * @param[in] huff
  * @param[in] ch
  * @param[out] fout
+ * @param[in,out] offset
  * @param[in] maxoffset
  */
-void Huff_transmit(huff_t *huff, int ch, byte *fout, int maxoffset)
+void Huff_transmit(huff_t *huff, int ch, byte *fout, int *offset, int maxoffset)
 {
 	if (huff->loc[ch] == NULL)
 	{
 		int i;
 
 		// node_t hasn't been transmitted, send a NYT, then the symbol
-		Huff_transmit(huff, NYT, fout, maxoffset);
+		Huff_transmit(huff, NYT, fout, offset, maxoffset);
 		for (i = 7; i >= 0; i--)
 		{
-			add_bit((char)((ch >> i) & 0x1), fout);
+			add_bit((char)((ch >> i) & 0x1), fout, offset);
 		}
 	}
 	else
 	{
-		send(huff->loc[ch], NULL, fout, maxoffset);
+		send(huff->loc[ch], NULL, fout, offset, maxoffset);
 	}
 }
 
@@ -515,9 +515,7 @@ void Huff_transmit(huff_t *huff, int ch, byte *fout, int maxoffset)
  */
 void Huff_offsetTransmit(huff_t *huff, int ch, byte *fout, int *offset, int maxoffset)
 {
-	bloc = *offset;
-	send(huff->loc[ch], NULL, fout, maxoffset);
-	*offset = bloc;
+	send(huff->loc[ch], NULL, fout, offset, maxoffset);
 }
 
 /**
@@ -527,7 +525,7 @@ void Huff_offsetTransmit(huff_t *huff, int ch, byte *fout, int *offset, int maxo
  */
 void Huff_Decompress(msg_t *mbuf, int offset)
 {
-	int    ch, cch, i, j, size;
+	int    ch, cch, i, j, size, bloc;
 	byte   seq[65536];
 	byte   *buffer;
 	huff_t huff;
@@ -566,13 +564,13 @@ void Huff_Decompress(msg_t *mbuf, int offset)
 			seq[j] = 0;
 			break;
 		}
-		Huff_Receive(huff.tree, &ch, buffer);           // Get a character
+		Huff_Receive(huff.tree, &ch, buffer, &bloc);    // Get a character
 		if (ch == NYT)                                  // We got a NYT, get the symbol associated with it
 		{
 			ch = 0;
 			for (i = 0; i < 8; i++)
 			{
-				ch = (ch << 1) + get_bit(buffer);
+				ch = (ch << 1) + get_bit(buffer, &bloc);
 			}
 		}
 
@@ -593,7 +591,7 @@ extern int oldsize;
  */
 void Huff_Compress(msg_t *mbuf, int offset)
 {
-	int    i, ch, size;
+	int    i, ch, size, bloc;
 	byte   seq[65536];
 	byte   *buffer;
 	huff_t huff;
@@ -623,7 +621,7 @@ void Huff_Compress(msg_t *mbuf, int offset)
 	for (i = 0; i < size; i++)
 	{
 		ch = buffer[i];
-		Huff_transmit(&huff, ch, seq, size<<3);  // Transmit symbol
+		Huff_transmit(&huff, ch, seq, &bloc, size << 3); // Transmit symbol
 		Huff_addRef(&huff, (byte)ch);   // Do update
 	}
 
@@ -657,3 +655,77 @@ void Huff_Init(huffman_t *huff)
 	huff->compressor.tree->parent = huff->compressor.tree->left = huff->compressor.tree->right = NULL;
 	huff->compressor.loc[NYT]     = huff->compressor.tree;
 }
+
+/**
+ * @brief Flattens a tree which doesn't adapt any more into encode and decode tables
+ * @param[in] compressor
+ * @param[in] decompressor
+ * @param[out] tables
+ * @return qfalse if a symbol is missing or its code is empty or doesn't fit into 32 bits
+ */
+qboolean Huff_BuildTables(huff_t *compressor, huff_t *decompressor, huffTables_t *tables)
+{
+	node_t       *node;
+	unsigned int code;
+	int          ch, len, fill;
+
+	Com_Memset(tables, 0, sizeof(*tables));
+
+	for (ch = 0; ch < HMAX; ch++)
+	{
+		if (!compressor->loc[ch])
+		{
+			return qfalse;
+		}
+
+		// walk up to the root, the bit next to the root is sent first
+		code = 0;
+		len  = 0;
+		for (node = compressor->loc[ch]; node->parent; node = node->parent)
+		{
+			if (len == 32)
+			{
+				return qfalse;
+			}
+			code = (code << 1) | (node->parent->right == node);
+			len++;
+		}
+
+		if (!len)
+		{
+			return qfalse;
+		}
+
+		tables->code[ch] = code;
+		tables->len[ch]  = (byte)len;
+	}
+
+	// the decompressor got the same updates, but read the codes off its own tree
+	for (ch = 0; ch < HMAX; ch++)
+	{
+		if (!decompressor->loc[ch])
+		{
+			return qfalse;
+		}
+
+		code = 0;
+		len  = 0;
+		for (node = decompressor->loc[ch]; node->parent; node = node->parent)
+		{
+			code = (code << 1) | (node->parent->right == node);
+			len++;
+		}
+
+		if (len > HUFF_LOOKUP_BITS)
+		{
+			continue;   // left to Huff_offsetReceive
+		}
+
+		for (fill = 0; fill < 1 << (HUFF_LOOKUP_BITS - len); fill++)
+		{
+			tables->lookup[code | (fill << len)] = (unsigned short)(len << 8 | ch);
+		}
+	}
+
+	return qtrue;
+}
@@ -42,8 +42,10 @@
 // redefined when included, producing a lot of recursive declarations errors...)
 #include "../game/g_public.h"
 
-static huffman_t msgHuff;
-static qboolean  msgInit = qfalse;
+static huffman_t    msgHuff;
+static huffTables_t msgHuffTables;
+static qboolean     msgHuffTablesValid = qfalse; ///< qfalse walks the tree bit by bit
+static qboolean     msgInit            = qfalse;
 
 int pcount[256];
 int wastedbits = 0;
@@ -185,6 +187,151 @@ bit functions
 
 // Negative bit values include signs
 
+/**
+ * @brief Writes the low bits raw and the bytes huffman coded, like the tree walk
+ * in MSG_WriteBits does, but a whole code at a time through a 64 bit accumulator
+ *
+ * @param[in,out] msg
+ * @param[in] value already masked to bits
+ * @param[in] bits
+ * @return qfalse if the message could overflow, nothing is written then
+ */
+static qboolean MSG_WriteHuffmanBits(msg_t *msg, unsigned int value, int bits)
+{
+	uint64_t acc;
+	int      i, x, ch, numAcc, total, nbits = bits & 7;
+	byte     *out;
+
+	total = nbits;
+	for (i = nbits; i < bits; i += 8)
+	{
+		total += msgHuffTables.len[(value >> i) & 0xff];
+	}
+
+	// let the tree walk handle the truncation exactly as before
+	if (msg->bit + total > msg->maxsize << 3)
+	{
+		return qfalse;
+	}
+
+	x      = msg->bit >> 3;
+	numAcc = msg->bit & 7;
+	out    = msg->data;
+
+	// keep the bits already in the current byte, the ones above are still 0
+	acc     = numAcc ? (out[x] & ((1 << numAcc) - 1)) : 0;
+	acc    |= (uint64_t)(value & ((1 << nbits) - 1)) << numAcc;
+	numAcc += nbits;
+
+	for (i = nbits; i < bits; i += 8)
+	{
+		ch = (value >> i) & 0xff;
+
+		if (numAcc + msgHuffTables.len[ch] > 64)
+		{
+			for ( ; numAcc >= 8; numAcc -= 8)
+			{
+				out[x++] = (byte)acc;
+				acc    >>= 8;
+			}
+		}
+
+		acc    |= (uint64_t)msgHuffTables.code[ch] << numAcc;
+		numAcc += msgHuffTables.len[ch];
+	}
+
+	for ( ; numAcc > 0; numAcc -= 8)
+	{
+		out[x++] = (byte)acc;
+		acc    >>= 8;
+	}
+
+	msg->bit += total;
+
+	if (bits >= 8 && msg->bit >= msg->maxsize << 3)
+	{
+		msg->overflowed = qtrue;
+		return qtrue;
+	}
+
+	msg->cursize = (msg->bit >> 3) + 1;
+	return qtrue;
+}
+
+/**
+ * @brief Reads what MSG_WriteHuffmanBits wrote, the codes are looked up
+ * HUFF_LOOKUP_BITS at a time from a 64 bit window of the message
+ *
+ * @param[in,out] msg
+ * @param[in] bits
+ * @param[out] value
+ * @return qfalse close to the end of the message or for a long code, nothing is read then
+ */
+static qboolean MSG_ReadHuffmanBits(msg_t *msg, int bits, int *value)
+{
+	uint64_t     acc = 0;
+	unsigned int v;
+	int          i, x, e, used, nbits = bits & 7;
+
+	x = msg->bit >> 3;
+
+	if (x + 8 > msg->cursize)
+	{
+		return qfalse;
+	}
+
+	for (i = 7; i >= 0; i--)
+	{
+		acc = (acc << 8) | msg->data[x + i];
+	}
+	acc >>= msg->bit & 7;
+
+	// at most 7 + 4 * HUFF_LOOKUP_BITS bits are used, the window holds 57 or more
+	v      = (unsigned int)(acc & ((1 << nbits) - 1));
+	acc  >>= nbits;
+	used   = nbits;
+
+	for (i = nbits; i < bits; i += 8)
+	{
+		e = msgHuffTables.lookup[acc & ((1 << HUFF_LOOKUP_BITS) - 1)];
+
+		if (!e)
+		{
+			return qfalse;
+		}
+
+		v    |= (unsigned int)(e & 0xff) << i;
+		acc >>= e >> 8;
+		used += e >> 8;
+	}
+
+	msg->bit      += used;
+	msg->readcount = (msg->bit >> 3) + 1;
+	*value         = (int)v;
+	return qtrue;
+}
+
+/**
+ * @brief Holds back an error of a message written on a worker thread
+ *
+ * Com_Error can't be raised off the main thread. The message is marked
+ * overflowed so nothing more gets written, the thread that handed out the
+ * work raises msg->error once the worker is done. Only the first error is kept.
+ *
+ * @param[in,out] msg
+ * @param[in] code errorParm_t
+ * @param[in] error Static text, it is read after the writer returned
+ */
+void MSG_SetError(msg_t *msg, int code, const char *error)
+{
+	if (!msg->error)
+	{
+		msg->errorCode = code;
+		msg->error     = error;
+	}
+	msg->overflowed = qtrue;
+}
+
 /**
  * @brief MSG_WriteBits
  * @param[in,out] msg
@@ -193,7 +340,10 @@ bit functions
  */
 void MSG_WriteBits(msg_t *msg, int value, int bits)
 {
-	oldsize += bits;
+	if (!msg->threaded)
+	{
+		oldsize += bits;
+	}
 
 	msg->uncompsize += bits; // net debugging
 
@@ -204,6 +354,11 @@ void MSG_WriteBits(msg_t *msg, int value, int bits)
 
 	if (bits == 0 || bits < -31 || bits > 32)
 	{
+		if (msg->threaded)
+		{
+			MSG_SetError(msg, ERR_DROP, "MSG_WriteBits: bad bits");
+			return;
+		}
 		Com_Error(ERR_DROP, "MSG_WriteBits: bad bits %i", bits);
 	}
 
@@ -255,6 +410,12 @@ void MSG_WriteBits(msg_t *msg, int value, int bits)
 		int i;
 
 		value &= (0xffffffff >> (32 - bits));
+
+		if (msgHuffTablesValid && MSG_WriteHuffmanBits(msg, (unsigned int)value, bits))
+		{
+			return;
+		}
+
 		if (bits & 7)
 		{
 			int nbits = bits & 7;
@@ -290,6 +451,71 @@ void MSG_WriteBits(msg_t *msg, int value, int bits)
 	}
 }
 
+/**
+ * @brief Appends bits which were written to another message by MSG_WriteBits
+ *
+ * The huffman codes don't depend on where they start, so a delta encoded once
+ * into a scratch message can be copied into any number of messages.
+ *
+ * @param[in,out] msg
+ * @param[in] data start of the encoded bits, unused bits of the last byte must be 0
+ * @param[in] bits
+ * @param[in] uncompsize sum of the bits passed to MSG_WriteBits, net debugging
+ */
+void MSG_WriteEncodedBits(msg_t *msg, const byte *data, int bits, int uncompsize)
+{
+	int  i, x, y, bytes;
+	byte *out;
+
+	msg->uncompsize += uncompsize; // net debugging
+
+	if (msg->overflowed)
+	{
+		return;
+	}
+
+	if (msg->oob)
+	{
+		if (msg->threaded)
+		{
+			MSG_SetError(msg, ERR_DROP, "MSG_WriteEncodedBits: can't write to an oob message");
+			return;
+		}
+		Com_Error(ERR_DROP, "MSG_WriteEncodedBits: can't write to an oob message");
+	}
+
+	if (msg->bit + bits >= msg->maxsize << 3)
+	{
+		msg->overflowed = qtrue;
+		return;
+	}
+
+	x     = msg->bit >> 3;
+	y     = msg->bit & 7;
+	bytes = (bits + 7) >> 3;
+	out   = msg->data + x;
+
+	if (!y)
+	{
+		Com_Memcpy(out, data, bytes);
+	}
+	else
+	{
+		// the bits above the write position are still 0
+		for (i = 0; i < bytes; i++)
+		{
+			out[i] |= data[i] << y;
+			if (((i + 1) << 3) - y < bits)
+			{
+				out[i + 1] = data[i] >> (8 - y);
+			}
+		}
+	}
+
+	msg->bit    += bits;
+	msg->cursize = (msg->bit >> 3) + 1;
+}
+
 /**
  * @brief MSG_ReadBits
  * @param[in,out] msg
@@ -358,39 +584,47 @@ int MSG_ReadBits(msg_t *msg, int bits)
 	{
 		int i, nbits = 0;
 
-		if (bits & 7)
+		if (msgHuffTablesValid && MSG_ReadHuffmanBits(msg, bits, &value))
 		{
-			nbits = bits & 7;
-
-			if (msg->bit + nbits > msg->cursize << 3)
-			{
-				msg->readcount = msg->cursize + 1;
-				return 0;
-			}
-
-			for (i = 0; i < nbits; i++)
-			{
-				value |= (Huff_getBit(msg->data, &msg->bit) << i);
-			}
-			bits = bits - nbits;
+			// the sign below is taken from the huffman coded part only
+			bits -= bits & 7;
 		}
-		if (bits)
+		else
 		{
-			int get;
-
-			for (i = 0; i < bits; i += 8)
+			if (bits & 7)
 			{
-				Huff_offsetReceive(msgHuff.decompressor.tree, &get, msg->data, &msg->bit, msg->cursize << 3);
-				value = (unsigned int)value | ((unsigned int)get << (i + nbits));
+				nbits = bits & 7;
 
-				if (msg->bit > msg->cursize << 3)
+				if (msg->bit + nbits > msg->cursize << 3)
 				{
 					msg->readcount = msg->cursize + 1;
 					return 0;
 				}
+
+				for (i = 0; i < nbits; i++)
+				{
+					value |= (Huff_getBit(msg->data, &msg->bit) << i);
+				}
+				bits = bits - nbits;
+			}
+			if (bits)
+			{
+				int get;
+
+				for (i = 0; i < bits; i += 8)
+				{
+					Huff_offsetReceive(msgHuff.decompressor.tree, &get, msg->data, &msg->bit, msg->cursize << 3);
+					value = (unsigned int)value | ((unsigned int)get << (i + nbits));
+
+					if (msg->bit > msg->cursize << 3)
+					{
+						msg->readcount = msg->cursize + 1;
+						return 0;
+					}
+				}
 			}
+			msg->readcount = (msg->bit >> 3) + 1;
 		}
-		msg->readcount = (msg->bit >> 3) + 1;
 	}
 	if (sgn && bits > 0 && bits < 32)
 	{
@@ -1232,6 +1466,37 @@ void MSG_PrioritiseEntitystateFields(void)
 #define FLOAT_INT_BITS  13
 #define FLOAT_INT_BIAS  (1 << (FLOAT_INT_BITS - 1))
 
+/**
+ * @brief Builds the change vector of two entity states, a bit per entityStateFields entry
+ * @param[in] from
+ * @param[in] to
+ * @param[out] changes
+ * @return qtrue if any field differs
+ */
+qboolean MSG_EntityStateChanges(const entityState_t *from, const entityState_t *to, unsigned int *changes)
+{
+	int        i;
+	int        numFields = sizeof(entityStateFields) / sizeof(entityStateFields[0]);
+	netField_t *field;
+	const int  *fromF, *toF;
+	qboolean   changed = qfalse;
+
+	Com_Memset(changes, 0, ENTITY_CHANGE_WORDS * sizeof(changes[0]));
+
+	for (i = 0, field = entityStateFields ; i < numFields ; i++, field++)
+	{
+		fromF = (const int *)((const byte *)from + field->offset);
+		toF   = (const int *)((const byte *)to + field->offset);
+		if (*fromF != *toF)
+		{
+			changes[i >> 5] |= 1u << (i & 31);
+			changed          = qtrue;
+		}
+	}
+
+	return changed;
+}
+
 /**
  * @brief Writes part of a packetentities message, including the entity number.
  * Can delta from either a baseline or a previous packet_entity
@@ -1245,18 +1510,14 @@ void MSG_PrioritiseEntitystateFields(void)
  */
 void MSG_WriteDeltaEntity(msg_t *msg, entityState_t *from, entityState_t *to, qboolean force)
 {
-	int        i, lc;
-	int        numFields = sizeof(entityStateFields) / sizeof(entityStateFields[0]);
-	netField_t *field;
-	int        trunc;
-	float      fullFloat;
-	int        *fromF, *toF;
+	unsigned int changes[ENTITY_CHANGE_WORDS];
 
 	// all fields should be 32 bits to avoid any compiler packing issues
 	// the "number" field is not part of the field list
 	// if this assert fails, someone added a field to the entityState_t
 	// struct without updating the message fields
-	etl_assert(numFields + 1 == sizeof(*from) / 4);
+	etl_assert(sizeof(entityStateFields) / sizeof(entityStateFields[0]) + 1 == sizeof(*from) / 4);
+	etl_assert(sizeof(entityStateFields) / sizeof(entityStateFields[0]) <= ENTITY_CHANGE_WORDS * 32);
 
 	// a NULL to is a delta remove message
 	if (to == NULL)
@@ -1265,7 +1526,7 @@ void MSG_WriteDeltaEntity(msg_t *msg, entityState_t *from, entityState_t *to, qb
 		{
 			return;
 		}
-		if (cl_shownet && (cl_shownet->integer >= 2 || cl_shownet->integer == -1))
+		if (!msg->threaded && cl_shownet && (cl_shownet->integer >= 2 || cl_shownet->integer == -1))
 		{
 			Com_Printf("W|%3i: #%-3i remove\n", msg->cursize, from->number);
 		}
@@ -1274,22 +1535,44 @@ void MSG_WriteDeltaEntity(msg_t *msg, entityState_t *from, entityState_t *to, qb
 		return;
 	}
 
+	MSG_EntityStateChanges(from, to, changes);
+	MSG_WriteDeltaEntityChanges(msg, from, to, changes, force);
+}
+
+/**
+ * @brief Same as MSG_WriteDeltaEntity for a to state, with the change vector
+ * of the two states already known, see MSG_EntityStateChanges
+ * @param[out] msg
+ * @param[in] from
+ * @param[in] to
+ * @param[in] changes
+ * @param[in] force
+ */
+void MSG_WriteDeltaEntityChanges(msg_t *msg, entityState_t *from, entityState_t *to, const unsigned int *changes, qboolean force)
+{
+	int        i, lc;
+	int        numFields = sizeof(entityStateFields) / sizeof(entityStateFields[0]);
+	netField_t *field;
+	int        trunc;
+	float      fullFloat;
+	int        *toF;
+
 	if (to->number < 0 || to->number >= MAX_GENTITIES)
 	{
+		if (msg->threaded)
+		{
+			MSG_SetError(msg, ERR_FATAL, "MSG_WriteDeltaEntity: Bad entity number");
+			return;
+		}
 		Com_Error(ERR_FATAL, "MSG_WriteDeltaEntity: Bad entity number: %i", to->number);
 	}
 
-	lc = 0;
-	// build the change vector as bytes so it is endien independent
-	for (i = 0, field = entityStateFields ; i < numFields ; i++, field++)
+	// the last changed field ends the change vector
+	for (lc = numFields; lc > 0; lc--)
 	{
-		fromF = ( int * )((byte *)from + field->offset);
-		toF   = ( int * )((byte *)to + field->offset);
-		if (*fromF != *toF)
+		if (changes[(lc - 1) >> 5] & (1u << ((lc - 1) & 31)))
 		{
-			lc = i + 1;
-
-			field->used++;
+			break;
 		}
 	}
 
@@ -1313,24 +1596,35 @@ void MSG_WriteDeltaEntity(msg_t *msg, entityState_t *from, entityState_t *to, qb
 
 	MSG_WriteByte(msg, lc);     // # of changes
 
-	oldsize += numFields;
+	// the statistics are shared, workers leave them alone
+	if (!msg->threaded)
+	{
+		oldsize += numFields;
+	}
 
 	//Com_Printf( "Delta for ent %i: ", to->number );
 
 	for (i = 0, field = entityStateFields ; i < lc ; i++, field++)
 	{
-		fromF = ( int * )((byte *)from + field->offset);
-		toF   = ( int * )((byte *)to + field->offset);
-
-		if (*fromF == *toF)
+		if (!(changes[i >> 5] & (1u << (i & 31))))
 		{
 			MSG_WriteBits(msg, 0, 1);   // no change
 
-			wastedbits++;
+			if (!msg->threaded)
+			{
+				wastedbits++;
+			}
 
 			continue;
 		}
 
+		toF = ( int * )((byte *)to + field->offset);
+
+		if (!msg->threaded)
+		{
+			field->used++;
+		}
+
 		MSG_WriteBits(msg, 1, 1);   // changed
 
 		if (field->bits == 0)
@@ -1342,7 +1636,10 @@ void MSG_WriteDeltaEntity(msg_t *msg, entityState_t *from, entityState_t *to, qb
 			if (fullFloat == 0.0f)
 			{
 				MSG_WriteBits(msg, 0, 1);
-				oldsize += FLOAT_INT_BITS;
+				if (!msg->threaded)
+				{
+					oldsize += FLOAT_INT_BITS;
+				}
 			}
 			else
 			{
@@ -2013,7 +2310,7 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 
 	// shownet 2/3 will interleave with other printed info, -2 will
 	// just print the delta records
-	if (cl_shownet && (cl_shownet->integer >= 2 || cl_shownet->integer == -2))
+	if (!msg->threaded && cl_shownet && (cl_shownet->integer >= 2 || cl_shownet->integer == -2))
 	{
 		print = 1;
 		Com_Printf("W|%3i: playerstate ", msg->cursize);
@@ -2034,13 +2331,19 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 		{
 			lc = i + 1;
 
-			field->used++;
+			if (!msg->threaded)
+			{
+				field->used++;
+			}
 		}
 	}
 
 	MSG_WriteByte(msg, lc);     // # of changes
 
-	oldsize += numFields - lc;
+	if (!msg->threaded)
+	{
+		oldsize += numFields - lc;
+	}
 
 	for (i = 0, field = playerStateFields ; i < lc ; i++, field++)
 	{
@@ -2049,7 +2352,10 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 
 		if (*fromF == *toF)
 		{
-			wastedbits++;
+			if (!msg->threaded)
+			{
+				wastedbits++;
+			}
 
 			MSG_WriteBits(msg, 0, 1);   // no change
 			continue;
@@ -2205,7 +2511,10 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 	else
 	{
 		MSG_WriteBits(msg, 0, 1);   // no change to any
-		oldsize += 4;
+		if (!msg->threaded)
+		{
+			oldsize += 4;
+		}
 	}
 
 	// Split this into two groups using shorts so it wouldn't have
@@ -2817,4 +3126,156 @@ void MSG_initHuffman(void)
 			Huff_addRef(&msgHuff.decompressor, (byte)i);  // Do update
 		}
 	}
+
+	// the tree is static from here on
+	msgHuffTablesValid = Huff_BuildTables(&msgHuff.compressor, &msgHuff.decompressor, &msgHuffTables);
+	if (!msgHuffTablesValid)
+	{
+		Com_DPrintf("MSG_initHuffman: can't flatten the tree, using the tree walk\n");
+	}
+}
+
+#define HUFFBENCH_BUFFER (MAX_MSGLEN * 4)
+
+/**
+ * @brief Runs one pass of the huffman benchmark over a demo message
+ * @param[in] data
+ * @param[in] len
+ * @param[out] decoded
+ * @param[out] numDecoded
+ * @param[out] encoded
+ * @param[out] numEncoded
+ * @param[in,out] readTime
+ * @param[in,out] writeTime
+ * @param[in] iterations
+ */
+static void MSG_HuffmanBenchPass(byte *data, int len, byte *decoded, int *numDecoded, byte *encoded, int *numEncoded,
+                                 int *readTime, int *writeTime, int iterations)
+{
+	msg_t msg;
+	int   i, c, start;
+
+	start = Sys_Milliseconds();
+	for (i = 0; i < iterations; i++)
+	{
+		MSG_Init(&msg, data, len);
+		msg.cursize = len;
+		MSG_BeginReading(&msg);
+
+		*numDecoded = 0;
+		while ((c = MSG_ReadByte(&msg)) != -1 && *numDecoded < MAX_MSGLEN)
+		{
+			decoded[(*numDecoded)++] = (byte)c;
+		}
+	}
+	*readTime += Sys_Milliseconds() - start;
+
+	start = Sys_Milliseconds();
+	for (i = 0; i < iterations; i++)
+	{
+		MSG_Init(&msg, encoded, HUFFBENCH_BUFFER);
+		for (c = 0; c < *numDecoded; c++)
+		{
+			MSG_WriteByte(&msg, decoded[c]);
+		}
+	}
+	*writeTime += Sys_Milliseconds() - start;
+
+	*numEncoded = msg.overflowed ? -1 : msg.bit;
+}
+
+/**
+ * @brief Times the huffman tables against the tree walk on the messages of a
+ * recorded demo and checks both read and write the same bits
+ */
+void MSG_HuffmanBench_f(void)
+{
+	byte     *file, *buffers;
+	int      fileLen, pos, len, iterations, numMessages = 0, numBytes = 0, mismatches = 0;
+	int      numDecoded[2], numEncoded[2], readTime[2] = { 0, 0 }, writeTime[2] = { 0, 0 };
+	qboolean tablesValid;
+
+	if (Cmd_Argc() < 2)
+	{
+		Com_Printf("usage: huffbench <demos/file.dm_84> [iterations]\n");
+		return;
+	}
+
+	if (!msgInit)
+	{
+		MSG_initHuffman();
+	}
+
+	if (!msgHuffTablesValid)
+	{
+		Com_Printf("huffbench: no huffman tables, the tree walk is always used\n");
+		return;
+	}
+
+	iterations = Cmd_Argc() > 2 ? Q_atoi(Cmd_Argv(2)) : 10;
+	if (iterations < 1)
+	{
+		iterations = 1;
+	}
+
+	fileLen = FS_ReadFile(Cmd_Argv(1), (void **)&file);
+	if (fileLen <= 0)
+	{
+		Com_Printf("huffbench: can't read %s\n", Cmd_Argv(1));
+		return;
+	}
+
+	buffers = (byte *)Com_Allocate(4 * HUFFBENCH_BUFFER);
+	if (!buffers)
+	{
+		FS_FreeFile(file);
+		Com_Printf("huffbench: out of memory\n");
+		return;
+	}
+
+	tablesValid = msgHuffTablesValid;
+
+	// demo messages are the server sequence, the length and the message as received
+	for (pos = 0; pos + 8 <= fileLen; pos += 8 + len)
+	{
+		len = LittleLong(*(int *)(file + pos + 4));
+		if (len <= 0 || len > MAX_MSGLEN || pos + 8 + len > fileLen)
+		{
+			break;
+		}
+
+		msgHuffTablesValid = qfalse;
+		MSG_HuffmanBenchPass(file + pos + 8, len, buffers, &numDecoded[0], buffers + HUFFBENCH_BUFFER, &numEncoded[0],
+		                     &readTime[0], &writeTime[0], iterations);
+
+		msgHuffTablesValid = qtrue;
+		MSG_HuffmanBenchPass(file + pos + 8, len, buffers + 2 * HUFFBENCH_BUFFER, &numDecoded[1], buffers + 3 * HUFFBENCH_BUFFER, &numEncoded[1],
+		                     &readTime[1], &writeTime[1], iterations);
+
+		if (numDecoded[0] != numDecoded[1] || memcmp(buffers, buffers + 2 * HUFFBENCH_BUFFER, numDecoded[0]) ||
+		    numEncoded[0] != numEncoded[1] || (numEncoded[0] > 0 && memcmp(buffers + HUFFBENCH_BUFFER, buffers + 3 * HUFFBENCH_BUFFER, (numEncoded[0] + 7) >> 3)))
+		{
+			mismatches++;
+		}
+
+		numMessages++;
+		numBytes += len;
+	}
+
+	msgHuffTablesValid = tablesValid;
+
+	Com_Dealloc(buffers);
+	FS_FreeFile(file);
+
+	Com_Printf("huffbench: %i messages, %i bytes, %i iterations\n", numMessages, numBytes, iterations);
+	Com_Printf("  tree walk: read %5i msec, write %5i msec\n", readTime[0], writeTime[0]);
+	Com_Printf("  tables   : read %5i msec, write %5i msec\n", readTime[1], writeTime[1]);
+	if (mismatches)
+	{
+		Com_Printf(S_COLOR_RED "  %i messages differ between the tree walk and the tables\n", mismatches);
+	}
+	else
+	{
+		Com_Printf("  all messages identical\n");
+	}
 }
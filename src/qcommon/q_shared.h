@@ -128,6 +128,13 @@
 #define Q_EXPORT
 #endif
 
+// storage that every thread gets its own copy of
+#ifdef _MSC_VER
+#define Q_THREAD_LOCAL __declspec(thread)
+#else
+#define Q_THREAD_LOCAL __thread
+#endif
+
 // FIXME: required for MinGW. Find a better way to handle this (<float.h>?)
 #ifdef __MINGW32__
 #   ifndef FLT_EPSILON
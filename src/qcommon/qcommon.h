@@ -57,6 +57,9 @@ typedef struct
 	int readcount;
 	int bit;                    ///< for bitwise reads and writes
 	int strip;                  ///< strip >= 0x80 chars from message, old clients don't like them
+	qboolean threaded;          ///< written on a worker thread: no statistics, prints or Com_Error, see MSG_SetError
+	int errorCode;              ///< errorParm_t of the error held back on a threaded message
+	const char *error;          ///< the error held back on a threaded message, NULL if none
 } msg_t;
 
 void MSG_Init(msg_t *buf, byte *data, int length);
@@ -80,6 +83,8 @@ struct entityState_s;
 struct playerState_s;
 
 void MSG_WriteBits(msg_t *msg, int value, int bits);
+void MSG_WriteEncodedBits(msg_t *msg, const byte *data, int bits, int uncompsize);
+void MSG_SetError(msg_t *msg, int code, const char *error);
 
 void MSG_WriteChar(msg_t *msg, int c);
 void MSG_WriteByte(msg_t *msg, int c);
@@ -111,7 +116,11 @@ void MSG_ReadData(msg_t *msg, void *data, int size);
 void MSG_WriteDeltaUsercmdKey(msg_t *msg, int key, usercmd_t *from, usercmd_t *to);
 void MSG_ReadDeltaUsercmdKey(msg_t *msg, int key, usercmd_t *from, usercmd_t *to);
 
+#define ENTITY_CHANGE_WORDS 3 ///< change vector of an entity state, a bit per field of the delta encoding
+
+qboolean MSG_EntityStateChanges(const entityState_t *from, const entityState_t *to, unsigned int *changes);
 void MSG_WriteDeltaEntity(msg_t *msg, entityState_t *from, entityState_t *to, qboolean force);
+void MSG_WriteDeltaEntityChanges(msg_t *msg, entityState_t *from, entityState_t *to, const unsigned int *changes, qboolean force);
 void MSG_ReadDeltaEntity(msg_t *msg, entityState_t *from, entityState_t *to, int number);
 
 void MSG_WriteDeltaSharedEntity(msg_t *msg, void *from, void *to, qboolean force, int number);
@@ -121,6 +130,7 @@ void MSG_WriteDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct pl
 void MSG_ReadDeltaPlayerstate(msg_t *msg, struct playerState_s *from, struct playerState_s *to);
 
 void MSG_ReportChangeVectors_f(void);
+void MSG_HuffmanBench_f(void);
 
 /**
 ==============================================================
@@ -150,6 +160,14 @@ NET
 #define PACKET_BACKUP   32
 #define PACKET_MASK (PACKET_BACKUP - 1)
 
+/**
+ * @def MAX_PARSE_ENTITIES
+ * @brief the parseEntities array must be large enough to hold PACKET_BACKUP frames of
+ * entities, so that when a delta compressed message arives from the server
+ * it can be un-deltad from the original
+ */
+#define MAX_PARSE_ENTITIES  2048
+
 /**
  * @def MAX_PACKET_USERCMDS
  * @brief max number of usercmd_t in a packet
@@ -595,6 +613,7 @@ void Cmd_CommandCompletion(void (*callback)(const char *s)); ///< callback with
 void Cmd_SetCommandCompletionFunc(const char *command, completionFunc_t complete);
 void Cmd_SetCommandDescription(const char *command, const char *description);
 void Cmd_CompleteArgument(const char *command, char *args, int argNum);
+void Cmd_Bench_f(void);
 
 void Cmd_SaveCmdContext(void);
 void Cmd_RestoreCmdContext(void);
@@ -820,6 +839,8 @@ fileHandle_t FS_FOpenFileWrite(const char *fileName);
 long FS_filelength(fileHandle_t f);
 fileHandle_t FS_SV_FOpenFileWrite(const char *fileName);
 long FS_SV_FOpenFileRead(const char *fileName, fileHandle_t *fp);
+typedef struct sysSharedFile_s sysSharedFile_t;
+sysSharedFile_t *FS_SV_OpenSharedFile(const char *fileName, int *length);
 void FS_SV_Rename(const char *from, const char *to);
 long FS_FOpenFileRead(const char *fileName, fileHandle_t *file, qboolean uniqueFILE);
 long FS_FOpenFileReadFullDir(const char *fullFileName, fileHandle_t *file);
@@ -867,6 +888,9 @@ int FS_ReadFile(const char *qpath, void **buffer);
 void FS_ForceFlush(fileHandle_t f);
 // forces flush on files we're writing to.
 
+FILE *FS_StreamForHandle(fileHandle_t f);
+// stdio stream of a file we're writing to, for writing outside of the main thread
+
 void FS_FreeFile(void *buffer);
 // frees the memory returned by FS_ReadFile
 
@@ -935,6 +959,7 @@ qboolean FS_CL_ExtractFromPakFile(const char *base, const char *gamedir, const c
 void FS_CopyFile(const char *fromOSPath, const char *toOSPath);
 
 qboolean FS_VerifyPak(const char *pak);
+void FS_ForEachPak(void (*callback)(const char *pakName, const char *ospath, void *arg), void *arg);
 
 qboolean FS_UnzipTo(const char *fileName, const char *outpath, qboolean quiet);
 qboolean FS_Unzip(const char *fileName, qboolean quiet);
@@ -1259,6 +1284,84 @@ void Com_WWWDownload(void);
 qboolean Com_WWWBadChecksum(const char *pakname);
 void Com_Download_f(void);
 
+// demo_index.c
+#define DEMO_INDEX_EXT "idx"
+
+/**
+ * @struct demoIndexGamestate_t
+ * @brief A gamestate of an indexed demo
+ */
+typedef struct
+{
+	int offset;                 ///< file offset of the message holding the gamestate
+	int dataOffset;             ///< configstrings in demoIndex_t::data
+	int dataSize;
+} demoIndexGamestate_t;
+
+/**
+ * @struct demoIndexPoint_t
+ * @brief A place playback can continue from without reading the messages before it
+ */
+typedef struct
+{
+	int offset;                 ///< file offset of the next message to read
+	int numMessages;            ///< messages before offset
+	int serverTime;             ///< time of the newest snapshot
+	int serverCommandSequence;  ///< the configstrings include every command up to this one
+	int gamestate;              ///< gamestate whose baselines the snapshots delta from
+	int dataOffset;             ///< configstring changes and snapshots in demoIndex_t::data
+	int dataSize;
+} demoIndexPoint_t;
+
+/**
+ * @struct demoIndex_t
+ * @brief The seek index of a demo, read from the .idx file next to it
+ */
+typedef struct
+{
+	int snapsInDemo;            ///< messages read with a valid snapshot, like the demo pre-scan counts them
+	int firstServerTime;
+	int lastServerTime;
+	int numGamestates;
+	int numPoints;
+	demoIndexGamestate_t *gamestates;
+	demoIndexPoint_t *points;
+	byte *data;
+} demoIndex_t;
+
+/**
+ * @struct demoIndexSnapshot_t
+ * @brief A snapshot of a demo index point
+ */
+typedef struct
+{
+	int messageNum;
+	int serverTime;
+	int snapFlags;
+	int serverCommandNum;
+	byte areamask[MAX_MAP_AREA_BYTES];
+	playerState_t ps;
+	int firstEntity;            ///< into the entities given to Com_ReadDemoIndexPoint
+	int numEntities;
+} demoIndexSnapshot_t;
+
+qboolean Com_WriteDemoIndex(const char *demoName);
+demoIndex_t *Com_LoadDemoIndex(const char *demoName);
+void Com_FreeDemoIndex(demoIndex_t *index);
+int Com_FindDemoIndexPoint(const demoIndex_t *index, int serverTime, int demoOffset);
+qboolean Com_ReadDemoIndexPoint(const demoIndex_t *index, int num, entityState_t *baselines, gameState_t *gameState,
+                                demoIndexSnapshot_t *snapshots, int *numSnapshots, entityState_t *entities, int maxEntities);
+void Com_DemoIndex_f(void);
+
+// demo_writer.c
+
+typedef struct demoWriter_s demoWriter_t;
+
+demoWriter_t *Com_CreateDemoWriter(fileHandle_t file);
+void Com_DemoWriterWrite(demoWriter_t *writer, const void *head, int headLen, const void *data, int dataLen);
+int Com_DemoWriterOffset(const demoWriter_t *writer);
+void Com_DestroyDemoWriter(demoWriter_t *writer);
+
 #if defined(FEATURE_SSL)
 void Com_CheckCaCertStatus(void);
 #endif
@@ -1400,6 +1503,11 @@ void Sys_ShowIP(void);
 qboolean Sys_CheckCD(void);
 
 FILE *Sys_FOpen(const char *ospath, const char *mode);
+void *Sys_MapFile(const char *ospath, int *length);
+void Sys_UnmapFile(void *data, int length);
+sysSharedFile_t *Sys_OpenSharedFile(const char *ospath, int *length);
+int Sys_ReadSharedFile(sysSharedFile_t *file, int offset, void *buffer, int length);
+void Sys_CloseSharedFile(sysSharedFile_t *file);
 qboolean Sys_Mkdir(const char *path);
 
 #ifdef _WIN32
@@ -1549,16 +1657,37 @@ typedef struct
 	huff_t decompressor;
 } huffman_t;
 
+/**
+ * @def HUFF_LOOKUP_BITS
+ * @brief Codes up to this length are decoded with a single table lookup
+ */
+#define HUFF_LOOKUP_BITS    11
+
+/**
+ * @struct huffTables_t
+ * @brief Flat tables of a tree which doesn't adapt any more
+ *
+ * The first bit sent is bit 0 of the code, the same order the bits take in
+ * the message, so codes can be or'ed into a bit accumulator as they are.
+ */
+typedef struct
+{
+	unsigned int code[HMAX];                        ///< prefix code of the symbol
+	byte len[HMAX];                                 ///< length of the code in bits
+	unsigned short lookup[1 << HUFF_LOOKUP_BITS];   ///< next HUFF_LOOKUP_BITS bits -> len << 8 | symbol, 0 if the code is longer
+} huffTables_t;
+
 void Huff_Compress(msg_t *mbuf, int offset);
 void Huff_Decompress(msg_t *mbuf, int offset);
 void Huff_Init(huffman_t *huff);
 void Huff_addRef(huff_t *huff, byte ch);
-int Huff_Receive(node_t *node, int *ch, byte *fin);
-void Huff_transmit(huff_t *huff, int ch, byte *fout, int maxoffset);
+int Huff_Receive(node_t *node, int *ch, byte *fin, int *offset);
+void Huff_transmit(huff_t *huff, int ch, byte *fout, int *offset, int maxoffset);
 void Huff_offsetReceive(node_t *node, int *ch, byte *fin, int *offset, int maxoffset);
 void Huff_offsetTransmit(huff_t *huff, int ch, byte *fout, int *offset, int maxoffset);
 void Huff_putBit(int bit, byte *fout, int *offset);
 int Huff_getBit(byte *fin, int *offset);
+qboolean Huff_BuildTables(huff_t *compressor, huff_t *decompressor, huffTables_t *tables);
 
 extern huffman_t clientHuffTables;
 
@@ -1569,6 +1698,41 @@ extern huffman_t clientHuffTables;
 
 void Com_GetHunkInfo(int *hunkused, int *hunkexpected);
 
+/*
+==============================================================
+THREADS
+==============================================================
+*/
+
+typedef struct qthread_s qthread_t;
+typedef struct qmutex_s qmutex_t;
+typedef struct qcond_s qcond_t;
+typedef struct threadPool_s threadPool_t;
+
+typedef void (*threadJob_t)(void *data, int index);
+
+qthread_t *Com_CreateThread(void (*func)(void *arg), void *arg);
+void Com_JoinThread(qthread_t *thread);
+
+qmutex_t *Com_CreateMutex(void);
+void Com_DestroyMutex(qmutex_t *mutex);
+void Com_LockMutex(qmutex_t *mutex);
+void Com_UnlockMutex(qmutex_t *mutex);
+
+qcond_t *Com_CreateCond(void);
+void Com_DestroyCond(qcond_t *cond);
+void Com_WaitCond(qcond_t *cond, qmutex_t *mutex);
+void Com_SignalCond(qcond_t *cond);
+void Com_BroadcastCond(qcond_t *cond);
+
+int Com_AtomicGet(volatile int *value);
+void Com_AtomicSet(volatile int *value, int newValue);
+
+threadPool_t *Com_CreateThreadPool(int numThreads);
+void Com_DestroyThreadPool(threadPool_t *pool);
+int Com_ThreadPoolSize(threadPool_t *pool);
+void Com_ThreadPoolRun(threadPool_t *pool, threadJob_t job, void *data, int count);
+
 /*
 ==============================================================
 Native language support
@@ -0,0 +1,588 @@
+/*
+ * Wolfenstein: Enemy Territory GPL Source Code
+ * Copyright (C) 1999-2010 id Software LLC, a ZeniMax Media company.
+ *
+ * ET: Legacy
+ * Copyright (C) 2012-2023 ET:Legacy team <mail@etlegacy.com>
+ *
+ * This file is part of ET: Legacy - http://www.etlegacy.com
+ *
+ * ET: Legacy is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ET: Legacy is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ET: Legacy. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, Wolfenstein: Enemy Territory GPL Source Code is also
+ * subject to certain additional terms. You should have received a copy
+ * of these additional terms immediately following the terms and conditions
+ * of the GNU General Public License which accompanied the source code.
+ * If not, please request a copy in writing from id Software at the address below.
+ *
+ * id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+ */
+/**
+ * @file threads.c
+ * @brief Portable threads, locks and a small worker pool
+ *
+ * Nothing in here may call back into the engine (Com_Printf, Z_Malloc, ...)
+ * from a worker thread, the engine itself is not thread safe. Work that is
+ * handed to a pool must only touch data the caller has made private to it.
+ */
+
+#include "q_shared.h"
+#include "qcommon.h"
+
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <pthread.h>
+#endif
+
+/**
+ * @struct qthread_s
+ * @brief
+ */
+struct qthread_s
+{
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	pthread_t handle;
+#endif
+	void (*func)(void *arg);
+	void *arg;
+};
+
+/**
+ * @struct qmutex_s
+ * @brief
+ */
+struct qmutex_s
+{
+#ifdef _WIN32
+	CRITICAL_SECTION cs;
+#else
+	pthread_mutex_t mutex;
+#endif
+};
+
+/**
+ * @struct qcond_s
+ * @brief
+ */
+struct qcond_s
+{
+#ifdef _WIN32
+	CONDITION_VARIABLE cond;
+#else
+	pthread_cond_t cond;
+#endif
+};
+
+#ifdef _WIN32
+
+/**
+ * @brief Com_ThreadProc
+ * @param[in] arg
+ * @return
+ */
+static DWORD WINAPI Com_ThreadProc(LPVOID arg)
+{
+	qthread_t *thread = (qthread_t *)arg;
+
+	thread->func(thread->arg);
+	return 0;
+}
+
+#else
+
+/**
+ * @brief Com_ThreadProc
+ * @param[in] arg
+ * @return
+ */
+static void *Com_ThreadProc(void *arg)
+{
+	qthread_t *thread = (qthread_t *)arg;
+
+	thread->func(thread->arg);
+	return NULL;
+}
+
+#endif
+
+/**
+ * @brief Starts a new system thread running func(arg)
+ * @param[in] func
+ * @param[in] arg
+ * @return The thread handle or NULL if the thread could not be created
+ */
+qthread_t *Com_CreateThread(void (*func)(void *arg), void *arg)
+{
+	qthread_t *thread = (qthread_t *)Com_Allocate(sizeof(qthread_t));
+
+	if (!thread)
+	{
+		return NULL;
+	}
+
+	thread->func = func;
+	thread->arg  = arg;
+
+#ifdef _WIN32
+	thread->handle = CreateThread(NULL, 0, Com_ThreadProc, thread, 0, NULL);
+	if (thread->handle == NULL)
+#else
+	if (pthread_create(&thread->handle, NULL, Com_ThreadProc, thread) != 0)
+#endif
+	{
+		Com_Dealloc(thread);
+		return NULL;
+	}
+
+	return thread;
+}
+
+/**
+ * @brief Waits for the thread to return and releases the handle
+ * @param[in] thread
+ */
+void Com_JoinThread(qthread_t *thread)
+{
+	if (!thread)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+#else
+	pthread_join(thread->handle, NULL);
+#endif
+
+	Com_Dealloc(thread);
+}
+
+/**
+ * @brief Com_CreateMutex
+ * @return
+ */
+qmutex_t *Com_CreateMutex(void)
+{
+	qmutex_t *mutex = (qmutex_t *)Com_Allocate(sizeof(qmutex_t));
+
+	if (!mutex)
+	{
+		return NULL;
+	}
+
+#ifdef _WIN32
+	InitializeCriticalSection(&mutex->cs);
+#else
+	pthread_mutex_init(&mutex->mutex, NULL);
+#endif
+
+	return mutex;
+}
+
+/**
+ * @brief Com_DestroyMutex
+ * @param[in] mutex
+ */
+void Com_DestroyMutex(qmutex_t *mutex)
+{
+	if (!mutex)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	DeleteCriticalSection(&mutex->cs);
+#else
+	pthread_mutex_destroy(&mutex->mutex);
+#endif
+
+	Com_Dealloc(mutex);
+}
+
+/**
+ * @brief Com_LockMutex
+ * @param[in] mutex
+ */
+void Com_LockMutex(qmutex_t *mutex)
+{
+#ifdef _WIN32
+	EnterCriticalSection(&mutex->cs);
+#else
+	pthread_mutex_lock(&mutex->mutex);
+#endif
+}
+
+/**
+ * @brief Com_UnlockMutex
+ * @param[in] mutex
+ */
+void Com_UnlockMutex(qmutex_t *mutex)
+{
+#ifdef _WIN32
+	LeaveCriticalSection(&mutex->cs);
+#else
+	pthread_mutex_unlock(&mutex->mutex);
+#endif
+}
+
+/**
+ * @brief Com_CreateCond
+ * @return
+ */
+qcond_t *Com_CreateCond(void)
+{
+	qcond_t *cond = (qcond_t *)Com_Allocate(sizeof(qcond_t));
+
+	if (!cond)
+	{
+		return NULL;
+	}
+
+#ifdef _WIN32
+	InitializeConditionVariable(&cond->cond);
+#else
+	pthread_cond_init(&cond->cond, NULL);
+#endif
+
+	return cond;
+}
+
+/**
+ * @brief Com_DestroyCond
+ * @param[in] cond
+ */
+void Com_DestroyCond(qcond_t *cond)
+{
+	if (!cond)
+	{
+		return;
+	}
+
+#ifndef _WIN32
+	pthread_cond_destroy(&cond->cond);
+#endif
+
+	Com_Dealloc(cond);
+}
+
+/**
+ * @brief Atomically releases the (locked) mutex and waits for the condition to be signalled
+ * @param[in] cond
+ * @param[in] mutex
+ */
+void Com_WaitCond(qcond_t *cond, qmutex_t *mutex)
+{
+#ifdef _WIN32
+	SleepConditionVariableCS(&cond->cond, &mutex->cs, INFINITE);
+#else
+	pthread_cond_wait(&cond->cond, &mutex->mutex);
+#endif
+}
+
+/**
+ * @brief Wakes up one thread waiting on the condition
+ * @param[in] cond
+ */
+void Com_SignalCond(qcond_t *cond)
+{
+#ifdef _WIN32
+	WakeConditionVariable(&cond->cond);
+#else
+	pthread_cond_signal(&cond->cond);
+#endif
+}
+
+/**
+ * @brief Wakes up all threads waiting on the condition
+ * @param[in] cond
+ */
+void Com_BroadcastCond(qcond_t *cond)
+{
+#ifdef _WIN32
+	WakeAllConditionVariable(&cond->cond);
+#else
+	pthread_cond_broadcast(&cond->cond);
+#endif
+}
+
+/**
+ * @brief Reads a value shared with another thread, later reads can't be moved before it
+ * @param[in] value
+ * @return
+ */
+int Com_AtomicGet(volatile int *value)
+{
+#ifdef _WIN32
+	return InterlockedCompareExchange((volatile LONG *)value, 0, 0);
+#else
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+/**
+ * @brief Publishes a value to another thread, earlier writes are visible once it is seen
+ * @param[out] value
+ * @param[in] newValue
+ */
+void Com_AtomicSet(volatile int *value, int newValue)
+{
+#ifdef _WIN32
+	InterlockedExchange((volatile LONG *)value, newValue);
+#else
+	__atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+#endif
+}
+
+/*
+=============================================================================
+Worker pool
+
+A fixed set of threads which execute "parallel for" batches. The calling
+thread takes part in every batch, so a pool of N threads runs N + 1 jobs
+at a time, and Com_ThreadPoolRun only returns once all indices are done.
+=============================================================================
+*/
+
+/**
+ * @struct threadPool_s
+ * @brief
+ */
+struct threadPool_s
+{
+	qmutex_t *lock;
+	qcond_t *wake;                  ///< signalled when a new batch is posted
+	qcond_t *done;                  ///< signalled when the last worker leaves a batch
+
+	int numThreads;
+	qthread_t **threads;
+
+	threadJob_t job;
+	void *data;
+	int count;
+	int next;                       ///< next index to hand out
+	int busy;                       ///< workers still inside the current batch
+	int batch;                      ///< incremented for every posted batch
+	qboolean quit;
+};
+
+/**
+ * @brief Hands out the indices of the current batch until there are none left
+ * @param[in] pool
+ * @param[in] job
+ * @param[in] data
+ * @param[in] count
+ *
+ * @note The pool lock must be held, it is released while a job runs
+ */
+static void Com_ThreadPoolDrain(threadPool_t *pool, threadJob_t job, void *data, int count)
+{
+	int index;
+
+	while (pool->next < count)
+	{
+		index = pool->next++;
+
+		Com_UnlockMutex(pool->lock);
+		job(data, index);
+		Com_LockMutex(pool->lock);
+	}
+}
+
+/**
+ * @brief Com_ThreadPoolWorker
+ * @param[in] arg
+ */
+static void Com_ThreadPoolWorker(void *arg)
+{
+	threadPool_t *pool  = (threadPool_t *)arg;
+	int          batch  = 0;
+
+	Com_LockMutex(pool->lock);
+
+	while (1)
+	{
+		while (!pool->quit && pool->batch == batch)
+		{
+			Com_WaitCond(pool->wake, pool->lock);
+		}
+
+		if (pool->quit)
+		{
+			break;
+		}
+
+		batch = pool->batch;
+
+		Com_ThreadPoolDrain(pool, pool->job, pool->data, pool->count);
+
+		if (--pool->busy == 0)
+		{
+			Com_SignalCond(pool->done);
+		}
+	}
+
+	Com_UnlockMutex(pool->lock);
+}
+
+/**
+ * @brief Starts a pool of worker threads
+ * @param[in] numThreads
+ * @return The pool or NULL if no thread could be started
+ */
+threadPool_t *Com_CreateThreadPool(int numThreads)
+{
+	threadPool_t *pool;
+	int          i;
+
+	if (numThreads <= 0)
+	{
+		return NULL;
+	}
+
+	pool = (threadPool_t *)Com_Allocate(sizeof(threadPool_t));
+	if (!pool)
+	{
+		return NULL;
+	}
+	Com_Memset(pool, 0, sizeof(threadPool_t));
+
+	pool->lock    = Com_CreateMutex();
+	pool->wake    = Com_CreateCond();
+	pool->done    = Com_CreateCond();
+	pool->threads = (qthread_t **)Com_Allocate(numThreads * sizeof(qthread_t *));
+
+	if (!pool->lock || !pool->wake || !pool->done || !pool->threads)
+	{
+		Com_DestroyThreadPool(pool);
+		return NULL;
+	}
+
+	for (i = 0; i < numThreads; i++)
+	{
+		pool->threads[i] = Com_CreateThread(Com_ThreadPoolWorker, pool);
+		if (!pool->threads[i])
+		{
+			break;
+		}
+		pool->numThreads++;
+	}
+
+	if (!pool->numThreads)
+	{
+		Com_DestroyThreadPool(pool);
+		return NULL;
+	}
+
+	return pool;
+}
+
+/**
+ * @brief Stops and joins all workers of the pool
+ * @param[in] pool
+ */
+void Com_DestroyThreadPool(threadPool_t *pool)
+{
+	int i;
+
+	if (!pool)
+	{
+		return;
+	}
+
+	if (pool->lock)
+	{
+		Com_LockMutex(pool->lock);
+		pool->quit = qtrue;
+		if (pool->wake)
+		{
+			Com_BroadcastCond(pool->wake);
+		}
+		Com_UnlockMutex(pool->lock);
+	}
+
+	for (i = 0; i < pool->numThreads; i++)
+	{
+		Com_JoinThread(pool->threads[i]);
+	}
+
+	if (pool->threads)
+	{
+		Com_Dealloc(pool->threads);
+	}
+
+	Com_DestroyCond(pool->done);
+	Com_DestroyCond(pool->wake);
+	Com_DestroyMutex(pool->lock);
+	Com_Dealloc(pool);
+}
+
+/**
+ * @brief Com_ThreadPoolSize
+ * @param[in] pool
+ * @return Number of worker threads, not counting the calling thread
+ */
+int Com_ThreadPoolSize(threadPool_t *pool)
+{
+	return pool ? pool->numThreads : 0;
+}
+
+/**
+ * @brief Runs job(data, index) for every index in [0, count) and returns when all are done
+ * @param[in] pool may be NULL, the jobs then run on the calling thread
+ * @param[in] job
+ * @param[in] data
+ * @param[in] count
+ */
+void Com_ThreadPoolRun(threadPool_t *pool, threadJob_t job, void *data, int count)
+{
+	int i;
+
+	if (count <= 0)
+	{
+		return;
+	}
+
+	if (!pool || count == 1)
+	{
+		for (i = 0; i < count; i++)
+		{
+			job(data, i);
+		}
+		return;
+	}
+
+	Com_LockMutex(pool->lock);
+
+	pool->job   = job;
+	pool->data  = data;
+	pool->count = count;
+	pool->next  = 0;
+	pool->busy  = pool->numThreads;
+	pool->batch++;
+
+	Com_BroadcastCond(pool->wake);
+
+	Com_ThreadPoolDrain(pool, job, data, count);
+
+	while (pool->busy > 0)
+	{
+		Com_WaitCond(pool->done, pool->lock);
+	}
+
+	Com_UnlockMutex(pool->lock);
+}
@@ -1195,6 +1195,7 @@ void R_Register(void)
 	// removed in R_Shutdown
 	ri.Cmd_AddSystemCommand("imagelist", R_ImageList_f, "Print out the list of images loaded", NULL);
 	ri.Cmd_AddSystemCommand("shaderlist", R_ShaderList_f, "Print out the list of shaders loaded", NULL);
+	ri.Cmd_AddSystemCommand("shaderbench", R_ShaderBench_f, "Time the shader script lookups of every label and as many misses", NULL);
 	ri.Cmd_AddSystemCommand("skinlist", R_SkinList_f, "Print out the list of skins", NULL);
 	ri.Cmd_AddSystemCommand("modellist", R_Modellist_f, "Print out the list of loaded models", NULL);
 	ri.Cmd_AddSystemCommand("screenshot", R_ScreenShot_f, "Take a screenshot of current frame", NULL);
@@ -1313,6 +1314,7 @@ void RE_Shutdown(qboolean destroyWindow)
 
 	ri.Cmd_RemoveSystemCommand("imagelist");
 	ri.Cmd_RemoveSystemCommand("shaderlist");
+	ri.Cmd_RemoveSystemCommand("shaderbench");
 	ri.Cmd_RemoveSystemCommand("skinlist");
 	ri.Cmd_RemoveSystemCommand("modellist");
 	ri.Cmd_RemoveSystemCommand("screenshot");
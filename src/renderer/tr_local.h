@@ -1614,6 +1614,7 @@ shader_t *R_GetShaderByHandle(qhandle_t hShader);
 shader_t *R_FindShaderByName(const char *name);
 void R_InitShaders(void);
 void R_ShaderList_f(void);
+void R_ShaderBench_f(void);
 void R_RemapShader(const char *shaderName, const char *newShaderName, const char *timeOffset);
 
 qboolean RE_LoadDynamicShader(const char *shadername, const char *shadertext);
@@ -4147,6 +4147,7 @@ shader_t *R_GetShaderByState(int index, long *cycleTime);
 shader_t *R_FindShaderByName(const char *name);
 void R_InitShaders(void);
 void R_ShaderList_f(void);
+void R_ShaderBench_f(void);
 void R_ShaderExp_f(void);
 void R_RemapShader(const char *shaderName, const char *newShaderName, const char *timeOffset);
 
@@ -5327,8 +5327,8 @@ qboolean RE_LoadDynamicShader(const char *shadername, const char *shadertext)
 //========================================================================================
 
 /**
- * @brief Scans the combined text description of all the shader files for
- * the given shader name.
+ * @brief Looks up the given shader name in the combined text description of
+ * all the shader files.
  * @param[in] shaderName
  * @return NULL if not found, otherwise it will return a valid shader
  */
@@ -5367,12 +5367,14 @@ static char *FindShaderInShaderText(const char *shaderName)
 		}
 	}
 
+	// ScanAndLoadShaderFiles hashes every shader and guided shader name of
+	// the text, so if the name isn't in its slot it mustn't exist
 	hash = generateHashValue(shaderName, MAX_SHADERTEXT_HASH);
 
 	for (i = 0; shaderTextHashTable[hash][i]; i++)
 	{
 		p     = shaderTextHashTable[hash][i];
-		token = COM_ParseExt2(&p, qtrue);
+		token = COM_ParseExt(&p, qtrue);
 		if (!Q_stricmp(token, shaderName))
 		{
 			//Ren_Print("found shader '%s' by hashing\n", shaderName);
@@ -5380,84 +5382,6 @@ static char *FindShaderInShaderText(const char *shaderName)
 		}
 	}
 
-	p = s_shaderText;
-
-	if (!p)
-	{
-		return NULL;
-	}
-
-	// look for label
-	while (1)
-	{
-		token = COM_ParseExt2(&p, qtrue);
-		if (token[0] == 0)
-		{
-			break;
-		}
-
-		if (!Q_stricmp(token, shaderName))
-		{
-			//Ren_Print("found shader '%s' by linear search\n", shaderName);
-			return p;
-		}
-		// skip shader tables
-		else if (!Q_stricmp(token, "table"))
-		{
-			// skip table name
-			(void) COM_ParseExt2(&p, qtrue);
-
-			SkipBracedSection(&p);
-		}
-		// support shader templates
-		else if (!Q_stricmp(token, "guide"))
-		{
-			// parse shader name
-			token = COM_ParseExt2(&p, qtrue);
-
-			if (!Q_stricmp(token, shaderName))
-			{
-				Ren_Print("found shader '%s' by linear search\n", shaderName);
-				return p;
-			}
-
-			// skip guide name
-			token = COM_ParseExt2(&p, qtrue);
-
-			// skip parameters
-			token = COM_ParseExt2(&p, qtrue);
-			if (Q_stricmp(token, "("))
-			{
-				break;
-			}
-
-			while (1)
-			{
-				token = COM_ParseExt2(&p, qtrue);
-
-				if (!token[0])
-				{
-					break;
-				}
-
-				if (!Q_stricmp(token, ")"))
-				{
-					break;
-				}
-			}
-
-			if (Q_stricmp(token, ")"))
-			{
-				break;
-			}
-		}
-		else
-		{
-			// skip the shader body
-			SkipBracedSection(&p);
-		}
-	}
-
 	return NULL;
 }
 
@@ -5990,6 +5914,83 @@ shader_t *R_GetShaderByHandle(qhandle_t hShader)
 	return tr.shaders[hShader];
 }
 
+/**
+ * @brief Times looking up every shader and guided shader name of the scripts,
+ * plus a name which isn't in them for each one, the way registering a map's shaders does
+ *
+ * @note Usage: shaderbench [passes]
+ */
+void R_ShaderBench_f(void)
+{
+	char *p, *token, *names, *name;
+	int  i, j, len, passes, numLabels = 0, size = 0, lost = 0, found = 0, start, msec;
+
+	passes = ri.Cmd_Argc() > 1 ? MAX(Q_atoi(ri.Cmd_Argv(1)), 1) : 10;
+
+	for (i = 0 ; i < MAX_SHADERTEXT_HASH ; i++)
+	{
+		for (j = 0 ; shaderTextHashTable[i] && shaderTextHashTable[i][j] ; j++)
+		{
+			p     = shaderTextHashTable[i][j];
+			size += 2 * strlen(COM_ParseExt(&p, qtrue)) + sizeof("_miss") + 1;
+			numLabels++;
+		}
+	}
+
+	if (!numLabels)
+	{
+		Ren_Print("No shader scripts loaded\n");
+		return;
+	}
+
+	// copy each label and its miss out, the lookups parse into the same token buffer
+	names = name = ri.Z_Malloc(size);
+	for (i = 0 ; i < MAX_SHADERTEXT_HASH ; i++)
+	{
+		for (j = 0 ; shaderTextHashTable[i] && shaderTextHashTable[i][j] ; j++)
+		{
+			p     = shaderTextHashTable[i][j];
+			token = COM_ParseExt(&p, qtrue);
+			len   = strlen(token);
+			Q_strncpyz(name, token, len + 1);
+			Com_sprintf(name + len + 1, len + sizeof("_miss"), "%s_miss", name);
+			name += 2 * len + sizeof("_miss") + 1;
+		}
+	}
+
+	for (name = names, j = 0 ; j < 2 * numLabels ; j++, name += strlen(name) + 1)
+	{
+		if (j & 1)
+		{
+			found += FindShaderInShaderText(name) != NULL;
+		}
+		else
+		{
+			lost += FindShaderInShaderText(name) == NULL;
+		}
+	}
+
+	start = ri.Milliseconds();
+	for (i = 0 ; i < passes ; i++)
+	{
+		for (name = names, j = 0 ; j < 2 * numLabels ; j++, name += strlen(name) + 1)
+		{
+			FindShaderInShaderText(name);
+		}
+	}
+	msec = ri.Milliseconds() - start;
+
+	Ren_Print("%i labels and as many misses, %i passes: %i msec, %.3f usec per lookup\n",
+	          numLabels, passes, msec, msec * 1000.0 / (2.0 * numLabels * passes));
+
+	if (lost || found)
+	{
+		Ren_Warning("WARNING: %i labels not found, %i misses found\n", lost, found);
+	}
+
+	ri.Free(names);
+}
+
 /**
  * @brief Dump information on all valid shaders to the console
  * A second parameter will cause it to print in sorted order
@@ -6637,8 +6638,8 @@ static int ScanAndLoadShaderFiles(void)
 		// support shader templates
 		else if (!Q_stricmp(token, "guide"))
 		{
-			// parse shader name
-			token = COM_ParseExt2(&p, qtrue);
+			// parse shader name, tokenized like FindShaderInShaderText reads it back
+			token = COM_ParseExt(&p, qtrue);
 			//Ren_Print("...guided '%s'\n", token);
 
 			hash = generateHashValue(token, MAX_SHADERTEXT_HASH);
@@ -6727,6 +6728,7 @@ static int ScanAndLoadShaderFiles(void)
 			token = COM_ParseExt2(&p, qtrue);
 
 			Q_strncpyz(table.name, token, sizeof(table.name));
+			oldp = p;
 
 			// check if already created
 			alreadyCreated = qfalse;
@@ -6784,13 +6786,18 @@ static int ScanAndLoadShaderFiles(void)
 				Ren_Developer("...generating '%s'\n", table.name);
 				GeneratePermanentShaderTable(values, numValues);
 			}
+
+			// continue behind the table exactly like the counting pass did,
+			// a truncated table must not shift the following names
+			p = oldp;
+			SkipBracedSection(&p);
 		}
 		// support shader templates
 		else if (!Q_stricmp(token, "guide"))
 		{
 			// parse shader name
 			oldp  = p;
-			token = COM_ParseExt2(&p, qtrue);
+			token = COM_ParseExt(&p, qtrue);
 
 			//Ren_Print("...guided '%s'\n", token);
 
@@ -57,6 +57,9 @@ static shader_t *hashTable[FILE_HASH_SIZE];
  *
  * @brief Table containing string indexes for each shader found in the scripts,
  * referenced by their checksum values.
+ *
+ * @note Every label of s_shaderText is in here, so a name which isn't in
+ * its chain isn't in the scripts at all.
  */
 typedef struct shaderStringPointer_s
 {
@@ -64,7 +67,7 @@ typedef struct shaderStringPointer_s
 	struct shaderStringPointer_s *next;
 } shaderStringPointer_t;
 
-shaderStringPointer_t shaderChecksumLookup[FILE_HASH_SIZE];
+static shaderStringPointer_t *shaderChecksumLookup[FILE_HASH_SIZE];
 
 /**
  * @brief R_RemapShader
@@ -3074,8 +3077,8 @@ qboolean RE_LoadDynamicShader(const char *shadername, const char *shadertext)
 }
 
 /**
- * @brief Scans the combined text description of all the shader files for
- * the given shader name.
+ * @brief Looks up the given shader name in the combined text description of
+ * all the shader files.
  *
  * @param[in] shadername
  *
@@ -3083,8 +3086,9 @@ qboolean RE_LoadDynamicShader(const char *shadername, const char *shadertext)
  */
 static char *FindShaderInShaderText(const char *shadername)
 {
-	char *p = s_shaderText;
-	char *token;
+	char                  *p = s_shaderText;
+	char                  *token;
+	shaderStringPointer_t *pShaderString;
 #ifdef SH_LOADTIMING
 	static int total = 0;
 
@@ -3130,52 +3134,15 @@ static char *FindShaderInShaderText(const char *shadername)
 		}
 	}
 
-	// optimized shader loading
-	if (r_cacheShaders->integer)
+	// the lookup holds every label of the scripts, so if the name isn't in
+	// its chain it mustn't exist
+	for (pShaderString = shaderChecksumLookup[generateHashValue(shadername)]; pShaderString; pShaderString = pShaderString->next)
 	{
-		/*if (strstr( shadername, "/" ) && !strstr( shadername, "." ))*/ {
-			unsigned short int    checksum;
-			shaderStringPointer_t *pShaderString;
-
-			checksum = generateHashValue(shadername);
-
-			// if it's known, skip straight to it's position
-			pShaderString = &shaderChecksumLookup[checksum];
-			while (pShaderString && pShaderString->pStr)
-			{
-				p = pShaderString->pStr;
-
-				token = COM_ParseExt(&p, qtrue);
+		p = pShaderString->pStr;
 
-				if ((token[0] != 0) && !Q_stricmp(token, shadername))
-				{
-#ifdef SH_LOADTIMING
-					total += Sys_Milliseconds() - start;
-					Ren_Print("Shader lookup: %i, total: %i\n", Sys_Milliseconds() - start, total);
-#endif // _DEBUG
-					return p;
-				}
-
-				pShaderString = pShaderString->next;
-			}
-
-			// it's not even in our list, so it mustn't exist
-			return NULL;
-		}
-	}
-
-	// look for label
-	// note that this could get confused if a shader name is used inside
-	// another shader definition
-	while (1)
-	{
 		token = COM_ParseExt(&p, qtrue);
-		if (token[0] == 0)
-		{
-			break;
-		}
 
-		if (!Q_stricmp(token, shadername))
+		if ((token[0] != 0) && !Q_stricmp(token, shadername))
 		{
 #ifdef SH_LOADTIMING
 			total += Sys_Milliseconds() - start;
@@ -3183,8 +3150,6 @@ static char *FindShaderInShaderText(const char *shadername)
 #endif // _DEBUG
 			return p;
 		}
-
-		SkipBracedSection(&p);
 	}
 
 #ifdef SH_LOADTIMING
@@ -3745,30 +3710,132 @@ void R_ShaderList_f(void)
 	Ren_Print("------------------\n");
 }
 
-// optimized shader loading
+/**
+ * @brief Times looking up every label of the shader scripts, plus a name
+ * which isn't in them for each one, the way registering a map's shaders does
+ *
+ * @note Usage: shaderbench [passes]
+ */
+void R_ShaderBench_f(void)
+{
+	shaderStringPointer_t *pShaderString;
+	char                  *p, *token, *names, *name;
+	int                   i, j, len, passes, numLabels = 0, size = 0, lost = 0, found = 0, start, msec;
+
+	passes = ri.Cmd_Argc() > 1 ? MAX(Q_atoi(ri.Cmd_Argv(1)), 1) : 10;
 
-#define MAX_SHADER_STRING_POINTERS  100000
-shaderStringPointer_t shaderStringPointerList[MAX_SHADER_STRING_POINTERS];
+	for (i = 0 ; i < FILE_HASH_SIZE ; i++)
+	{
+		for (pShaderString = shaderChecksumLookup[i] ; pShaderString ; pShaderString = pShaderString->next)
+		{
+			p     = pShaderString->pStr;
+			size += 2 * strlen(COM_ParseExt(&p, qtrue)) + sizeof("_miss") + 1;
+			numLabels++;
+		}
+	}
+
+	if (!numLabels)
+	{
+		Ren_Print("No shader scripts loaded\n");
+		return;
+	}
+
+	// copy each label and its miss out, the lookups parse into the same token buffer
+	names = name = ri.Z_Malloc(size);
+	for (i = 0 ; i < FILE_HASH_SIZE ; i++)
+	{
+		for (pShaderString = shaderChecksumLookup[i] ; pShaderString ; pShaderString = pShaderString->next)
+		{
+			p     = pShaderString->pStr;
+			token = COM_ParseExt(&p, qtrue);
+			len   = strlen(token);
+			Q_strncpyz(name, token, len + 1);
+			Com_sprintf(name + len + 1, len + sizeof("_miss"), "%s_miss", name);
+			name += 2 * len + sizeof("_miss") + 1;
+		}
+	}
+
+	for (name = names, j = 0 ; j < 2 * numLabels ; j++, name += strlen(name) + 1)
+	{
+		if (j & 1)
+		{
+			found += FindShaderInShaderText(name) != NULL;
+		}
+		else
+		{
+			lost += FindShaderInShaderText(name) == NULL;
+		}
+	}
+
+	start = ri.Milliseconds();
+	for (i = 0 ; i < passes ; i++)
+	{
+		for (name = names, j = 0 ; j < 2 * numLabels ; j++, name += strlen(name) + 1)
+		{
+			FindShaderInShaderText(name);
+		}
+	}
+	msec = ri.Milliseconds() - start;
+
+	Ren_Print("%i labels and as many misses, %i passes: %i msec, %.3f usec per lookup\n",
+	          numLabels, passes, msec, msec * 1000.0 / (2.0 * numLabels * passes));
+
+	if (lost || found)
+	{
+		Ren_Warning("WARNING: %i labels not found, %i misses found\n", lost, found);
+	}
+
+	ri.Free(names);
+}
 
 /**
- * @brief BuildShaderChecksumLookup
+ * @brief Hashes every label of s_shaderText, so FindShaderInShaderText never
+ * has to fall back to scanning the text.
+ *
+ * @note The labels are walked exactly the way FindShaderInShaderText reads
+ * them back, the first walk only counts them to size the hunk allocation.
  */
 static void BuildShaderChecksumLookup(void)
 {
-	char               *p = s_shaderText, *pOld;
-	char               *token;
-	unsigned short int checksum;
-	int                numShaderStringPointers = 0;
+	char                  *p, *pOld;
+	char                  *token;
+	unsigned short int    checksum;
+	int                   numShaderStringPointers = 0;
+	shaderStringPointer_t *pShaderString;
 
 	// initialize the checksums
 	Com_Memset(shaderChecksumLookup, 0, sizeof(shaderChecksumLookup));
 
-	if (!p)
+	if (!s_shaderText)
 	{
 		return;
 	}
 
+	// count all labels
+	p = s_shaderText;
+	while (1)
+	{
+		token = COM_ParseExt(&p, qtrue);
+		if (!*token)
+		{
+			break;
+		}
+
+		numShaderStringPointers++;
+
+		// skip the actual shader section
+		SkipBracedSection(&p);
+	}
+
+	if (!numShaderStringPointers)
+	{
+		return;
+	}
+
+	pShaderString = ri.Hunk_Alloc(numShaderStringPointers * sizeof(shaderStringPointer_t), h_low);
+
 	// loop for all labels
+	p = s_shaderText;
 	while (1)
 	{
 		pOld = p;
@@ -3784,26 +3851,25 @@ static void BuildShaderChecksumLookup(void)
 
 		//Ren_Print("Shader Found: %s\n", token );
 
-		// if it's not currently used
-		if (!shaderChecksumLookup[checksum].pStr)
+		// append, so the first definition of a name is still the one found
+		pShaderString->pStr = pOld;
+		pShaderString->next = NULL;
+
+		if (!shaderChecksumLookup[checksum])
 		{
-			shaderChecksumLookup[checksum].pStr = pOld;
+			shaderChecksumLookup[checksum] = pShaderString;
 		}
 		else
 		{
-			// create a new list item
-			shaderStringPointer_t *newStrPtr;
+			shaderStringPointer_t *last = shaderChecksumLookup[checksum];
 
-			if (numShaderStringPointers >= MAX_SHADER_STRING_POINTERS)
+			while (last->next)
 			{
-				Ren_Drop("MAX_SHADER_STRING_POINTERS exceeded, too many shaders");
+				last = last->next;
 			}
-
-			newStrPtr                           = &shaderStringPointerList[numShaderStringPointers++]; //ri.Hunk_Alloc( sizeof( shaderStringPointer_t ), h_low );
-			newStrPtr->pStr                     = pOld;
-			newStrPtr->next                     = shaderChecksumLookup[checksum].next;
-			shaderChecksumLookup[checksum].next = newStrPtr;
+			last->next = pShaderString;
 		}
+		pShaderString++;
 
 		// skip the actual shader section
 		SkipBracedSection(&p);
@@ -3879,10 +3945,7 @@ static void ScanAndLoadShaderFiles(void)
 	ri.FS_FreeFileList(shaderFiles);
 
 	// optimized shader loading (18ms on a P3-500 for sfm1.bsp)
-	if (r_cacheShaders->integer)
-	{
-		BuildShaderChecksumLookup();
-	}
+	BuildShaderChecksumLookup();
 }
 
 /**
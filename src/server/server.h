@@ -75,8 +75,13 @@ typedef struct svEntity_s
 	int clusternums[MAX_ENT_CLUSTERS];
 	int lastCluster;                    ///< if all the clusters don't fit in clusternums
 	int areanum, areanum2;
-	int snapshotCounter;                ///< used to prevent double adding from portal views
 	int originCluster;                  ///< calced upon linking, for origin only bmodel vis checks
+
+	entityState_t snapshotState;        ///< the state as of the last SV_BuildSnapshotCandidates
+	int snapshotStateId;                ///< changes along with snapshotState, 0 before the first one
+	int snapshotPrevStateId;            ///< id of the state snapshotState replaced
+	unsigned int snapshotChanges[ENTITY_CHANGE_WORDS]; ///< fields which differ between those two states
+	int snapshotStateBuild;             ///< SV_BuildSnapshotCandidates call that checked snapshotState
 } svEntity_t;
 
 /**
@@ -113,7 +118,6 @@ typedef struct
 	int checksumFeed;                   ///< the feed key that we use to compute the pure checksum strings
 	/// the serverId associated with the current checksumFeed (always <= serverId)
 	int checksumFeedServerId;
-	int snapshotCounter;                ///< incremented for each snapshot built
 	int timeResidual;                   ///< <= 1000 / sv_frame->value
 	int nextFrameTime;                  ///< when time > nextFrameTime, process world
 	char *configstrings[MAX_CONFIGSTRINGS];
@@ -153,6 +157,7 @@ typedef struct
 
 	// serverside demo recording
 	fileHandle_t demoFile;
+	demoWriter_t *demoWriter;               ///< queues the messages of the demo being recorded
 	demoState_t demoState;
 	char demoName[MAX_QPATH];
 
@@ -195,6 +200,18 @@ typedef enum
 	CS_ACTIVE       ///< client is fully in game
 } clientState_t;
 
+/**
+ * @struct svDownloadView_t
+ * @brief A file opened once and shared by all the clients downloading it over UDP
+ */
+typedef struct
+{
+	char name[MAX_QPATH];
+	sysSharedFile_t *file;
+	int size;
+	int refCount;                       ///< clients reading from the view, closed at 0
+} svDownloadView_t;
+
 /**
  * @struct netchan_buffer_s
  * @typedef netchan_buffer_t
@@ -248,6 +265,7 @@ typedef struct client_s
 	int downloadClientBlock;                ///< last block we sent to the client, awaiting ack
 	int downloadCurrentBlock;               ///< current block number
 	int downloadXmitBlock;                  ///< last block we xmited
+	svDownloadView_t *downloadView;         ///< shared view of the file, the blocks are read from it instead of download
 	unsigned char *downloadBlocks[MAX_DOWNLOAD_WINDOW];     ///< the buffers for the download blocks
 	int downloadBlockSize[MAX_DOWNLOAD_WINDOW];
 	qboolean downloadEOF;                   ///< We have sent the EOF block
@@ -387,6 +405,7 @@ typedef struct
 	int numSnapshotEntities;                    ///< sv_maxclients->integer*PACKET_BACKUP*MAX_PACKET_ENTITIES
 	int nextSnapshotEntities;                   ///< next snapshotEntities to use
 	entityState_t *snapshotEntities;            ///< [numSnapshotEntities]
+	int *snapshotEntityStates;                  ///< [numSnapshotEntities] svEntity_t::snapshotStateId of each, 0 if unknown
 	int nextHeartbeatTime;
 	challenge_t challenges[MAX_CHALLENGES];     ///< to prevent invalid IPs from connecting
 	receipt_t infoReceipts[MAX_INFO_RECEIPTS];
@@ -479,6 +498,8 @@ extern cvar_t *sv_wh_active;
 extern cvar_t *sv_wh_bbox_horz;
 extern cvar_t *sv_wh_bbox_vert;
 extern cvar_t *sv_wh_check_fov;
+extern cvar_t *sv_wh_cache;
+extern cvar_t *sv_wh_threads;
 #endif
 
 // server side demo recording
@@ -487,11 +508,15 @@ extern cvar_t *sv_demoState;
 extern cvar_t *sv_autoDemo;
 extern cvar_t *sv_freezeDemo;
 extern cvar_t *sv_demoTolerant;
+extern cvar_t *sv_demoKeyframe;
 
 extern cvar_t *sv_ipMaxClients; ///< limit client connection
 
 extern cvar_t *sv_serverTimeReset;
 
+extern cvar_t *sv_snapshotThreads;
+extern cvar_t *sv_snapshotThreadsCheck;
+
 //===========================================================
 
 // sv_demo.c
@@ -587,8 +612,17 @@ void SV_DropClient(client_t *drop, const char *reason);
 void SV_ExecuteClientCommand(client_t *cl, const char *s, qboolean clientOK, qboolean premaprestart);
 void SV_ClientThink(client_t *cl, usercmd_t *cmd);
 int SV_SendDownloadMessages(void);
+void SV_ShutdownDownloads(void);
 int SV_SendQueuedMessages(void);
 
+#ifdef DEDICATED
+// sv_http.c
+void SV_HTTP_Init(void);
+void SV_HTTP_Update(void);
+void SV_HTTP_Shutdown(void);
+const char *SV_HTTP_BaseURL(void);
+#endif
+
 // sv_ccmds.c
 void SV_Heartbeat_f(void);
 qboolean SV_TempBanIsBanned(netadr_t address);
@@ -603,6 +637,8 @@ void SV_SendClientMessages(void);
 void SV_SendClientSnapshot(client_t *client);
 void SV_CheckClientUserinfoTimer(void);
 void SV_SendClientIdle(client_t *client);
+void SV_ShutdownSnapshotThreads(void);
+qboolean SV_EntityClustersInPVS(svEntity_t *svEnt, const byte *bitvector);
 
 // sv_game.c
 int SV_NumForGentity(sharedEntity_t *ent);
@@ -631,9 +667,12 @@ void BotImport_DebugPolygonDelete(int id);
 #ifdef FEATURE_ANTICHEAT
 void SV_RandomizePos(int player, int other);
 void SV_InitWallhack(void);
+void SV_ShutdownWallhack(void);
 void SV_RestorePos(int cli);
+void SV_WallhackFrame(void);
 int SV_CanSee(int player, int other);
 int SV_PositionChanged(int cli);
+void SV_WallhackStats_f(void);
 #endif
 
 //============================================================
@@ -657,6 +696,7 @@ void SV_LinkEntity(sharedEntity_t *gEnt);
 clipHandle_t SV_ClipHandleForEntity(const sharedEntity_t *ent);
 
 void SV_SectorList_f(void);
+void SV_SectorBench_f(void);
 
 int SV_AreaEntities(const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount);
 // fills in a table of entity numbers with entities that have bounding boxes
@@ -369,7 +369,7 @@ static void SV_MapRestart_f(void)
 		}
 
 		// Player won't enter the world until the download is done
-		if (client->download == 0 && client->bWWWing == qfalse)
+		if (client->download == 0 && !client->downloadView && client->bWWWing == qfalse)
 		{
 			if (client->state == CS_ACTIVE)
 			{
@@ -706,6 +706,7 @@ void SV_AddOperatorCommands(void)
 	Cmd_AddCommand("map_restart", SV_MapRestart_f, "Restarts given map.");
 	Cmd_AddCommand("fieldinfo", SV_FieldInfo_f, "Prints field info.");
 	Cmd_AddCommand("sectorlist", SV_SectorList_f, "Prints sector list.");
+	Cmd_AddCommand("sectorbench", SV_SectorBench_f, "Records area queries and replays them against the sector tree.");
 	Cmd_AddCommand("gameCompleteStatus", SV_GameCompleteStatus_f, "Sends a game complete status message to all master servers.");
 	Cmd_AddCommand("map", SV_Map_f, "Loads a specific map.", SV_CompleteMapName);
 	Cmd_AddCommand("devmap", SV_Map_f, "Loads a specific map in developer mode.", SV_CompleteMapName);
@@ -717,6 +718,10 @@ void SV_AddOperatorCommands(void)
 
 	Cmd_AddCommand("uptime", SV_Uptime_f, "Prints uptime info.");
 
+#ifdef FEATURE_ANTICHEAT
+	Cmd_AddCommand("sv_wh_stats", SV_WallhackStats_f, "Prints the anti-wallhack visibility counters.");
+#endif
+
 #if defined(FEATURE_IRC_SERVER) && defined(DEDICATED)
 	Cmd_AddCommand("irc_connect", IRC_Connect, "Connects to an IRC server.");
 	Cmd_AddCommand("irc_disconnect", IRC_InitiateShutdown, "Disconnects from an IRC seerver.");
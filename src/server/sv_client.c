@@ -37,6 +37,8 @@
 
 static void SV_CloseDownload(client_t *cl);
 
+static svDownloadView_t svDownloadViews[MAX_CLIENTS];   ///< a client downloads one file at a time
+
 /**
  * @brief A "getchallenge" OOB command has been received
  *
@@ -862,6 +864,66 @@ CLIENT COMMAND EXECUTION
 ============================================================
 */
 
+/**
+ * @brief Gets the shared view of a download, opening the file if no other client is downloading it
+ * @param[in] fileName
+ * @return The view or NULL if the file can't be opened
+ */
+static svDownloadView_t *SV_AcquireDownloadView(const char *fileName)
+{
+	svDownloadView_t *view, *freeView = NULL;
+	int              i;
+
+	for (i = 0, view = svDownloadViews; i < MAX_CLIENTS; i++, view++)
+	{
+		if (!view->refCount)
+		{
+			if (!freeView)
+			{
+				freeView = view;
+			}
+			continue;
+		}
+
+		if (!Q_stricmp(view->name, fileName))
+		{
+			view->refCount++;
+			return view;
+		}
+	}
+
+	if (!freeView)
+	{
+		return NULL;
+	}
+
+	freeView->file = FS_SV_OpenSharedFile(fileName, &freeView->size);
+	if (!freeView->file)
+	{
+		return NULL;
+	}
+
+	Q_strncpyz(freeView->name, fileName, sizeof(freeView->name));
+	freeView->refCount = 1;
+
+	return freeView;
+}
+
+/**
+ * @brief Drops a client's reference to a download view, closing the file with the last one
+ * @param[in,out] view
+ */
+static void SV_ReleaseDownloadView(svDownloadView_t *view)
+{
+	if (--view->refCount > 0)
+	{
+		return;
+	}
+
+	Sys_CloseSharedFile(view->file);
+	Com_Memset(view, 0, sizeof(*view));
+}
+
 /**
  * @brief Clear/free any download vars
  * @param[in,out] cl
@@ -876,6 +938,11 @@ static void SV_CloseDownload(client_t *cl)
 		FS_FCloseFile(cl->download);
 	}
 	cl->download      = 0;
+	if (cl->downloadView)
+	{
+		SV_ReleaseDownloadView(cl->downloadView);
+		cl->downloadView = NULL;
+	}
 	*cl->downloadName = 0;
 
 	// don't timeout after download for valid clients
@@ -896,6 +963,19 @@ static void SV_CloseDownload(client_t *cl)
 	}
 }
 
+/**
+ * @brief Closes the downloads of all clients, so no file or mapping outlives the client list
+ */
+void SV_ShutdownDownloads(void)
+{
+	int i;
+
+	for (i = 0; i < sv_maxclients->integer; i++)
+	{
+		SV_CloseDownload(&svs.clients[i]);
+	}
+}
+
 /**
  * @brief Abort a download if in progress
  * @param[in] cl
@@ -1156,6 +1236,7 @@ static qboolean SV_SetupDownloadFile(client_t *cl, msg_t *msg)
 	int          download_flag;
 	fileHandle_t downloadFileHandle = 0;
 	int          downloadSize       = 0;
+	const char   *wwwBaseURL        = NULL;
 
 	// prevent duplicate download notifications
 	if (cl->downloadnotify & DLNOTIFY_BEGIN)
@@ -1184,7 +1265,19 @@ static qboolean SV_SetupDownloadFile(client_t *cl, msg_t *msg)
 	// NOTE: this is called repeatedly while a client connects. Maybe we should sort of cache the message or something
 	// FIXME: we need to abstract this to an independant module for maximum configuration/usability by server admins
 	// FIXME: I could rework that, it's crappy
-	if (sv_wwwDownload->integer)
+	if (sv_wwwDownload->integer && *sv_wwwBaseURL->string)
+	{
+		wwwBaseURL = sv_wwwBaseURL->string;
+	}
+#ifdef DEDICATED
+	else
+	{
+		// fall back to the embedded HTTP server when it runs
+		wwwBaseURL = SV_HTTP_BaseURL();
+	}
+#endif
+
+	if (wwwBaseURL)
 	{
 		if (cl->bDlOK)
 		{
@@ -1192,7 +1285,7 @@ static qboolean SV_SetupDownloadFile(client_t *cl, msg_t *msg)
 			{
 				FS_FCloseFile(downloadFileHandle);   // don't keep open, we only care about the size
 
-				Q_strncpyz(cl->downloadURL, va("%s/%s", sv_wwwBaseURL->string, cl->downloadName), sizeof(cl->downloadURL));
+				Q_strncpyz(cl->downloadURL, va("%s/%s", wwwBaseURL, cl->downloadName), sizeof(cl->downloadURL));
 
 				// prevent multiple download notifications
 				if (cl->downloadnotify & DLNOTIFY_REDIRECT)
@@ -1249,6 +1342,16 @@ static qboolean SV_SetupDownloadFile(client_t *cl, msg_t *msg)
 	cl->download     = downloadFileHandle;
 	cl->downloadSize = downloadSize;
 
+	// serve the blocks straight from a view shared by everyone downloading the file,
+	// the handle is only kept when the file can't be opened that way
+	cl->downloadView = SV_AcquireDownloadView(cl->downloadName);
+	if (cl->downloadView)
+	{
+		FS_FCloseFile(cl->download);
+		cl->download     = 0;
+		cl->downloadSize = cl->downloadView->size;
+	}
+
 	// is valid source, init
 	cl->downloadCurrentBlock = cl->downloadClientBlock = cl->downloadXmitBlock = 0;
 	cl->downloadCount        = 0;
@@ -1268,7 +1371,8 @@ static qboolean SV_SetupDownloadFile(client_t *cl, msg_t *msg)
  */
 static qboolean SV_WriteDownloadToClient(client_t *cl, msg_t *msg)
 {
-	int curindex;
+	int  curindex;
+	byte block[MAX_DOWNLOAD_BLKSIZE];
 
 	if (!*cl->downloadName)
 	{
@@ -1288,7 +1392,7 @@ static qboolean SV_WriteDownloadToClient(client_t *cl, msg_t *msg)
 	}
 
 	// set up the file to be downloaded
-	if (!cl->download && SV_SetupDownloadFile(cl, msg))
+	if (!cl->download && !cl->downloadView && SV_SetupDownloadFile(cl, msg))
 	{
 		return qtrue;
 	}
@@ -1298,6 +1402,15 @@ static qboolean SV_WriteDownloadToClient(client_t *cl, msg_t *msg)
 	{
 		curindex = (cl->downloadCurrentBlock % MAX_DOWNLOAD_WINDOW);
 
+		// shared, the block is only a range of the view, read when it is sent
+		if (cl->downloadView)
+		{
+			cl->downloadBlockSize[curindex] = MIN(MAX_DOWNLOAD_BLKSIZE, cl->downloadSize - cl->downloadCount);
+			cl->downloadCount              += cl->downloadBlockSize[curindex];
+			cl->downloadCurrentBlock++;
+			continue;
+		}
+
 		if (!cl->downloadBlocks[curindex])
 		{
 			cl->downloadBlocks[curindex] = Z_Malloc(MAX_DOWNLOAD_BLKSIZE);
@@ -1352,6 +1465,14 @@ static qboolean SV_WriteDownloadToClient(client_t *cl, msg_t *msg)
 	// Send current block
 	curindex = (cl->downloadXmitBlock % MAX_DOWNLOAD_WINDOW);
 
+	// read from the shared view before the size goes out, a file changed on the
+	// disk meanwhile gives a short block just like a short FS_Read did
+	if (cl->downloadView && cl->downloadBlockSize[curindex])
+	{
+		cl->downloadBlockSize[curindex] = MAX(0, Sys_ReadSharedFile(cl->downloadView->file, cl->downloadXmitBlock * MAX_DOWNLOAD_BLKSIZE,
+		                                                            block, cl->downloadBlockSize[curindex]));
+	}
+
 	MSG_WriteByte(msg, svc_download);
 	MSG_WriteShort(msg, cl->downloadXmitBlock);
 
@@ -1366,7 +1487,14 @@ static qboolean SV_WriteDownloadToClient(client_t *cl, msg_t *msg)
 	// Write the block
 	if (cl->downloadBlockSize[curindex])
 	{
-		MSG_WriteData(msg, cl->downloadBlocks[curindex], cl->downloadBlockSize[curindex]);
+		if (cl->downloadView)
+		{
+			MSG_WriteData(msg, block, cl->downloadBlockSize[curindex]);
+		}
+		else
+		{
+			MSG_WriteData(msg, cl->downloadBlocks[curindex], cl->downloadBlockSize[curindex]);
+		}
 	}
 
 	Com_DPrintf("clientDownload: %d : writing block %d\n", (int)(cl - svs.clients), cl->downloadXmitBlock);
@@ -61,10 +61,15 @@ typedef enum
 	demo_entityState, // gentity_t->entityState_t management
 	demo_entityShared, // gentity_t->entityShared_t management
 	demo_playerState, // players game state event (playerState_t management)
+	demo_keyFrame, // full frame marker: the states of the previous frames are dropped, everything that follows in the frame is a delta from nothing
 
 	//demo_clientUsercmd, // players commands/movements packets (usercmd_t management)
 } demo_ops_e;
 
+// Format of the recorded demos, written as "version" meta data. Demos without it are version 1.
+// 2: single message frames and demo_keyFrame
+#define SV_DEMO_VERSION 2
+
 /*** STATIC VARIABLES ***/
 // We set them as static so that they are global only for this file, this limit a bit the side-effect
 
@@ -98,6 +103,19 @@ static char gstats[MAX_CLIENTS][MAX_STRING_CHARS];
 
 static int playerStatsNum;
 
+// Recording of the frames
+static int demoNextKeyframe = -1; // server time of the next keyframe, -1 forces one on the next frame
+static int demoChangedEntities[MAX_GENTITIES]; // entities picked by the last changed states scan
+
+static struct
+{
+	int bytes;
+	int frames;
+	int keyframes;
+	int entities;
+	int players;
+} demoStats; // recording summary printed when the demo is stopped
+
 /**
  * @brief Restores all CVARs
  */
@@ -581,8 +599,8 @@ static void SV_DemoWriteMessage(msg_t *msg)
 	// Write the entire message to the file, prefixed by the length
 	MSG_WriteByte(msg, demo_EOF); // append EOF (end-of-file or rather end-of-flux) to the message so that it will tell the demo parser when the demo will be read that the message ends here, and that it can proceed to the next message
 	len = LittleLong(msg->cursize);
-	(void) FS_Write(&len, 4, sv.demoFile);
-	(void) FS_Write(msg->data, msg->cursize, sv.demoFile);
+	Com_DemoWriterWrite(sv.demoWriter, &len, 4, msg->data, msg->cursize);
+	demoStats.bytes += 4 + msg->cursize;
 	MSG_Clear(msg);
 }
 
@@ -857,21 +875,18 @@ void SV_DemoWriteClientUsercmd( client_t *cl, qboolean delta, int cmdCount, user
 */
 
 /**
- * @brief Write all active clients playerState (playerState_t)
+ * @brief Write the playerState (playerState_t) of all active clients that changed since the previous frame
+ * @param[in,out] msg
  *
  * @note This is called at every game's endFrame.
  *
- * @note Contrary to the other DemoWrite functions, this one writes all entities at once in one message, instead of one entity/command per message.
+ * @note Unchanged players are left out entirely, the demo reader keeps their previous state.
  */
-static void SV_DemoWriteAllPlayerState(void)
+static void SV_DemoWriteAllPlayerState(msg_t *msg)
 {
-	msg_t         msg;
 	playerState_t *player;
 	int           i;
 
-	// Initiliaze msg
-	MSG_Init(&msg, buf, sizeof(buf));
-
 	// Write clients playerState (playerState_t)
 	for (i = 0; i < sv_maxclients->integer; i++)
 	{
@@ -881,35 +896,34 @@ static void SV_DemoWriteAllPlayerState(void)
 		}
 
 		player = SV_GameClientNum(i);
-		MSG_WriteByte(&msg, demo_playerState);
-		MSG_WriteByte(&msg, i);
-		MSG_WriteDeltaPlayerstate(&msg, &sv.demoPlayerStates[i], player);
+
+		if (!memcmp(&sv.demoPlayerStates[i], player, sizeof(playerState_t)))
+		{
+			continue;
+		}
+
+		MSG_WriteByte(msg, demo_playerState);
+		MSG_WriteByte(msg, i);
+		MSG_WriteDeltaPlayerstate(msg, &sv.demoPlayerStates[i], player);
 		sv.demoPlayerStates[i] = *player;
+		demoStats.players++;
 	}
-
-	// Commit all these datas to the demo file
-	SV_DemoWriteMessage(&msg);
 }
 
 /**
- * @brief Write all entities state (gentity_t->entityState_t)
+ * @brief Write all entities state (gentity_t->entityState_t) that changed since the previous frame
+ * @param[in,out] msg
  *
  * @note This is called at every game's endFrame.
  *
  * @note Contrary to the other DemoWrite functions, this one writes all entities at once in one message, instead of one entity/command per message.
- * This could be easily changed, but I'm not sure it would be beneficial for the CPU time and demo storage.
+ * A raw compare picks the changed entities first, so the field by field delta only runs on those and nothing is written when none changed.
  */
-static void SV_DemoWriteAllEntityState(void)
+static void SV_DemoWriteAllEntityState(msg_t *msg)
 {
-	msg_t          msg;
 	sharedEntity_t *entity;
-	int            i;
+	int            i, num, numChanged = 0;
 
-	// Initiliaze msg
-	MSG_Init(&msg, buf, sizeof(buf));
-
-	// Write entities (gentity_t->entityState_t or concretely sv.gentities[num].s, in gamecode level. instead of sv.)
-	MSG_WriteByte(&msg, demo_entityState);
 	for (i = 0; i < sv.num_entities; i++)
 	{
 		if (i >= sv_maxclients->integer && i < MAX_CLIENTS)
@@ -919,34 +933,45 @@ static void SV_DemoWriteAllEntityState(void)
 
 		entity           = SV_GentityNum(i);
 		entity->s.number = i;
-		MSG_WriteDeltaEntity(&msg, &sv.demoEntities[i].s, &entity->s, qfalse);
-		sv.demoEntities[i].s = entity->s;
+
+		if (memcmp(&sv.demoEntities[i].s, &entity->s, sizeof(entityState_t)))
+		{
+			demoChangedEntities[numChanged++] = i;
+		}
 	}
 
-	MSG_WriteBits(&msg, ENTITYNUM_NONE, GENTITYNUM_BITS); // End marker/Condition to break: since we don't know prior how many entities we store, when reading  the demo we will use an empty entity to break from our while loop
+	demoStats.entities += numChanged;
 
-	// Commit all these datas to the demo file
-	SV_DemoWriteMessage(&msg);
+	if (!numChanged)
+	{
+		return;
+	}
+
+	// Write entities (gentity_t->entityState_t or concretely sv.gentities[num].s, in gamecode level. instead of sv.)
+	MSG_WriteByte(msg, demo_entityState);
+	for (i = 0; i < numChanged; i++)
+	{
+		num    = demoChangedEntities[i];
+		entity = SV_GentityNum(num);
+		MSG_WriteDeltaEntity(msg, &sv.demoEntities[num].s, &entity->s, qfalse);
+		sv.demoEntities[num].s = entity->s;
+	}
+
+	MSG_WriteBits(msg, ENTITYNUM_NONE, GENTITYNUM_BITS); // End marker/Condition to break: since we don't know prior how many entities we store, when reading  the demo we will use an empty entity to break from our while loop
 }
 
 /**
- * @brief Write all entities (gentity_t->entityShared_t)
+ * @brief Write all entities (gentity_t->entityShared_t) that changed since the previous frame
+ * @param[in,out] msg
  *
  * @note This is called at every game's endFrame.
  *
  * @note Contrary to the other DemoWrite functions, this one writes all entities at once in one message, instead of one entity/command per message.
  */
-static void SV_DemoWriteAllEntityShared(void)
+static void SV_DemoWriteAllEntityShared(msg_t *msg)
 {
-	msg_t          msg;
 	sharedEntity_t *entity;
-	int            i;
-
-	// Initiliaze msg
-	MSG_Init(&msg, buf, sizeof(buf));
-
-	// Write entities (gentity_t->entityShared_t or concretely sv.gentities[num].r, in gamecode level. instead of sv.)
-	MSG_WriteByte(&msg, demo_entityShared);
+	int            i, num, numChanged = 0;
 
 	for (i = 0; i < sv.num_entities; i++)
 	{
@@ -956,14 +981,31 @@ static void SV_DemoWriteAllEntityShared(void)
 		}
 
 		entity = SV_GentityNum(i);
-		MSG_WriteDeltaSharedEntity(&msg, &sv.demoEntities[i].r, &entity->r, qfalse, i);
-		sv.demoEntities[i].r = entity->r;
+
+		if (memcmp(&sv.demoEntities[i].r, &entity->r, sizeof(entityShared_t)))
+		{
+			demoChangedEntities[numChanged++] = i;
+		}
 	}
 
-	MSG_WriteBits(&msg, ENTITYNUM_NONE, GENTITYNUM_BITS); // End marker/Condition to break: since we don't know prior how many entities we store, when reading  the demo we will use an empty entity to break from our while loop
+	demoStats.entities += numChanged;
 
-	// Commit all these datas to the demo file
-	SV_DemoWriteMessage(&msg);
+	if (!numChanged)
+	{
+		return;
+	}
+
+	// Write entities (gentity_t->entityShared_t or concretely sv.gentities[num].r, in gamecode level. instead of sv.)
+	MSG_WriteByte(msg, demo_entityShared);
+	for (i = 0; i < numChanged; i++)
+	{
+		num    = demoChangedEntities[i];
+		entity = SV_GentityNum(num);
+		MSG_WriteDeltaSharedEntity(msg, &sv.demoEntities[num].r, &entity->r, qfalse, num);
+		sv.demoEntities[num].r = entity->r;
+	}
+
+	MSG_WriteBits(msg, ENTITYNUM_NONE, GENTITYNUM_BITS); // End marker/Condition to break: since we don't know prior how many entities we store, when reading  the demo we will use an empty entity to break from our while loop
 }
 
 /**
@@ -1058,30 +1100,47 @@ static void SV_DemoConnectDummy()
  * Called in the main server's loop SV_Frame() in sv_main.c
  * Note that this function could be called DemoWriteEndFrame,
  * because it writes once at the end of every frame (the other events are written whenever they happen using hooks)
+ *
+ * The whole frame goes into a single demo message holding only what changed since the previous frame.
+ * Every sv_demoKeyframe seconds the frame is a keyframe instead: the previous states are dropped
+ * and everything is written in full, so a reader can resynchronise from there without the frames before it.
  */
 void SV_DemoWriteFrame(void)
 {
 	msg_t msg;
 
-	// STEP1: write all entities states at the end of the frame
+	// Request stats first, the game commands it triggers are written as messages of their own
+	SV_DemoRequestStats();
+
+	MSG_Init(&msg, buf, sizeof(buf));
+
+	// STEP1: start a keyframe if it's time to
+
+	if (demoNextKeyframe < 0 || (sv_demoKeyframe->integer > 0 && (svs.time >= demoNextKeyframe || demoNextKeyframe - svs.time > sv_demoKeyframe->integer * 1000)))
+	{
+		Com_Memset(sv.demoEntities, 0, sizeof(sv.demoEntities));
+		Com_Memset(sv.demoPlayerStates, 0, sizeof(sv.demoPlayerStates));
+
+		MSG_WriteByte(&msg, demo_keyFrame);
+
+		demoNextKeyframe = svs.time + sv_demoKeyframe->integer * 1000;
+		demoStats.keyframes++;
+	}
+
+	// STEP2: write all entities states at the end of the frame
 
 	// Write entities (gentity_t->entityState_t or concretely sv.gentities[num].s, in gamecode level. instead of sv.)
-	SV_DemoWriteAllEntityState();
+	SV_DemoWriteAllEntityState(&msg);
 
 	// Write entities (gentity_t->entityShared_t or concretely sv.gentities[num].r, in gamecode level. instead of sv.)
-	SV_DemoWriteAllEntityShared();
+	SV_DemoWriteAllEntityShared(&msg);
 
 	// Write clients playerState (playerState_t)
-	SV_DemoWriteAllPlayerState();
-
-	// Request stats
-	SV_DemoRequestStats();
+	SV_DemoWriteAllPlayerState(&msg);
 
 	//-----------------------------------------------------
 
-	// STEP2: write the endFrame marker and server time
-
-	MSG_Init(&msg, buf, sizeof(buf));
+	// STEP3: write the endFrame marker and server time
 
 	// Write end of frame marker: this will commit every demo entity change (and it's done at the very end of every server frame to overwrite any change the gamecode/engine may have done)
 	MSG_WriteByte(&msg, demo_endFrame);
@@ -1091,6 +1150,8 @@ void SV_DemoWriteFrame(void)
 
 	// Commit data to the demo file
 	SV_DemoWriteMessage(&msg);
+
+	demoStats.frames++;
 }
 
 /***********************************************
@@ -1358,6 +1419,16 @@ static void SV_DemoStartPlayback(void)
 		{
 			break;
 		}
+		else if (!Q_stricmp(metadata, "version"))
+		{
+			// refused even in tolerant mode, the frames can't be read
+			int version = MSG_ReadLong(&msg);
+
+			if (version > SV_DEMO_VERSION)
+			{
+				SV_DemoPlaybackError(va("DEMOERROR: Demo format version %d is not supported (this build reads up to version %d), use a newer build to play it.\n", version, SV_DEMO_VERSION));
+			}
+		}
 		else if (!Q_stricmp(metadata, "clients"))
 		{ // democlients
 			// Check slots, time and map
@@ -1742,8 +1813,14 @@ static void SV_DemoStartRecord(void)
 	// Set democlients to 0 since it's only used for replaying demo
 	Cvar_SetValue("sv_democlients", 0);
 
+	// Queue the messages, the file is written in the background
+	sv.demoWriter = Com_CreateDemoWriter(sv.demoFile);
+
 	MSG_Init(&msg, buf, sizeof(buf));
 
+	// Write demo format version first, so a build that can't read it stops before changing anything
+	MSG_WriteString(&msg, "version");
+	MSG_WriteLong(&msg, SV_DEMO_VERSION);
 	// Write number of clients (sv_maxclients < MAX_CLIENTS or else we can't playback)
 	MSG_WriteString(&msg, "clients"); // for each demo meta data (infos about the demo), we prepend the name of the var (this allows for fault tolerance and retrocompatibility) - FIXME? We could also use MSG_LookaheadByte() to read a byte, instead of a string, this would save a tiny bit of storage space
 	MSG_WriteByte(&msg, sv_maxclients->integer);
@@ -1848,6 +1925,8 @@ static void SV_DemoStartRecord(void)
 	Com_Memset(sv.demoPlayerStates, 0, sizeof(sv.demoPlayerStates));
 	Com_Memset(sv.demoPlayerStats, 0, sizeof(sv.demoPlayerStats));
 	playerStatsNum = 0;
+	Com_Memset(&demoStats, 0, sizeof(demoStats));
+	demoNextKeyframe = -1;
 	// End of frame
 	SV_DemoWriteFrame();
 	// Announce we are writing the demo
@@ -1878,6 +1957,10 @@ static void SV_DemoStopRecord(void)
 	MSG_WriteByte(&msg, demo_endDemo);
 	SV_DemoWriteMessage(&msg); // this also writes demo_EOF
 
+	// Write out what is still queued
+	Com_DestroyDemoWriter(sv.demoWriter);
+	sv.demoWriter = NULL;
+
 	// Close the file (else it won't be openable until the server is closed)
 	FS_FCloseFile(sv.demoFile);
 	// Change recording state
@@ -1885,6 +1968,7 @@ static void SV_DemoStopRecord(void)
 	Cvar_SetValue("sv_demoState", DS_NONE);
 	// Announce
 	Com_Printf("DEMO: Stopped recording server-side demo %s.\n", sv.demoName);
+	Com_Printf("DEMO: %i frames (%i keyframes) in %i bytes, %i entity and %i player deltas written.\n", demoStats.frames, demoStats.keyframes, demoStats.bytes, demoStats.entities, demoStats.players);
 	SV_SendServerCommand(NULL, "chat \"^3DEMO: Stopped recording server-side demo %s.\"", sv.demoName);
 
 	// disconnect dummy client if there is one
@@ -2325,6 +2409,26 @@ static void SV_DemoReadAllEntityShared(msg_t *msg)
 	}
 }
 
+/**
+ * @brief Drop the states of the previous frames, the keyframe that follows is written as deltas from nothing
+ */
+static void SV_DemoReadKeyFrame(void)
+{
+	int i;
+
+	// Unlink everything, the keyframe links again what is still linked
+	for (i = 0; i < MAX_GENTITIES; i++)
+	{
+		if (sv.demoEntities[i].r.linked)
+		{
+			SV_UnlinkEntity(SV_GentityNum(i));
+		}
+	}
+
+	Com_Memset(sv.demoEntities, 0, sizeof(sv.demoEntities));
+	Com_Memset(sv.demoPlayerStates, 0, sizeof(sv.demoPlayerStates));
+}
+
 /**
  * @brief Load into memory all stored demo players states and entities (which effectively overwrites the one that were previously written by the game since SV_ReadFrame is called at the very end of every game's frame iteration).
  */
@@ -2501,6 +2605,9 @@ read_next_demo_event: // used to read next demo event
 			case demo_entityShared:     // gentity_t->entityShared_t management (see g_local.h for more infos)
 				SV_DemoReadAllEntityShared(&msg);
 				break;
+			case demo_keyFrame:     // full frame: drop the previous states before reading the frame
+				SV_DemoReadKeyFrame();
+				break;
 			/*
 			case demo_clientUsercmd:
 			    SV_DemoReadClientUsercmd(&msg);
@@ -0,0 +1,968 @@
+/*
+ * Wolfenstein: Enemy Territory GPL Source Code
+ * Copyright (C) 1999-2010 id Software LLC, a ZeniMax Media company.
+ *
+ * ET: Legacy
+ * Copyright (C) 2012-2023 ET:Legacy team <mail@etlegacy.com>
+ *
+ * This file is part of ET: Legacy - http://www.etlegacy.com
+ *
+ * ET: Legacy is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ET: Legacy is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ET: Legacy. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * In addition, Wolfenstein: Enemy Territory GPL Source Code is also
+ * subject to certain additional terms. You should have received a copy
+ * of these additional terms immediately following the terms and conditions
+ * of the GNU General Public License which accompanied the source code.
+ * If not, please request a copy in writing from id Software at the address below.
+ *
+ * id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+ */
+/**
+ * @file sv_http.c
+ * @brief Embedded HTTP server for pk3 downloads
+ *
+ * A small HTTP/1.1 file server on its own thread, so clients can download
+ * paks at full speed through the regular www download redirect without a
+ * web server next to the game server. Only the paks a client may request
+ * over UDP are served (the FS_VerifyPak set without the id paks), looked up
+ * by the exact "gamename/basename.pk3" name. GET and HEAD, single byte
+ * ranges and keep-alive connections are supported. On Linux the bodies go
+ * out with sendfile.
+ *
+ * The list of paks is built on the main thread at each map load and handed
+ * to the server thread under a lock. The server thread never calls into the
+ * engine, it only reads the files it is handed.
+ *
+ * @note Dedicated server only.
+ */
+
+#include "server.h"
+
+#ifdef DEDICATED
+
+#include <errno.h>
+
+#ifdef _WIN32
+#   include <winsock2.h>
+#   include <ws2tcpip.h>
+#   define HTTP_WOULDBLOCK  (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+#   include <sys/socket.h>
+#   include <sys/select.h>
+#   include <netinet/in.h>
+#   include <arpa/inet.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   ifdef __linux__
+#       include <sys/sendfile.h>
+#   endif
+typedef int SOCKET;
+#   define INVALID_SOCKET   -1
+#   define closesocket      close
+#   define HTTP_WOULDBLOCK  (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+#endif
+
+#ifdef MSG_NOSIGNAL
+#   define HTTP_SEND_FLAGS  MSG_NOSIGNAL
+#else
+#   define HTTP_SEND_FLAGS  0
+#endif
+
+#define HTTP_MAX_CONNECTIONS    32
+#define HTTP_REQUEST_SIZE       2048        ///< longest request head accepted
+#define HTTP_BUFFER_SIZE        16384       ///< body buffer where sendfile isn't available
+#define HTTP_SENDFILE_CHUNK     0x100000    ///< most bytes handed to sendfile at once
+#define HTTP_IDLE_TIMEOUT       30000       ///< msec before a silent connection is closed
+#define HTTP_SELECT_TIMEOUT     100         ///< msec between checks for shutdown
+
+/**
+ * @struct httpPak_t
+ * @brief A pak the server may send
+ */
+typedef struct
+{
+	char name[MAX_QPATH];                   ///< as requested, "gamename/basename.pk3"
+	char ospath[MAX_OSPATH];
+} httpPak_t;
+
+/**
+ * @struct httpPakList_t
+ * @brief A list of paks being built on the main thread, away from svHttp
+ */
+typedef struct
+{
+	httpPak_t *paks;                        ///< NULL while counting
+	int numPaks;
+} httpPakList_t;
+
+/**
+ * @enum httpState_t
+ * @brief
+ */
+typedef enum
+{
+	HTTP_FREE = 0,
+	HTTP_READING,                           ///< waiting for a complete request head
+	HTTP_SENDING                            ///< sending the response head and body
+} httpState_t;
+
+/**
+ * @struct httpConnection_t
+ * @brief
+ */
+typedef struct
+{
+	httpState_t state;
+	SOCKET socket;
+	int lastActive;
+
+	char request[HTTP_REQUEST_SIZE];
+	int requestLen;
+	int headLen;                            ///< of the request being answered, pipelined requests follow it
+
+	char header[512];
+	int headerLen;
+	int headerSent;
+
+	FILE *file;
+	int offset;                             ///< next byte of the file to send
+	int remaining;                          ///< body bytes left to send
+	qboolean keepAlive;
+
+	byte buffer[HTTP_BUFFER_SIZE];
+	int bufferLen;
+	int bufferSent;
+} httpConnection_t;
+
+static cvar_t *sv_httpServer;
+static cvar_t *sv_httpServerPort;
+static cvar_t *sv_httpServerHost;
+
+static struct
+{
+	qthread_t *thread;
+	qmutex_t *lock;                         ///< guards paks and numPaks
+	volatile int quit;
+
+	SOCKET listener;
+	int port;
+
+	httpPak_t *paks;
+	int numPaks;
+
+	httpConnection_t connections[HTTP_MAX_CONNECTIONS];
+} svHttp = { NULL, NULL, 0, INVALID_SOCKET, 0, NULL, 0 };
+
+/**
+ * @brief Switches a socket to non-blocking mode
+ * @param[in] sock
+ * @return
+ */
+static qboolean SV_HTTP_SetNonBlocking(SOCKET sock)
+{
+#ifdef _WIN32
+	u_long _true = 1;
+
+	return ioctlsocket(sock, FIONBIO, &_true) == 0;
+#else
+	return fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK) != -1;
+#endif
+}
+
+/**
+ * @brief Closes a connection and frees its slot
+ * @param[in,out] conn
+ */
+static void SV_HTTP_Close(httpConnection_t *conn)
+{
+	if (conn->file)
+	{
+		fclose(conn->file);
+		conn->file = NULL;
+	}
+
+	closesocket(conn->socket);
+	conn->socket = INVALID_SOCKET;
+	conn->state  = HTTP_FREE;
+}
+
+static void SV_HTTP_CheckRequest(httpConnection_t *conn);
+
+/**
+ * @brief Gets ready for the next request on a kept alive connection
+ * @param[in,out] conn
+ *
+ * @note A client may already have sent its next requests after the answered
+ * one, they are kept and a complete one is answered right away.
+ */
+static void SV_HTTP_Reset(httpConnection_t *conn)
+{
+	if (conn->file)
+	{
+		fclose(conn->file);
+		conn->file = NULL;
+	}
+
+	conn->requestLen -= conn->headLen;
+	memmove(conn->request, conn->request + conn->headLen, conn->requestLen + 1);
+	conn->headLen = 0;
+
+	conn->state     = HTTP_READING;
+	conn->headerLen = conn->headerSent = 0;
+	conn->bufferLen = conn->bufferSent = 0;
+	conn->remaining = 0;
+
+	if (conn->requestLen)
+	{
+		SV_HTTP_CheckRequest(conn);
+	}
+}
+
+/**
+ * @brief Queues a response without a file body, the connection is closed once it is sent
+ * @param[in,out] conn
+ * @param[in] status
+ * @param[in] reason
+ * @param[in] extra Additional header lines
+ */
+static void SV_HTTP_Error(httpConnection_t *conn, int status, const char *reason, const char *extra)
+{
+	conn->headerLen = Com_sprintf(conn->header, sizeof(conn->header),
+	                              "HTTP/1.1 %i %s\r\n"
+	                              "Server: " PRODUCT_LABEL "\r\n"
+	                              "Content-Type: text/plain\r\n"
+	                              "Content-Length: %i\r\n"
+	                              "%s"
+	                              "Connection: close\r\n"
+	                              "\r\n"
+	                              "%s\n",
+	                              status, reason, (int)strlen(reason) + 1, extra, reason);
+	conn->headerSent = 0;
+	conn->remaining  = 0;
+	conn->keepAlive  = qfalse;
+	conn->state      = HTTP_SENDING;
+}
+
+/**
+ * @brief Finds the value of a header in the request head
+ * @param[in] request
+ * @param[in] name Header name followed by ':'
+ * @return Start of the value or NULL
+ */
+static const char *SV_HTTP_Header(const char *request, const char *name)
+{
+	const char *line = strstr(request, "\r\n");
+	size_t     len   = strlen(name);
+
+	while (line && line[2] != '\r' && line[2] != '\0')
+	{
+		line += 2;
+
+		if (!Q_stricmpn(line, name, len))
+		{
+			line += len;
+			while (*line == ' ' || *line == '\t')
+			{
+				line++;
+			}
+			return line;
+		}
+
+		line = strstr(line, "\r\n");
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Decodes the path of the request into a pak name
+ * @param[in] path Starts after the leading '/'
+ * @param[out] name
+ * @param[in] size
+ * @return qfalse if the path is malformed or too long
+ */
+static qboolean SV_HTTP_DecodePath(const char *path, char *name, int size)
+{
+	int  len = 0;
+	char hex[3];
+
+	while (*path && *path != ' ' && *path != '?' && *path != '#')
+	{
+		if (len >= size - 1)
+		{
+			return qfalse;
+		}
+
+		if (*path == '%')
+		{
+			if (!isxdigit((unsigned char)path[1]) || !isxdigit((unsigned char)path[2]))
+			{
+				return qfalse;
+			}
+			hex[0]      = path[1];
+			hex[1]      = path[2];
+			hex[2]      = '\0';
+			name[len++] = (char)strtol(hex, NULL, 16);
+			path       += 3;
+		}
+		else
+		{
+			name[len++] = *path++;
+		}
+	}
+
+	name[len] = '\0';
+	return len > 0;
+}
+
+/**
+ * @brief Parses a byte position of a Range header
+ * @param[in] str
+ * @param[out] end Set behind the number
+ * @return The position or -1 if it is malformed or out of range
+ */
+static int SV_HTTP_RangeValue(const char *str, const char **end)
+{
+	char *stop;
+	long value;
+
+	*end = str;
+	if (!isdigit((unsigned char)*str))
+	{
+		return -1;
+	}
+
+	errno = 0;
+	value = strtol(str, &stop, 10);
+	*end  = stop;
+
+	if (errno == ERANGE || value > INT_MAX)
+	{
+		return -1;
+	}
+	return (int)value;
+}
+
+/**
+ * @brief Answers a complete request head
+ * @param[in,out] conn
+ */
+static void SV_HTTP_HandleRequest(httpConnection_t *conn)
+{
+	char       name[MAX_QPATH], ospath[MAX_OSPATH];
+	char       range[64] = "";
+	const char *path, *value;
+	qboolean   head;
+	int        i, size, start, end, last;
+
+	if (!Q_strncmp(conn->request, "GET /", 5))
+	{
+		head = qfalse;
+		path = conn->request + 5;
+	}
+	else if (!Q_strncmp(conn->request, "HEAD /", 6))
+	{
+		head = qtrue;
+		path = conn->request + 6;
+	}
+	else
+	{
+		SV_HTTP_Error(conn, 405, "Method Not Allowed", "Allow: GET, HEAD\r\n");
+		return;
+	}
+
+	if (!SV_HTTP_DecodePath(path, name, sizeof(name)))
+	{
+		SV_HTTP_Error(conn, 400, "Bad Request", "");
+		return;
+	}
+
+	// HTTP/1.1 keeps the connection open unless told otherwise, HTTP/1.0 closes it unless told otherwise
+	value           = SV_HTTP_Header(conn->request, "Connection:");
+	conn->keepAlive = strstr(conn->request, " HTTP/1.1\r\n") != NULL;
+	if (value)
+	{
+		if (!Q_stricmpn(value, "close", 5))
+		{
+			conn->keepAlive = qfalse;
+		}
+		else if (!Q_stricmpn(value, "keep-alive", 10))
+		{
+			conn->keepAlive = qtrue;
+		}
+	}
+
+	// only exact names of the served paks, nothing else on the disk can be reached
+	ospath[0] = '\0';
+	Com_LockMutex(svHttp.lock);
+	for (i = 0; i < svHttp.numPaks; i++)
+	{
+		if (!Q_stricmp(svHttp.paks[i].name, name))
+		{
+			Q_strncpyz(ospath, svHttp.paks[i].ospath, sizeof(ospath));
+			break;
+		}
+	}
+	Com_UnlockMutex(svHttp.lock);
+
+	if (!ospath[0] || !(conn->file = fopen(ospath, "rb")))
+	{
+		SV_HTTP_Error(conn, 404, "Not Found", "");
+		return;
+	}
+
+	fseek(conn->file, 0, SEEK_END);
+	size = (int)ftell(conn->file);
+	if (size < 0)
+	{
+		SV_HTTP_Error(conn, 500, "Internal Server Error", "");
+		return;
+	}
+
+	start = 0;
+	end   = size - 1;
+
+	// a single byte range: "bytes=a-b", "bytes=a-" or "bytes=-n"
+	value = SV_HTTP_Header(conn->request, "Range:");
+	if (value)
+	{
+		const char *comma = strchr(value, ',');
+
+		// multiple ranges would need a multipart body, they aren't supported
+		if (Q_stricmpn(value, "bytes=", 6) || (comma && comma < strstr(value, "\r\n")))
+		{
+			Com_sprintf(range, sizeof(range), "Content-Range: bytes */%i\r\n", size);
+			SV_HTTP_Error(conn, 416, "Range Not Satisfiable", range);
+			return;
+		}
+
+		value += 6;
+		if (*value == '-')
+		{
+			last  = SV_HTTP_RangeValue(value + 1, &value);
+			start = last > 0 ? MAX(0, size - last) : size;
+		}
+		else
+		{
+			start = SV_HTTP_RangeValue(value, &value);
+			if (*value != '-')
+			{
+				start = -1;
+			}
+			else if (isdigit((unsigned char)value[1]))
+			{
+				last = SV_HTTP_RangeValue(value + 1, &value);
+				end  = last < 0 ? -1 : MIN(last, size - 1);
+			}
+			else
+			{
+				value++;
+			}
+		}
+
+		// anything but the end of the line behind the range is malformed
+		if (start < 0 || start >= size || start > end || (*value != '\r' && *value != ' ' && *value != '\t'))
+		{
+			Com_sprintf(range, sizeof(range), "Content-Range: bytes */%i\r\n", size);
+			SV_HTTP_Error(conn, 416, "Range Not Satisfiable", range);
+			return;
+		}
+
+		Com_sprintf(range, sizeof(range), "Content-Range: bytes %i-%i/%i\r\n", start, end, size);
+	}
+
+	conn->offset    = start;
+	conn->remaining = head ? 0 : end - start + 1;
+	fseek(conn->file, start, SEEK_SET);
+
+	conn->headerLen = Com_sprintf(conn->header, sizeof(conn->header),
+	                              "HTTP/1.1 %s\r\n"
+	                              "Server: " PRODUCT_LABEL "\r\n"
+	                              "Content-Type: application/zip\r\n"
+	                              "Content-Length: %i\r\n"
+	                              "Accept-Ranges: bytes\r\n"
+	                              "%s"
+	                              "Connection: %s\r\n"
+	                              "\r\n",
+	                              range[0] ? "206 Partial Content" : "200 OK", end - start + 1, range,
+	                              conn->keepAlive ? "keep-alive" : "close");
+	conn->headerSent = 0;
+	conn->bufferLen  = conn->bufferSent = 0;
+	conn->state      = HTTP_SENDING;
+}
+
+/**
+ * @brief Reads from a connection waiting for its request
+ * @param[in,out] conn
+ */
+static void SV_HTTP_Read(httpConnection_t *conn)
+{
+	int len;
+
+	len = recv(conn->socket, conn->request + conn->requestLen, HTTP_REQUEST_SIZE - 1 - conn->requestLen, 0);
+	if (len <= 0)
+	{
+		if (len < 0 && HTTP_WOULDBLOCK)
+		{
+			return;
+		}
+		SV_HTTP_Close(conn);
+		return;
+	}
+
+	conn->requestLen                += len;
+	conn->request[conn->requestLen] = '\0';
+
+	SV_HTTP_CheckRequest(conn);
+}
+
+/**
+ * @brief Answers the first request of the read bytes once its head is complete
+ * @param[in,out] conn
+ */
+static void SV_HTTP_CheckRequest(httpConnection_t *conn)
+{
+	char *headEnd = strstr(conn->request, "\r\n\r\n");
+	char next;
+
+	if (!headEnd)
+	{
+		if (conn->requestLen >= HTTP_REQUEST_SIZE - 1)
+		{
+			SV_HTTP_Error(conn, 431, "Request Header Fields Too Large", "");
+		}
+		return;
+	}
+
+	// end the head for the header lookups, pipelined requests may follow it
+	conn->headLen                = (int)(headEnd - conn->request) + 4;
+	next                         = conn->request[conn->headLen];
+	conn->request[conn->headLen] = '\0';
+
+	SV_HTTP_HandleRequest(conn);
+
+	conn->request[conn->headLen] = next;
+}
+
+/**
+ * @brief Sends the next part of the response
+ * @param[in,out] conn
+ */
+static void SV_HTTP_Send(httpConnection_t *conn)
+{
+	int len;
+
+	if (conn->headerSent < conn->headerLen)
+	{
+		len = send(conn->socket, conn->header + conn->headerSent, conn->headerLen - conn->headerSent, HTTP_SEND_FLAGS);
+		if (len < 0)
+		{
+			if (!HTTP_WOULDBLOCK)
+			{
+				SV_HTTP_Close(conn);
+			}
+			return;
+		}
+		conn->headerSent += len;
+	}
+	else if (conn->remaining > 0)
+	{
+#ifdef __linux__
+		off_t offset = conn->offset;
+
+		len = (int)sendfile(conn->socket, fileno(conn->file), &offset, MIN(conn->remaining, HTTP_SENDFILE_CHUNK));
+#else
+		if (conn->bufferSent == conn->bufferLen)
+		{
+			conn->bufferLen  = (int)fread(conn->buffer, 1, MIN(conn->remaining, HTTP_BUFFER_SIZE), conn->file);
+			conn->bufferSent = 0;
+			if (conn->bufferLen <= 0)
+			{
+				SV_HTTP_Close(conn);
+				return;
+			}
+		}
+
+		len = send(conn->socket, (const char *)conn->buffer + conn->bufferSent, conn->bufferLen - conn->bufferSent, HTTP_SEND_FLAGS);
+		if (len > 0)
+		{
+			conn->bufferSent += len;
+		}
+#endif
+		if (len <= 0)
+		{
+			if (len < 0 && HTTP_WOULDBLOCK)
+			{
+				return;
+			}
+			SV_HTTP_Close(conn);
+			return;
+		}
+
+		conn->offset    += len;
+		conn->remaining -= len;
+	}
+
+	if (conn->headerSent == conn->headerLen && conn->remaining <= 0)
+	{
+		if (conn->keepAlive)
+		{
+			SV_HTTP_Reset(conn);
+		}
+		else
+		{
+			SV_HTTP_Close(conn);
+		}
+	}
+}
+
+/**
+ * @brief Takes the pending connections
+ * @param[in] now
+ */
+static void SV_HTTP_Accept(int now)
+{
+	httpConnection_t *conn;
+	SOCKET           sock;
+	int              i;
+
+	while ((sock = accept(svHttp.listener, NULL, NULL)) != INVALID_SOCKET)
+	{
+		for (i = 0, conn = svHttp.connections; i < HTTP_MAX_CONNECTIONS; i++, conn++)
+		{
+			if (conn->state == HTTP_FREE)
+			{
+				break;
+			}
+		}
+
+		if (i == HTTP_MAX_CONNECTIONS || !SV_HTTP_SetNonBlocking(sock))
+		{
+			closesocket(sock);
+			continue;
+		}
+
+		conn->socket     = sock;
+		conn->lastActive = now;
+		conn->keepAlive  = qfalse;
+		conn->requestLen = conn->headLen = 0;
+		conn->request[0] = '\0';
+		SV_HTTP_Reset(conn);
+	}
+}
+
+/**
+ * @brief Server thread, multiplexes all connections until asked to quit
+ * @param[in] arg
+ */
+static void SV_HTTP_Thread(void *arg)
+{
+	httpConnection_t *conn;
+	fd_set           readSet, writeSet;
+	struct timeval   timeout;
+	SOCKET           maxSocket;
+	int              i, now;
+
+	while (!Com_AtomicGet(&svHttp.quit))
+	{
+		FD_ZERO(&readSet);
+		FD_ZERO(&writeSet);
+		FD_SET(svHttp.listener, &readSet);
+		maxSocket = svHttp.listener;
+
+		for (i = 0, conn = svHttp.connections; i < HTTP_MAX_CONNECTIONS; i++, conn++)
+		{
+			if (conn->state == HTTP_READING)
+			{
+				FD_SET(conn->socket, &readSet);
+			}
+			else if (conn->state == HTTP_SENDING)
+			{
+				FD_SET(conn->socket, &writeSet);
+			}
+			else
+			{
+				continue;
+			}
+
+			if (conn->socket > maxSocket)
+			{
+				maxSocket = conn->socket;
+			}
+		}
+
+		timeout.tv_sec  = 0;
+		timeout.tv_usec = HTTP_SELECT_TIMEOUT * 1000;
+
+		if (select((int)maxSocket + 1, &readSet, &writeSet, NULL, &timeout) < 0)
+		{
+			continue;
+		}
+
+		now = Sys_Milliseconds();
+
+		if (FD_ISSET(svHttp.listener, &readSet))
+		{
+			SV_HTTP_Accept(now);
+		}
+
+		for (i = 0, conn = svHttp.connections; i < HTTP_MAX_CONNECTIONS; i++, conn++)
+		{
+			if (conn->state == HTTP_READING && FD_ISSET(conn->socket, &readSet))
+			{
+				conn->lastActive = now;
+				SV_HTTP_Read(conn);
+			}
+			else if (conn->state == HTTP_SENDING && FD_ISSET(conn->socket, &writeSet))
+			{
+				conn->lastActive = now;
+				SV_HTTP_Send(conn);
+			}
+			else if (conn->state != HTTP_FREE && now - conn->lastActive > HTTP_IDLE_TIMEOUT)
+			{
+				SV_HTTP_Close(conn);
+			}
+		}
+	}
+
+	for (i = 0, conn = svHttp.connections; i < HTTP_MAX_CONNECTIONS; i++, conn++)
+	{
+		if (conn->state != HTTP_FREE)
+		{
+			SV_HTTP_Close(conn);
+		}
+	}
+}
+
+/**
+ * @brief Adds a pak to the list being built if clients may download it
+ * @param[in] pakName
+ * @param[in] ospath
+ * @param[in,out] arg The httpPakList_t being built, without paks to count only
+ */
+static void SV_HTTP_AddPak(const char *pakName, const char *ospath, void *arg)
+{
+	httpPakList_t *list = (httpPakList_t *)arg;
+	char          baseName[MAX_QPATH];
+
+	COM_StripExtension(pakName, baseName, sizeof(baseName));
+	if (FS_idPak(baseName, BASEGAME))
+	{
+		return;
+	}
+
+	if (list->paks)
+	{
+		Q_strncpyz(list->paks[list->numPaks].name, pakName, sizeof(list->paks[0].name));
+		Q_strncpyz(list->paks[list->numPaks].ospath, ospath, sizeof(list->paks[0].ospath));
+	}
+	list->numPaks++;
+}
+
+/**
+ * @brief Rebuilds the list of served paks from the current search paths
+ *
+ * The new list is built aside and swapped in as a whole under the lock, so
+ * the server thread never sees a count that doesn't match the array.
+ */
+static void SV_HTTP_UpdatePaks(void)
+{
+	httpPakList_t list;
+	int           numPaks;
+
+	Com_Memset(&list, 0, sizeof(list));
+
+	if (sv_allowDownload->integer)
+	{
+		FS_ForEachPak(SV_HTTP_AddPak, &list);
+		numPaks = list.numPaks;
+
+		if (numPaks)
+		{
+			list.paks = (httpPak_t *)Com_Allocate(numPaks * sizeof(httpPak_t));
+			if (!list.paks)
+			{
+				Com_Error(ERR_FATAL, "SV_HTTP_UpdatePaks: out of memory");
+			}
+			list.numPaks = 0;
+			FS_ForEachPak(SV_HTTP_AddPak, &list);
+		}
+	}
+
+	Com_LockMutex(svHttp.lock);
+	if (svHttp.paks)
+	{
+		Com_Dealloc(svHttp.paks);
+	}
+	svHttp.paks    = list.paks;
+	svHttp.numPaks = list.numPaks;
+	Com_UnlockMutex(svHttp.lock);
+}
+
+/**
+ * @brief Opens the listening socket and starts the server thread
+ * @return
+ */
+static qboolean SV_HTTP_Start(void)
+{
+	struct sockaddr_in address;
+	const char         *ip = Cvar_VariableString("net_ip");
+	int                _true = 1;
+
+	svHttp.port = sv_httpServerPort->integer > 0 ? sv_httpServerPort->integer : Cvar_VariableIntegerValue("net_port");
+
+	Com_Memset(&address, 0, sizeof(address));
+	address.sin_family      = AF_INET;
+	address.sin_port        = htons((unsigned short)svHttp.port);
+	address.sin_addr.s_addr = inet_addr(ip);
+	if (address.sin_addr.s_addr == INADDR_NONE)
+	{
+		address.sin_addr.s_addr = INADDR_ANY;
+	}
+
+	svHttp.listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (svHttp.listener == INVALID_SOCKET)
+	{
+		Com_Printf(S_COLOR_YELLOW "WARNING: HTTP server: can't create socket\n");
+		return qfalse;
+	}
+
+	setsockopt(svHttp.listener, SOL_SOCKET, SO_REUSEADDR, (const char *)&_true, sizeof(_true));
+
+	if (!SV_HTTP_SetNonBlocking(svHttp.listener)
+	    || bind(svHttp.listener, (struct sockaddr *)&address, sizeof(address)) != 0
+	    || listen(svHttp.listener, HTTP_MAX_CONNECTIONS) != 0)
+	{
+		Com_Printf(S_COLOR_YELLOW "WARNING: HTTP server: can't listen on TCP port %i\n", svHttp.port);
+		closesocket(svHttp.listener);
+		svHttp.listener = INVALID_SOCKET;
+		return qfalse;
+	}
+
+	svHttp.lock = Com_CreateMutex();
+	svHttp.quit = 0;
+	SV_HTTP_UpdatePaks();
+
+	svHttp.thread = Com_CreateThread(SV_HTTP_Thread, NULL);
+	if (!svHttp.thread)
+	{
+		Com_Printf(S_COLOR_YELLOW "WARNING: HTTP server: can't start thread\n");
+		SV_HTTP_Shutdown();
+		return qfalse;
+	}
+
+	Com_Printf("HTTP server: serving %i paks on TCP port %i\n", svHttp.numPaks, svHttp.port);
+
+	if (!SV_HTTP_BaseURL())
+	{
+		Com_Printf(S_COLOR_YELLOW "WARNING: HTTP server: set sv_httpServerHost to the public address of the server, clients are not redirected until then\n");
+	}
+
+	return qtrue;
+}
+
+/**
+ * @brief Registers the HTTP server cvars
+ */
+void SV_HTTP_Init(void)
+{
+	sv_httpServer     = Cvar_Get("sv_httpServer", "0", CVAR_ARCHIVE);
+	sv_httpServerPort = Cvar_Get("sv_httpServerPort", "0", CVAR_ARCHIVE);
+	sv_httpServerHost = Cvar_Get("sv_httpServerHost", "", CVAR_ARCHIVE);
+}
+
+/**
+ * @brief Starts or stops the server following sv_httpServer and refreshes the served paks
+ *
+ * @note Called once the paks of a new map are loaded.
+ */
+void SV_HTTP_Update(void)
+{
+	if (!sv_httpServer->integer)
+	{
+		SV_HTTP_Shutdown();
+		return;
+	}
+
+	if (!svHttp.thread)
+	{
+		SV_HTTP_Start();
+		return;
+	}
+
+	SV_HTTP_UpdatePaks();
+}
+
+/**
+ * @brief Stops the server thread and closes all connections
+ */
+void SV_HTTP_Shutdown(void)
+{
+	if (svHttp.thread)
+	{
+		Com_AtomicSet(&svHttp.quit, 1);
+		Com_JoinThread(svHttp.thread);
+		svHttp.thread = NULL;
+	}
+
+	if (svHttp.listener != INVALID_SOCKET)
+	{
+		closesocket(svHttp.listener);
+		svHttp.listener = INVALID_SOCKET;
+	}
+
+	if (svHttp.paks)
+	{
+		Com_Dealloc(svHttp.paks);
+		svHttp.paks = NULL;
+	}
+	svHttp.numPaks = 0;
+
+	if (svHttp.lock)
+	{
+		Com_DestroyMutex(svHttp.lock);
+		svHttp.lock = NULL;
+	}
+}
+
+/**
+ * @brief Base URL clients are redirected to for downloads
+ * @return NULL if the server isn't running or has no public address
+ */
+const char *SV_HTTP_BaseURL(void)
+{
+	static char url[MAX_OSPATH];
+	const char  *host;
+
+	if (!svHttp.thread && svHttp.listener == INVALID_SOCKET)
+	{
+		return NULL;
+	}
+
+	host = sv_httpServerHost->string;
+	if (!*host)
+	{
+		// the bound address is only usable when it is a real one
+		host = Cvar_VariableString("net_ip");
+		if (!*host || !Q_stricmp(host, "0.0.0.0") || !Q_stricmp(host, "localhost"))
+		{
+			return NULL;
+		}
+	}
+
+	Com_sprintf(url, sizeof(url), "http://%s:%i", host, svHttp.port);
+	return url;
+}
+
+#endif // DEDICATED
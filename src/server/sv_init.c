@@ -732,6 +732,7 @@ void SV_SpawnServer(const char *server)
 
 	// allocate the snapshot entities on the hunk
 	svs.snapshotEntities     = Hunk_Alloc(sizeof(entityState_t) * svs.numSnapshotEntities, h_high);
+	svs.snapshotEntityStates = Hunk_Alloc(sizeof(int) * svs.numSnapshotEntities, h_high);
 	svs.nextSnapshotEntities = 0;
 
 	// toggle the server bit so clients can detect that a
@@ -909,6 +910,11 @@ void SV_SpawnServer(const char *server)
 	}
 	Cvar_Set("sv_referencedPakNames", p);
 
+#ifdef DEDICATED
+	// serve the paks of the new map over HTTP
+	SV_HTTP_Update();
+#endif
+
 	// save systeminfo and serverinfo strings
 	cvar_modifiedFlags &= ~CVAR_SYSTEMINFO;
 	SV_SetConfigstring(CS_SYSTEMINFO, Cvar_InfoString_Big(CVAR_SYSTEMINFO));
@@ -1108,6 +1114,10 @@ void SV_Init(void)
 
 	sv_wh_check_fov = Cvar_Get("wh_check_fov", "0", CVAR_ARCHIVE);
 
+	// visibility results are reused while both players stay within a few units, 0 traces every pair every frame
+	sv_wh_cache   = Cvar_Get("sv_wh_cache", "100", CVAR_ARCHIVE);
+	sv_wh_threads = Cvar_Get("sv_wh_threads", "0", CVAR_ARCHIVE);
+
 	SV_InitWallhack();
 #endif
 
@@ -1137,6 +1147,9 @@ void SV_Init(void)
 
 	sv_showAverageBPS = Cvar_Get("sv_showAverageBPS", "0", 0); // net debugging
 
+	sv_snapshotThreads      = Cvar_GetAndDescribe("sv_snapshotThreads", "0", CVAR_ARCHIVE, "Number of worker threads building client snapshots on a dedicated server, 0 builds them on the main thread.");
+	sv_snapshotThreadsCheck = Cvar_Get("sv_snapshotThreadsCheck", "0", CVAR_TEMP);
+
 	// create user set cvars
 	Cvar_Get("g_userTimeLimit", "0", 0);
 	Cvar_Get("g_userAlliedRespawnTime", "0", 0);
@@ -1185,6 +1198,7 @@ void SV_Init(void)
 	sv_freezeDemo   = Cvar_Get("cl_freezeDemo", "0", CVAR_TEMP); // port from client-side to freeze server-side demos
 	sv_demoTolerant = Cvar_Get("sv_demoTolerant", "0", CVAR_ARCHIVE);
 	sv_demopath     = Cvar_Get("sv_demopath", "", CVAR_ARCHIVE);
+	sv_demoKeyframe = Cvar_Get("sv_demoKeyframe", "60", CVAR_ARCHIVE);
 
 	// init the botlib here because we need the pre-compiler in the UI
 	SV_BotInitBotLib();
@@ -1195,6 +1209,10 @@ void SV_Init(void)
 
 	sv_serverTimeReset = Cvar_GetAndDescribe("sv_serverTimeReset", "0", CVAR_ARCHIVE_ND, "Reset server time on map change.");
 
+#ifdef DEDICATED
+	SV_HTTP_Init();
+#endif
+
 #if defined(FEATURE_IRC_SERVER) && defined(DEDICATED)
 	IRC_Init();
 #endif
@@ -1277,6 +1295,13 @@ void SV_Shutdown(const char *finalmsg)
 	SV_RemoveOperatorCommands();
 	SV_MasterShutdown();
 	SV_ShutdownGameProgs();
+	SV_ShutdownSnapshotThreads();
+#ifdef DEDICATED
+	SV_HTTP_Shutdown();
+#endif
+#ifdef FEATURE_ANTICHEAT
+	SV_ShutdownWallhack();
+#endif
 
 	// SV_ShutdownGameProgs calls SV_DemoStopAll();
 
@@ -1288,6 +1313,8 @@ void SV_Shutdown(const char *finalmsg)
 	{
 		int index;
 
+		SV_ShutdownDownloads();
+
 		for (index = 0; index < sv_maxclients->integer; index++)
 		{
 			SV_Netchan_ClearQueue(&svs.clients[index]);
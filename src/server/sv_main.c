@@ -109,6 +109,8 @@ cvar_t *sv_wh_active;
 cvar_t *sv_wh_bbox_horz;
 cvar_t *sv_wh_bbox_vert;
 cvar_t *sv_wh_check_fov;
+cvar_t *sv_wh_cache;
+cvar_t *sv_wh_threads;
 #endif
 
 cvar_t *sv_demopath;
@@ -116,11 +118,15 @@ cvar_t *sv_demoState;
 cvar_t *sv_autoDemo;
 cvar_t *sv_freezeDemo;  // to freeze server-side demos
 cvar_t *sv_demoTolerant;
+cvar_t *sv_demoKeyframe; // seconds between full demo frames
 
 cvar_t *sv_ipMaxClients;
 
 cvar_t *sv_serverTimeReset;
 
+cvar_t *sv_snapshotThreads;      // worker threads building client snapshots, 0 = main thread only
+cvar_t *sv_snapshotThreadsCheck; // debug: compare threaded snapshots against the serial path
+
 static void SVC_Status(netadr_t from, qboolean force);
 
 /*
@@ -56,6 +56,173 @@ A normal server packet will look like:
 =============================================================================
 */
 
+#define DELTA_CACHE_WAYS        4           ///< cached deltas per entity, clients ack different frames
+#define MAX_DELTA_CACHE_BYTES   256         ///< bigger deltas are written directly
+#define DELTA_CACHE_LOCKS       64          ///< power of 2, only used by the snapshot threads
+
+/**
+ * @struct entityDeltaCache_t
+ * @brief An entity delta as encoded by MSG_WriteDeltaEntity
+ *
+ * The encoding only depends on the two states and the force flag, so a
+ * delta most clients need this frame is encoded once and then copied.
+ */
+typedef struct
+{
+	qboolean valid;
+	qboolean force;
+	entityState_t from;
+	entityState_t to;
+	int fromState;                      ///< svs.snapshotEntityStates ids of the two states, 0 if unknown
+	int toState;
+	int bits;                           ///< length of the encoded delta
+	int uncompsize;                     ///< net debugging
+	byte data[MAX_DELTA_CACHE_BYTES];
+} entityDeltaCache_t;
+
+static entityDeltaCache_t sv_deltaCache[MAX_GENTITIES][DELTA_CACHE_WAYS];
+static int                sv_deltaCacheNext[MAX_GENTITIES];       ///< way to replace next
+static qmutex_t           *sv_deltaCacheLocks[DELTA_CACHE_LOCKS]; ///< set while the snapshot threads run
+static int                sv_snapshotStateCount;                  ///< last svEntity_t::snapshotStateId handed out
+static int                sv_snapshotCandidateBuild;              ///< counts SV_BuildSnapshotCandidates calls
+
+/**
+ * @brief Looks the delta up in the cache and copies it into the message
+ * @param[in,out] msg
+ * @param[in] from
+ * @param[in] to
+ * @param[in] force
+ * @param[in] fromState
+ * @param[in] toState
+ * @return qfalse if the delta isn't cached
+ */
+static qboolean SV_WriteCachedDelta(msg_t *msg, entityState_t *from, entityState_t *to, qboolean force, int fromState, int toState)
+{
+	entityDeltaCache_t *entry = sv_deltaCache[to->number];
+	int                i;
+
+	for (i = 0; i < DELTA_CACHE_WAYS; i++, entry++)
+	{
+		if (!entry->valid || entry->force != force)
+		{
+			continue;
+		}
+
+		// equal state ids are equal states
+		if ((fromState && toState && entry->fromState == fromState && entry->toState == toState) ||
+		    (!memcmp(&entry->to, to, sizeof(*to)) && !memcmp(&entry->from, from, sizeof(*from))))
+		{
+			MSG_WriteEncodedBits(msg, entry->data, entry->bits, entry->uncompsize);
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+/**
+ * @brief Same as MSG_WriteDeltaEntity, but the encoded bits are shared between clients
+ *
+ * The state ids come from svs.snapshotEntityStates. Known ids spare the
+ * state compares, and a delta between the last two states of the entity
+ * reuses the change vector SV_BuildSnapshotCandidates found.
+ *
+ * @param[in,out] msg
+ * @param[in] from
+ * @param[in] to
+ * @param[in] force
+ * @param[in] fromState
+ * @param[in] toState
+ */
+static void SV_WriteDeltaEntity(msg_t *msg, entityState_t *from, entityState_t *to, qboolean force, int fromState, int toState)
+{
+	byte               buf[MAX_DELTA_CACHE_BYTES];
+	msg_t              delta;
+	entityDeltaCache_t *entry;
+	svEntity_t         *svEnt;
+	qmutex_t           *lock;
+	qboolean           cached;
+
+	// nothing at all changed, this writes nothing
+	if (!force && ((fromState && fromState == toState) || !memcmp(from, to, sizeof(*to))))
+	{
+		return;
+	}
+
+	if (to->number < 0 || to->number >= MAX_GENTITIES)
+	{
+		if (msg->threaded)
+		{
+			MSG_SetError(msg, ERR_FATAL, "MSG_WriteDeltaEntity: Bad entity number");
+			return;
+		}
+		Com_Error(ERR_FATAL, "MSG_WriteDeltaEntity: Bad entity number: %i", to->number);
+	}
+
+	lock = sv_deltaCacheLocks[to->number & (DELTA_CACHE_LOCKS - 1)];
+
+	if (lock)
+	{
+		Com_LockMutex(lock);
+	}
+	cached = SV_WriteCachedDelta(msg, from, to, force, fromState, toState);
+	if (lock)
+	{
+		Com_UnlockMutex(lock);
+	}
+
+	if (cached)
+	{
+		return;
+	}
+
+	MSG_Init(&delta, buf, sizeof(buf));
+	delta.allowoverflow = qtrue;
+	delta.threaded      = msg->threaded;
+
+	svEnt = &sv.svEntities[to->number];
+
+	if (fromState && fromState == svEnt->snapshotPrevStateId && toState == svEnt->snapshotStateId)
+	{
+		MSG_WriteDeltaEntityChanges(&delta, from, to, svEnt->snapshotChanges, force);
+	}
+	else
+	{
+		MSG_WriteDeltaEntity(&delta, from, to, force);
+	}
+
+	if (delta.overflowed)
+	{
+		MSG_WriteDeltaEntity(msg, from, to, force);
+		return;
+	}
+
+	MSG_WriteEncodedBits(msg, delta.data, delta.bit, delta.uncompsize);
+
+	if (lock)
+	{
+		Com_LockMutex(lock);
+	}
+
+	entry = &sv_deltaCache[to->number][sv_deltaCacheNext[to->number]];
+	sv_deltaCacheNext[to->number] = (sv_deltaCacheNext[to->number] + 1) % DELTA_CACHE_WAYS;
+
+	entry->valid      = qtrue;
+	entry->force      = force;
+	entry->from       = *from;
+	entry->to         = *to;
+	entry->fromState  = fromState;
+	entry->toState    = toState;
+	entry->bits       = delta.bit;
+	entry->uncompsize = delta.uncompsize;
+	Com_Memcpy(entry->data, delta.data, (delta.bit + 7) >> 3);
+
+	if (lock)
+	{
+		Com_UnlockMutex(lock);
+	}
+}
+
 /**
  * @brief Writes a delta update of an entityState_t list to the message.
  * @param[in] from
@@ -67,6 +234,7 @@ static void SV_EmitPacketEntities(clientSnapshot_t *from, clientSnapshot_t *to,
 	entityState_t *oldent = NULL, *newent = NULL;
 	int           oldindex = 0, newindex = 0;
 	int           oldnum, newnum;
+	int           oldstate = 0, newstate = 0;
 	int           from_num_entities;
 
 	// generate the delta update
@@ -87,8 +255,9 @@ static void SV_EmitPacketEntities(clientSnapshot_t *from, clientSnapshot_t *to,
 		}
 		else
 		{
-			newent = &svs.snapshotEntities[(to->first_entity + newindex) % svs.numSnapshotEntities];
-			newnum = newent->number;
+			newent   = &svs.snapshotEntities[(to->first_entity + newindex) % svs.numSnapshotEntities];
+			newnum   = newent->number;
+			newstate = svs.snapshotEntityStates[(to->first_entity + newindex) % svs.numSnapshotEntities];
 		}
 
 		if (oldindex >= from_num_entities)
@@ -97,8 +266,9 @@ static void SV_EmitPacketEntities(clientSnapshot_t *from, clientSnapshot_t *to,
 		}
 		else
 		{
-			oldent = &svs.snapshotEntities[(from->first_entity + oldindex) % svs.numSnapshotEntities];
-			oldnum = oldent->number;
+			oldent   = &svs.snapshotEntities[(from->first_entity + oldindex) % svs.numSnapshotEntities];
+			oldnum   = oldent->number;
+			oldstate = svs.snapshotEntityStates[(from->first_entity + oldindex) % svs.numSnapshotEntities];
 		}
 
 		if (newnum == oldnum)
@@ -106,7 +276,7 @@ static void SV_EmitPacketEntities(clientSnapshot_t *from, clientSnapshot_t *to,
 			// delta update from old position
 			// because the force parm is qfalse, this will not result
 			// in any bytes being emited if the entity has not changed at all
-			MSG_WriteDeltaEntity(msg, oldent, newent, qfalse);
+			SV_WriteDeltaEntity(msg, oldent, newent, qfalse, oldstate, newstate);
 			oldindex++;
 			newindex++;
 			continue;
@@ -116,11 +286,16 @@ static void SV_EmitPacketEntities(clientSnapshot_t *from, clientSnapshot_t *to,
 		{
 			if (newnum >= MAX_GENTITIES)
 			{
+				if (msg->threaded)
+				{
+					MSG_SetError(msg, ERR_FATAL, "SV_EmitPacketEntities: MAX_GENTITIES exceeded");
+					return;
+				}
 				Com_Error(ERR_FATAL, "SV_EmitPacketEntities: MAX_GENTITIES exceeded");
 			}
 
 			// this is a new entity, send it from the baseline
-			MSG_WriteDeltaEntity(msg, &sv.svEntities[newnum].baseline, newent, qtrue);
+			SV_WriteDeltaEntity(msg, &sv.svEntities[newnum].baseline, newent, qtrue, 0, newstate);
 			newindex++;
 			continue;
 		}
@@ -138,48 +313,64 @@ static void SV_EmitPacketEntities(clientSnapshot_t *from, clientSnapshot_t *to,
 }
 
 /**
- * @brief SV_WriteSnapshotToClient
+ * @brief Picks the previous frame the snapshot currently being built will be delta'd from
  * @param[in] client
- * @param[in] msg
+ * @param[out] lastframe how many frames back the delta source is, 0 for none
+ * @return The delta source or NULL if a full snapshot has to be sent
  */
-static void SV_WriteSnapshotToClient(client_t *client, msg_t *msg)
+static clientSnapshot_t *SV_SnapshotDeltaFrame(client_t *client, int *lastframe)
 {
-	clientSnapshot_t *frame, *oldframe;
-	int              lastframe;
-	int              snapFlags;
-
-	// this is the snapshot we are creating
-	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+	clientSnapshot_t *oldframe;
 
 	// try to use a previous frame as the source for delta compressing the snapshot
 	if (client->deltaMessage <= 0 || client->state != CS_ACTIVE)
 	{
 		// client is asking for a retransmit
-		oldframe  = NULL;
-		lastframe = 0;
+		oldframe   = NULL;
+		*lastframe = 0;
 	}
 	else if (client->netchan.outgoingSequence - client->deltaMessage >= (PACKET_BACKUP - 3))
 	{
 		// client hasn't gotten a good message through in a long time
 		Com_DPrintf("%s: Delta request from out of date packet.\n", client->name);
-		oldframe  = NULL;
-		lastframe = 0;
+		oldframe   = NULL;
+		*lastframe = 0;
 	}
 	else
 	{
 		// we have a valid snapshot to delta from
-		oldframe  = &client->frames[client->deltaMessage & PACKET_MASK];
-		lastframe = client->netchan.outgoingSequence - client->deltaMessage;
+		oldframe   = &client->frames[client->deltaMessage & PACKET_MASK];
+		*lastframe = client->netchan.outgoingSequence - client->deltaMessage;
 
 		// the snapshot's entities may still have rolled off the buffer, though
 		if (oldframe->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities)
 		{
 			Com_DPrintf("%s: Delta request from out of date entities.\n", client->name);
-			oldframe  = NULL;
-			lastframe = 0;
+			oldframe   = NULL;
+			*lastframe = 0;
 		}
 	}
 
+	return oldframe;
+}
+
+/**
+ * @brief SV_WriteSnapshotToClient
+ * @param[in] client
+ * @param[in] oldframe
+ * @param[in] lastframe
+ * @param[in] msg
+ *
+ * @note Called from the snapshot worker threads, see SV_SendClientMessages
+ */
+static void SV_WriteSnapshotToClient(client_t *client, clientSnapshot_t *oldframe, int lastframe, msg_t *msg)
+{
+	clientSnapshot_t *frame;
+	int              snapFlags;
+
+	// this is the snapshot we are creating
+	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+
 	MSG_WriteByte(msg, svc_snapshot);
 
 	// NOTE, MRE: now sent at the start of every message from server to client
@@ -270,10 +461,18 @@ Build a client snapshot structure
 //#define   MAX_SNAPSHOT_ENTITIES   1024 // q3 uses this
 #define MAX_SNAPSHOT_ENTITIES   2048
 
+/**
+ * @struct snapshotEntityNumbers_t
+ * @brief Entities found visible for one client snapshot
+ *
+ * Every entity is added at most once, the game snapshot callback and the
+ * MAX_SNAPSHOT_ENTITIES limit are applied afterwards by SV_FilterSnapshotEntities.
+ */
 typedef struct
 {
 	int numSnapshotEntities;
-	int snapshotEntities[MAX_SNAPSHOT_ENTITIES];
+	int snapshotEntities[MAX_GENTITIES];
+	byte added[MAX_GENTITIES];          ///< used to prevent double adding from portal views
 } snapshotEntityNumbers_t;
 
 /**
@@ -304,37 +503,275 @@ static int QDECL SV_QsortEntityNumbers(const void *a, const void *b)
 
 /**
  * @brief SV_AddEntToSnapshot
- * @param[in] clientEnt
- * @param[in,out] svEnt
- * @param[in] gEnt
+ * @param[in] entityNum
  * @param[in,out] eNums
  */
-static void SV_AddEntToSnapshot(sharedEntity_t *clientEnt, svEntity_t *svEnt, sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums)
+static void SV_AddEntToSnapshot(int entityNum, snapshotEntityNumbers_t *eNums)
 {
 	// if we have already added this entity to this snapshot, don't add again
-	if (svEnt->snapshotCounter == sv.snapshotCounter)
+	if (eNums->added[entityNum])
 	{
 		return;
 	}
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	eNums->added[entityNum] = 1;
+
+	eNums->snapshotEntities[eNums->numSnapshotEntities] = entityNum;
+	eNums->numSnapshotEntities++;
+}
+
+/**
+ * @brief Drops the entities the game doesn't want to send to this client and
+ * applies the MAX_SNAPSHOT_ENTITIES limit, in the order they were added.
+ *
+ * @param[in] clientEnt
+ * @param[in,out] eNums
+ *
+ * @note Calls into the game VM, so this must run on the main thread
+ */
+static void SV_FilterSnapshotEntities(sharedEntity_t *clientEnt, snapshotEntityNumbers_t *eNums)
+{
+	sharedEntity_t *gEnt;
+	int            i, numEntities = 0;
+
+	for (i = 0; i < eNums->numSnapshotEntities; i++)
+	{
+		// if we are full, silently discard entities
+		if (numEntities == MAX_SNAPSHOT_ENTITIES)
+		{
+			Com_Printf("Warning: MAX_SNAPSHOT_ENTITIES reached. Ignoring ent.\n");
+			continue;
+		}
+
+		gEnt = SV_GentityNum(eNums->snapshotEntities[i]);
+
+		if (gEnt->r.snapshotCallback)
+		{
+			if (!(qboolean)(VM_Call(gvm, GAME_SNAPSHOT_CALLBACK, gEnt->s.number, clientEnt->s.number)))
+			{
+				continue;
+			}
+		}
+
+		eNums->snapshotEntities[numEntities++] = gEnt->s.number;
+	}
+
+	eNums->numSnapshotEntities = numEntities;
+}
+
+/**
+ * @struct snapshotCandidates_t
+ * @brief Entities which can go into a snapshot this frame
+ *
+ * Built once per frame by SV_BuildSnapshotCandidates, so the gather of every
+ * client walks only the linked entities the clients may see instead of all
+ * sv.num_entities, and finds what it tests packed together.
+ * The clusters of an entity are merged into (PVS byte, bit mask) pairs.
+ */
+typedef struct
+{
+	int numEntities;
+	int number[MAX_GENTITIES];
+	int svFlags[MAX_GENTITIES];
+	int singleClient[MAX_GENTITIES];
+	int otherEntityNum[MAX_GENTITIES];
+	int areanum[MAX_GENTITIES];
+	int areanum2[MAX_GENTITIES];
+	int originCluster[MAX_GENTITIES];
+	int firstClusterByte[MAX_GENTITIES];                    ///< into clusterBytes and clusterMasks
+	int numClusterBytes[MAX_GENTITIES];                     ///< -1 if the clusters overflowed, see SV_EntityClustersInPVS
+	int clusterBytes[MAX_GENTITIES * MAX_ENT_CLUSTERS];
+	byte clusterMasks[MAX_GENTITIES * MAX_ENT_CLUSTERS];
+} snapshotCandidates_t;
+
+static snapshotCandidates_t sv_snapshotCandidates;
+
+/**
+ * @brief Records the state the snapshots will copy of a candidate entity
+ *
+ * The state gets a new id whenever it differs from the last one, along with
+ * the change vector between the two. Snapshot entities carry the id, so the
+ * encoder knows equal states and consecutive states without comparing them.
+ *
+ * @param[in,out] svEnt
+ * @param[in] ent
+ */
+static void SV_UpdateSnapshotState(svEntity_t *svEnt, sharedEntity_t *ent)
+{
+	if (!svEnt->snapshotStateId || memcmp(&svEnt->snapshotState, &ent->s, sizeof(ent->s)))
+	{
+		MSG_EntityStateChanges(&svEnt->snapshotState, &ent->s, svEnt->snapshotChanges);
+
+		if (++sv_snapshotStateCount <= 0)
+		{
+			sv_snapshotStateCount = 1;
+		}
+
+		svEnt->snapshotState       = ent->s;
+		svEnt->snapshotPrevStateId = svEnt->snapshotStateId;
+		svEnt->snapshotStateId     = sv_snapshotStateCount;
+	}
+
+	svEnt->snapshotStateBuild = sv_snapshotCandidateBuild;
+}
+
+/**
+ * @brief Collects the entities which can be sent to the clients this frame
+ *
+ * Must be redone whenever the game could have linked or unlinked entities,
+ * which is after every client drop.
+ */
+static void SV_BuildSnapshotCandidates(void)
+{
+	snapshotCandidates_t *sc = &sv_snapshotCandidates;
+	sharedEntity_t       *ent;
+	svEntity_t           *svEnt;
+	int                  e, i, j, c, l, first, numBytes = 0;
+
+	sc->numEntities = 0;
+
+	sv_snapshotCandidateBuild++;
 
-	// if we are full, silently discard entities
-	if (eNums->numSnapshotEntities == MAX_SNAPSHOT_ENTITIES)
+	if (!sv.state)
 	{
-		Com_Printf("Warning: MAX_SNAPSHOT_ENTITIES reached. Ignoring ent.\n");
 		return;
 	}
 
-	if (gEnt->r.snapshotCallback)
+	for (e = 0; e < sv.num_entities; e++)
 	{
-		if (!(qboolean)(VM_Call(gvm, GAME_SNAPSHOT_CALLBACK, gEnt->s.number, clientEnt->s.number)))
+		ent = SV_GentityNum(e);
+
+		// never send entities that aren't linked in
+		if (!ent->r.linked)
 		{
-			return;
+			continue;
+		}
+
+		if (ent->s.number != e)
+		{
+			Com_DPrintf("FIXING ENT->S.NUMBER!!!\n");
+			ent->s.number = e;
+		}
+
+		// entities can be flagged to explicitly not be sent to the client
+		if (ent->r.svFlags & SVF_NOCLIENT)
+		{
+			continue;
+		}
+
+		svEnt = &sv.svEntities[e];
+		c     = sc->numEntities++;
+
+		SV_UpdateSnapshotState(svEnt, ent);
+
+		sc->number[c]         = e;
+		sc->svFlags[c]        = ent->r.svFlags;
+		sc->singleClient[c]   = ent->r.singleClient;
+		sc->otherEntityNum[c] = ent->s.otherEntityNum;
+		sc->areanum[c]        = svEnt->areanum;
+		sc->areanum2[c]       = svEnt->areanum2;
+		sc->originCluster[c]  = svEnt->originCluster;
+
+		first                   = numBytes;
+		sc->firstClusterByte[c] = first;
+
+		// the overflow clusters are only known as a range, test those the slow way
+		if (svEnt->lastCluster)
+		{
+			sc->numClusterBytes[c] = -1;
+			continue;
+		}
+
+		for (i = 0; i < svEnt->numClusters; i++)
+		{
+			l = svEnt->clusternums[i];
+
+			for (j = first; j < numBytes; j++)
+			{
+				if (sc->clusterBytes[j] == (l >> 3))
+				{
+					break;
+				}
+			}
+
+			if (j == numBytes)
+			{
+				sc->clusterBytes[numBytes] = l >> 3;
+				sc->clusterMasks[numBytes] = 0;
+				numBytes++;
+			}
+
+			sc->clusterMasks[j] |= 1 << (l & 7);
 		}
+
+		sc->numClusterBytes[c] = numBytes - first;
 	}
+}
 
-	eNums->snapshotEntities[eNums->numSnapshotEntities] = gEnt->s.number;
-	eNums->numSnapshotEntities++;
+/**
+ * @brief Tests the clusters of an entity which touches more than MAX_ENT_CLUSTERS
+ * @param[in] svEnt
+ * @param[in] bitvector
+ * @return
+ */
+qboolean SV_EntityClustersInPVS(svEntity_t *svEnt, const byte *bitvector)
+{
+	int i, l;
+
+	// check individual leafs
+	if (!svEnt->numClusters)
+	{
+		return qfalse;
+	}
+	l = 0;
+	for (i = 0 ; i < svEnt->numClusters ; i++)
+	{
+		l = svEnt->clusternums[i];
+		if (bitvector[l >> 3] & (1 << (l & 7)))
+		{
+			return qtrue;
+		}
+	}
+
+	// we haven't found it to be visible,
+	// check overflow clusters that coudln't be stored
+	for ( ; l <= svEnt->lastCluster ; l++)
+	{
+		if (bitvector[l >> 3] & (1 << (l & 7)))
+		{
+			break;
+		}
+	}
+
+	return (qboolean)(l != svEnt->lastCluster);
+}
+
+/**
+ * @brief Tells if any cluster the candidate touches is in the PVS
+ * @param[in] sc
+ * @param[in] c
+ * @param[in] bitvector
+ * @return
+ */
+static qboolean SV_CandidateInPVS(const snapshotCandidates_t *sc, int c, const byte *bitvector)
+{
+	int i, last;
+
+	if (sc->numClusterBytes[c] < 0)
+	{
+		return SV_EntityClustersInPVS(&sv.svEntities[sc->number[c]], bitvector);
+	}
+
+	last = sc->firstClusterByte[c] + sc->numClusterBytes[c];
+
+	for (i = sc->firstClusterByte[c]; i < last; i++)
+	{
+		if (bitvector[sc->clusterBytes[i]] & sc->clusterMasks[i])
+		{
+			return qtrue;
+		}
+	}
+
+	return qfalse;
 }
 
 #ifdef FEATURE_ANTICHEAT
@@ -356,17 +793,16 @@ static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t *fram
 static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t *frame, snapshotEntityNumbers_t *eNums)
 #endif
 {
-	int            e, i;
-	sharedEntity_t *ent, *playerEnt, *ment;
+	int                  e, c, svFlags;
+	sharedEntity_t       *ent, *playerEnt, *ment;
 #ifdef FEATURE_ANTICHEAT
 	sharedEntity_t *client;
 #endif
-	svEntity_t *svEnt;
-	int        l;
-	int        clientarea, clientcluster;
-	int        leafnum;
-	byte       *clientpvs;
-	byte       *bitvector;
+	snapshotCandidates_t *sc = &sv_snapshotCandidates;
+	int                  clientarea, clientcluster;
+	int                  leafnum;
+	byte                 *clientpvs;
+	byte                 *bitvector;
 
 	// during an error shutdown message we may need to transmit
 	// the shutdown message after the server has shutdown, so
@@ -395,68 +831,49 @@ static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t *fram
 #endif
 	}
 
-	for (e = 0 ; e < sv.num_entities ; e++)
+	for (c = 0; c < sc->numEntities; c++)
 	{
-		ent = SV_GentityNum(e);
-
-		// never send entities that aren't linked in
-		if (!ent->r.linked)
-		{
-			continue;
-		}
-
-		if (ent->s.number != e)
-		{
-			Com_DPrintf("FIXING ENT->S.NUMBER!!!\n");
-			ent->s.number = e;
-		}
-
-		// entities can be flagged to explicitly not be sent to the client
-		if (ent->r.svFlags & SVF_NOCLIENT)
-		{
-			continue;
-		}
+		e       = sc->number[c];
+		svFlags = sc->svFlags[c];
 
 		// entities can be flagged to be sent to only one client
-		if (ent->r.svFlags & SVF_SINGLECLIENT)
+		if (svFlags & SVF_SINGLECLIENT)
 		{
-			if (ent->r.singleClient != frame->ps.clientNum)
+			if (sc->singleClient[c] != frame->ps.clientNum)
 			{
 				continue;
 			}
 		}
 		// entities can be flagged to be sent to everyone but one client
-		if (ent->r.svFlags & SVF_NOTSINGLECLIENT)
+		if (svFlags & SVF_NOTSINGLECLIENT)
 		{
-			if (ent->r.singleClient == frame->ps.clientNum)
+			if (sc->singleClient[c] == frame->ps.clientNum)
 			{
 				continue;
 			}
 		}
 
-		svEnt = SV_SvEntityForGentity(ent);
-
 		// don't double add an entity through portals
-		if (svEnt->snapshotCounter == sv.snapshotCounter)
+		if (eNums->added[e])
 		{
 			continue;
 		}
 
 		// broadcast entities are always sent
-		if (ent->r.svFlags & SVF_BROADCAST)
+		if (svFlags & SVF_BROADCAST)
 		{
-			SV_AddEntToSnapshot(playerEnt, svEnt, ent, eNums);
+			SV_AddEntToSnapshot(e, eNums);
 			continue;
 		}
 
 		bitvector = clientpvs;
 
 		// just check origin for being in pvs, ignore bmodel extents
-		if (ent->r.svFlags & SVF_IGNOREBMODELEXTENTS)
+		if (svFlags & SVF_IGNOREBMODELEXTENTS)
 		{
-			if (bitvector[svEnt->originCluster >> 3] & (1 << (svEnt->originCluster & 7)))
+			if (bitvector[sc->originCluster[c] >> 3] & (1 << (sc->originCluster[c] & 7)))
 			{
-				SV_AddEntToSnapshot(playerEnt, svEnt, ent, eNums);
+				SV_AddEntToSnapshot(e, eNums);
 			}
 
 			continue;
@@ -464,123 +881,55 @@ static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t *fram
 
 		// ignore if not touching a PV leaf
 		// check area
-		if (!CM_AreasConnected(clientarea, svEnt->areanum))
+		if (!CM_AreasConnected(clientarea, sc->areanum[c]))
 		{
 			// doors can legally straddle two areas, so
 			// we may need to check another one
-			if (!CM_AreasConnected(clientarea, svEnt->areanum2))
+			if (!CM_AreasConnected(clientarea, sc->areanum2[c]))
 			{
 				continue;
 			}
 		}
 
 		// check individual leafs
-		if (!svEnt->numClusters)
+		if (!SV_CandidateInPVS(sc, c, bitvector))
 		{
-			continue;
+			continue; // not visible
 		}
-		l = 0;
-		for (i = 0 ; i < svEnt->numClusters ; i++)
-		{
-			l = svEnt->clusternums[i];
-			if (bitvector[l >> 3] & (1 << (l & 7)))
-			{
-				break;
-			}
-		}
-
-		// if we haven't found it to be visible,
-		// check overflow clusters that coudln't be stored
-		if (i == svEnt->numClusters)
-		{
-			if (svEnt->lastCluster)
-			{
-				for ( ; l <= svEnt->lastCluster ; l++)
-				{
-					if (bitvector[l >> 3] & (1 << (l & 7)))
-					{
-						break;
-					}
-				}
-				if (l == svEnt->lastCluster)
-				{
-					continue; // not visible
-				}
-			}
-			else
-			{
-				continue;
-			}
-		}
-
-		// added "visibility dummies"
-		if (ent->r.svFlags & SVF_VISDUMMY)
+
+		// added "visibility dummies"
+		if (svFlags & SVF_VISDUMMY)
 		{
 			// find master;
-			ment = SV_GentityNum(ent->s.otherEntityNum);
+			ment = SV_GentityNum(sc->otherEntityNum[c]);
 
 			if (ment)
 			{
-				svEntity_t *master = 0;
-				master = SV_SvEntityForGentity(ment);
-
-				if (master->snapshotCounter == sv.snapshotCounter || !ment->r.linked)
+				if (eNums->added[ment->s.number] || !ment->r.linked)
 				{
 					continue;
 				}
 
-				SV_AddEntToSnapshot(playerEnt, master, ment, eNums);
+				SV_AddEntToSnapshot(ment->s.number, eNums);
 			}
 
 			continue;   // master needs to be added, but not this dummy ent
 		}
-		else if (ent->r.svFlags & SVF_VISDUMMY_MULTIPLE)
+		else if (svFlags & SVF_VISDUMMY_MULTIPLE)
 		{
-			int        h;
-			svEntity_t *master = 0;
+			int h;
 
-			for (h = 0; h < sv.num_entities; h++)
+			// the candidates are all linked and sendable
+			for (h = 0; h < sc->numEntities; h++)
 			{
-				ment = SV_GentityNum(h);
-
-				if (ment == ent)
+				if (h == c || eNums->added[sc->number[h]])
 				{
 					continue;
 				}
 
-				if (ment)
+				if (sc->otherEntityNum[h] == e)
 				{
-					master = SV_SvEntityForGentity(ment);
-				}
-				else
-				{
-					continue;
-				}
-
-				if (!(ment->r.linked))
-				{
-					continue;
-				}
-
-				if (ment->s.number != h)
-				{
-					Com_DPrintf("FIXING vis dummy multiple ment->S.NUMBER!!!\n");
-					ment->s.number = h;
-				}
-
-				if (ment->r.svFlags & SVF_NOCLIENT)
-				{
-					continue;
-				}
-
-				if (master->snapshotCounter == sv.snapshotCounter)
-				{
-					continue;
-				}
-
-				if (ment->s.otherEntityNum == ent->s.number)
-				{
-					SV_AddEntToSnapshot(playerEnt, master, ment, eNums);
+					SV_AddEntToSnapshot(sc->number[h], eNums);
 				}
 			}
 
@@ -605,7 +954,7 @@ static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t *fram
 				if (!SV_CanSee(frame->ps.clientNum, e))
 				{
 					SV_RandomizePos(frame->ps.clientNum, e);
-					SV_AddEntToSnapshot(client, svEnt, ent, eNums);
+					SV_AddEntToSnapshot(e, eNums);
 					continue;
 				}
 			}
@@ -613,11 +962,12 @@ static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t *fram
 #endif
 
 		// add it
-		SV_AddEntToSnapshot(playerEnt, svEnt, ent, eNums);
+		SV_AddEntToSnapshot(e, eNums);
 
 		// if its a portal entity, add everything visible from its camera position
-		if (ent->r.svFlags & SVF_PORTAL)
+		if (svFlags & SVF_PORTAL)
 		{
+			ent = SV_GentityNum(e);
 #ifdef FEATURE_ANTICHEAT
 			SV_AddEntitiesVisibleFromPoint(ent->s.origin2, frame, eNums, qtrue /*localClient*/);
 #else
@@ -639,28 +989,28 @@ static void SV_AddEntitiesVisibleFromPoint(vec3_t origin, clientSnapshot_t *fram
  * For viewing through other player's eyes, clent can be something other than client->gentity
  *
  * @param[in,out] client
+ * @param[out] eNums
+ * @return qfalse if there is nothing to send and the frame is left empty
+ *
+ * @note Only touches the client's own frame and eNums, so the snapshot worker
+ * threads can run this for different clients at the same time, unless the
+ * anti-wallhack is active.
  */
-static void SV_BuildClientSnapshot(client_t *client)
+static qboolean SV_GatherClientSnapshot(client_t *client, snapshotEntityNumbers_t *eNums)
 {
-	vec3_t                  org;
-	clientSnapshot_t        *frame;
-	snapshotEntityNumbers_t entityNumbers;
-	int                     i;
-	sharedEntity_t          *ent;
-	entityState_t           *state;
-	svEntity_t              *svEnt;
-	sharedEntity_t          *clent;
-	int                     clientNum;
-	playerState_t           *ps;
-
-	// bump the counter used to prevent double adding
-	sv.snapshotCounter++;
+	vec3_t           org;
+	clientSnapshot_t *frame;
+	int              i;
+	sharedEntity_t   *clent;
+	int              clientNum;
+	playerState_t    *ps;
 
 	// this is the frame we are creating
 	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
 
 	// clear everything in this snapshot
-	entityNumbers.numSnapshotEntities = 0;
+	eNums->numSnapshotEntities = 0;
+	Com_Memset(eNums->added, 0, sizeof(eNums->added));
 	Com_Memset(frame->areabits, 0, sizeof(frame->areabits));
 
 	frame->num_entities = 0;
@@ -668,7 +1018,7 @@ static void SV_BuildClientSnapshot(client_t *client)
 	clent = client->gentity;
 	if (!clent || client->state == CS_ZOMBIE)
 	{
-		return;
+		return qfalse;
 	}
 
 	// grab the current playerState_t
@@ -682,9 +1032,8 @@ static void SV_BuildClientSnapshot(client_t *client)
 	{
 		Com_Error(ERR_DROP, "SV_BuildClientSnapshot: bad gEnt");
 	}
-	svEnt = &sv.svEntities[clientNum];
 
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	eNums->added[clientNum] = 1;
 
 	if (clent->r.svFlags & SVF_SELF_PORTAL_EXCLUSIVE)
 	{
@@ -711,18 +1060,11 @@ static void SV_BuildClientSnapshot(client_t *client)
 	// add all the entities directly visible to the eye, which
 	// may include portal entities that merge other viewpoints
 #ifdef FEATURE_ANTICHEAT
-	SV_AddEntitiesVisibleFromPoint(org, frame, &entityNumbers, qfalse /*client->netchan.remoteAddress.type == NA_LOOPBACK*/);
+	SV_AddEntitiesVisibleFromPoint(org, frame, eNums, qfalse /*client->netchan.remoteAddress.type == NA_LOOPBACK*/);
 #else
-	SV_AddEntitiesVisibleFromPoint(org, frame, &entityNumbers /*, qfalse, client->netchan.remoteAddress.type == NA_LOOPBACK*/);
+	SV_AddEntitiesVisibleFromPoint(org, frame, eNums /*, qfalse, client->netchan.remoteAddress.type == NA_LOOPBACK*/);
 #endif
 
-	// if there were portals visible, there may be out of order entities
-	// in the list which will need to be resorted for the delta compression
-	// to work correctly.  This also catches the error condition
-	// of an entity being included twice.
-	qsort(entityNumbers.snapshotEntities, entityNumbers.numSnapshotEntities,
-	      sizeof(entityNumbers.snapshotEntities[0]), SV_QsortEntityNumbers);
-
 	// now that all viewpoint's areabits have been OR'd together, invert
 	// all of them to make it a mask vector, which is what the renderer wants
 	for (i = 0 ; i < MAX_MAP_AREA_BYTES / 4 ; i++)
@@ -730,25 +1072,60 @@ static void SV_BuildClientSnapshot(client_t *client)
 		((int *)frame->areabits)[i] = ((int *)frame->areabits)[i] ^ -1;
 	}
 
+	return qtrue;
+}
+
+/**
+ * @brief Copies the states of the gathered entities into the snapshot entity ring
+ *
+ * @param[in,out] client
+ * @param[in,out] eNums
+ */
+static void SV_FinishClientSnapshot(client_t *client, snapshotEntityNumbers_t *eNums)
+{
+	clientSnapshot_t *frame;
+	int              i, stateId;
+	sharedEntity_t   *ent;
+	svEntity_t       *svEnt;
+	entityState_t    *state;
+
+	frame = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+
+	// if there were portals visible, there may be out of order entities
+	// in the list which will need to be resorted for the delta compression
+	// to work correctly.  This also catches the error condition
+	// of an entity being included twice.
+	qsort(eNums->snapshotEntities, eNums->numSnapshotEntities,
+	      sizeof(eNums->snapshotEntities[0]), SV_QsortEntityNumbers);
+
 	// copy the entity states out
 	frame->num_entities = 0;
 	frame->first_entity = svs.nextSnapshotEntities;
-	for (i = 0 ; i < entityNumbers.numSnapshotEntities ; i++)
+	for (i = 0 ; i < eNums->numSnapshotEntities ; i++)
 	{
-		ent    = SV_GentityNum(entityNumbers.snapshotEntities[i]);
+		ent    = SV_GentityNum(eNums->snapshotEntities[i]);
+		svEnt  = &sv.svEntities[eNums->snapshotEntities[i]];
 		state  = &svs.snapshotEntities[svs.nextSnapshotEntities % svs.numSnapshotEntities];
 		*state = ent->s;
 
+		// the state is known to be the recorded one unless the game had a chance to touch it
+		stateId = (svEnt->snapshotStateBuild == sv_snapshotCandidateBuild && !ent->r.snapshotCallback) ? svEnt->snapshotStateId : 0;
+
 #ifdef FEATURE_ANTICHEAT
-		if (sv_wh_active->integer && entityNumbers.snapshotEntities[i] < sv_maxclients->integer)
+		if (sv_wh_active->integer && eNums->snapshotEntities[i] < sv_maxclients->integer)
 		{
-			if (SV_PositionChanged(entityNumbers.snapshotEntities[i]))
+			// the position may be randomized for this client
+			stateId = 0;
+
+			if (SV_PositionChanged(eNums->snapshotEntities[i]))
 			{
-				SV_RestorePos(entityNumbers.snapshotEntities[i]);
+				SV_RestorePos(eNums->snapshotEntities[i]);
 			}
 		}
 #endif
 
+		svs.snapshotEntityStates[svs.nextSnapshotEntities % svs.numSnapshotEntities] = stateId;
+
 		svs.nextSnapshotEntities++;
 		// this should never hit, map should always be restarted first in SV_Frame
 		if (svs.nextSnapshotEntities >= 0x7FFFFFFE)
@@ -760,6 +1137,21 @@ static void SV_BuildClientSnapshot(client_t *client)
 	}
 }
 
+/**
+ * @brief SV_BuildClientSnapshot
+ * @param[in,out] client
+ */
+static void SV_BuildClientSnapshot(client_t *client)
+{
+	snapshotEntityNumbers_t entityNumbers;
+
+	if (SV_GatherClientSnapshot(client, &entityNumbers))
+	{
+		SV_FilterSnapshotEntities(SV_GentityNum(client->frames[client->netchan.outgoingSequence & PACKET_MASK].ps.clientNum), &entityNumbers);
+		SV_FinishClientSnapshot(client, &entityNumbers);
+	}
+}
+
 #define UDPIP_HEADER_SIZE 28
 #define UDPIP6_HEADER_SIZE 48
 
@@ -893,16 +1285,75 @@ void SV_SendClientIdle(client_t *client)
 }
 
 /**
- * @brief SV_SendClientSnapshot
- *
+ * @brief Writes the acknowledge and the pending reliable commands which lead a snapshot message
  * @param[in] client
+ * @param[out] msg
  *
- * @note Also called by SV_FinalCommand
+ * @note Main thread only, it updates the client and MSG_WriteString may print
  */
-void SV_SendClientSnapshot(client_t *client)
+static void SV_WriteClientSnapshotHeader(client_t *client, msg_t *msg)
 {
-	byte  msg_buf[MAX_MSGLEN];
-	msg_t msg;
+	if (!Com_IsCompatible(&client->agent, 0x1))
+	{
+		MSG_EnableCharStrip(msg);
+	}
+
+	// NOTE, MRE: all server->client messages now acknowledge
+	// let the client know which reliable clientCommands we have received
+	MSG_WriteLong(msg, client->lastClientCommand);
+
+	// (re)send any reliable server commands
+	SV_UpdateServerCommandsToClient(client, msg);
+}
+
+/**
+ * @brief Writes the acknowledge, the pending reliable commands and the snapshot
+ * @param[in] client
+ * @param[in] oldframe
+ * @param[in] lastframe
+ * @param[out] msg
+ */
+static void SV_WriteClientSnapshotMessage(client_t *client, clientSnapshot_t *oldframe, int lastframe, msg_t *msg)
+{
+	SV_WriteClientSnapshotHeader(client, msg);
+
+	// send over all the relevant entityState_t
+	// and the playerState_t
+	SV_WriteSnapshotToClient(client, oldframe, lastframe, msg);
+}
+
+/**
+ * @brief SV_TransmitClientSnapshot
+ * @param[in,out] client
+ * @param[in] msg
+ * @return qfalse if the message overflowed and the client got dropped
+ */
+static qboolean SV_TransmitClientSnapshot(client_t *client, msg_t *msg)
+{
+	if (SV_CheckForMsgOverflow(client, msg))
+	{
+		return qfalse;
+	}
+
+	SV_SendMessageToClient(msg, client);
+
+	sv.bpsTotalBytes  += msg->cursize;           // net debugging
+	sv.ubpsTotalBytes += msg->uncompsize / 8;    // net debugging
+
+	return qtrue;
+}
+
+/**
+ * @brief Builds and sends the next snapshot of the client
+ * @param[in,out] client
+ * @return qtrue if the message overflowed and the client got dropped
+ */
+static qboolean SV_SendSnapshot(client_t *client)
+{
+	byte             msg_buf[MAX_MSGLEN];
+	msg_t            msg;
+	clientSnapshot_t *oldframe;
+	int              lastframe;
 
 	if (client->state < CS_ACTIVE)
 	{
@@ -911,7 +1362,7 @@ void SV_SendClientSnapshot(client_t *client)
 		if (client->state != CS_ZOMBIE)
 		{
 			SV_SendClientIdle(client);
-			return;
+			return (qboolean)(client->state == CS_ZOMBIE);
 		}
 	}
 
@@ -922,37 +1373,388 @@ void SV_SendClientSnapshot(client_t *client)
 	// the query them directly without needing to be sent
 	if (client->gentity && (client->gentity->r.svFlags & SVF_BOT))
 	{
-		return;
+		return qfalse;
 	}
 
+	oldframe = SV_SnapshotDeltaFrame(client, &lastframe);
+
 	MSG_Init(&msg, msg_buf, sizeof(msg_buf));
 	msg.allowoverflow = qtrue;
 
-	if (!Com_IsCompatible(&client->agent, 0x1))
+	SV_WriteClientSnapshotMessage(client, oldframe, lastframe, &msg);
+
+	return (qboolean)(!SV_TransmitClientSnapshot(client, &msg));
+}
+
+/**
+ * @brief SV_SendClientSnapshot
+ *
+ * @param[in] client
+ *
+ * @note Also called by SV_FinalCommand
+ */
+void SV_SendClientSnapshot(client_t *client)
+{
+	// the world may have changed since SV_SendClientMessages
+	SV_BuildSnapshotCandidates();
+
+	SV_SendSnapshot(client);
+}
+
+/*
+=============================================================================
+Threaded snapshots
+
+With sv_snapshotThreads set, SV_SendClientMessages queues the clients which
+are due a snapshot and serves them in batches:
+
+1. the visibility gather runs on the worker pool
+2. the game snapshot callbacks and the copy into the snapshot entity ring run
+   on the main thread, in client order
+3. the acknowledge and the reliable commands are written on the main thread,
+   the snapshots are encoded behind them on the worker pool, into a buffer
+   per client. Those messages are threaded: msg.c keeps its statistics and
+   prints to the main thread and errors wait in the message until the pool
+   is done
+4. the messages are transmitted on the main thread, in client order
+
+Each step sees the same state the serial path would, so the bytes sent are
+identical. Dropping a client can change the world, so a batch is flushed
+before a drop and once a client got dropped while transmitting, the rest
+of the batch is served the serial way.
+=============================================================================
+*/
+
+#define MAX_SNAPSHOT_THREADS 32
+
+/**
+ * @struct snapshotJob_t
+ * @brief
+ */
+typedef struct
+{
+	client_t *client;
+	qboolean idle;                      ///< still loading, only gets an idle packet
+	qboolean built;                     ///< the gather produced a frame
+	qboolean encoded;                   ///< msg holds the finished message
+	clientSnapshot_t *oldframe;         ///< delta source, picked on the main thread
+	int lastframe;
+	msg_t msg;
+	byte msgBuf[MAX_MSGLEN];
+	snapshotEntityNumbers_t entityNumbers;
+} snapshotJob_t;
+
+static threadPool_t  *sv_snapshotPool = NULL;
+static snapshotJob_t *sv_snapshotJobs = NULL;
+
+/**
+ * @brief Stops the snapshot worker threads
+ */
+void SV_ShutdownSnapshotThreads(void)
+{
+	int i;
+
+	Com_DestroyThreadPool(sv_snapshotPool);
+	sv_snapshotPool = NULL;
+
+	for (i = 0; i < DELTA_CACHE_LOCKS; i++)
 	{
-		MSG_EnableCharStrip(&msg);
+		Com_DestroyMutex(sv_deltaCacheLocks[i]);
+		sv_deltaCacheLocks[i] = NULL;
 	}
 
-	// NOTE, MRE: all server->client messages now acknowledge
-	// let the client know which reliable clientCommands we have received
-	MSG_WriteLong(&msg, client->lastClientCommand);
+	if (sv_snapshotJobs)
+	{
+		Com_Dealloc(sv_snapshotJobs);
+		sv_snapshotJobs = NULL;
+	}
+}
 
-	// (re)send any reliable server commands
-	SV_UpdateServerCommandsToClient(client, &msg);
+/**
+ * @brief (Re)starts the snapshot worker threads when needed
+ * @return qtrue if this frame's snapshots can be built on the workers
+ */
+static qboolean SV_InitSnapshotThreads(void)
+{
+	int      numThreads, i;
+	qboolean failed;
 
-	// send over all the relevant entityState_t
-	// and the playerState_t
-	SV_WriteSnapshotToClient(client, &msg);
+	if (sv_snapshotThreads->modified)
+	{
+		sv_snapshotThreads->modified = qfalse;
+		SV_ShutdownSnapshotThreads();
+	}
 
-	if (SV_CheckForMsgOverflow(client, &msg))
+	// the listen server client may print net debugging from the encoder
+	if (sv_snapshotThreads->integer <= 0 || !com_dedicated->integer)
+	{
+		return qfalse;
+	}
+
+#ifdef FEATURE_ANTICHEAT
+	// the anti-wallhack traces and moves entities while gathering
+	if (sv_wh_active->integer > 0)
+	{
+		return qfalse;
+	}
+#endif
+
+	if (!sv_snapshotPool)
+	{
+		numThreads = sv_snapshotThreads->integer;
+		if (numThreads > MAX_SNAPSHOT_THREADS)
+		{
+			numThreads = MAX_SNAPSHOT_THREADS;
+		}
+
+		sv_snapshotJobs = (snapshotJob_t *)Com_Allocate(MAX_CLIENTS * sizeof(snapshotJob_t));
+		sv_snapshotPool = Com_CreateThreadPool(numThreads);
+		failed          = (qboolean)(!sv_snapshotJobs || !sv_snapshotPool);
+
+		for (i = 0; i < DELTA_CACHE_LOCKS; i++)
+		{
+			sv_deltaCacheLocks[i] = Com_CreateMutex();
+			if (!sv_deltaCacheLocks[i])
+			{
+				failed = qtrue;
+			}
+		}
+
+		if (failed)
+		{
+			Com_Printf(S_COLOR_YELLOW "WARNING: can't start snapshot threads, building snapshots on the main thread\n");
+			SV_ShutdownSnapshotThreads();
+			Cvar_Set("sv_snapshotThreads", "0");
+			return qfalse;
+		}
+
+		Com_Printf("Building client snapshots on %i worker threads\n", Com_ThreadPoolSize(sv_snapshotPool));
+	}
+
+	return qtrue;
+}
+
+/**
+ * @brief SV_GatherSnapshotJob
+ * @param[in,out] data
+ * @param[in] index
+ */
+static void SV_GatherSnapshotJob(void *data, int index)
+{
+	snapshotJob_t *job = &((snapshotJob_t *)data)[index];
+
+	if (job->idle)
 	{
 		return;
 	}
 
-	SV_SendMessageToClient(&msg, client);
+	job->built = SV_GatherClientSnapshot(job->client, &job->entityNumbers);
+}
 
-	sv.bpsTotalBytes  += msg.cursize;           // net debugging
-	sv.ubpsTotalBytes += msg.uncompsize / 8;    // net debugging
+/**
+ * @brief Appends the snapshot to the message header written on the main thread
+ * @param[in,out] data
+ * @param[in] index
+ *
+ * @note The message is threaded, errors are left in job->msg for SV_SendSnapshotJobs
+ */
+static void SV_EncodeSnapshotJob(void *data, int index)
+{
+	snapshotJob_t *job = &((snapshotJob_t *)data)[index];
+
+	if (job->encoded)
+	{
+		return;
+	}
+
+	SV_WriteSnapshotToClient(job->client, job->oldframe, job->lastframe, &job->msg);
+	job->encoded = qtrue;
+}
+
+/**
+ * @brief Tells if ring entries of the frame get reused before the batch is encoded
+ * @param[in] frame
+ * @param[in] nextEntities svs.nextSnapshotEntities once the whole batch is copied
+ * @return
+ */
+static qboolean SV_SnapshotEntitiesOverwritten(clientSnapshot_t *frame, int nextEntities)
+{
+	return frame->num_entities > 0 && frame->first_entity < nextEntities - svs.numSnapshotEntities;
+}
+
+/**
+ * @brief Debug check (sv_snapshotThreadsCheck) of the worker gather against the serial one
+ * @param[in] job
+ */
+static void SV_CheckSnapshotJobEntities(snapshotJob_t *job)
+{
+	static snapshotEntityNumbers_t entityNumbers;
+	qboolean                       built;
+
+	built = SV_GatherClientSnapshot(job->client, &entityNumbers);
+
+	if (built != job->built || entityNumbers.numSnapshotEntities != job->entityNumbers.numSnapshotEntities ||
+	    memcmp(entityNumbers.snapshotEntities, job->entityNumbers.snapshotEntities, entityNumbers.numSnapshotEntities * sizeof(entityNumbers.snapshotEntities[0])))
+	{
+		Com_Printf(S_COLOR_RED "SV_SendClientMessages: threaded snapshot entities differ for %s\n", job->client->name);
+	}
+}
+
+/**
+ * @brief Debug check (sv_snapshotThreadsCheck) of the worker encoding against the serial one
+ * @param[in] job
+ */
+static void SV_CheckSnapshotJobMessage(snapshotJob_t *job)
+{
+	static byte msg_buf[MAX_MSGLEN];
+	msg_t       msg;
+
+	MSG_Init(&msg, msg_buf, sizeof(msg_buf));
+	msg.allowoverflow = qtrue;
+
+	SV_WriteClientSnapshotMessage(job->client, job->oldframe, job->lastframe, &msg);
+
+	if (msg.cursize != job->msg.cursize || msg.bit != job->msg.bit || msg.overflowed != job->msg.overflowed ||
+	    memcmp(msg.data, job->msg.data, msg.cursize))
+	{
+		Com_Printf(S_COLOR_RED "SV_SendClientMessages: threaded snapshot message differs for %s\n", job->client->name);
+	}
+}
+
+/**
+ * @brief Builds, encodes and transmits the snapshots of the queued clients
+ * @param[in] numJobs
+ */
+static void SV_SendSnapshotJobs(int numJobs)
+{
+	snapshotJob_t    *job;
+	client_t         *client;
+	clientSnapshot_t *frame;
+	int              i, nextEntities;
+	qboolean         dropped = qfalse;
+
+	for (i = 0, job = sv_snapshotJobs; i < numJobs; i++, job++)
+	{
+		client = job->client;
+
+		job->idle    = (qboolean)(client->state < CS_ACTIVE && client->state != CS_ZOMBIE);
+		job->built   = qfalse;
+		job->encoded = job->idle;
+
+		// the workers can't raise errors, so check what SV_GatherClientSnapshot would complain about
+		if (!job->idle && client->gentity && client->state != CS_ZOMBIE)
+		{
+			int clientNum = SV_GameClientNum(client - svs.clients)->clientNum;
+
+			if (clientNum < 0 || clientNum >= MAX_GENTITIES)
+			{
+				Com_Error(ERR_DROP, "SV_BuildClientSnapshot: bad gEnt");
+			}
+		}
+	}
+
+	Com_ThreadPoolRun(sv_snapshotPool, SV_GatherSnapshotJob, sv_snapshotJobs, numJobs);
+
+	nextEntities = svs.nextSnapshotEntities;
+
+	for (i = 0, job = sv_snapshotJobs; i < numJobs; i++, job++)
+	{
+		if (sv_snapshotThreadsCheck->integer && !job->idle)
+		{
+			SV_CheckSnapshotJobEntities(job);
+		}
+
+		if (job->built)
+		{
+			client = job->client;
+			frame  = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+
+			SV_FilterSnapshotEntities(SV_GentityNum(frame->ps.clientNum), &job->entityNumbers);
+			nextEntities += job->entityNumbers.numSnapshotEntities;
+		}
+	}
+
+	for (i = 0, job = sv_snapshotJobs; i < numJobs; i++, job++)
+	{
+		if (job->idle)
+		{
+			continue;
+		}
+
+		client = job->client;
+		frame  = &client->frames[client->netchan.outgoingSequence & PACKET_MASK];
+
+		if (job->built)
+		{
+			SV_FinishClientSnapshot(client, &job->entityNumbers);
+		}
+
+		job->oldframe = SV_SnapshotDeltaFrame(client, &job->lastframe);
+
+		MSG_Init(&job->msg, job->msgBuf, sizeof(job->msgBuf));
+		job->msg.allowoverflow = qtrue;
+
+		SV_WriteClientSnapshotHeader(client, &job->msg);
+		job->msg.threaded = qtrue;
+
+		// the clients after this one are copied into the ring before the
+		// workers encode, so whatever they overwrite is encoded right now
+		if (SV_SnapshotEntitiesOverwritten(frame, nextEntities) ||
+		    (job->oldframe && SV_SnapshotEntitiesOverwritten(job->oldframe, nextEntities)))
+		{
+			SV_EncodeSnapshotJob(sv_snapshotJobs, i);
+		}
+	}
+
+	Com_ThreadPoolRun(sv_snapshotPool, SV_EncodeSnapshotJob, sv_snapshotJobs, numJobs);
+
+	// raise what the workers had to hold back
+	for (i = 0, job = sv_snapshotJobs; i < numJobs; i++, job++)
+	{
+		if (!job->idle && job->msg.error)
+		{
+			Com_Error(job->msg.errorCode, "%s", job->msg.error);
+		}
+	}
+
+	for (i = 0, job = sv_snapshotJobs; i < numJobs; i++, job++)
+	{
+		client = job->client;
+
+		if (dropped)
+		{
+			// the drop went through the game, the rest is built from the current world
+			if (SV_SendSnapshot(client))
+			{
+				SV_BuildSnapshotCandidates();
+			}
+		}
+		else
+		{
+			if (job->idle)
+			{
+				SV_SendClientIdle(client);
+				dropped = (qboolean)(client->state == CS_ZOMBIE);
+			}
+			else
+			{
+				if (sv_snapshotThreadsCheck->integer)
+				{
+					SV_CheckSnapshotJobMessage(job);
+				}
+
+				dropped = (qboolean)(!SV_TransmitClientSnapshot(client, &job->msg));
+			}
+
+			if (dropped)
+			{
+				SV_BuildSnapshotCandidates();
+			}
+		}
+
+		client->lastSnapshotTime = svs.time;
+		client->rateDelayed      = qfalse;
+	}
 }
 
 /**
@@ -962,7 +1764,9 @@ void SV_SendClientMessages(void)
 {
 	int      i;
 	client_t *c;
-	int      numclients = 0;    // net debugging
+	int      numclients = 0;       // net debugging
+	int      numJobs    = 0;
+	qboolean threaded;
 
 	sv.bpsTotalBytes  = 0;      // net debugging
 	sv.ubpsTotalBytes = 0;      // net debugging
@@ -970,6 +1774,17 @@ void SV_SendClientMessages(void)
 	// update any changed configstrings from this frame
 	SV_UpdateConfigStrings();
 
+	threaded = SV_InitSnapshotThreads();
+
+	SV_BuildSnapshotCandidates();
+
+#ifdef FEATURE_ANTICHEAT
+	if (sv_wh_active->integer > 0)
+	{
+		SV_WallhackFrame();
+	}
+#endif
+
 	// send a message to each connected client
 	for (i = 0; i < sv_maxclients->integer; i++)
 	{
@@ -998,9 +1813,17 @@ void SV_SendClientMessages(void)
 		if (*c->downloadName)
 		{
 			// If the client is downloading via netchan and has not acknowledged a package in 4secs drop it
-			if (c->download && (svs.time - c->downloadAckTime) > 4000)
+			if ((c->download || c->downloadView) && (svs.time - c->downloadAckTime) > 4000)
 			{
+				// serve the queued clients from the world before the drop
+				if (numJobs)
+				{
+					SV_SendSnapshotJobs(numJobs);
+					numJobs = 0;
+				}
+
 				SV_DropClient(c, "Download failed");
+				SV_BuildSnapshotCandidates();
 			}
 			c->lastValidGamestate = svs.time;
 			continue;       // Client is downloading, don't send snapshots
@@ -1030,12 +1853,26 @@ void SV_SendClientMessages(void)
 
 		numclients++; // net debugging
 
+		if (threaded)
+		{
+			sv_snapshotJobs[numJobs++].client = c;
+			continue;
+		}
+
 		// generate and send a new message
-		SV_SendClientSnapshot(c);
+		if (SV_SendSnapshot(c))
+		{
+			SV_BuildSnapshotCandidates();
+		}
 		c->lastSnapshotTime = svs.time;
 		c->rateDelayed      = qfalse;
 	}
 
+	if (numJobs)
+	{
+		SV_SendSnapshotJobs(numJobs);
+	}
+
 	// net debugging
 	if (sv_showAverageBPS->integer && numclients > 0)
 	{
@@ -19,7 +19,6 @@
 
 //======================================================================
 
-static vec3_t       pred_ppos, pred_opos;
 static trajectory_t traject;
 static vec3_t       old_origin[MAX_CLIENTS];
 static int          origin_changed[MAX_CLIENTS];
@@ -40,6 +39,71 @@ static vec3_t delta[8];
 static int bbox_horz;
 static int bbox_vert;
 
+/**
+ * @struct whClient_s
+ * @brief Per frame view and predicted positions of a client
+ */
+typedef struct
+{
+	int frame;                  ///< wh_frameNum the positions were taken in
+	vec3_t origin;
+	vec3_t viewpoint;
+	vec3_t viewangles;
+	vec3_t predOrigin;          ///< PREDICT_TIME ahead
+	vec3_t predViewpoint;
+} whClient_t;
+
+/**
+ * @struct whCache_s
+ * @brief Last result of a (player, other) pair and the positions it was computed for
+ */
+typedef struct
+{
+	int expire;                 ///< svs.time the result runs out
+	int visible;
+	vec3_t viewpoint;
+	vec3_t predViewpoint;
+	vec3_t viewangles;
+	vec3_t origin;
+	vec3_t predOrigin;
+} whCache_t;
+
+/**
+ * @struct whPair_s
+ * @brief A pair whose visibility is traced in the batch
+ */
+typedef struct
+{
+	int player;
+	int other;
+	int visible;
+	int traces;
+} whPair_t;
+
+/**
+ * @struct whStats_s
+ */
+typedef struct
+{
+	int frames;
+	int pairs;                  ///< pairs asked for
+	int culled;                 ///< pairs skipped by the pvs and fov tests
+	int cacheHits;
+	int traces;
+} whStats_t;
+
+#define WH_UNKNOWN  -1
+
+static whClient_t  wh_clients[MAX_CLIENTS];
+static whCache_t   wh_cache[MAX_CLIENTS][MAX_CLIENTS];
+static signed char wh_visible[MAX_CLIENTS][MAX_CLIENTS];    ///< results of the current frame, WH_UNKNOWN if not batched
+static whPair_t    wh_pairs[MAX_CLIENTS * MAX_CLIENTS];
+static int         wh_frameNum;
+static int         wh_frameTime = -1;
+static whStats_t   wh_frameStats, wh_lastStats, wh_totalStats;
+
+static threadPool_t *wh_pool = NULL;
+
 //======================================================================
 // local functions
 //======================================================================
@@ -363,7 +427,7 @@ static void calc_viewpoint(playerState_t *ps, vec3_t org, vec3_t vp)
 		VectorCopy(ps->viewangles, v3ViewAngles);
 		v3ViewAngles[2] += ps->leanf / 2.0f;
 		angles_vectors(v3ViewAngles, NULL, right, NULL);
-		VectorMA(org, ps->leanf, right, org);
+		VectorMA(vp, ps->leanf, right, vp);
 	}
 
 	if (ps->pm_flags & PMF_DUCKED)
@@ -505,6 +569,18 @@ void SV_InitWallhack(void)
 {
 	init_horz_delta();
 	init_vert_delta();
+
+	Com_Memset(wh_cache, 0, sizeof(wh_cache));
+	wh_frameTime = -1;
+}
+
+/**
+ * @brief Stops the visibility worker threads
+ */
+void SV_ShutdownWallhack(void)
+{
+	Com_DestroyThreadPool(wh_pool);
+	wh_pool = NULL;
 }
 
 //======================================================================
@@ -512,80 +588,144 @@ void SV_InitWallhack(void)
 #define PREDICT_TIME      0.1f
 #define VOFS              6
 
+#define WH_CACHE_MOVE     8     ///< units a cached pair may move, covered by the bbox margins
+#define WH_CACHE_TURN     5     ///< degrees the viewer may turn before a cached fov test is redone
+#define WH_PAIR_BATCH     16    ///< pairs per pool job
+
 /**
- * @brief Checks if 'player' can see 'other' or not.
- *
- * @details First a check is made if 'other' is in the maximum allowed fov
- * of 'player'. If not, then zero is returned w/o any further checks.
- * Next traces are carried out from the present viewpoint of 'player'
- * to the corners of the bounding box of 'other'. If any of these
- * traces are successful (i.e. nothing solid is between the start
- * and end positions) then non-zero is returned.
- *
- * Otherwise the expected positions of the two players are calculated,
- * by extrapolating their movements for PREDICT_TIME seconds and the above
- * tests are carried out again. The result is reported by returning non-zero
- * (expected to become visible) or zero (not expected to become visible
- * in the next frame).
- *
- * @param[in] player
- * @param[in] other
- *
- * @return
+ * @brief Refreshes the bbox deltas when the cvars change
  */
-int SV_CanSee(int player, int other)
+static void check_bbox(void)
 {
-	sharedEntity_t *pent, *oent;
-	playerState_t  *ps;
-	vec3_t         viewpoint, tmp;
-	int            i;
-
-	// check if bounding box has been changed
 	if (sv_wh_bbox_horz->integer != bbox_horz)
 	{
 		init_horz_delta();
+		Com_Memset(wh_cache, 0, sizeof(wh_cache));
 	}
 
 	if (sv_wh_bbox_vert->integer != bbox_vert)
 	{
 		init_vert_delta();
+		Com_Memset(wh_cache, 0, sizeof(wh_cache));
 	}
+}
 
-	ps   = SV_GameClientNum(player);
-	pent = SV_GentityNum(player);
-	oent = SV_GentityNum(other);
+//======================================================================
 
-	// check if 'other' is in the maximum fov allowed
-	if (sv_wh_check_fov->integer > 0)
+/**
+ * @brief Takes the present and predicted view of a client, once per frame
+ *
+ * @details The slide move prediction traces against entities, so this
+ * runs on the main thread before any pair is traced.
+ *
+ * @param[in] cli
+ * @return
+ */
+static whClient_t *prepare_client(int cli)
+{
+	whClient_t     *wc = &wh_clients[cli];
+	sharedEntity_t *ent;
+	playerState_t  *ps;
+
+	if (wc->frame == wh_frameNum)
 	{
-		if (!player_in_fov(pent->s.apos.trBase, pent->s.pos.trBase, oent->s.pos.trBase))
-		{
-			return 0;
-		}
+		return wc;
 	}
 
-	// check if visible in this frame
-	calc_viewpoint(ps, pent->s.pos.trBase, viewpoint);
+	wc->frame = wh_frameNum;
+
+	ps  = SV_GameClientNum(cli);
+	ent = SV_GentityNum(cli);
+
+	VectorCopy(ent->s.pos.trBase, wc->origin);
+	VectorCopy(ent->s.apos.trBase, wc->viewangles);
+	calc_viewpoint(ps, wc->origin, wc->viewpoint);
+
+	copy_trajectory(&ent->s.pos, &traject);
+	predict_move(ent, PREDICT_TIME, &traject, wc->predOrigin);
+	calc_viewpoint(ps, wc->predOrigin, wc->predViewpoint);
+
+	return wc;
+}
+
+//======================================================================
+
+/**
+ * @brief Traces from a viewpoint to the bounding box of a player at 'org'
+ *
+ * @details A single ray to the middle of the box goes first, it settles
+ * most visible pairs before the corner fan. This is more permissive than the
+ * corners alone: a player seen only through a gap narrower than the box,
+ * with all 8 corners hidden, now counts as visible and is sent to the viewer.
+ * Erring towards visible is the safe side, a hidden entity that should have
+ * been drawn is a bug while one sent too many is what happens anyway at the
+ * box margins.
+ *
+ * @param[in] vp
+ * @param[in] org
+ * @param[in,out] traces
+ * @return
+ */
+static int box_visible(vec3_t vp, vec3_t org, int *traces)
+{
+	vec3_t tmp;
+	int    i;
+
+	VectorCopy(org, tmp);
+	tmp[2] += VOFS;
+
+	(*traces)++;
+	if (is_visible(vp, tmp))
+	{
+		return 1;
+	}
 
 	for (i = 0; i < 8; i++)
 	{
-		VectorCopy(oent->s.pos.trBase, tmp);
+		VectorCopy(org, tmp);
 		tmp[0] += delta[i][0];
 		tmp[1] += delta[i][1];
 		tmp[2] += delta[i][2] + VOFS;
 
-		if (is_visible(viewpoint, tmp))
+		(*traces)++;
+		if (is_visible(vp, tmp))
 		{
 			return 1;
 		}
 	}
 
-	// predict player positions
-	copy_trajectory(&pent->s.pos, &traject);
-	predict_move(pent, PREDICT_TIME, &traject, pred_ppos);
+	return 0;
+}
 
-	copy_trajectory(&oent->s.pos, &traject);
-	predict_move(oent, PREDICT_TIME, &traject, pred_opos);
+/**
+ * @brief Checks if 'player' can see 'other' from the prepared positions
+ *
+ * @details Only traces the world, so the batch runs this on worker threads.
+ *
+ * @param[in] player
+ * @param[in] other
+ * @param[in,out] traces
+ * @return
+ */
+static int pair_visible(int player, int other, int *traces)
+{
+	whClient_t *p = &wh_clients[player];
+	whClient_t *o = &wh_clients[other];
+
+	// check if 'other' is in the maximum fov allowed
+	if (sv_wh_check_fov->integer > 0)
+	{
+		if (!player_in_fov(p->viewangles, p->origin, o->origin))
+		{
+			return 0;
+		}
+	}
+
+	// check if visible in this frame
+	if (box_visible(p->viewpoint, o->origin, traces))
+	{
+		return 1;
+	}
 
 	// Check again if 'other' is in the maximum fov allowed.
 	// FIXME: We use the original viewangle that may have
@@ -593,29 +733,354 @@ int SV_CanSee(int player, int other)
 	// errors.
 	if (sv_wh_check_fov->integer > 0)
 	{
-		if (!player_in_fov(pent->s.apos.trBase, pred_ppos, pred_opos))
+		if (!player_in_fov(p->viewangles, p->predOrigin, o->predOrigin))
 		{
 			return 0;
 		}
 	}
 
 	// check if expected to be visible in the next frame
-	calc_viewpoint(ps, pred_ppos, viewpoint);
+	return box_visible(p->predViewpoint, o->predOrigin, traces);
+}
 
-	for (i = 0; i < 8; i++)
+//======================================================================
+
+/**
+ * @brief Tells if two points are within WH_CACHE_MOVE of each other
+ * @param[in] a
+ * @param[in] b
+ * @return
+ */
+static int near_point(vec3_t a, vec3_t b)
+{
+	return (vec3_distance(a, b) <= WH_CACHE_MOVE);
+}
+
+/**
+ * @brief Looks up a pair result that is still valid for the prepared positions
+ * @param[in] player
+ * @param[in] other
+ * @return The cached result or WH_UNKNOWN
+ */
+static int cache_lookup(int player, int other)
+{
+	whCache_t  *c = &wh_cache[player][other];
+	whClient_t *p = &wh_clients[player];
+	whClient_t *o = &wh_clients[other];
+
+	if (c->expire <= svs.time || c->expire - svs.time > sv_wh_cache->integer)
 	{
-		VectorCopy(pred_opos, tmp);
-		tmp[0] += delta[i][0];
-		tmp[1] += delta[i][1];
-		tmp[2] += delta[i][2] + VOFS;
+		return WH_UNKNOWN;
+	}
 
-		if (is_visible(viewpoint, tmp))
+	if (!near_point(c->viewpoint, p->viewpoint) || !near_point(c->predViewpoint, p->predViewpoint)
+	    || !near_point(c->origin, o->origin) || !near_point(c->predOrigin, o->predOrigin))
+	{
+		return WH_UNKNOWN;
+	}
+
+	if (sv_wh_check_fov->integer > 0)
+	{
+		if (Q_fabs(angle_delta(c->viewangles[YAW], p->viewangles[YAW])) > WH_CACHE_TURN
+		    || Q_fabs(angle_delta(c->viewangles[PITCH], p->viewangles[PITCH])) > WH_CACHE_TURN)
 		{
-			return 1;
+			return WH_UNKNOWN;
 		}
 	}
 
-	return 0;
+	return c->visible;
+}
+
+/**
+ * @brief Stores a pair result along with the positions it holds for
+ * @param[in] player
+ * @param[in] other
+ * @param[in] visible
+ */
+static void cache_store(int player, int other, int visible)
+{
+	whCache_t  *c = &wh_cache[player][other];
+	whClient_t *p = &wh_clients[player];
+	whClient_t *o = &wh_clients[other];
+
+	if (sv_wh_cache->integer <= 0)
+	{
+		return;
+	}
+
+	c->expire  = svs.time + sv_wh_cache->integer;
+	c->visible = visible;
+	VectorCopy(p->viewpoint, c->viewpoint);
+	VectorCopy(p->predViewpoint, c->predViewpoint);
+	VectorCopy(p->viewangles, c->viewangles);
+	VectorCopy(o->origin, c->origin);
+	VectorCopy(o->predOrigin, c->predOrigin);
+}
+
+//======================================================================
+
+/**
+ * @brief Traces one batch of pairs on a pool thread
+ * @param[in,out] data
+ * @param[in] index
+ */
+static void trace_pairs_job(void *data, int index)
+{
+	whPair_t *pairs = (whPair_t *)data;
+	int      i;
+
+	for (i = index * WH_PAIR_BATCH; i < (index + 1) * WH_PAIR_BATCH && pairs[i].player >= 0; i++)
+	{
+		pairs[i].traces  = 0;
+		pairs[i].visible = pair_visible(pairs[i].player, pairs[i].other, &pairs[i].traces);
+	}
+}
+
+/**
+ * @brief Tells if the snapshot of a client will run the wallhack check
+ * @param[in] cl
+ * @return
+ */
+static int is_viewer(client_t *cl)
+{
+	playerState_t *ps;
+
+	if (cl->state != CS_ACTIVE || cl->demoClient || !cl->gentity || (cl->gentity->r.svFlags & (SVF_BOT | SVF_SELF_PORTAL_EXCLUSIVE)))
+	{
+		return 0;
+	}
+
+	if (svs.time - cl->lastSnapshotTime < cl->snapshotMsec * com_timescale->value || *cl->downloadName)
+	{
+		return 0;
+	}
+
+	ps = SV_GameClientNum(cl - svs.clients);
+
+	return (ps->persistant[PERS_TEAM] != TEAM_SPECTATOR && !(ps->pm_flags & PMF_FOLLOW));
+}
+
+/**
+ * @brief Works out the visibility of every client pair the snapshots of this frame will ask for
+ *
+ * @details Pairs that can't pass the snapshot pvs and area tests are skipped,
+ * pairs whose players barely moved reuse the cached result and the rest
+ * is traced in one batch, on the sv_wh_threads pool when there is one.
+ * SV_CanSee answers from this batch and only traces pairs it missed.
+ */
+void SV_WallhackFrame(void)
+{
+	sharedEntity_t *ent;
+	svEntity_t     *svEnt;
+	whClient_t     *wc;
+	byte           *pvs;
+	int            viewers[MAX_CLIENTS], targets[MAX_CLIENTS];
+	int            numViewers = 0, numTargets = 0, numPairs = 0;
+	int            i, j, p, o, leafnum, area, visible;
+
+	// roll the counters of the previous frame
+	if (wh_frameStats.frames)
+	{
+		wh_lastStats             = wh_frameStats;
+		wh_totalStats.frames    += wh_frameStats.frames;
+		wh_totalStats.pairs     += wh_frameStats.pairs;
+		wh_totalStats.culled    += wh_frameStats.culled;
+		wh_totalStats.cacheHits += wh_frameStats.cacheHits;
+		wh_totalStats.traces    += wh_frameStats.traces;
+	}
+	Com_Memset(&wh_frameStats, 0, sizeof(wh_frameStats));
+	wh_frameStats.frames = 1;
+
+	wh_frameNum++;
+	wh_frameTime = svs.time;
+	Com_Memset(wh_visible, WH_UNKNOWN, sizeof(wh_visible));
+
+	check_bbox();
+
+	if (sv_wh_threads->modified)
+	{
+		sv_wh_threads->modified = qfalse;
+		SV_ShutdownWallhack();
+	}
+
+	if (!wh_pool && sv_wh_threads->integer > 0)
+	{
+		wh_pool = Com_CreateThreadPool(MIN(sv_wh_threads->integer, 16));
+		if (!wh_pool)
+		{
+			Com_Printf(S_COLOR_YELLOW "WARNING: can't start wallhack threads, tracing on the main thread\n");
+			Cvar_Set("sv_wh_threads", "0");
+			sv_wh_threads->modified = qfalse;
+		}
+	}
+
+	for (i = 0; i < sv_maxclients->integer; i++)
+	{
+		ent = SV_GentityNum(i);
+		if (svs.clients[i].state < CS_CONNECTED || !ent->r.linked || (ent->r.svFlags & SVF_NOCLIENT))
+		{
+			continue;
+		}
+
+		prepare_client(i);
+		targets[numTargets++] = i;
+
+		if (is_viewer(&svs.clients[i]))
+		{
+			viewers[numViewers++] = i;
+		}
+	}
+
+	for (i = 0; i < numViewers; i++)
+	{
+		p       = viewers[i];
+		wc      = &wh_clients[p];
+		leafnum = CM_PointLeafnum(wc->viewpoint);
+		area    = CM_LeafArea(leafnum);
+		pvs     = CM_ClusterPVS(CM_LeafCluster(leafnum));
+
+		for (j = 0; j < numTargets; j++)
+		{
+			o = targets[j];
+			if (o == p)
+			{
+				continue;
+			}
+
+			wh_frameStats.pairs++;
+
+			// the snapshot won't consider entities it can't see through the pvs
+			svEnt = &sv.svEntities[o];
+			if ((!CM_AreasConnected(area, svEnt->areanum) && !CM_AreasConnected(area, svEnt->areanum2))
+			    || !SV_EntityClustersInPVS(svEnt, pvs))
+			{
+				wh_frameStats.culled++;
+				continue;
+			}
+
+			visible = cache_lookup(p, o);
+			if (visible != WH_UNKNOWN)
+			{
+				wh_visible[p][o] = (signed char)visible;
+				wh_frameStats.cacheHits++;
+				continue;
+			}
+
+			wh_pairs[numPairs].player = p;
+			wh_pairs[numPairs].other  = o;
+			numPairs++;
+		}
+	}
+
+	// pad the last batch
+	for (i = numPairs; i < numPairs + WH_PAIR_BATCH && i < MAX_CLIENTS * MAX_CLIENTS; i++)
+	{
+		wh_pairs[i].player = -1;
+	}
+
+	Com_ThreadPoolRun(wh_pool, trace_pairs_job, wh_pairs, (numPairs + WH_PAIR_BATCH - 1) / WH_PAIR_BATCH);
+
+	for (i = 0; i < numPairs; i++)
+	{
+		wh_visible[wh_pairs[i].player][wh_pairs[i].other] = (signed char)wh_pairs[i].visible;
+		wh_frameStats.traces += wh_pairs[i].traces;
+		cache_store(wh_pairs[i].player, wh_pairs[i].other, wh_pairs[i].visible);
+	}
+}
+
+//======================================================================
+
+/**
+ * @brief Checks if 'player' can see 'other' or not.
+ *
+ * @details First a check is made if 'other' is in the maximum allowed fov
+ * of 'player'. If not, then zero is returned w/o any further checks.
+ * Next traces are carried out from the present viewpoint of 'player'
+ * to the corners of the bounding box of 'other'. If any of these
+ * traces are successful (i.e. nothing solid is between the start
+ * and end positions) then non-zero is returned.
+ *
+ * Otherwise the expected positions of the two players are calculated,
+ * by extrapolating their movements for PREDICT_TIME seconds and the above
+ * tests are carried out again. The result is reported by returning non-zero
+ * (expected to become visible) or zero (not expected to become visible
+ * in the next frame).
+ *
+ * Pairs worked out by SV_WallhackFrame are answered from the batch.
+ *
+ * @param[in] player
+ * @param[in] other
+ *
+ * @return
+ */
+int SV_CanSee(int player, int other)
+{
+	int visible, traces = 0;
+
+	if (wh_frameTime == svs.time && wh_visible[player][other] != WH_UNKNOWN)
+	{
+		return wh_visible[player][other];
+	}
+
+	// not part of this frame's batch
+	if (wh_frameTime != svs.time)
+	{
+		wh_frameNum++;
+		wh_frameTime = svs.time;
+		Com_Memset(wh_visible, WH_UNKNOWN, sizeof(wh_visible));
+	}
+
+	check_bbox();
+
+	prepare_client(player);
+	prepare_client(other);
+
+	wh_frameStats.pairs++;
+
+	visible = cache_lookup(player, other);
+	if (visible != WH_UNKNOWN)
+	{
+		wh_frameStats.cacheHits++;
+	}
+	else
+	{
+		visible = pair_visible(player, other, &traces);
+		wh_frameStats.traces += traces;
+		cache_store(player, other, visible);
+	}
+
+	wh_visible[player][other] = (signed char)visible;
+
+	return visible;
+}
+
+/**
+ * @brief Prints the visibility counters of the last frame and the averages since the last call
+ */
+void SV_WallhackStats_f(void)
+{
+	whStats_t *t = &wh_totalStats;
+
+	if (!sv_wh_active->integer)
+	{
+		Com_Printf("sv_wh_active is off\n");
+	}
+
+	Com_Printf("last frame: %i pairs, %i culled, %i cache hits, %i traced with %i traces\n",
+	           wh_lastStats.pairs, wh_lastStats.culled, wh_lastStats.cacheHits,
+	           wh_lastStats.pairs - wh_lastStats.culled - wh_lastStats.cacheHits, wh_lastStats.traces);
+
+	if (t->frames)
+	{
+		Com_Printf("%i frames: %.1f pairs, %.1f culled, %.1f cache hits, %.1f traces per frame, %.1f%% cache hit rate\n",
+		           t->frames, (double)t->pairs / t->frames, (double)t->culled / t->frames,
+		           (double)t->cacheHits / t->frames, (double)t->traces / t->frames,
+		           t->pairs > t->culled ? 100.0 * t->cacheHits / (t->pairs - t->culled) : 0.0);
+	}
+
+	Com_Printf("cache %i msec, %i threads\n", sv_wh_cache->integer, sv_wh_threads->integer);
+
+	Com_Memset(&wh_totalStats, 0, sizeof(wh_totalStats));
 }
 
 //======================================================================
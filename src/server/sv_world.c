@@ -66,93 +66,232 @@ clipHandle_t SV_ClipHandleForEntity(const sharedEntity_t *ent)
 ENTITY CHECKING
 
 To avoid linearly searching through lists of entities during environment testing,
-the world is carved up with an evenly spaced, axially aligned bsp tree.  Entities
-are kept in chains either at the final leafs, or at the first node that splits
-them, which prevents having to deal with multiple fragments of a single entity.
+the world is carved up with a loose octree. Each node is a cube whose contents may
+stick out of it by half its size, so an entity is kept in the deepest node whose
+cube holds its center and which is at least as large as the entity. Small entities
+sink deep into the tree and stay apart from each other however many gather in one
+spot, big ones stay near the root, and nothing is ever split between nodes.
+
+Nodes are created as entities move into new parts of the world. Empty nodes are
+kept for the entities moving back in and only freed when the pool runs short.
 ===============================================================================
 */
 
+/**
+ * @struct worldSector_s
+ * @typedef worldSector_t
+ * @brief Node of the loose octree
+ */
 typedef struct worldSector_s
 {
-	int axis;                         // -1 = leaf node
-	float dist;
-	struct     worldSector_s *children[2];
+	vec3_t center;
+	float halfSize;                         ///< of the cube, entities may stick out by as much again
+	int depth;
+	struct worldSector_s *parent;
+	struct worldSector_s *children[8];      ///< indexed by the sides of the center, bit 0 for x, 1 for y, 2 for z
 	svEntity_t *entities;
+	int numEntities;                        ///< linked in this node and all below it
 } worldSector_t;
 
-#define AREA_DEPTH  4
-#define AREA_NODES  64
+#define AREA_DEPTH  8
+#define AREA_NODES  4096
 
-worldSector_t sv_worldSectors[AREA_NODES];
-int           sv_numworldSectors;
+worldSector_t        sv_worldSectors[AREA_NODES];   ///< the first one is the root
+static worldSector_t *sv_freeWorldSectors;          ///< chained through children[0]
+static int           sv_numFreeWorldSectors;
 
 /**
- * @brief SV_SectorList_f
+ * @brief Returns a node and all below it to the pool
+ * @param[in,out] node
  */
-void SV_SectorList_f(void)
+static void SV_FreeWorldSector(worldSector_t *node)
 {
-	int           i, c;
-	worldSector_t *sec;
-	svEntity_t    *ent;
+	int i;
 
-	for (i = 0 ; i < AREA_NODES ; i++)
+	for (i = 0; i < 8; i++)
 	{
-		sec = &sv_worldSectors[i];
+		if (node->children[i])
+		{
+			SV_FreeWorldSector(node->children[i]);
+		}
+	}
+
+	Com_Memset(node, 0, sizeof(*node));
+	node->children[0]   = sv_freeWorldSectors;
+	sv_freeWorldSectors = node;
+	sv_numFreeWorldSectors++;
+}
+
+/**
+ * @brief Frees the empty parts of the tree below a node
+ * @param[in,out] node
+ */
+static void SV_PruneWorldSector(worldSector_t *node)
+{
+	int i;
 
-		c = 0;
-		for (ent = sec->entities ; ent ; ent = ent->nextEntityInWorldSector)
+	for (i = 0; i < 8; i++)
+	{
+		if (!node->children[i])
 		{
-			c++;
+			continue;
 		}
 
-		Com_Printf("sector %i: %i entities\n", i, c);
+		if (!node->children[i]->numEntities)
+		{
+			SV_FreeWorldSector(node->children[i]);
+			node->children[i] = NULL;
+		}
+		else
+		{
+			SV_PruneWorldSector(node->children[i]);
+		}
 	}
 }
 
 /**
- * @brief Builds a uniformly subdivided tree for the given world size
- * @param[in] depth
- * @param[in] mins
- * @param[in] maxs
+ * @brief Creates a child of a node
+ * @param[in,out] parent
+ * @param[in] index Side of the parent center, see worldSector_t::children
+ * @return NULL if the pool is exhausted
+ */
+static worldSector_t *SV_CreateWorldSector(worldSector_t *parent, int index)
+{
+	worldSector_t *node = sv_freeWorldSectors;
+	int           i;
+
+	if (!node)
+	{
+		return NULL;
+	}
+
+	sv_freeWorldSectors = node->children[0];
+	sv_numFreeWorldSectors--;
+
+	node->children[0] = NULL;
+	node->halfSize    = parent->halfSize * 0.5f;
+	node->depth       = parent->depth + 1;
+	node->parent      = parent;
+
+	for (i = 0; i < 3; i++)
+	{
+		node->center[i] = parent->center[i] + ((index & (1 << i)) ? node->halfSize : -node->halfSize);
+	}
+
+	parent->children[index] = node;
+	return node;
+}
+
+/**
+ * @brief Finds the node an entity box belongs to, creating the missing ones on the way
+ * @param[in] absmin
+ * @param[in] absmax
  * @return
  */
-worldSector_t *SV_CreateworldSector(int depth, vec3_t mins, vec3_t maxs)
+static worldSector_t *SV_WorldSectorForBox(const vec3_t absmin, const vec3_t absmax)
 {
-	worldSector_t *anode = &sv_worldSectors[sv_numworldSectors];
-	vec3_t        size;
-	vec3_t        mins1, maxs1, mins2, maxs2;
+	worldSector_t *node = sv_worldSectors, *child;
+	vec3_t        center;
+	float         radius = 0;
+	int           i, index;
 
-	sv_numworldSectors++;
+	// make sure a whole branch can be created
+	if (sv_numFreeWorldSectors < AREA_DEPTH)
+	{
+		SV_PruneWorldSector(sv_worldSectors);
+	}
 
-	if (depth == AREA_DEPTH)
+	for (i = 0; i < 3; i++)
 	{
-		anode->axis        = -1;
-		anode->children[0] = anode->children[1] = NULL;
-		return anode;
+		center[i] = 0.5f * (absmin[i] + absmax[i]);
+		radius    = MAX(radius, 0.5f * (absmax[i] - absmin[i]));
+
+		// outside of the world, only the root takes it
+		if (center[i] < node->center[i] - node->halfSize || center[i] > node->center[i] + node->halfSize)
+		{
+			return node;
+		}
 	}
 
-	VectorSubtract(maxs, mins, size);
-	if (size[0] > size[1])
+	// descend while the box fits into the loose bounds of the child holding its center
+	while (node->depth < AREA_DEPTH && radius <= node->halfSize * 0.5f)
 	{
-		anode->axis = 0;
+		index = 0;
+		for (i = 0; i < 3; i++)
+		{
+			if (center[i] > node->center[i])
+			{
+				index |= 1 << i;
+			}
+		}
+
+		child = node->children[index];
+		if (!child)
+		{
+			child = SV_CreateWorldSector(node, index);
+			if (!child)
+			{
+				break;
+			}
+		}
+		node = child;
 	}
-	else
+
+	return node;
+}
+
+/**
+ * @brief Prints the nodes and entities on each level of the tree
+ * @param[in] node
+ * @param[in,out] nodes
+ * @param[in,out] entities
+ * @param[in,out] most
+ */
+static void SV_SectorList_r(worldSector_t *node, int *nodes, int *entities, int *most)
+{
+	svEntity_t *ent;
+	int        i, c = 0;
+
+	for (ent = node->entities ; ent ; ent = ent->nextEntityInWorldSector)
 	{
-		anode->axis = 1;
+		c++;
 	}
 
-	anode->dist = 0.5f * (maxs[anode->axis] + mins[anode->axis]);
-	VectorCopy(mins, mins1);
-	VectorCopy(mins, mins2);
-	VectorCopy(maxs, maxs1);
-	VectorCopy(maxs, maxs2);
+	nodes[node->depth]++;
+	entities[node->depth] += c;
+	most[node->depth]      = MAX(most[node->depth], c);
 
-	maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
+	for (i = 0; i < 8; i++)
+	{
+		if (node->children[i])
+		{
+			SV_SectorList_r(node->children[i], nodes, entities, most);
+		}
+	}
+}
 
-	anode->children[0] = SV_CreateworldSector(depth + 1, mins2, maxs2);
-	anode->children[1] = SV_CreateworldSector(depth + 1, mins1, maxs1);
+/**
+ * @brief SV_SectorList_f
+ */
+void SV_SectorList_f(void)
+{
+	int nodes[AREA_DEPTH + 1]    = { 0 };
+	int entities[AREA_DEPTH + 1] = { 0 };
+	int most[AREA_DEPTH + 1]     = { 0 };
+	int i;
 
-	return anode;
+	SV_SectorList_r(sv_worldSectors, nodes, entities, most);
+
+	for (i = 0 ; i <= AREA_DEPTH ; i++)
+	{
+		if (nodes[i])
+		{
+			Com_Printf("depth %i: %i sectors of size %.0f, %i entities, at most %i in one sector\n",
+			           i, nodes[i], (double)(sv_worldSectors[0].halfSize * 2.0f / (1 << i)), entities[i], most[i]);
+		}
+	}
+
+	Com_Printf("%i of %i sectors in use\n", AREA_NODES - sv_numFreeWorldSectors, AREA_NODES);
 }
 
 /**
@@ -162,14 +301,27 @@ void SV_ClearWorld(void)
 {
 	clipHandle_t h;
 	vec3_t       mins, maxs;
+	int          i;
 
 	Com_Memset(sv_worldSectors, 0, sizeof(sv_worldSectors));
-	sv_numworldSectors = 0;
 
-	// get world map bounds
+	sv_freeWorldSectors    = NULL;
+	sv_numFreeWorldSectors = AREA_NODES - 1;
+	for (i = AREA_NODES - 1 ; i > 0 ; i--)
+	{
+		sv_worldSectors[i].children[0] = sv_freeWorldSectors;
+		sv_freeWorldSectors            = &sv_worldSectors[i];
+	}
+
+	// get world map bounds, the root is the cube around them
 	h = CM_InlineModel(0);
 	CM_ModelBounds(h, mins, maxs);
-	SV_CreateworldSector(0, mins, maxs);
+
+	for (i = 0 ; i < 3 ; i++)
+	{
+		sv_worldSectors[0].center[i] = 0.5f * (mins[i] + maxs[i]);
+		sv_worldSectors[0].halfSize  = MAX(sv_worldSectors[0].halfSize, 0.5f * (maxs[i] - mins[i]) + 1);
+	}
 }
 
 /**
@@ -180,7 +332,7 @@ void SV_UnlinkEntity(sharedEntity_t *gEnt)
 {
 	svEntity_t    *ent;
 	svEntity_t    *scan;
-	worldSector_t *ws;
+	worldSector_t *ws, *node;
 
 	ent = SV_SvEntityForGentity(gEnt);
 
@@ -193,6 +345,11 @@ void SV_UnlinkEntity(sharedEntity_t *gEnt)
 	}
 	ent->worldSector = NULL;
 
+	for (node = ws ; node ; node = node->parent)
+	{
+		node->numEntities--;
+	}
+
 	if (ws->entities == ent)
 	{
 		ws->entities = ent->nextEntityInWorldSector;
@@ -219,7 +376,7 @@ void SV_UnlinkEntity(sharedEntity_t *gEnt)
  */
 void SV_LinkEntity(sharedEntity_t *gEnt)
 {
-	worldSector_t *node;
+	worldSector_t *node, *ws;
 	int           leafs[MAX_TOTAL_ENT_LEAFS];
 	int           cluster;
 	int           num_leafs;
@@ -394,33 +551,19 @@ void SV_LinkEntity(sharedEntity_t *gEnt)
 
 	gEnt->r.linkcount++;
 
-	// find the first world sector node that the ent's box crosses
-	node = sv_worldSectors;
-	while (1)
-	{
-		if (node->axis == -1)
-		{
-			break;
-		}
-		if (gEnt->r.absmin[node->axis] > node->dist)
-		{
-			node = node->children[0];
-		}
-		else if (gEnt->r.absmax[node->axis] < node->dist)
-		{
-			node = node->children[1];
-		}
-		else
-		{
-			break;      // crosses the node
-		}
-	}
+	// find the world sector node that holds the ent's box
+	node = SV_WorldSectorForBox(gEnt->r.absmin, gEnt->r.absmax);
 
 	// link it in
 	ent->worldSector             = node;
 	ent->nextEntityInWorldSector = node->entities;
 	node->entities               = ent;
 
+	for (ws = node ; ws ; ws = ws->parent)
+	{
+		ws->numEntities++;
+	}
+
 	gEnt->r.linked = qtrue;
 }
 
@@ -439,8 +582,22 @@ typedef struct
 	const float *maxs;
 	int *list;
 	int count, maxcount;
+	int checked;                        ///< entity boxes tested, for sectorbench
 } areaParms_t;
 
+/**
+ * @struct sectorBench_t
+ * @brief Area queries recorded for sectorbench
+ */
+typedef struct
+{
+	vec3_t *boxes;                      ///< mins and maxs of each query
+	int numBoxes, maxBoxes;
+	qboolean recording;
+} sectorBench_t;
+
+static sectorBench_t sv_sectorBench;
+
 /**
  * @brief SV_AreaEntities_r
  * @param[in] node
@@ -450,6 +607,26 @@ void SV_AreaEntities_r(worldSector_t *node, areaParms_t *ap)
 {
 	svEntity_t     *check, *next;
 	sharedEntity_t *gcheck;
+	float          size;
+	int            i;
+
+	if (!node->numEntities)
+	{
+		return;     // nothing linked down there
+	}
+
+	// the loose bounds, anything outside the world is in the root
+	if (node->parent)
+	{
+		size = node->halfSize * 2.0f;
+		for (i = 0 ; i < 3 ; i++)
+		{
+			if (ap->mins[i] > node->center[i] + size || ap->maxs[i] < node->center[i] - size)
+			{
+				return;
+			}
+		}
+	}
 
 	for (check = node->entities  ; check ; check = next)
 	{
@@ -462,6 +639,8 @@ void SV_AreaEntities_r(worldSector_t *node, areaParms_t *ap)
 			continue;
 		}
 
+		ap->checked++;
+
 		if (gcheck->r.absmin[0] > ap->maxs[0]
 		    || gcheck->r.absmin[1] > ap->maxs[1]
 		    || gcheck->r.absmin[2] > ap->maxs[2]
@@ -482,19 +661,12 @@ void SV_AreaEntities_r(worldSector_t *node, areaParms_t *ap)
 		ap->count++;
 	}
 
-	if (node->axis == -1)
+	for (i = 0 ; i < 8 ; i++)
 	{
-		return;     // terminal node
-	}
-
-	// recurse down both sides
-	if (ap->maxs[node->axis] > node->dist)
-	{
-		SV_AreaEntities_r(node->children[0], ap);
-	}
-	if (ap->mins[node->axis] < node->dist)
-	{
-		SV_AreaEntities_r(node->children[1], ap);
+		if (node->children[i])
+		{
+			SV_AreaEntities_r(node->children[i], ap);
+		}
 	}
 }
 
@@ -510,17 +682,184 @@ int SV_AreaEntities(const vec3_t mins, const vec3_t maxs, int *entityList, int m
 {
 	areaParms_t ap;
 
+	if (sv_sectorBench.recording)
+	{
+		VectorCopy(mins, sv_sectorBench.boxes[sv_sectorBench.numBoxes * 2]);
+		VectorCopy(maxs, sv_sectorBench.boxes[sv_sectorBench.numBoxes * 2 + 1]);
+		if (++sv_sectorBench.numBoxes == sv_sectorBench.maxBoxes)
+		{
+			sv_sectorBench.recording = qfalse;
+			Com_Printf("sectorbench: recorded %i area queries\n", sv_sectorBench.numBoxes);
+		}
+	}
+
 	ap.mins     = mins;
 	ap.maxs     = maxs;
 	ap.list     = entityList;
 	ap.count    = 0;
 	ap.maxcount = maxcount;
+	ap.checked  = 0;
 
 	SV_AreaEntities_r(sv_worldSectors, &ap);
 
 	return ap.count;
 }
 
+/**
+ * @brief Same as SV_AreaEntities, but tests every linked entity
+ * @param[in,out] ap
+ */
+static void SV_AreaEntitiesLinear(areaParms_t *ap)
+{
+	sharedEntity_t *gcheck;
+	int            i;
+
+	for (i = 0 ; i < sv.num_entities ; i++)
+	{
+		if (!sv.svEntities[i].worldSector)
+		{
+			continue;
+		}
+
+		gcheck = SV_GentityNum(i);
+		if (!gcheck->r.linked)
+		{
+			continue;
+		}
+
+		ap->checked++;
+
+		if (gcheck->r.absmin[0] > ap->maxs[0]
+		    || gcheck->r.absmin[1] > ap->maxs[1]
+		    || gcheck->r.absmin[2] > ap->maxs[2]
+		    || gcheck->r.absmax[0] < ap->mins[0]
+		    || gcheck->r.absmax[1] < ap->mins[1]
+		    || gcheck->r.absmax[2] < ap->mins[2])
+		{
+			continue;
+		}
+
+		if (ap->count < ap->maxcount)
+		{
+			ap->list[ap->count++] = i;
+		}
+	}
+}
+
+/**
+ * @brief Records the area queries of a running game and replays them against the sector tree
+ *
+ * "sectorbench record <count>" records the next area queries the game and the traces make,
+ * "sectorbench [passes]" replays them against the entities linked at that moment and compares
+ * with testing every entity.
+ */
+void SV_SectorBench_f(void)
+{
+	static int  tree[MAX_GENTITIES], linear[MAX_GENTITIES];
+	areaParms_t ap;
+	int         i, j, k, passes, start, treeMsec, linearMsec;
+	int         treeChecked = 0, linearChecked = 0, found = 0, mismatches = 0;
+
+	if (Cmd_Argc() > 1 && !Q_stricmp(Cmd_Argv(1), "record"))
+	{
+		if (sv_sectorBench.boxes)
+		{
+			Z_Free(sv_sectorBench.boxes);
+		}
+
+		sv_sectorBench.maxBoxes  = Cmd_Argc() > 2 ? MAX(atoi(Cmd_Argv(2)), 1) : 100000;
+		sv_sectorBench.boxes     = (vec3_t *)Z_Malloc(sv_sectorBench.maxBoxes * 2 * sizeof(vec3_t));
+		sv_sectorBench.numBoxes  = 0;
+		sv_sectorBench.recording = qtrue;
+		Com_Printf("sectorbench: recording the next %i area queries\n", sv_sectorBench.maxBoxes);
+		return;
+	}
+
+	if (sv.state != SS_GAME || !sv_sectorBench.numBoxes)
+	{
+		Com_Printf("usage: sectorbench record [count], then sectorbench [passes] while the map is still running\n");
+		return;
+	}
+
+	sv_sectorBench.recording = qfalse;
+	passes                   = Cmd_Argc() > 1 ? MAX(atoi(Cmd_Argv(1)), 1) : 10;
+
+	ap.list     = tree;
+	ap.maxcount = MAX_GENTITIES;
+
+	start = Sys_Milliseconds();
+	for (k = 0 ; k < passes ; k++)
+	{
+		for (i = 0 ; i < sv_sectorBench.numBoxes ; i++)
+		{
+			ap.mins    = sv_sectorBench.boxes[i * 2];
+			ap.maxs    = sv_sectorBench.boxes[i * 2 + 1];
+			ap.count   = 0;
+			ap.checked = 0;
+			SV_AreaEntities_r(sv_worldSectors, &ap);
+			treeChecked += ap.checked;
+		}
+	}
+	treeMsec = Sys_Milliseconds() - start;
+
+	ap.list = linear;
+
+	start = Sys_Milliseconds();
+	for (k = 0 ; k < passes ; k++)
+	{
+		for (i = 0 ; i < sv_sectorBench.numBoxes ; i++)
+		{
+			ap.mins    = sv_sectorBench.boxes[i * 2];
+			ap.maxs    = sv_sectorBench.boxes[i * 2 + 1];
+			ap.count   = 0;
+			ap.checked = 0;
+			SV_AreaEntitiesLinear(&ap);
+			linearChecked += ap.checked;
+		}
+	}
+	linearMsec = Sys_Milliseconds() - start;
+
+	// both must find the same entities, in any order
+	for (i = 0 ; i < sv_sectorBench.numBoxes ; i++)
+	{
+		int treeCount, linearCount;
+
+		treeCount   = SV_AreaEntities(sv_sectorBench.boxes[i * 2], sv_sectorBench.boxes[i * 2 + 1], tree, MAX_GENTITIES);
+		ap.mins     = sv_sectorBench.boxes[i * 2];
+		ap.maxs     = sv_sectorBench.boxes[i * 2 + 1];
+		ap.count    = 0;
+		SV_AreaEntitiesLinear(&ap);
+		linearCount = ap.count;
+		found      += treeCount;
+
+		for (j = 0 ; j < linearCount && treeCount == linearCount ; j++)
+		{
+			for (k = 0 ; k < treeCount && tree[k] != linear[j] ; k++)
+			{
+			}
+			if (k == treeCount)
+			{
+				break;
+			}
+		}
+		if (treeCount != linearCount || j != linearCount)
+		{
+			mismatches++;
+		}
+	}
+
+	Com_Printf("%i queries x %i passes, %.1f entities found per query\n",
+	           sv_sectorBench.numBoxes, passes, (double)found / sv_sectorBench.numBoxes);
+	Com_Printf("sector tree: %i msec, %.1f entity boxes tested per query\n",
+	           treeMsec, (double)treeChecked / (sv_sectorBench.numBoxes * passes));
+	Com_Printf("linear scan: %i msec, %.1f entity boxes tested per query\n",
+	           linearMsec, (double)linearChecked / (sv_sectorBench.numBoxes * passes));
+	if (mismatches)
+	{
+		Com_Printf(S_COLOR_YELLOW "WARNING: %i queries found different entities\n", mismatches);
+	}
+}
+
 //===========================================================================
 
 typedef struct
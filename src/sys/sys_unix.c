@@ -372,6 +372,146 @@ FILE *Sys_FOpen(const char *ospath, const char *mode)
 	return fp;
 }
 
+/**
+ * @brief Maps a whole file read-only into memory
+ * @param[in] ospath The file path to map
+ * @param[out] length Size of the view
+ * @return The view or NULL if the file can't be mapped
+ *
+ * @note The file must not be truncated while it is mapped.
+ */
+void *Sys_MapFile(const char *ospath, int *length)
+{
+	struct stat stat_info;
+	void        *data;
+	int         fd;
+
+	if ((fd = open(ospath, O_RDONLY)) == -1)
+	{
+		return NULL;
+	}
+
+	if (fstat(fd, &stat_info) == -1 || !S_ISREG(stat_info.st_mode) || stat_info.st_size <= 0 || stat_info.st_size > 0x7fffffff)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	data = mmap(NULL, (size_t)stat_info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping keeps the file open
+
+	if (data == MAP_FAILED)
+	{
+		Com_Printf("Sys_MapFile: mmap('%s') failed: errno %d\n", ospath, errno);
+		return NULL;
+	}
+
+	*length = (int)stat_info.st_size;
+	return data;
+}
+
+/**
+ * @brief Releases a view returned by Sys_MapFile
+ * @param[in] data
+ * @param[in] length
+ */
+void Sys_UnmapFile(void *data, int length)
+{
+	munmap(data, (size_t)length);
+}
+
+/**
+ * @struct sysSharedFile_s
+ * @brief A file opened once for reads at any offset
+ *
+ * Reads go through pread rather than a mapping: if the file gets truncated
+ * or rewritten in place while it is open, a mapping faults with SIGBUS,
+ * pread just comes up short.
+ */
+struct sysSharedFile_s
+{
+	int fd;
+	int length;                         ///< at open time
+};
+
+/**
+ * @brief Opens a file for Sys_ReadSharedFile
+ * @param[in] ospath
+ * @param[out] length
+ * @return The file or NULL if it can't be opened
+ */
+sysSharedFile_t *Sys_OpenSharedFile(const char *ospath, int *length)
+{
+	struct stat     stat_info;
+	sysSharedFile_t *file;
+	int             fd;
+
+	if ((fd = open(ospath, O_RDONLY)) == -1)
+	{
+		return NULL;
+	}
+
+	if (fstat(fd, &stat_info) == -1 || !S_ISREG(stat_info.st_mode) || stat_info.st_size <= 0 || stat_info.st_size > 0x7fffffff)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	file         = (sysSharedFile_t *)Z_Malloc(sizeof(*file));
+	file->fd     = fd;
+	file->length = (int)stat_info.st_size;
+
+	*length = file->length;
+	return file;
+}
+
+/**
+ * @brief Reads a range of a file opened by Sys_OpenSharedFile
+ * @param[in] file
+ * @param[in] offset
+ * @param[out] buffer
+ * @param[in] length
+ * @return Bytes read, less than length if the file ended early, -1 on errors
+ */
+int Sys_ReadSharedFile(sysSharedFile_t *file, int offset, void *buffer, int length)
+{
+	int     total = 0;
+	ssize_t count;
+
+	while (total < length)
+	{
+		count = pread(file->fd, (byte *)buffer + total, (size_t)(length - total), (off_t)offset + total);
+
+		if (count < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return total ? total : -1;
+		}
+
+		if (count == 0)
+		{
+			break;
+		}
+
+		total += (int)count;
+	}
+
+	return total;
+}
+
+/**
+ * @brief Closes a file opened by Sys_OpenSharedFile
+ * @param[in] file
+ */
+void Sys_CloseSharedFile(sysSharedFile_t *file)
+{
+	close(file->fd);
+	Z_Free(file);
+}
+
 /**
  * @brief Create directory
  * @param[in] path Path
@@ -345,6 +345,135 @@ FILE *Sys_FOpen(const char *ospath, const char *mode)
 	return _wfopen(w_ospath, w_mode);
 }
 
+/**
+ * @brief Maps a whole file read-only into memory
+ * @param[in] ospath
+ * @param[out] length
+ * @return The view or NULL if the file can't be mapped
+ */
+void *Sys_MapFile(const char *ospath, int *length)
+{
+	size_t        pathLength;
+	wchar_t       w_ospath[MAX_OSPATH];
+	HANDLE        file, mapping;
+	LARGE_INTEGER size;
+	void          *data = NULL;
+
+	// same restriction as Sys_FOpen
+	pathLength = strlen(ospath);
+	if (pathLength == 0 || ospath[pathLength - 1] == ' ' || ospath[pathLength - 1] == '.')
+	{
+		return NULL;
+	}
+
+	Sys_StringToWideCharArray(ospath, w_ospath, MAX_OSPATH);
+
+	file = CreateFileW(w_ospath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return NULL;
+	}
+
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && size.QuadPart <= 0x7fffffff)
+	{
+		mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping)
+		{
+			data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping); // the view keeps the mapping alive
+		}
+	}
+
+	CloseHandle(file);
+
+	if (data)
+	{
+		*length = (int)size.QuadPart;
+	}
+
+	return data;
+}
+
+/**
+ * @brief Releases a view returned by Sys_MapFile
+ * @param[in] data
+ * @param[in] length
+ */
+void Sys_UnmapFile(void *data, int length)
+{
+	UnmapViewOfFile(data);
+}
+
+/**
+ * @struct sysSharedFile_s
+ * @brief A file opened once for reads at any offset
+ *
+ * Windows refuses to truncate or overwrite a file while a view of it is
+ * mapped, so the reads are copies out of a Sys_MapFile view.
+ */
+struct sysSharedFile_s
+{
+	byte *data;
+	int length;
+};
+
+/**
+ * @brief Opens a file for Sys_ReadSharedFile
+ * @param[in] ospath
+ * @param[out] length
+ * @return The file or NULL if it can't be opened
+ */
+sysSharedFile_t *Sys_OpenSharedFile(const char *ospath, int *length)
+{
+	sysSharedFile_t *file;
+	byte            *data;
+	int             dataLength;
+
+	data = (byte *)Sys_MapFile(ospath, &dataLength);
+	if (!data)
+	{
+		return NULL;
+	}
+
+	file         = (sysSharedFile_t *)Z_Malloc(sizeof(*file));
+	file->data   = data;
+	file->length = dataLength;
+
+	*length = dataLength;
+	return file;
+}
+
+/**
+ * @brief Reads a range of a file opened by Sys_OpenSharedFile
+ * @param[in] file
+ * @param[in] offset
+ * @param[out] buffer
+ * @param[in] length
+ * @return Bytes read, less than length if the file ends early
+ */
+int Sys_ReadSharedFile(sysSharedFile_t *file, int offset, void *buffer, int length)
+{
+	if (offset < 0 || offset >= file->length)
+	{
+		return 0;
+	}
+
+	length = MIN(length, file->length - offset);
+	Com_Memcpy(buffer, file->data + offset, length);
+
+	return length;
+}
+
+/**
+ * @brief Closes a file opened by Sys_OpenSharedFile
+ * @param[in] file
+ */
+void Sys_CloseSharedFile(sysSharedFile_t *file)
+{
+	Sys_UnmapFile(file->data, file->length);
+	Z_Free(file);
+}
+
 /**
  * @brief Sys_Mkdir
  * @param[in] path